@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+
+set -o errexit -o pipefail -o nounset
+
+# Runs every route request file without and with memoized edge costs
+# (thor.edge_cost_memo) and diffs the trips. Each config is run by one long
+# lived actor (the python bindings) so the memo is shared by all the requests.
+# Every request is run without a time and at a few departure and arrival times
+# so tables of different speed times are filled side by side, and the memoized
+# run routes everything twice so the second round is answered from the memo.
+# All the rounds must give the same trips.
+
+function usage() {
+	echo "Usage: $0 conf [requests_dir=../test_requests]"
+	echo "Example: $0 ~/valhalla.json"
+	echo "Example: $0 ~/valhalla.json ../test_requests"
+	echo "Needs the python bindings (-DENABLE_PYTHON_BINDINGS=On) built in ../build"
+	exit 1
+}
+
+if [ -z "${1:-}" ] || [ ! -f "${1}" ]; then
+	usage
+fi
+readonly CONF="${1}"
+readonly REQUESTS="${2:-../test_requests}"
+readonly OUTDIR="results/$(date +%Y%m%d_%H%M%S)_edge_cost_memo"
+mkdir --parent "${OUTDIR}"
+
+# Configs with the memo disabled and enabled
+readonly TMP_DIR="$(mktemp -d)"
+trap 'rm -rf "${TMP_DIR}"' EXIT
+for memo in false true; do
+	python3 -c "import json,sys; c=json.load(open(sys.argv[1])); c.setdefault('thor', {})['edge_cost_memo']=(sys.argv[2]=='true'); json.dump(c, open(sys.argv[3], 'w'), indent=2)" \
+		"${CONF}" "${memo}" "${TMP_DIR}/memo_${memo}.json"
+done
+
+# Route all the requests with one actor: run_routes conf rounds outprefix
+function run_routes() {
+	PYTHONPATH=../build/src/bindings/python:${PYTHONPATH:-} python3 - "$@" "${REQUESTS}" <<'EOF'
+import json, os, shlex, sys
+import valhalla
+
+conf, rounds, prefix, requests_dir = sys.argv[1], int(sys.argv[2]), sys.argv[3], sys.argv[4]
+
+# Without time, departing on a weekday morning and evening and arriving on a weekend night
+times = [None, (1, '2020-01-08T08:00'), (1, '2020-01-08T17:30'), (2, '2020-01-11T02:15')]
+
+requests = []
+for root, _, files in sorted(os.walk(requests_dir)):
+  for name in sorted(f for f in files if f.endswith('.txt')):
+    for line in open(os.path.join(root, name)):
+      args = shlex.split(line)
+      if '-j' not in args:
+        continue
+      request = json.loads(args[args.index('-j') + 1])
+      for time in times:
+        request.pop('date_time', None)
+        if time:
+          request['date_time'] = {'type': time[0], 'value': time[1]}
+        requests.append(json.dumps(request))
+
+valhalla.Configure(conf)
+actor = valhalla.Actor()
+for r in range(rounds):
+  with open('%s_%d.txt' % (prefix, r), 'w') as out:
+    for request in requests:
+      try:
+        trip = json.loads(actor.Route(request))['trip']
+        result = {'summary': trip['summary'], 'shapes': [leg['shape'] for leg in trip['legs']]}
+      except Exception as e:
+        result = {'error': str(e)}
+      out.write(request + '\n' + json.dumps(result, sort_keys=True) + '\n')
+EOF
+}
+
+echo -e "\x1b[32;1mRouting the requests of ${REQUESTS} without the memo\x1b[0m"
+run_routes "${TMP_DIR}/memo_false.json" 1 "${OUTDIR}/uncached"
+echo -e "\x1b[32;1mRouting the requests of ${REQUESTS} twice with the memo\x1b[0m"
+run_routes "${TMP_DIR}/memo_true.json" 2 "${OUTDIR}/cached"
+
+DIFFS=0
+for round in 0 1; do
+	if ! diff -q "${OUTDIR}/uncached_0.txt" "${OUTDIR}/cached_${round}.txt"; then
+		DIFFS=$((DIFFS + 1))
+	fi
+done
+
+if [ ${DIFFS} -ne 0 ]; then
+	echo -e "\x1b[31;1m${DIFFS} memoized rounds differ, see ${OUTDIR}\x1b[0m"
+	exit 1
+fi
+echo -e "\x1b[32;1mNo differences with memoized edge costs\x1b[0m"
@@ -0,0 +1,92 @@
+#include "baldr/edgecostmemo.h"
+
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Marks entries without a stored cost. Both halves are a NaN which costs never are.
+constexpr uint64_t kEmptyEntry = std::numeric_limits<uint64_t>::max();
+
+uint32_t to_bits(const float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float from_bits(const uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+EdgeCostTable::EdgeCostTable(const uint32_t count) : entries_(new std::atomic<uint64_t>[count]) {
+  for (uint32_t i = 0; i < count; ++i) {
+    entries_[i].store(kEmptyEntry, std::memory_order_relaxed);
+  }
+}
+
+bool EdgeCostTable::get(const uint32_t idx, float& cost, float& secs) const {
+  const uint64_t entry = entries_[idx].load(std::memory_order_relaxed);
+  if (entry == kEmptyEntry) {
+    return false;
+  }
+  cost = from_bits(static_cast<uint32_t>(entry));
+  secs = from_bits(static_cast<uint32_t>(entry >> 32));
+  return true;
+}
+
+void EdgeCostTable::set(const uint32_t idx, const float cost, const float secs) {
+  const uint64_t entry = static_cast<uint64_t>(to_bits(cost)) |
+                         (static_cast<uint64_t>(to_bits(secs)) << 32);
+  entries_[idx].store(entry, std::memory_order_relaxed);
+}
+
+std::shared_ptr<EdgeCostTable>
+EdgeCostMemo::table(const uint64_t profile, const uint32_t time_key, const uint32_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : tables_) {
+    if (entry.profile == profile && entry.time_key == time_key) {
+      return entry.table;
+    }
+  }
+
+  // Add a new table, replacing the oldest one once the memo is full. The tables of
+  // a tile all have the same size.
+  Entry entry{profile, time_key, std::make_shared<EdgeCostTable>(count)};
+  if (tables_.size() < kMaxEdgeCostTables) {
+    tables_.emplace_back(std::move(entry));
+    memory_.set(tables_.size() * count * sizeof(uint64_t));
+    return tables_.back().table;
+  }
+  tables_[oldest_] = std::move(entry);
+  auto table = tables_[oldest_].table;
+  oldest_ = (oldest_ + 1) % kMaxEdgeCostTables;
+  return table;
+}
+
+void EdgeCostMemo::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tables_.clear();
+  oldest_ = 0;
+  memory_.set(0);
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+void EdgeCostMemo::attach(const std::shared_ptr<std::atomic<size_t>>& counter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memory_.attach(counter);
+}
+
+size_t EdgeCostMemo::memory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memory_.bytes();
+}
+
+} // namespace baldr
+} // namespace valhalla
@@ -74,7 +74,9 @@ GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
 // ----------------------------------------------------------------------------
 
 // Constructor.
-SimpleTileCache::SimpleTileCache(size_t max_size) : cache_size_(0), max_cache_size_(max_size) {
+SimpleTileCache::SimpleTileCache(size_t max_size)
+    : cache_size_(0), tile_data_size_(std::make_shared<std::atomic<size_t>>(0)),
+      max_cache_size_(max_size) {
 }
 
 // Reserves enough cache to hold (max_cache_size / tile_size) items.
@@ -87,9 +89,10 @@ bool SimpleTileCache::Contains(const GraphId& graphid) const {
   return cache_.find(graphid) != cache_.end();
 }
 
-// Lets you know if the cache is too large.
+// Lets you know if the cache is too large. Data built by the tiles after they
+// were loaded counts too.
 bool SimpleTileCache::OverCommitted() const {
-  return cache_size_ > max_cache_size_;
+  return cache_size_ + *tile_data_size_ > max_cache_size_;
 }
 
 // Clears the cache.
@@ -110,7 +113,9 @@ const GraphTile* SimpleTileCache::Get(const GraphId& graphid) const {
 // Puts a copy of a tile of into the cache.
 const GraphTile* SimpleTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size) {
   cache_size_ += size;
-  return &cache_.emplace(graphid, tile).first->second;
+  const GraphTile* cached = &cache_.emplace(graphid, tile).first->second;
+  cached->AttachCacheMemory(tile_data_size_);
+  return cached;
 }
 
 void SimpleTileCache::Trim() {
@@ -123,7 +128,8 @@ void SimpleTileCache::Trim() {
 
 // Constructor.
 TileCacheLRU::TileCacheLRU(size_t max_size, MemoryLimitControl mem_control)
-    : cache_size_(0), max_cache_size_(max_size), mem_control_(mem_control) {
+    : cache_size_(0), tile_data_size_(std::make_shared<std::atomic<size_t>>(0)),
+      max_cache_size_(max_size), mem_control_(mem_control) {
 }
 
 void TileCacheLRU::Reserve(size_t tile_size) {
@@ -138,7 +144,7 @@ bool TileCacheLRU::Contains(const GraphId& graphid) const {
 }
 
 bool TileCacheLRU::OverCommitted() const {
-  return cache_size_ > max_cache_size_;
+  return cache_size_ + *tile_data_size_ > max_cache_size_;
 }
 
 void TileCacheLRU::Clear() {
@@ -165,7 +171,9 @@ const GraphTile* TileCacheLRU::Get(const GraphId& graphid) const {
 
 size_t TileCacheLRU::TrimToFit(const size_t required_size) {
   size_t freed_space = 0;
-  while ((OverCommitted() || (max_cache_size_ - cache_size_) < required_size) &&
+  // Evicted tiles release the data they built once no copy of them is left
+  while ((OverCommitted() ||
+          (max_cache_size_ - cache_size_ - *tile_data_size_) < required_size) &&
          !key_val_lru_list_.empty()) {
     const KeyValue& entry_to_evict = key_val_lru_list_.back();
     const auto tile_size = entry_to_evict.tile.header()->end_offset();
@@ -220,7 +228,9 @@ TileCacheLRU::Put(const GraphId& graphid, const GraphTile& tile, size_t new_tile
   }
   cache_size_ += new_tile_size;
 
-  return &key_val_lru_list_.front().tile;
+  const GraphTile* cached_tile = &key_val_lru_list_.front().tile;
+  cached_tile->AttachCacheMemory(tile_data_size_);
+  return cached_tile;
 }
 
 // ----------------------------------------------------------------------------
@@ -315,7 +325,7 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt)
                                                pt.get<std::string>("user_agent", ""))),
       tile_url_(pt.get<std::string>("tile_url", "")),
       tile_url_gz_(pt.get<bool>("tile_url_gz", false)),
-      cache_(TileCacheFactory::createTileCache(pt)) {
+      cache_(TileCacheFactory::createTileCache(pt)), tile_lookups_(0), tile_cache_misses_(0) {
   // validate tile url
   if (!tile_url_.empty() && tile_url_.find(GraphTile::kTilePathPattern) == std::string::npos)
     throw std::runtime_error("Not found tilePath pattern in tile url");
@@ -376,10 +386,12 @@ const GraphTile* GraphReader::GetGraphTile(const GraphId& graphid) {
 
   // Check if the level/tileid combination is in the cache
   auto base = graphid.Tile_Base();
+  tile_lookups_++;
   if (auto cached = cache_->Get(base)) {
     // LOG_DEBUG("Memory cache hit " + GraphTile::FileSuffix(base));
     return cached;
   }
+  tile_cache_misses_++;
 
   // Try getting it from the memmapped tar extract
   if (!tile_extract_->tiles.empty()) {
@@ -626,6 +638,12 @@ std::vector<GraphId> GraphReader::RecoverShortcut(const GraphId& shortcut_id) {
     return {shortcut_id};
   }
 
+  // use the edges stored by the shortcut builder if the tile has them
+  auto stored = tile->GetShortcutEdges(shortcut_id.id());
+  if (stored.size() > 0) {
+    return {stored.begin(), stored.end()};
+  }
+
   // loop over the edges leaving its begin node and find the superseded edge
   GraphId begin_node = edge_startnode(shortcut_id);
   if (!begin_node)
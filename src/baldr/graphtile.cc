@@ -8,6 +8,7 @@
 #include "midgard/pointll.h"
 #include "midgard/tiles.h"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <chrono>
@@ -317,6 +318,39 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr, const size_t
     lane_connectivity_size_ = header_->end_offset() - header_->lane_connectivity_offset();
   }
 
+  // Start of arc flags (optional). Arc flags are appended after the lane connectivity
+  // or, if predicted speeds were added first, after the predicted speed data.
+  if (header_->arcflags_offset() > 0) {
+    arcflags_ = reinterpret_cast<const uint64_t*>(tile_ptr + header_->arcflags_offset());
+    arcflag_regions_ = reinterpret_cast<const uint8_t*>(arcflags_ + header_->directededgecount());
+    if (header_->arcflags_offset() > header_->lane_connectivity_offset()) {
+      lane_connectivity_size_ = std::min(lane_connectivity_size_,
+                                         static_cast<std::size_t>(header_->arcflags_offset() -
+                                                                  header_->lane_connectivity_offset()));
+    }
+  } else {
+    arcflags_ = nullptr;
+    arcflag_regions_ = nullptr;
+  }
+
+  // Start of shortcut edges (optional). They follow the lane connectivity: a count
+  // of shortcuts, their expansions plus an end marker and the superseded edges.
+  if (header_->shortcut_edges_offset() > 0) {
+    const char* ptr1 = tile_ptr + header_->shortcut_edges_offset();
+    shortcut_expansion_count_ = static_cast<uint32_t>(*reinterpret_cast<const uint64_t*>(ptr1));
+    shortcut_expansions_ = reinterpret_cast<const ShortcutExpansion*>(ptr1 + sizeof(uint64_t));
+    shortcut_edges_ =
+        reinterpret_cast<const GraphId*>(shortcut_expansions_ + shortcut_expansion_count_ + 1);
+    lane_connectivity_size_ =
+        std::min(lane_connectivity_size_,
+                 static_cast<std::size_t>(header_->shortcut_edges_offset() -
+                                          header_->lane_connectivity_offset()));
+  } else {
+    shortcut_expansion_count_ = 0;
+    shortcut_expansions_ = nullptr;
+    shortcut_edges_ = nullptr;
+  }
+
   // For reference - how to use the end offset to set size of an object (that
   // is not fixed size and count).
   // example_size_ = header_->end_offset() - header_->example_offset();
@@ -745,85 +779,54 @@ std::vector<LaneConnectivity> GraphTile::GetLaneConnectivity(const uint32_t idx)
   return lcs;
 }
 
-// Get the next departure given the directed line Id and the current
-// time (seconds from midnight).
-const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
-                                                    const uint32_t current_time,
-                                                    const uint32_t day,
-                                                    const uint32_t dow,
-                                                    bool date_before_tile,
-                                                    bool wheelchair,
-                                                    bool bicycle) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
-    return nullptr;
+// Get the edges superseded by a shortcut edge.
+iterable_t<const GraphId> GraphTile::GetShortcutEdges(const uint32_t idx) const {
+  auto end = shortcut_expansions_ + shortcut_expansion_count_;
+  auto found = std::lower_bound(shortcut_expansions_, end, ShortcutExpansion(idx, 0));
+  if (found == end || found->shortcut() != idx) {
+    return iterable_t<const GraphId>{shortcut_edges_, shortcut_edges_};
   }
+  return iterable_t<const GraphId>{shortcut_edges_ + found->offset(),
+                                   (found + 1)->offset() - found->offset()};
+}
 
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count - 1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    // matching lineid and a workable time
-    if (lineid == dep.lineid() &&
-        ((current_time <= dep.departure_time() && dep.type() == kFixedSchedule) ||
-         (current_time <= dep.end_time() && dep.type() == kFrequencySchedule))) {
-      found = mid;
-      high = mid - 1;
-    } // need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    } // either need a bigger lineid or a later time
-    else {
-      low = mid + 1;
-    }
-  }
-
-  // Iterate through departures until one is found with valid date, dow or
-  // calendar date, and does not have a calendar exception.
-  for (; found < count && departures_[found].lineid() == lineid; ++found) {
-    // Make sure valid departure time
-    if (departures_[found].type() == kFixedSchedule) {
-      if (departures_[found].departure_time() >= current_time &&
-          GetTransitSchedule(departures_[found].schedule_index())
-              ->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
-        return &departures_[found];
-      }
-    } else {
-      uint32_t departure_time = departures_[found].departure_time();
-      uint32_t end_time = departures_[found].end_time();
-      uint32_t frequency = departures_[found].frequency();
-      while (departure_time < current_time && departure_time < end_time) {
-        departure_time += frequency;
-      }
-
-      if (departure_time >= current_time && departure_time < end_time &&
-          GetTransitSchedule(departures_[found].schedule_index())
-              ->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
+// Get the departures running on a service day, building the index if needed.
+std::shared_ptr<const TransitServiceDay>
+GraphTile::GetServiceDay(const uint32_t day, const uint32_t dow, bool date_before_tile) const {
+  const auto runs_today = [&](const TransitDeparture& departure) {
+    return GetTransitSchedule(departure.schedule_index())->IsValid(day, dow, date_before_tile);
+  };
+  return service_days_->service_day(day, dow, date_before_tile, [&]() {
+    return std::make_shared<const TransitServiceDay>(departures_, header_->departurecount(),
+                                                     runs_today);
+  });
+}
 
-        const auto& d = departures_[found];
-        const TransitDeparture* dep =
-            new TransitDeparture(d.lineid(), d.tripid(), d.routeid(), d.blockid(),
-                                 d.headsign_offset(), departure_time, d.end_time(), d.frequency(),
-                                 d.elapsed_time(), d.schedule_index(), d.wheelchair_accessible(),
-                                 d.bicycle_accessible());
-        return dep;
-      }
-    }
+// Get the next departure given the directed line Id and the current
+// time (seconds from midnight).
+boost::optional<TransitDeparture> GraphTile::GetNextDeparture(const uint32_t lineid,
+                                                              const uint32_t current_time,
+                                                              const uint32_t day,
+                                                              const uint32_t dow,
+                                                              bool date_before_tile,
+                                                              bool wheelchair,
+                                                              bool bicycle) const {
+  if (header_->departurecount() == 0) {
+    return boost::none;
   }
 
-  // TODO - maybe wrap around, try next day?
-  LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
-            " current_time = " + std::to_string(current_time));
-  return nullptr;
+  // Binary search the departures of the line running that day. Hold the index
+  // while copying the departure, another thread may drop it from the tile.
+  const auto service_day = GetServiceDay(day, dow, date_before_tile);
+  const TransitDeparture* departure =
+      service_day->GetNextDeparture(lineid, current_time, wheelchair, bicycle);
+  if (departure == nullptr) {
+    // TODO - maybe wrap around, try next day?
+    LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
+              " current_time = " + std::to_string(current_time));
+    return boost::none;
+  }
+  return *departure;
 }
 
 // Get the departure given the line Id and tripid
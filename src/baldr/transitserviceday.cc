@@ -0,0 +1,119 @@
+#include "baldr/transitserviceday.h"
+
+#include <algorithm>
+
+namespace valhalla {
+namespace baldr {
+
+TransitServiceDay::TransitServiceDay(
+    const TransitDeparture* departures,
+    const uint32_t count,
+    const std::function<bool(const TransitDeparture&)>& runs_today)
+    : departures_of_tile_(departures) {
+  for (uint32_t i = 0; i < count; ++i) {
+    const TransitDeparture& d = departures[i];
+    if (!runs_today(d)) {
+      continue;
+    }
+
+    // Departures are sorted by line Id, a new line starts a new range
+    if (lineids_.empty() || lineids_.back() != d.lineid()) {
+      lineids_.push_back(d.lineid());
+      offsets_.push_back(departures_.size());
+    }
+    if (d.type() == kFixedSchedule) {
+      departures_.push_back(
+          {d.departure_time(), i, 0, d.wheelchair_accessible(), d.bicycle_accessible()});
+      continue;
+    }
+
+    // One departure per run of a frequency based departure
+    uint32_t departure_time = d.departure_time();
+    do {
+      departures_.push_back({departure_time, static_cast<uint32_t>(runs_.size()), 1,
+                             d.wheelchair_accessible(), d.bicycle_accessible()});
+      runs_.emplace_back(d.lineid(), d.tripid(), d.routeid(), d.blockid(), d.headsign_offset(),
+                         departure_time, d.end_time(), d.frequency(), d.elapsed_time(),
+                         d.schedule_index(), d.wheelchair_accessible(), d.bicycle_accessible());
+      departure_time += d.frequency();
+    } while (d.frequency() > 0 && departure_time < d.end_time());
+  }
+  offsets_.push_back(departures_.size());
+
+  // Sort the departures of each line by time, runs interleave the fixed departures
+  for (size_t i = 0; i < lineids_.size(); ++i) {
+    std::stable_sort(departures_.begin() + offsets_[i], departures_.begin() + offsets_[i + 1],
+                     [](const Departure& a, const Departure& b) {
+                       return a.departure_time < b.departure_time;
+                     });
+  }
+}
+
+const TransitDeparture* TransitServiceDay::GetNextDeparture(const uint32_t lineid,
+                                                            const uint32_t current_time,
+                                                            const bool wheelchair,
+                                                            const bool bicycle) const {
+  auto line = std::lower_bound(lineids_.begin(), lineids_.end(), lineid);
+  if (line == lineids_.end() || *line != lineid) {
+    return nullptr;
+  }
+  const size_t l = line - lineids_.begin();
+  const auto end = departures_.begin() + offsets_[l + 1];
+  auto departure = std::lower_bound(departures_.begin() + offsets_[l], end, current_time,
+                                    [](const Departure& d, const uint32_t time) {
+                                      return d.departure_time < time;
+                                    });
+  for (; departure != end; ++departure) {
+    if ((!wheelchair || departure->wheelchair_accessible) &&
+        (!bicycle || departure->bicycle_accessible)) {
+      return departure->run ? &runs_[departure->index] : &departures_of_tile_[departure->index];
+    }
+  }
+  return nullptr;
+}
+
+size_t TransitServiceDay::memory() const {
+  return sizeof(*this) + (lineids_.capacity() + offsets_.capacity()) * sizeof(uint32_t) +
+         departures_.capacity() * sizeof(Departure) + runs_.capacity() * sizeof(TransitDeparture);
+}
+
+std::shared_ptr<const TransitServiceDay> TransitServiceDays::service_day(
+    const uint32_t day,
+    const uint32_t dow,
+    const bool date_before_tile,
+    const std::function<std::shared_ptr<const TransitServiceDay>()>& build) {
+  const uint64_t key = date_before_tile
+                           ? (static_cast<uint64_t>(1) << 40) | dow
+                           : (static_cast<uint64_t>(day) << 8) | dow;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : days_) {
+    if (entry.key == key) {
+      return entry.index;
+    }
+  }
+
+  // Add a new index, replacing the oldest one once full
+  Entry entry{key, build()};
+  std::shared_ptr<const TransitServiceDay> index = entry.index;
+  if (days_.size() < kMaxTransitServiceDays) {
+    days_.emplace_back(std::move(entry));
+  } else {
+    days_[oldest_] = std::move(entry);
+    oldest_ = (oldest_ + 1) % kMaxTransitServiceDays;
+  }
+
+  size_t bytes = 0;
+  for (const auto& day : days_) {
+    bytes += day.index->memory();
+  }
+  memory_.set(bytes);
+  return index;
+}
+
+void TransitServiceDays::attach(const std::shared_ptr<std::atomic<size_t>>& counter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memory_.attach(counter);
+}
+
+} // namespace baldr
+} // namespace valhalla
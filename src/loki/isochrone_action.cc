@@ -37,6 +37,7 @@ namespace valhalla {
 namespace loki {
 
 void loki_worker_t::init_isochrones(Api& request) {
+  parse_timeout(request);
   auto& options = *request.mutable_options();
 
   // strip off unused information
@@ -92,5 +93,25 @@ void loki_worker_t::isochrones(Api& request) {
   } catch (const std::exception&) { throw valhalla_exception_t{171}; }
 }
 
+void loki_worker_t::batch_isochrones(Api& request) {
+  init_isochrones(request);
+  auto& options = *request.mutable_options();
+  // each location is a separate origin so only their number is limited
+  if (options.locations_size() > max_batch_locations) {
+    throw valhalla_exception_t{150, std::to_string(max_batch_locations)};
+  };
+
+  // correlate the various locations to the underlying graph. origins that can
+  // not be correlated are left without edges and reported in their own result
+  auto locations = PathLocation::fromPBF(options.locations());
+  const auto projections = loki::Search(locations, *reader, costing.get());
+  for (size_t i = 0; i < locations.size(); ++i) {
+    const auto projection = projections.find(locations[i]);
+    if (projection != projections.cend()) {
+      PathLocation::toPBF(projection->second, options.mutable_locations(i), *reader);
+    }
+  }
+}
+
 } // namespace loki
 } // namespace valhalla
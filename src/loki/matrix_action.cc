@@ -48,11 +48,22 @@ namespace valhalla {
 namespace loki {
 
 void loki_worker_t::init_matrix(Api& request) {
+  parse_timeout(request);
   // we require sources and targets
   auto& options = *request.mutable_options();
   if (options.action() == Options::sources_to_targets) {
     parse_locations(options.mutable_sources(), valhalla_exception_t{112});
     parse_locations(options.mutable_targets(), valhalla_exception_t{112});
+  } // optimized routes has vehicles and jobs at the locations and needs a matrix between all of them
+  else if (options.action() == Options::optimized_routes) {
+    parse_locations(options.mutable_locations(), valhalla_exception_t{112});
+    if (options.vehicles_size() < 1) {
+      throw valhalla_exception_t{115};
+    }
+
+    // create new sources and targets from locations
+    options.mutable_targets()->CopyFrom(options.locations());
+    options.mutable_sources()->CopyFrom(options.locations());
   } // optimized route uses locations but needs to do a matrix
   else {
     parse_locations(options.mutable_locations(), valhalla_exception_t{112});
@@ -46,6 +46,7 @@ namespace valhalla {
 namespace loki {
 
 void loki_worker_t::init_route(Api& request) {
+  parse_timeout(request);
   parse_locations(request.mutable_options()->mutable_locations());
   // need to check location size here instead of in parse_locations because of locate action needing
   // a different size
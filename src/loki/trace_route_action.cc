@@ -113,6 +113,7 @@ namespace valhalla {
 namespace loki {
 
 void loki_worker_t::init_trace(Api& request) {
+  parse_timeout(request);
   parse_costing(request);
   auto& options = *request.mutable_options();
 
@@ -1,4 +1,5 @@
 #include <boost/property_tree/ptree.hpp>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <sstream>
@@ -134,6 +135,27 @@ void loki_worker_t::parse_costing(Api& api) {
     options.set_alternates(max_alternates);
 }
 
+void loki_worker_t::parse_timeout(Api& api) {
+  auto& options = *api.mutable_options();
+  // The request can only shorten the maximum, without a maximum only those asking get a deadline
+  uint32_t timeout = options.timeout();
+  if (max_timeout > 0 && (timeout == 0 || timeout > max_timeout)) {
+    timeout = max_timeout;
+  }
+  if (timeout == 0) {
+    options.clear_timeout();
+    options.clear_deadline();
+  } else {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+    options.set_timeout(timeout);
+    options.set_deadline(now.count() + timeout);
+  }
+
+  // The rest of the pipeline enforces the deadline as does loki from here on
+  set_deadline(api);
+}
+
 loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
     : config(config), reader(graph_reader),
@@ -143,6 +165,7 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
       long_request(config.get<float>("loki.logging.long_request")),
       max_contours(config.get<size_t>("service_limits.isochrone.max_contours")),
       max_time(config.get<size_t>("service_limits.isochrone.max_time")),
+      max_batch_locations(config.get<size_t>("service_limits.isochrone.max_batch_locations", 1000)),
       max_trace_shape(config.get<size_t>("service_limits.trace.max_shape")),
       sample(config.get<std::string>("additional_data.elevation", "test/data/")),
       max_elevation_shape(config.get<size_t>("service_limits.skadi.max_shape")),
@@ -169,7 +192,8 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   for (const auto& kv : config.get_child("service_limits")) {
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" ||
-        kv.first == "max_alternates") {
+        kv.first == "max_alternates" || kv.first == "max_timeout" ||
+        kv.first == "max_search_memory") {
       continue;
     }
     if (kv.first != "skadi" && kv.first != "trace") {
@@ -224,6 +248,8 @@ loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config,
   max_best_paths = config.get<unsigned int>("service_limits.trace.max_best_paths");
   max_best_paths_shape = config.get<size_t>("service_limits.trace.max_best_paths_shape");
   max_alternates = config.get<unsigned int>("service_limits.max_alternates");
+  max_timeout =
+      static_cast<uint32_t>(config.get<float>("service_limits.max_timeout", 0.f) * 1000.f + .5f);
 
   // Register standard edge/node costing methods
   factory.RegisterStandardCostingModels();
@@ -275,6 +301,7 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         break;
       case Options::sources_to_targets:
       case Options::optimized_route:
+      case Options::optimized_routes:
         matrix(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
@@ -282,6 +309,10 @@ loki_worker_t::work(const std::list<zmq::message_t>& job,
         isochrones(request);
         result.messages.emplace_back(request.SerializeAsString());
         break;
+      case Options::batch_isochrone:
+        batch_isochrones(request);
+        result.messages.emplace_back(request.SerializeAsString());
+        break;
       case Options::trace_attributes:
       case Options::trace_route:
         trace(request);
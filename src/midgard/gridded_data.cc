@@ -8,7 +8,28 @@
 
 #include <algorithm>
 #include <cmath>
+#include <exception>
+#include <memory>
 #include <sstream>
+#include <thread>
+
+namespace {
+
+// Rows of the grid in a band of contour generation. Bands do not depend on the
+// number of threads so neither do the contours.
+constexpr int kBandRows = 32;
+
+// Contours go through the points of the grid identified by a tile and one of
+// these slots: its base corner, a point on its bottom or left side, its center
+// or a point on one of the diagonals from its center to its 4 corners.
+constexpr size_t kCorner = 0;
+constexpr size_t kBottomSide = 1;
+constexpr size_t kLeftSide = 2;
+constexpr size_t kCenter = 3;
+constexpr size_t kDiagonal = 4;
+constexpr size_t kSlotCount = 8;
+
+} // namespace
 
 namespace valhalla {
 namespace midgard {
@@ -19,44 +40,60 @@ GriddedData<coord_t>::GriddedData(const AABB2<coord_t>& bounds,
                                   const float tilesize,
                                   const float value)
     : Tiles<coord_t>(bounds, tilesize), max_value_(value) {
-  // Resize the data vector and fill with the value
-  data_.resize(this->nrows_ * this->ncolumns_);
-  std::fill(data_.begin(), data_.end(), value);
+  // Blocks are allocated when a tile within them is set
+  block_columns_ = (this->ncolumns_ + kGridBlockSize - 1) / kGridBlockSize;
+  blocks_.resize(block_columns_ * ((this->nrows_ + kGridBlockSize - 1) / kGridBlockSize));
 }
 
-// Generate contour lines from the isotile data.
-// contours is an ordered list of contour interval values
+// Generate the contour lines crossing a band of rows.
 // Derivation from the C code version of CONREC by Paul Bourke:
 // http://paulbourke.net/papers/conrec/
 template <class coord_t>
-typename GriddedData<coord_t>::contours_t
-GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_intervals,
-                                       const bool rings_only,
-                                       const float denoise,
-                                       const float generalize) const {
-  // TODO: sort and validate contour range
-
+void GriddedData<coord_t>::GenerateBandContours(
+    const std::vector<float>& contour_intervals,
+    const std::vector<bool>& crossed,
+    const int first_row,
+    const int last_row,
+    std::vector<std::vector<band_line_t>>& lines) const {
   // Values at tile corners and center (0 element is center)
   int sh[5];
   typename coord_t::first_type s[5]; // Values at the tile corners and center
   coord_t tile_corners[5];           // coord_t at tile corners and center
+  size_t corner_keys[5];             // Keys of the tile corners and center
+  size_t side_keys[4];               // Keys of the points on the sides of the tile
 
-  // Find the intersection along a tile edge
-  auto intersect = [&tile_corners, &s](int p1, int p2) {
+  // Find the intersection along a tile edge and its key. Tile sides are shared
+  // with the neighboring tiles, the diagonals to the center are not
+  int tileid;
+  auto intersect = [&](int p1, int p2, coord_t& pt, size_t& key) {
     auto ds = s[p2] - s[p1];
-    return coord_t((s[p2] * tile_corners[p1].x() - s[p1] * tile_corners[p2].x()) / ds,
-                   (s[p2] * tile_corners[p1].y() - s[p1] * tile_corners[p2].y()) / ds);
+    pt = coord_t((s[p2] * tile_corners[p1].x() - s[p1] * tile_corners[p2].x()) / ds,
+                 (s[p2] * tile_corners[p1].y() - s[p1] * tile_corners[p2].y()) / ds);
+    if (p1 == 0 || p2 == 0) {
+      key = tileid * kSlotCount + kDiagonal + p1 + p2 - 1;
+    } else {
+      key = side_keys[std::abs(p1 - p2) == 3 ? 3 : std::min(p1, p2) - 1];
+    }
   };
 
-  // we need something to hold each iso-line, bigger ones first
-  contours_t contours([](float a, float b) { return a > b; });
-  for (auto v : contour_intervals) {
-    contours[v].emplace_back();
-  }
-  // and something to find them quickly
-  using contour_lookup_t = std::unordered_map<coord_t, typename feature_t::iterator>;
-  std::unordered_map<float, contour_lookup_t> lookup(contour_intervals.size());
-  // TODO: preallocate the lookups for each interval
+  // Index of the line ending at each point of the current and next row of
+  // tiles, for each contour. Points of the previous rows can not be reached
+  // anymore so the rows alternate between 2 halves of the lookup. It is only
+  // allocated once a tile of the band has contours.
+  int row;
+  const size_t row_size = this->ncolumns_ * kSlotCount;
+  std::vector<std::vector<int32_t>> lookup;
+  auto find = [this, &row, row_size](std::vector<int32_t>& table, size_t key) -> int32_t* {
+    auto tile = key / kSlotCount;
+    int key_row = tile / this->ncolumns_;
+    if (key_row < row) {
+      return nullptr;
+    }
+    return &table[(key_row & 1) * row_size + (tile % this->ncolumns_) * kSlotCount +
+                   key % kSlotCount];
+  };
+  lines.assign(contour_intervals.size(), {});
+  bool used[2] = {false, false};
 
   int tile_inc[4] = {0, 1, this->ncolumns_ + 1, this->ncolumns_};
   int case_value;
@@ -64,23 +101,50 @@ GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_interva
                              {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
                              {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}}};
 
-  // For each cell, skipping the outer rim since its out of bounds
-  for (int row = 1; row < this->nrows_ - 1; ++row) {
+  for (row = first_row; row < last_row; ++row) {
+    // The half of the lookup for the next row was used by the previous row,
+    // if it had any tiles with contours
+    if (used[(row + 1) & 1]) {
+      for (auto& ends : lookup) {
+        auto next = ends.begin() + ((row + 1) & 1) * row_size;
+        std::fill(next, next + row_size, -1);
+      }
+      used[(row + 1) & 1] = false;
+    }
+
     for (int col = 1; col < this->ncolumns_ - 1; ++col) {
-      int tileid = this->TileId(col, row);
-      auto cell1 = data_[tileid];
-      auto cell2 = data_[tileid + this->ncolumns_];     // TileId(col,   row+1)];
-      auto cell3 = data_[tileid + 1];                   // TileId(col+1, row)];
-      auto cell4 = data_[tileid + this->ncolumns_ + 1]; // TileId(col+1, row+1)];
-      auto dmin = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
-      auto dmax = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
+      // Skip to the next block if no contour line can cross this one
+      if (!crossed[(row / kGridBlockSize) * block_columns_ + col / kGridBlockSize]) {
+        col = (col / kGridBlockSize + 1) * kGridBlockSize - 1;
+        continue;
+      }
+
+      tileid = this->TileId(col, row);
+      // Values at the tile corners, in the order of tile_inc
+      float cells[4] = {Get(col, row), Get(col + 1, row), Get(col + 1, row + 1), Get(col, row + 1)};
+      auto dmin = *std::min_element(cells, cells + 4);
+      auto dmax = *std::max_element(cells, cells + 4);
 
       // Continue if outside the range of contour values
       if (dmax < contour_intervals.front() || dmin > contour_intervals.back()) {
         continue;
       }
+      if (lookup.empty()) {
+        lookup.assign(contour_intervals.size(), std::vector<int32_t>(2 * row_size, -1));
+      }
+      used[0] = used[1] = true;
+
+      corner_keys[0] = tileid * kSlotCount + kCenter;
+      for (int m = 1; m <= 4; m++) {
+        corner_keys[m] = (tileid + tile_inc[m - 1]) * kSlotCount + kCorner;
+      }
+      side_keys[0] = tileid * kSlotCount + kBottomSide;
+      side_keys[1] = (tileid + 1) * kSlotCount + kLeftSide;
+      side_keys[2] = (tileid + this->ncolumns_) * kSlotCount + kBottomSide;
+      side_keys[3] = tileid * kSlotCount + kLeftSide;
 
-      for (auto contour : contour_intervals) {
+      for (size_t i = 0; i < contour_intervals.size(); ++i) {
+        auto contour = contour_intervals[i];
         if (contour < dmin || contour > dmax) {
           continue;
         }
@@ -91,7 +155,7 @@ GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_interva
             // (messes up the intersect method). Set a value slightly above
             // the contour (e.g. 1 minute higher).
             // TODO - the value 1 is a bit of a hack.
-            s[m] = (data_[newtileid] < max_value_) ? data_[newtileid] - contour : 1.0f;
+            s[m] = (cells[m - 1] < max_value_) ? cells[m - 1] - contour : 1.0f;
             tile_corners[m] = this->Base(newtileid);
           } else {
             s[0] = 0.25 * (s[1] + s[2] + s[3] + s[4]);
@@ -132,6 +196,9 @@ GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_interva
 
         // Scan each triangle in the box
         coord_t pt1, pt2;
+        size_t key1 = 0, key2 = 0;
+        auto& band_lines = lines[i];
+        auto& ends = lookup[i];
         for (int m = 1; m <= 4; m++) {
           int m1 = m;
           int m2 = 0;
@@ -143,126 +210,315 @@ GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_interva
           switch (case_value) {
             case 1: // Line between vertices 1 and 2
               pt1 = tile_corners[m1];
+              key1 = corner_keys[m1];
               pt2 = tile_corners[m2];
+              key2 = corner_keys[m2];
               break;
             case 2: // Line between vertices 2 and 3
               pt1 = tile_corners[m2];
+              key1 = corner_keys[m2];
               pt2 = tile_corners[m3];
+              key2 = corner_keys[m3];
               break;
             case 3: // Line between vertices 3 and 1
               pt1 = tile_corners[m3];
+              key1 = corner_keys[m3];
               pt2 = tile_corners[m1];
+              key2 = corner_keys[m1];
               break;
             case 4: // Line between vertex 1 and side 2-3
               pt1 = tile_corners[m1];
-              pt2 = intersect(m2, m3);
+              key1 = corner_keys[m1];
+              intersect(m2, m3, pt2, key2);
               break;
             case 5: // Line between vertex 2 and side 3-1
               pt1 = tile_corners[m2];
-              pt2 = intersect(m3, m1);
+              key1 = corner_keys[m2];
+              intersect(m3, m1, pt2, key2);
               break;
             case 6: // Line between vertex 3 and side 1-2
               pt1 = tile_corners[m3];
-              pt2 = intersect(m1, m2);
+              key1 = corner_keys[m3];
+              intersect(m1, m2, pt2, key2);
               break;
             case 7: // Line between sides 1-2 and 2-3
-              pt1 = intersect(m1, m2);
-              pt2 = intersect(m2, m3);
+              intersect(m1, m2, pt1, key1);
+              intersect(m2, m3, pt2, key2);
               break;
             case 8: // Line between sides 2-3 and 3-1
-              pt1 = intersect(m2, m3);
-              pt2 = intersect(m3, m1);
+              intersect(m2, m3, pt1, key1);
+              intersect(m3, m1, pt2, key2);
               break;
             case 9: // Line between sides 3-1 and 1-2
-              pt1 = intersect(m3, m1);
-              pt2 = intersect(m1, m2);
+              intersect(m3, m1, pt1, key1);
+              intersect(m1, m2, pt2, key2);
               break;
             default:
               break;
           }
 
-          // this isnt a segment..
-          if (pt1 == pt2) {
+          // this isnt a segment.. but intersections close to a vertex can round
+          // to the same point, which still connects the lines at both keys
+          bool point = pt1 == pt2;
+          if (point && key1 == key2) {
             continue;
           }
 
           // see if we have anything to connect this segment to
-          typename contour_lookup_t::iterator rec_a = lookup[contour].find(pt1);
-          typename contour_lookup_t::iterator rec_b = lookup[contour].find(pt2);
-          if (rec_b != lookup[contour].end()) {
+          int32_t* rec_a = find(ends, key1);
+          int32_t* rec_b = find(ends, key2);
+          if (*rec_b >= 0) {
             std::swap(pt1, pt2);
+            std::swap(key1, key2);
             std::swap(rec_a, rec_b);
           }
 
           // we want to merge two records
-          if (rec_b != lookup[contour].end()) {
-            // get the segments in question and remove their lookup info
-            auto segment_a = rec_a->second;
-            bool head_a = rec_a->first == segment_a->front();
-            auto segment_b = rec_b->second;
-            bool head_b = rec_b->first == segment_b->front();
-            lookup[contour].erase(rec_a);
-            lookup[contour].erase(rec_b);
-
-            // this segment is now a ring
-            if (segment_a == segment_b) {
-              segment_a->push_back(segment_a->front());
+          if (*rec_b >= 0) {
+            // get the lines in question and remove their lookup info
+            auto a = *rec_a;
+            auto b = *rec_b;
+            *rec_a = -1;
+            *rec_b = -1;
+
+            // this line is now a ring
+            if (a == b) {
+              if (!point) {
+                band_lines[a].line.push_back(band_lines[a].line.front());
+              }
+              band_lines[a].ring = true;
               continue;
             }
 
-            // erase the other lookups
-            lookup[contour].erase(lookup[contour].find(
-                pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
-            lookup[contour].erase(lookup[contour].find(
-                pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
-
-            // add b to a
-            if (!head_a && head_b) {
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            } // add a to b
-            else if (!head_b && head_a) {
-              segment_b->splice(segment_b->end(), *segment_a);
-              contours[contour].front().erase(segment_a);
-              segment_a = segment_b;
-            } // flip a and add b
-            else if (head_a && head_b) {
-              segment_a->reverse();
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            } // flip b and add to a
-            else if (!head_a && !head_b) {
-              segment_b->reverse();
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
+            // add a to b rather than flipping both
+            bool head_a = band_lines[a].front == key1;
+            bool head_b = band_lines[b].front == key2;
+            if (head_a && !head_b) {
+              std::swap(a, b);
+              head_a = false;
+              head_b = true;
+            }
+            auto& line_a = band_lines[a];
+            auto& line_b = band_lines[b];
+            if (head_a) {
+              line_a.line.reverse();
+              std::swap(line_a.front, line_a.back);
             }
+            if (!head_b) {
+              line_b.line.reverse();
+              std::swap(line_b.front, line_b.back);
+            }
+            if (point) {
+              line_a.line.pop_back();
+            }
+            line_a.line.splice(line_a.line.end(), line_b.line);
+            line_a.back = line_b.back;
 
-            // update the look up
-            lookup[contour].emplace(segment_a->front(), segment_a);
-            lookup[contour].emplace(segment_a->back(), segment_a);
+            // update the look up, the end of b may be in a row we are done with
+            auto* rec = find(ends, line_a.back);
+            if (rec != nullptr) {
+              *rec = a;
+            }
           } // ap/prepend to an existing one
-          else if (rec_a != lookup[contour].end()) {
+          else if (*rec_a >= 0) {
+            auto& line = band_lines[*rec_a];
             // it goes on the front
-            if (rec_a->second->front() == pt1) {
-              rec_a->second->push_front(pt2);
+            if (line.front == key1) {
+              if (!point) {
+                line.line.push_front(pt2);
+              }
+              line.front = key2;
               // it goes on the back
             } else {
-              rec_a->second->push_back(pt2);
+              if (!point) {
+                line.line.push_back(pt2);
+              }
+              line.back = key2;
             }
 
             // update the lookup table
-            lookup[contour].emplace(pt2, rec_a->second);
-            lookup[contour].erase(rec_a);
+            *rec_b = *rec_a;
+            *rec_a = -1;
           } // this is an orphan segment for now
           else {
-            contours[contour].front().push_front(contour_t{pt1, pt2});
-            lookup[contour].emplace(pt1, contours[contour].front().begin());
-            lookup[contour].emplace(pt2, contours[contour].front().begin());
+            band_lines.push_back({point ? contour_t{pt1} : contour_t{pt1, pt2}, key1, key2, false});
+            *rec_a = band_lines.size() - 1;
+            *rec_b = band_lines.size() - 1;
           }
         }
       } // Each contour
     }   // Each tile col
   }     // Each tile row
+}
+
+// Generate contour lines from the isotile data.
+// contours is an ordered list of contour interval values
+template <class coord_t>
+typename GriddedData<coord_t>::contours_t
+GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_intervals,
+                                       const bool rings_only,
+                                       const float denoise,
+                                       const float generalize,
+                                       const uint32_t threads) const {
+  // TODO: sort and validate contour range
+
+  // we need something to hold each iso-line, bigger ones first
+  contours_t contours([](float a, float b) { return a > b; });
+  for (auto v : contour_intervals) {
+    contours[v].emplace_back();
+  }
+
+  // Split the rows into bands, skipping the outer rim since its out of bounds
+  std::vector<std::pair<int, int>> bands;
+  for (int row = 1; row < this->nrows_ - 1; row += kBandRows) {
+    bands.emplace_back(row, std::min(row + kBandRows, this->nrows_ - 1));
+  }
+
+  // Find the blocks whose tiles a contour line can cross. The corners of the
+  // tiles of a block are within it or the blocks above and to the right of it.
+  std::vector<std::pair<float, float>> ranges(blocks_.size(), {max_value_, max_value_});
+  for (size_t i = 0; i < blocks_.size(); ++i) {
+    if (!blocks_[i].empty()) {
+      const auto minmax = std::minmax_element(blocks_[i].begin(), blocks_[i].end());
+      ranges[i] = {*minmax.first, *minmax.second};
+    }
+  }
+  const int32_t block_rows = blocks_.size() / block_columns_;
+  std::vector<bool> crossed(blocks_.size(), false);
+  for (int32_t block_row = 0; block_row < block_rows; ++block_row) {
+    for (int32_t block_col = 0; block_col < block_columns_; ++block_col) {
+      auto range = ranges[block_row * block_columns_ + block_col];
+      for (int32_t r = block_row; r <= std::min(block_row + 1, block_rows - 1); ++r) {
+        for (int32_t c = block_col; c <= std::min(block_col + 1, block_columns_ - 1); ++c) {
+          range.first = std::min(range.first, ranges[r * block_columns_ + c].first);
+          range.second = std::max(range.second, ranges[r * block_columns_ + c].second);
+        }
+      }
+      crossed[block_row * block_columns_ + block_col] =
+          std::any_of(contour_intervals.begin(), contour_intervals.end(), [&range](float contour) {
+            return contour >= range.first && contour <= range.second;
+          });
+    }
+  }
+
+  // Generate the lines of each band
+  std::vector<std::vector<std::vector<band_line_t>>> band_lines(bands.size());
+  uint32_t thread_count = std::max(1u, std::min(threads, static_cast<uint32_t>(bands.size())));
+  std::vector<std::exception_ptr> errors(thread_count);
+  auto work = [&](const uint32_t thread) {
+    try {
+      for (uint32_t i = thread; i < bands.size(); i += thread_count) {
+        GenerateBandContours(contour_intervals, crossed, bands[i].first, bands[i].second,
+                             band_lines[i]);
+      }
+    } catch (...) { errors[thread] = std::current_exception(); }
+  };
+  std::vector<std::shared_ptr<std::thread>> workers(thread_count - 1);
+  for (uint32_t i = 1; i < thread_count; ++i) {
+    workers[i - 1].reset(new std::thread(work, i));
+  }
+  work(0);
+  for (auto& worker : workers) {
+    worker->join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Only the corners and bottom sides of the first row of a band are shared
+  // with the band below it
+  const size_t boundary_size = this->ncolumns_ * 2;
+  auto boundary = [this, boundary_size](std::vector<int32_t>& table, size_t key) -> int32_t* {
+    auto tile = key / kSlotCount;
+    auto slot = key % kSlotCount;
+    int row = tile / this->ncolumns_;
+    if (slot > kBottomSide || (row - 1) % kBandRows != 0) {
+      return nullptr;
+    }
+    return &table[((row - 1) / kBandRows) * boundary_size + (tile % this->ncolumns_) * 2 + slot];
+  };
+
+  // Append line b to line a where they share the point key
+  auto join = [](band_line_t& a, band_line_t& b, size_t key) {
+    if (a.front == key) {
+      a.line.reverse();
+      std::swap(a.front, a.back);
+    }
+    if (b.back == key) {
+      b.line.reverse();
+      std::swap(b.front, b.back);
+    }
+    a.line.pop_back();
+    a.line.splice(a.line.end(), b.line);
+    a.back = b.back;
+  };
+
+  // Join the lines across the bands in band order so that the contours do not
+  // depend on the number of threads
+  for (size_t i = 0; i < contour_intervals.size(); ++i) {
+    std::vector<band_line_t> joined;
+    std::vector<int32_t> lookup((bands.size() + 1) * boundary_size, -1);
+    for (auto& lines : band_lines) {
+      for (auto& line : lines[i]) {
+        if (line.line.empty()) {
+          continue;
+        }
+        int32_t* rec_a = line.ring ? nullptr : boundary(lookup, line.front);
+        int32_t* rec_b = line.ring ? nullptr : boundary(lookup, line.back);
+        if ((rec_a == nullptr || *rec_a < 0) && rec_b != nullptr && *rec_b >= 0) {
+          line.line.reverse();
+          std::swap(line.front, line.back);
+          std::swap(rec_a, rec_b);
+        }
+
+        // a line of its own for now
+        if (rec_a == nullptr || *rec_a < 0) {
+          joined.emplace_back(std::move(line));
+          if (rec_a != nullptr) {
+            *rec_a = joined.size() - 1;
+          }
+          if (rec_b != nullptr) {
+            *rec_b = joined.size() - 1;
+          }
+          continue;
+        }
+
+        // continue the line ending at its front
+        auto a = *rec_a;
+        *rec_a = -1;
+        join(joined[a], line, line.front);
+        if (rec_b == nullptr) {
+          continue;
+        }
+        if (*rec_b < 0) {
+          *rec_b = a;
+          continue;
+        }
+
+        // it also continues a line at its back, which may be the same line
+        auto b = *rec_b;
+        *rec_b = -1;
+        if (a == b) {
+          joined[a].ring = true;
+          continue;
+        }
+        join(joined[a], joined[b], joined[a].back);
+        auto* rec = boundary(lookup, joined[a].back);
+        if (rec != nullptr && *rec >= 0) {
+          *rec = a;
+        }
+      }
+    }
+
+    auto& feature = contours[contour_intervals[i]].front();
+    for (auto& line : joined) {
+      if (line.line.size() > 1) {
+        feature.push_front(std::move(line.line));
+      }
+    }
+  }
 
   // If the generalization value equals kOptimalGeneralization then set
   // the generalization factor to 1/4 of the grid size
@@ -0,0 +1,671 @@
+#include "mjolnir/arcflagsbuilder.h"
+#include "mjolnir/graphtilebuilder.h"
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "baldr/arcflags.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphid.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "midgard/pointll.h"
+#include "sif/autocost.h"
+#include "sif/costfactory.h"
+#include "sif/edgelabel.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+constexpr float kNotAllowed = -1.0f;
+
+// Tolerance when deciding if an edge is on a shortest path (costs are floats)
+constexpr float kCostEpsilon = 0.001f;
+
+// Node used to partition the graph into regions
+struct RegionPoint {
+  PointLL ll;
+  uint32_t weight;
+};
+
+// Regions are formed by cutting the graph along the longer axis recursively. Each cell
+// is either cut in two at a value of one coordinate or is a region.
+struct Partition {
+  struct Cell {
+    bool split_x;
+    float value;
+    uint32_t left;
+    uint32_t right;
+    uint8_t region;
+  };
+  std::vector<Cell> cells;
+
+  uint8_t region(const PointLL& ll) const {
+    if (cells.empty()) {
+      return kNoArcFlagRegion;
+    }
+    uint32_t c = 0;
+    while (cells[c].region == kNoArcFlagRegion) {
+      c = ((cells[c].split_x ? ll.lng() : ll.lat()) < cells[c].value) ? cells[c].left
+                                                                       : cells[c].right;
+    }
+    return cells[c].region;
+  }
+};
+
+// Compact copy of the highway and arterial levels. Nodes and edges are indexed
+// globally: the index of a node (edge) is the offset of its tile plus its index
+// within the tile. Nodes copied onto both levels are linked by transitions. The
+// local edges leaving or entering the copies of the nodes on the local level are
+// added after the edges of the tiles, so routes joining and leaving the arterial
+// levels turn as they do in the path algorithms.
+struct Graph {
+  std::vector<GraphId> tiles;
+  std::unordered_map<uint32_t, uint32_t> node_offsets;
+  std::unordered_map<uint32_t, uint32_t> edge_offsets;
+  uint32_t tile_edges;
+
+  // Per node
+  std::vector<uint32_t> edge_index;
+  std::vector<uint32_t> edge_count;
+  std::vector<PointLL> ll;
+  std::vector<uint8_t> region;
+
+  // Per edge
+  std::vector<uint32_t> begin_node;
+  std::vector<uint32_t> end_node;
+  std::vector<float> cost;
+
+  // Turns from an edge onto the next edge with their transition costs, by edge
+  // leaving (turn_begin) and by edge entering (in_turn_begin, in_turns)
+  std::vector<uint32_t> turn_begin;
+  std::vector<uint32_t> turn_from;
+  std::vector<uint32_t> turn_to;
+  std::vector<float> turn_cost;
+  std::vector<bool> turn_destonly;
+  std::vector<uint32_t> in_turn_begin;
+  std::vector<uint32_t> in_turns;
+
+  uint32_t node(const GraphId& id) const {
+    auto offset = node_offsets.find(id.tile_value());
+    return offset == node_offsets.end() ? kInvalidIndex : offset->second + id.id();
+  }
+
+  uint32_t edge(const GraphId& id) const {
+    auto offset = edge_offsets.find(id.tile_value());
+    return offset == edge_offsets.end() ? kInvalidIndex : offset->second + id.id();
+  }
+};
+
+// A turn before it is sorted into the turn lists of the graph
+struct Turn {
+  uint32_t from;
+  uint32_t to;
+  float cost;
+  bool destonly;
+};
+
+// Recursively bisect the nodes along the longer axis, balancing the number of edges
+// on each side, until the requested number of regions is formed. Returns the cell.
+uint32_t Bisect(std::vector<RegionPoint>::iterator begin,
+                std::vector<RegionPoint>::iterator end,
+                const uint32_t count,
+                uint8_t& next_region,
+                Partition& partition) {
+  uint32_t cell = partition.cells.size();
+  partition.cells.push_back({false, 0.0f, 0, 0, kNoArcFlagRegion});
+  if (count <= 1 || std::distance(begin, end) <= 1) {
+    partition.cells[cell].region = next_region++;
+    return cell;
+  }
+
+  // Split along the longer extent
+  float minx = 180.0f, maxx = -180.0f, miny = 90.0f, maxy = -90.0f;
+  uint64_t total = 0;
+  for (auto p = begin; p != end; ++p) {
+    minx = std::min(minx, p->ll.lng());
+    maxx = std::max(maxx, p->ll.lng());
+    miny = std::min(miny, p->ll.lat());
+    maxy = std::max(maxy, p->ll.lat());
+    total += p->weight;
+  }
+  bool split_x = (maxx - minx) >= (maxy - miny);
+  auto coord = [split_x](const RegionPoint& p) { return split_x ? p.ll.lng() : p.ll.lat(); };
+  std::sort(begin, end, [&coord](const RegionPoint& a, const RegionPoint& b) {
+    return coord(a) < coord(b);
+  });
+
+  // Find the split so that each side gets weight proportional to its region count
+  uint32_t left_count = count / 2;
+  uint64_t target = (total * left_count) / count;
+  uint64_t sum = 0;
+  auto mid = begin;
+  while (mid != end - 1 && sum + mid->weight <= target) {
+    sum += mid->weight;
+    ++mid;
+  }
+  if (mid == begin) {
+    ++mid;
+  }
+  float value = (coord(*(mid - 1)) + coord(*mid)) * 0.5f;
+  uint32_t left = Bisect(begin, mid, left_count, next_region, partition);
+  uint32_t right = Bisect(mid, end, count - left_count, next_region, partition);
+  partition.cells[cell] = {split_x, value, left, right, kNoArcFlagRegion};
+  return cell;
+}
+
+// Copy the nodes and edges of the highway and arterial levels into memory along with
+// the costs of the edges
+void LoadGraph(GraphReader& reader, const cost_ptr_t& costing, Graph& graph) {
+  for (uint8_t level = 0; level < kArcFlagLevels; ++level) {
+    for (const auto& id : reader.GetTileSet(level)) {
+      graph.tiles.push_back(id);
+    }
+  }
+
+  // Assign offsets for each tile
+  uint32_t node_count = 0, edge_count = 0;
+  for (const auto& id : graph.tiles) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    graph.node_offsets[id.tile_value()] = node_count;
+    graph.edge_offsets[id.tile_value()] = edge_count;
+    node_count += tile->header()->nodecount();
+    edge_count += tile->header()->directededgecount();
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  graph.tile_edges = edge_count;
+  graph.edge_index.resize(node_count);
+  graph.edge_count.resize(node_count);
+  graph.ll.resize(node_count);
+  graph.begin_node.resize(edge_count);
+  graph.end_node.resize(edge_count);
+  graph.cost.resize(edge_count);
+
+  // Copy nodes and edges
+  for (const auto& id : graph.tiles) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    uint32_t n = graph.node_offsets[id.tile_value()];
+    uint32_t e = graph.edge_offsets[id.tile_value()];
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i, ++n) {
+      const NodeInfo* nodeinfo = tile->node(i);
+      graph.edge_index[n] = e + nodeinfo->edge_index();
+      graph.edge_count[n] = nodeinfo->edge_count();
+      graph.ll[n] = nodeinfo->latlng(tile->header()->base_ll());
+
+      // Edges are only usable if the costing allows the edge and its begin node
+      const bool node_allowed = costing->Allowed(nodeinfo);
+      const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+      for (uint32_t j = 0; j < nodeinfo->edge_count(); ++j, ++directededge) {
+        uint32_t idx = graph.edge_index[n] + j;
+        graph.begin_node[idx] = n;
+        graph.end_node[idx] = graph.node(directededge->endnode());
+        graph.cost[idx] = (node_allowed && !directededge->is_shortcut() &&
+                           (directededge->forwardaccess() & costing->access_mode()))
+                              ? costing->EdgeCost(directededge, tile).cost
+                              : kNotAllowed;
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+}
+
+// Add the turns between the edges, with the access checks and transition costs of the
+// path algorithms. A search at a node also expands the edges of the copies of the node
+// on the other levels, keeping the edge it arrived on as predecessor.
+void AddTurns(GraphReader& reader, const cost_ptr_t& costing, Graph& graph) {
+  const uint8_t local_level = TileHierarchy::levels().rbegin()->first;
+  std::vector<Turn> turns;
+
+  // Local edges are added the first time they are reached
+  std::unordered_map<uint64_t, uint32_t> local_edges;
+  auto local_edge = [&](const GraphId& id, const DirectedEdge* directededge,
+                        const GraphTile* tile) {
+    auto found = local_edges.find(id.value);
+    if (found != local_edges.end()) {
+      return found->second;
+    }
+    uint32_t idx = graph.cost.size();
+    local_edges.emplace(id.value, idx);
+    graph.begin_node.push_back(kInvalidIndex);
+    graph.end_node.push_back(kInvalidIndex);
+    graph.cost.push_back(costing->EdgeCost(directededge, tile).cost);
+    return idx;
+  };
+
+  // Add the turns from an edge onto the edges leaving its end node and the copies of it
+  auto add_turns = [&](const uint32_t from, const GraphId& from_id,
+                       const DirectedEdge* from_edge, const GraphId& node,
+                       const bool to_local) {
+    const EdgeLabel pred(kInvalidIndex, from_id, from_edge, Cost(), 0.0f, 0.0f,
+                         TravelMode::kDrive, 0);
+    const GraphTile* tile = reader.GetGraphTile(node);
+    if (tile == nullptr) {
+      return;
+    }
+    std::vector<GraphId> copies{node};
+    const NodeInfo* nodeinfo = tile->node(node);
+    for (uint32_t t = 0; t < nodeinfo->transition_count(); ++t) {
+      copies.push_back(tile->transition(nodeinfo->transition_index() + t)->endnode());
+    }
+    for (const auto& copy : copies) {
+      const bool local = copy.level() == local_level;
+      const GraphTile* copy_tile = reader.GetGraphTile(copy);
+      if ((local && !to_local) || copy_tile == nullptr) {
+        continue;
+      }
+      const NodeInfo* copy_node = copy_tile->node(copy);
+      if (!costing->Allowed(copy_node)) {
+        continue;
+      }
+      GraphId edgeid(copy.tileid(), copy.level(), copy_node->edge_index());
+      const DirectedEdge* directededge = copy_tile->directededge(copy_node->edge_index());
+      for (uint32_t i = 0; i < copy_node->edge_count(); ++i, ++directededge, ++edgeid) {
+        uint32_t to;
+        if (local) {
+          if (!(directededge->forwardaccess() & costing->access_mode())) {
+            continue;
+          }
+          to = local_edge(edgeid, directededge, copy_tile);
+          graph.begin_node[to] = graph.node(node);
+        } else {
+          to = graph.edge(edgeid);
+          if (to == kInvalidIndex || graph.cost[to] == kNotAllowed) {
+            continue;
+          }
+        }
+        bool has_time_restrictions = false;
+        if (!costing->Allowed(directededge, pred, copy_tile, edgeid, 0, 0,
+                              has_time_restrictions)) {
+          continue;
+        }
+        turns.push_back({from, to, costing->TransitionCost(directededge, copy_node, pred).cost,
+                         directededge->destonly() && !pred.destonly()});
+      }
+    }
+  };
+
+  for (const auto& id : graph.tiles) {
+    // Turns from the edges of the tile, onto the arterial levels or onto local edges
+    uint32_t e = graph.edge_offsets[id.tile_value()];
+    uint32_t edge_count = reader.GetGraphTile(id)->header()->directededgecount();
+    for (uint32_t i = 0; i < edge_count; ++i) {
+      if (graph.cost[e + i] == kNotAllowed || graph.end_node[e + i] == kInvalidIndex) {
+        continue;
+      }
+      GraphId edgeid(id.tileid(), id.level(), i);
+      const GraphTile* tile = reader.GetGraphTile(id);
+      const DirectedEdge* directededge = tile->directededge(i);
+      add_turns(e + i, edgeid, directededge, directededge->endnode(), true);
+    }
+
+    // Turns from the local edges entering the copies of the nodes of the tile
+    uint32_t n = graph.node_offsets[id.tile_value()];
+    uint32_t node_count = reader.GetGraphTile(id)->header()->nodecount();
+    for (uint32_t i = 0; i < node_count; ++i) {
+      const GraphTile* tile = reader.GetGraphTile(id);
+      const NodeInfo* nodeinfo = tile->node(i);
+      std::vector<GraphId> local_copies;
+      for (uint32_t t = 0; t < nodeinfo->transition_count(); ++t) {
+        GraphId copy = tile->transition(nodeinfo->transition_index() + t)->endnode();
+        if (copy.level() == local_level) {
+          local_copies.push_back(copy);
+        }
+      }
+      for (const auto& copy : local_copies) {
+        const GraphTile* copy_tile = reader.GetGraphTile(copy);
+        if (copy_tile == nullptr) {
+          continue;
+        }
+        const NodeInfo* copy_node = copy_tile->node(copy);
+        const uint32_t copy_edge_count = copy_node->edge_count();
+        std::vector<GraphId> entering;
+        GraphId edgeid(copy.tileid(), copy.level(), copy_node->edge_index());
+        for (uint32_t j = 0; j < copy_edge_count; ++j, ++edgeid) {
+          entering.push_back(reader.GetOpposingEdgeId(edgeid));
+        }
+        for (const auto& entering_id : entering) {
+          const GraphTile* entering_tile = reader.GetGraphTile(entering_id);
+          if (!entering_id.Is_Valid() || entering_tile == nullptr) {
+            continue;
+          }
+          const DirectedEdge* entering_edge = entering_tile->directededge(entering_id);
+          if (!(entering_edge->forwardaccess() & costing->access_mode())) {
+            continue;
+          }
+          uint32_t from = local_edge(entering_id, entering_edge, entering_tile);
+          graph.end_node[from] = n + i;
+          add_turns(from, entering_id, entering_edge, copy, false);
+        }
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // Sort the turns by the edge they leave and list them by the edge they enter
+  const uint32_t edge_count = graph.cost.size();
+  std::sort(turns.begin(), turns.end(),
+            [](const Turn& a, const Turn& b) { return a.from < b.from; });
+  graph.turn_begin.assign(edge_count + 1, 0);
+  graph.in_turn_begin.assign(edge_count + 1, 0);
+  for (const auto& turn : turns) {
+    graph.turn_begin[turn.from + 1]++;
+    graph.in_turn_begin[turn.to + 1]++;
+    graph.turn_from.push_back(turn.from);
+    graph.turn_to.push_back(turn.to);
+    graph.turn_cost.push_back(turn.cost);
+    graph.turn_destonly.push_back(turn.destonly);
+  }
+  for (uint32_t idx = 0; idx < edge_count; ++idx) {
+    graph.turn_begin[idx + 1] += graph.turn_begin[idx];
+    graph.in_turn_begin[idx + 1] += graph.in_turn_begin[idx];
+  }
+  graph.in_turns.resize(turns.size());
+  std::vector<uint32_t> fill(graph.in_turn_begin.begin(), graph.in_turn_begin.end() - 1);
+  for (uint32_t t = 0; t < turns.size(); ++t) {
+    graph.in_turns[fill[graph.turn_to[t]]++] = t;
+  }
+}
+
+// A search from an edge crossing into (backward) or out of (forward) a region. The
+// backward search computes the cost of the best path starting with each edge and
+// ending with the crossing edge, an edge is then on a best path into the region if it
+// is the best next edge after some edge. The forward search is symmetric: an edge is
+// on a best path out of the region if it is the best edge before some edge. Searches
+// without destination only sets the flags for routes that can not enter destination
+// only edges.
+struct Search {
+  uint32_t edge;
+  uint8_t region;
+  bool backward;
+  bool destonly;
+};
+
+void ComputeFlags(const Graph& graph,
+                  std::vector<Search>& searches,
+                  std::vector<uint64_t>& flags,
+                  std::mutex& lock,
+                  std::promise<uint32_t>& result) {
+  const uint32_t edge_count = graph.cost.size();
+  std::vector<float> dist(edge_count, std::numeric_limits<float>::max());
+  std::vector<uint32_t> touched;
+  std::vector<uint64_t> local_flags(flags.size(), 0);
+  using queue_t = std::pair<float, uint32_t>;
+  uint32_t count = 0;
+
+  while (true) {
+    Search search;
+    lock.lock();
+    if (searches.empty()) {
+      lock.unlock();
+      break;
+    }
+    search = searches.back();
+    searches.pop_back();
+    lock.unlock();
+
+    // Reset costs from the last search
+    for (auto e : touched) {
+      dist[e] = std::numeric_limits<float>::max();
+    }
+    touched.clear();
+
+    // Dijkstra from the crossing edge
+    std::priority_queue<queue_t, std::vector<queue_t>, std::greater<queue_t>> queue;
+    dist[search.edge] = graph.cost[search.edge];
+    touched.push_back(search.edge);
+    queue.emplace(dist[search.edge], search.edge);
+    auto relax = [&](const uint32_t e, const float d) {
+      if (d < dist[e]) {
+        if (dist[e] == std::numeric_limits<float>::max()) {
+          touched.push_back(e);
+        }
+        dist[e] = d;
+        queue.emplace(d, e);
+      }
+    };
+    while (!queue.empty()) {
+      auto top = queue.top();
+      queue.pop();
+      if (top.first > dist[top.second]) {
+        continue;
+      }
+      uint32_t e = top.second;
+      if (search.backward) {
+        for (uint32_t i = graph.in_turn_begin[e]; i < graph.in_turn_begin[e + 1]; ++i) {
+          uint32_t t = graph.in_turns[i];
+          if (!search.destonly || !graph.turn_destonly[t]) {
+            uint32_t from = graph.turn_from[t];
+            relax(from, graph.cost[from] + graph.turn_cost[t] + top.first);
+          }
+        }
+      } else {
+        for (uint32_t t = graph.turn_begin[e]; t < graph.turn_begin[e + 1]; ++t) {
+          if (!search.destonly || !graph.turn_destonly[t]) {
+            uint32_t to = graph.turn_to[t];
+            relax(to, top.first + graph.turn_cost[t] + graph.cost[to]);
+          }
+        }
+      }
+    }
+
+    // Mark the edges on the best paths (including ties)
+    uint64_t flag = search.backward ? ForwardArcFlag(search.region) : ReverseArcFlag(search.region);
+    local_flags[search.edge] |= flag;
+    auto tight = [](const float through, const float best) {
+      return through <= best + kCostEpsilon * std::max(1.0f, best);
+    };
+    for (auto e : touched) {
+      if (e >= graph.tile_edges) {
+        continue;
+      }
+      if (search.backward) {
+        for (uint32_t i = graph.in_turn_begin[e]; i < graph.in_turn_begin[e + 1]; ++i) {
+          uint32_t t = graph.in_turns[i];
+          uint32_t from = graph.turn_from[t];
+          if ((!search.destonly || !graph.turn_destonly[t]) &&
+              dist[from] != std::numeric_limits<float>::max() &&
+              tight(graph.cost[from] + graph.turn_cost[t] + dist[e], dist[from])) {
+            local_flags[e] |= flag;
+            break;
+          }
+        }
+      } else {
+        for (uint32_t t = graph.turn_begin[e]; t < graph.turn_begin[e + 1]; ++t) {
+          uint32_t to = graph.turn_to[t];
+          if ((!search.destonly || !graph.turn_destonly[t]) &&
+              dist[to] != std::numeric_limits<float>::max() &&
+              tight(dist[e] + graph.turn_cost[t] + graph.cost[to], dist[to])) {
+            local_flags[e] |= flag;
+            break;
+          }
+        }
+      }
+    }
+    ++count;
+  }
+
+  // Merge into the shared flags
+  lock.lock();
+  for (size_t idx = 0; idx < flags.size(); ++idx) {
+    flags[idx] |= local_flags[idx];
+  }
+  lock.unlock();
+  result.set_value(count);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ArcFlagsBuilder::Build(const boost::property_tree::ptree& pt) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  uint32_t region_count =
+      std::min(pt.get<uint32_t>("mjolnir.arc_flag_regions", kMaxArcFlagRegions), kMaxArcFlagRegions);
+
+  // Baseline costing - default auto costing without time dependent speeds
+  Options options;
+  rapidjson::Document doc;
+  doc.SetObject();
+  auto* costing_options = options.add_costing_options();
+  ParseAutoCostOptions(doc, "/costing_options/auto", costing_options);
+  costing_options->set_flow_mask(static_cast<uint8_t>(costing_options->flow_mask()) &
+                                 ~(kPredictedFlowMask | kCurrentFlowMask));
+  CostFactory<DynamicCost> factory;
+  factory.RegisterStandardCostingModels();
+  cost_ptr_t costing = factory.Create(Costing::auto_, options);
+
+  // Load the highway and arterial levels and the turns between their edges
+  Graph graph;
+  LoadGraph(reader, costing, graph);
+  AddTurns(reader, costing, graph);
+  LOG_INFO("Loaded " + std::to_string(graph.ll.size()) + " nodes, " +
+           std::to_string(graph.cost.size()) + " edges and " +
+           std::to_string(graph.turn_to.size()) + " turns");
+
+  // Partition the nodes into regions
+  std::vector<RegionPoint> points;
+  points.reserve(graph.ll.size());
+  for (uint32_t n = 0; n < graph.ll.size(); ++n) {
+    points.push_back({graph.ll[n], graph.edge_count[n] + 1});
+  }
+  Partition partition;
+  uint8_t next_region = 0;
+  Bisect(points.begin(), points.end(), region_count, next_region, partition);
+  graph.region.resize(graph.ll.size());
+  for (uint32_t n = 0; n < graph.ll.size(); ++n) {
+    graph.region[n] = partition.region(graph.ll[n]);
+  }
+  LOG_INFO("Partitioned " + std::to_string(points.size()) + " nodes into " +
+           std::to_string(next_region) + " regions");
+
+  // Edges within a region are flagged for that region. Edges crossing into or out of
+  // a region seed the searches.
+  std::vector<uint64_t> flags(graph.tile_edges, 0);
+  std::vector<Search> searches;
+  for (uint32_t idx = 0; idx < graph.cost.size(); ++idx) {
+    uint32_t u = graph.begin_node[idx];
+    uint32_t v = graph.end_node[idx];
+    if (graph.cost[idx] == kNotAllowed || u == kInvalidIndex || v == kInvalidIndex) {
+      continue;
+    }
+    if (graph.region[u] == graph.region[v]) {
+      if (idx < graph.tile_edges) {
+        flags[idx] |= ForwardArcFlag(graph.region[u]) | ReverseArcFlag(graph.region[u]);
+      }
+      continue;
+    }
+    searches.push_back({idx, graph.region[v], true, false});
+    searches.push_back({idx, graph.region[u], false, false});
+  }
+
+  // The first pass of the bidirectional search does not enter destination only edges
+  if (std::find(graph.turn_destonly.begin(), graph.turn_destonly.end(), true) !=
+      graph.turn_destonly.end()) {
+    const size_t count = searches.size();
+    for (size_t i = 0; i < count; ++i) {
+      searches.push_back(searches[i]);
+      searches.back().destonly = true;
+    }
+  }
+
+  // Run the searches on a number of threads
+  uint32_t nthreads =
+      std::max(static_cast<uint32_t>(1),
+               pt.get<uint32_t>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  LOG_INFO("Computing arc flags from " + std::to_string(searches.size()) +
+           " crossing edge searches with " + std::to_string(nthreads) + " threads...");
+  std::vector<std::shared_ptr<std::thread>> threads(nthreads);
+  std::vector<std::promise<uint32_t>> results(nthreads);
+  std::mutex lock;
+  for (uint32_t i = 0; i < nthreads; ++i) {
+    threads[i].reset(new std::thread(ComputeFlags, std::cref(graph), std::ref(searches),
+                                     std::ref(flags), std::ref(lock), std::ref(results[i])));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  // Write the flags to the tiles. Shortcuts get the intersection of the flags of the
+  // edges they supersede. Edges the costing cannot use and edges leaving the loaded
+  // graph are never pruned.
+  for (const auto& id : graph.tiles) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    uint32_t e = graph.edge_offsets[id.tile_value()];
+    std::vector<uint64_t> tile_flags(tile->header()->directededgecount(), kAllArcFlags);
+    for (uint32_t i = 0; i < tile_flags.size(); ++i) {
+      const DirectedEdge* directededge = tile->directededge(i);
+      if (directededge->is_shortcut()) {
+        GraphId shortcut_id(id.tileid(), id.level(), i);
+        auto edges = reader.RecoverShortcut(shortcut_id);
+        if (edges.size() > 1 || edges.front() != shortcut_id) {
+          for (const auto& edge : edges) {
+            uint32_t idx = graph.edge(edge);
+            if (idx != kInvalidIndex && graph.cost[idx] != kNotAllowed) {
+              tile_flags[i] &= flags[idx];
+            }
+          }
+        }
+        // Recovering the shortcut may have evicted this tile
+        tile = reader.GetGraphTile(id);
+      } else if (graph.cost[e + i] != kNotAllowed && graph.end_node[e + i] != kInvalidIndex) {
+        tile_flags[i] = flags[e + i];
+      }
+    }
+    std::vector<uint8_t> tile_regions(graph.region.begin() + graph.node_offsets[id.tile_value()],
+                                      graph.region.begin() + graph.node_offsets[id.tile_value()] +
+                                          tile->header()->nodecount());
+    GraphTileBuilder tilebuilder(tile_dir, id, false);
+    tilebuilder.UpdateArcFlags(tile_flags, tile_regions);
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // Local tiles only need node regions so path algorithms can find the destination region
+  uint8_t local_level = TileHierarchy::levels().rbegin()->first;
+  for (const auto& id : reader.GetTileSet(local_level)) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    std::vector<uint64_t> tile_flags(tile->header()->directededgecount(), kAllArcFlags);
+    std::vector<uint8_t> tile_regions(tile->header()->nodecount());
+    for (uint32_t i = 0; i < tile_regions.size(); ++i) {
+      tile_regions[i] = partition.region(tile->node(i)->latlng(tile->header()->base_ll()));
+    }
+    GraphTileBuilder tilebuilder(tile_dir, id, false);
+    tilebuilder.UpdateArcFlags(tile_flags, tile_regions);
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  uint32_t count = 0;
+  for (auto& result : results) {
+    count += result.get_future().get();
+  }
+  LOG_INFO("Finished arc flags with " + std::to_string(count) + " searches");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -188,6 +188,14 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
   lane_connectivity_builder_.reserve(n);
   std::copy(lane_connectivity_, lane_connectivity_ + n,
             std::back_inserter(lane_connectivity_builder_));
+
+  // Shortcut edges. Edge Ids do not change when deserializing so they remain valid.
+  for (uint32_t i = 0; i < shortcut_expansion_count_; i++) {
+    auto edges = GetShortcutEdges(shortcut_expansions_[i].shortcut());
+    shortcut_expansion_builder_.emplace_back(shortcut_expansions_[i].shortcut(),
+                                             shortcut_edges_builder_.size());
+    shortcut_edges_builder_.insert(shortcut_edges_builder_.end(), edges.begin(), edges.end());
+  }
 }
 
 // Output the tile to file. Stores as binary data.
@@ -339,6 +347,29 @@ void GraphTileBuilder::StoreTileData() {
     header_builder_.set_end_offset(header_builder_.lane_connectivity_offset() +
                                    (lane_connectivity_builder_.size() * sizeof(LaneConnectivity)));
 
+    // Write the shortcut edges: the count of shortcuts, their expansions followed by an
+    // end marker and the superseded edges
+    if (!shortcut_expansion_builder_.empty()) {
+      header_builder_.set_shortcut_edges_offset(header_builder_.end_offset());
+      uint64_t count = shortcut_expansion_builder_.size();
+      ShortcutExpansion end_marker(kMaxGraphId, shortcut_edges_builder_.size());
+      in_mem.write(reinterpret_cast<const char*>(&count), sizeof(uint64_t));
+      in_mem.write(reinterpret_cast<const char*>(shortcut_expansion_builder_.data()),
+                   shortcut_expansion_builder_.size() * sizeof(ShortcutExpansion));
+      in_mem.write(reinterpret_cast<const char*>(&end_marker), sizeof(ShortcutExpansion));
+      in_mem.write(reinterpret_cast<const char*>(shortcut_edges_builder_.data()),
+                   shortcut_edges_builder_.size() * sizeof(GraphId));
+      header_builder_.set_end_offset(header_builder_.end_offset() + sizeof(uint64_t) +
+                                     (shortcut_expansion_builder_.size() + 1) *
+                                         sizeof(ShortcutExpansion) +
+                                     shortcut_edges_builder_.size() * sizeof(GraphId));
+    } else {
+      header_builder_.set_shortcut_edges_offset(0);
+    }
+
+    // Arc flags are not carried through builders, they must be recomputed
+    header_builder_.set_arcflags_offset(0);
+
     // Sanity check for the end offset
     uint32_t curr =
         static_cast<uint32_t>(in_mem.tellp()) + static_cast<uint32_t>(sizeof(GraphTileHeader));
@@ -482,6 +513,15 @@ void GraphTileBuilder::AddLaneConnectivity(const std::vector<baldr::LaneConnecti
   lane_connectivity_offset_ += sizeof(baldr::LaneConnectivity) * lc.size();
 }
 
+// Add the edges superseded by a shortcut edge.
+void GraphTileBuilder::AddShortcutEdges(const uint32_t idx, const std::vector<GraphId>& edges) {
+  if (!shortcut_expansion_builder_.empty() && shortcut_expansion_builder_.back().shortcut() >= idx) {
+    throw std::runtime_error("GraphTileBuilder::AddShortcutEdges - shortcuts must be added in order");
+  }
+  shortcut_expansion_builder_.emplace_back(idx, shortcut_edges_builder_.size());
+  shortcut_edges_builder_.insert(shortcut_edges_builder_.end(), edges.begin(), edges.end());
+}
+
 // Add forward complex restriction.
 void GraphTileBuilder::AddForwardComplexRestriction(const ComplexRestrictionBuilder& res) {
   complex_restriction_forward_builder_.push_back(res);
@@ -948,6 +988,12 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   header.set_edgeinfo_offset(header.edgeinfo_offset() + shift);
   header.set_textlist_offset(header.textlist_offset() + shift);
   header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
+  if (header.arcflags_offset() > 0) {
+    header.set_arcflags_offset(header.arcflags_offset() + shift);
+  }
+  if (header.shortcut_edges_offset() > 0) {
+    header.set_shortcut_edges_offset(header.shortcut_edges_offset() + shift);
+  }
   header.set_end_offset(header.end_offset() + shift);
   // rewrite the tile
   boost::filesystem::path filename =
@@ -1064,5 +1110,58 @@ void GraphTileBuilder::UpdatePredictedSpeeds(const std::vector<DirectedEdge>& di
   }
 }
 
+// Updates a tile with arc flags and node regions.
+void GraphTileBuilder::UpdateArcFlags(const std::vector<uint64_t>& arcflags,
+                                      const std::vector<uint8_t>& regions) {
+  if (arcflags.size() != header_->directededgecount() || regions.size() != header_->nodecount()) {
+    throw std::runtime_error("GraphTileBuilder::UpdateArcFlags - edge or node count mismatch");
+  }
+
+  // Get the name of the file
+  boost::filesystem::path filename = tile_dir_ + filesystem::path::preferred_separator +
+                                     GraphTile::FileSuffix(header_builder_.graphid());
+
+  // If the tile already has arc flags they are the same size (counts have not changed)
+  // so they are simply overwritten in place
+  if (header_->arcflags_offset() > 0) {
+    std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (file.is_open()) {
+      file.seekp(header_->arcflags_offset());
+      file.write(reinterpret_cast<const char*>(arcflags.data()), arcflags.size() * sizeof(uint64_t));
+      file.write(reinterpret_cast<const char*>(regions.data()), regions.size() * sizeof(uint8_t));
+      file.close();
+    }
+    return;
+  }
+
+  // Make sure the directory exists on the system
+  if (!boost::filesystem::exists(filename.parent_path()))
+    boost::filesystem::create_directories(filename.parent_path());
+
+  // Open file and truncate
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (file.is_open()) {
+    // Write a new header - arc flags are appended to the end of the tile. Pad the
+    // region list so the tile size remains a multiple of 8 bytes.
+    size_t offset = header_->end_offset();
+    size_t padding = (8 - (regions.size() % 8)) % 8;
+    header_builder_.set_arcflags_offset(offset);
+    header_builder_.set_end_offset(offset + (arcflags.size() * sizeof(uint64_t)) + regions.size() +
+                                   padding);
+    file.write(reinterpret_cast<const char*>(&header_builder_), sizeof(GraphTileHeader));
+
+    // Copy everything else in the tile unchanged
+    auto begin = reinterpret_cast<const char*>(header()) + sizeof(GraphTileHeader);
+    auto end = reinterpret_cast<const char*>(header()) + offset;
+    file.write(begin, end - begin);
+
+    // Append the arc flags and node regions
+    file.write(reinterpret_cast<const char*>(arcflags.data()), arcflags.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(regions.data()), regions.size() * sizeof(uint8_t));
+    file.write("\0\0\0\0\0\0\0\0", padding);
+    file.close();
+  }
+}
+
 } // namespace mjolnir
 } // namespace valhalla
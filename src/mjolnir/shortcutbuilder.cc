@@ -36,6 +36,25 @@ struct EdgePairs {
   std::pair<GraphId, GraphId> edge2;
 };
 
+// Edges superseded by a shortcut, each one as the node it leaves and its index
+// among the regular (not shortcut) edges of that node. Edge Ids change while the
+// tiles of a level get their shortcuts, these indexes do not.
+using ShortcutChain = std::vector<std::pair<GraphId, uint32_t>>;
+
+// Chains of the shortcuts of a level by tile (base Id) and by shortcut edge index
+// within the tile, so each tile is updated once when the chains are stored
+using ShortcutChains = std::map<GraphId, std::map<uint32_t, ShortcutChain>>;
+
+// Get the index of an edge among the regular edges leaving its start node.
+// Shortcut edges are always the first edges of a node.
+uint32_t RegularEdgeIndex(const GraphTile* tile, const GraphId& node, const GraphId& edge) {
+  uint32_t idx = tile->node(node)->edge_index();
+  while (idx < edge.id() && tile->directededge(idx)->is_shortcut()) {
+    idx++;
+  }
+  return edge.id() - idx;
+}
+
 /**
  * Test if 2 edges have matching attributes such that they should be
  * considered for combining into a shortcut edge.
@@ -361,7 +380,8 @@ uint32_t AddShortcutEdges(GraphReader& reader,
                           const GraphId& start_node,
                           const uint32_t edge_index,
                           const uint32_t edge_count,
-                          std::unordered_map<uint32_t, uint32_t>& shortcuts) {
+                          std::unordered_map<uint32_t, uint32_t>& shortcuts,
+                          ShortcutChains& chains) {
   // Shortcut edges have to start at a node that is not contracted - return if
   // this node can be contracted.
   EdgePairs edgepairs;
@@ -427,6 +447,9 @@ uint32_t AddShortcutEdges(GraphReader& reader,
         }
       }
 
+      // Keep the chain of superseded edges so they can be stored with the shortcut
+      ShortcutChain chain{{start_node, RegularEdgeIndex(tile, start_node, edge_id)}};
+
       // Connect edges to the shortcut while the end node is marked as
       // contracted (contains edge pairs in the shortcut info).
       uint32_t rst = 0;
@@ -459,6 +482,7 @@ uint32_t AddShortcutEdges(GraphReader& reader,
         // end node in the new level). Keep track of the last restriction
         // on the connected shortcut - need to set that so turn restrictions
         // off of shortcuts work properly
+        chain.emplace_back(end_node, RegularEdgeIndex(tile, end_node, next_edge_id));
         length += ConnectEdges(reader, end_node, next_edge_id, shape, end_node, opp_local_idx, rst,
                                average_density);
       }
@@ -535,6 +559,8 @@ uint32_t AddShortcutEdges(GraphReader& reader,
       newedge.set_internal(false);
 
       // Add new directed edge to tile builder
+      chains[start_node.Tile_Base()].emplace(tilebuilder.directededges().size(),
+                                             std::move(chain));
       tilebuilder.directededges().emplace_back(std::move(newedge));
       shortcut_count++;
       shortcut++;
@@ -552,7 +578,7 @@ uint32_t AddShortcutEdges(GraphReader& reader,
 }
 
 // Form shortcuts for tiles in this level.
-uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
+uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level, ShortcutChains& chains) {
   // Iterate through the tiles at this level (TODO - can we mark the tiles
   // the tiles that shortcuts end within?)
   reader.Clear();
@@ -600,7 +626,7 @@ uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
       // Add shortcut edges first.
       std::unordered_map<uint32_t, uint32_t> shortcuts;
       shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id, old_edge_index,
-                                         old_edge_count, shortcuts);
+                                         old_edge_count, shortcuts, chains);
 
       // Copy the rest of the directed edges from this node
       GraphId edgeid(tileid, tile_level, old_edge_index);
@@ -704,6 +730,54 @@ uint32_t FormShortcuts(GraphReader& reader, const TileLevel& level) {
   return shortcut_count;
 }
 
+// Store the edges superseded by the shortcuts of a level in their tiles. This is
+// done once all tiles of the level have their shortcuts so the edge Ids are final.
+void StoreShortcutEdges(GraphReader& reader, const ShortcutChains& chains) {
+  reader.Clear();
+  uint32_t failed = 0;
+  for (const auto& tile_chains : chains) {
+    GraphTileBuilder tilebuilder(reader.tile_dir(), tile_chains.first, true);
+    for (const auto& chain : tile_chains.second) {
+      // Skip the shortcuts leaving a node to get the Id of each superseded edge
+      std::vector<GraphId> edges;
+      for (const auto& hop : chain.second) {
+        const GraphTile* tile = reader.GetGraphTile(hop.first);
+        const NodeInfo* nodeinfo = tile->node(hop.first);
+        uint32_t idx = nodeinfo->edge_index();
+        uint32_t end = idx + nodeinfo->edge_count();
+        while (idx < end && tile->directededge(idx)->is_shortcut()) {
+          idx++;
+        }
+        if (idx + hop.second >= end) {
+          edges.clear();
+          break;
+        }
+        edges.emplace_back(hop.first.tileid(), hop.first.level(), idx + hop.second);
+      }
+
+      // The edges must end where the shortcut ends. Shortcuts without stored
+      // edges are recovered by walking the graph.
+      const DirectedEdge& shortcut = tilebuilder.directededge(chain.first);
+      if (edges.empty() ||
+          reader.GetGraphTile(edges.back())->directededge(edges.back())->endnode() !=
+              shortcut.endnode()) {
+        failed++;
+        continue;
+      }
+      tilebuilder.AddShortcutEdges(chain.first, edges);
+    }
+    tilebuilder.StoreTileData();
+
+    // Check if we need to clear the tile cache.
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  if (failed > 0) {
+    LOG_WARN("Could not store the edges of " + std::to_string(failed) + " shortcuts");
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -727,8 +801,12 @@ void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
     // Create shortcuts on this level
     auto tile_level = level->second;
     LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level.level));
-    uint32_t count = FormShortcuts(reader, tile_level);
+    ShortcutChains chains;
+    uint32_t count = FormShortcuts(reader, tile_level, chains);
     LOG_INFO("Finished with " + std::to_string(count) + " shortcuts");
+
+    // Store the edges each shortcut supersedes so they can be recovered directly
+    StoreShortcutEdges(reader, chains);
   }
 }
 
@@ -0,0 +1,102 @@
+#include "baldr/rapidjson_utils.h"
+#include "filesystem.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+#include "mjolnir/arcflagsbuilder.h"
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "config.h"
+
+namespace bpo = boost::program_options;
+
+int main(int argc, char** argv) {
+  std::string inline_config;
+  std::string config_file_path;
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  unsigned int regions = 0;
+
+  bpo::options_description options(
+      "valhalla_build_arcflags " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_build_arcflags [options]\n"
+      "\n"
+      "adds arc flags to valhalla tiles. The highway and arterial levels are partitioned into "
+      "regions and each directed edge is flagged with the regions it leads to (and from) on some "
+      "shortest path under default auto costing, turn costs included. Set thor.arc_flags to "
+      "prune route expansion with them."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "concurrency,j", bpo::value<unsigned int>(&num_threads), "Number of threads to use.")(
+      "regions,r", bpo::value<unsigned int>(&regions),
+      "Number of regions (at most 32). Overrides mjolnir.arc_flag_regions.")(
+      "config,c", boost::program_options::value<std::string>(&config_file_path),
+      "Path to the json configuration file.")("inline-config,i",
+                                              boost::program_options::value<std::string>(
+                                                  &inline_config),
+                                              "Inline json config.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_build_arcflags " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  // Read the config file
+  boost::property_tree::ptree pt;
+  if (vm.count("inline-config")) {
+    std::stringstream ss;
+    ss << inline_config;
+    rapidjson::read_json(ss, pt);
+  } else if (vm.count("config") && filesystem::is_regular_file(config_file_path)) {
+    rapidjson::read_json(config_file_path, pt);
+  } else {
+    std::cerr << "Configuration is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+
+  // configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree =
+      pt.get_child_optional("mjolnir.logging");
+  if (logging_subtree) {
+    auto logging_config =
+        valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+                                 std::unordered_map<std::string, std::string>>(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  // Command line overrides
+  if (vm.count("concurrency")) {
+    pt.put<unsigned int>("mjolnir.concurrency", num_threads);
+  }
+  if (vm.count("regions")) {
+    pt.put<unsigned int>("mjolnir.arc_flag_regions", regions);
+  }
+
+  valhalla::mjolnir::ArcFlagsBuilder::Build(pt);
+  return EXIT_SUCCESS;
+}
@@ -80,7 +80,7 @@ bool WalkTransitLines(const GraphId& n_graphId,
     // all should be a transit lines, but make sure.
     if (de->IsTransitLine()) {
 
-      const TransitDeparture* departure =
+      auto departure =
           endnodetile->GetNextDeparture(de->lineid(), localtime, day, dow, false, false, false);
 
       // Don't want to walk an edge at a particular time more than once.
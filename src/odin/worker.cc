@@ -57,12 +57,17 @@ odin_worker_t::work(const std::list<zmq::message_t>& job,
     // crack open the in progress request
     request.ParseFromArray(job.front().data(), job.front().size());
 
+    // Give up if the request already waited past its deadline
+    service_worker_t::set_deadline(request);
+
     // narrate them and serialize them along
     narrate(request);
     auto response = tyr::serializeDirections(request);
     auto* to_response =
         request.options().format() == Options::gpx ? to_response_xml : to_response_json;
     return to_response(response, info, request);
+  } catch (const valhalla_exception_t& e) {
+    return jsonify_error(e, info, request);
   } catch (const std::exception& e) {
     return jsonify_error({299, std::string(e.what())}, info, request);
   }
@@ -223,6 +223,14 @@ public:
   virtual ~BicycleCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<BicycleCost>(*this);
+  }
+
   /**
    * Get the access mode used by this costing method.
    * @return  Returns access mode.
@@ -0,0 +1,114 @@
+#include "sif/costcache.h"
+
+#include <cstdint>
+
+namespace valhalla {
+namespace sif {
+
+std::atomic<uint64_t> CostCache::last_profile_id_(0);
+
+CostCache& CostCache::GetInstance() {
+  static CostCache cache;
+  return cache;
+}
+
+CostCache::CostCache(const size_t max_profiles)
+    : max_profiles_(max_profiles), edge_cost_memo_(false) {
+}
+
+cost_ptr_t
+CostCache::Create(const Costing costing, const Options& options, create_function_t create) {
+  if (max_profiles_ == 0) {
+    return create(costing, options);
+  }
+
+  const std::string key = Key(costing, options, create);
+  std::shared_ptr<const DynamicCost> profile;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cached = profiles_.find(key);
+    if (cached != profiles_.end()) {
+      profile = cached->second;
+    }
+  }
+
+  // Construct the profile without holding the lock. If another thread added the
+  // same profile meanwhile keep that one, they are identical.
+  if (!profile) {
+    Options profile_options(options);
+    profile_options.clear_avoid_edges();
+    cost_ptr_t cost = create(costing, profile_options);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (profiles_.size() < max_profiles_ && profiles_.find(key) == profiles_.end()) {
+      if (edge_cost_memo_ && cost->EdgeCostMemoizable()) {
+        cost->set_profile_id(++last_profile_id_);
+      }
+      profiles_.emplace(key, cost);
+    }
+    profile = cost;
+  }
+
+  // The avoid edges are the only part of the options not in the profile
+  cost_ptr_t cost = profile->Clone();
+  cost->AddUserAvoidEdges(options);
+  return cost;
+}
+
+std::string
+CostCache::Key(const Costing costing, const Options& options, create_function_t create) {
+  std::string costing_options;
+  if (static_cast<int>(costing) < options.costing_options_size()) {
+    costing_options = options.costing_options(static_cast<int>(costing)).SerializeAsString();
+  }
+  return std::to_string(reinterpret_cast<std::uintptr_t>(create)) + ":" +
+         std::to_string(static_cast<int>(costing)) + ":" + costing_options;
+}
+
+size_t CostCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return profiles_.size();
+}
+
+void CostCache::set_edge_cost_memo(const bool enabled) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (edge_cost_memo_ != enabled) {
+    edge_cost_memo_ = enabled;
+    profiles_.clear();
+  }
+}
+
+void CostCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  profiles_.clear();
+}
+
+baldr::EdgeCostTable* GetEdgeCostTable(const uint64_t profile_id,
+                                       const uint8_t flow_mask,
+                                       const baldr::GraphTile* tile,
+                                       const uint32_t seconds) {
+  // The cursor keeps the memo alive so its address can't be reused by the memo
+  // of another tile while it is remembered. The generation is read before the
+  // table is fetched so a Clear in between makes the next call fetch it again.
+  struct Cursor {
+    std::shared_ptr<baldr::EdgeCostMemo> memo;
+    uint64_t generation = 0;
+    uint64_t profile_id = 0;
+    uint32_t time_key = 0;
+    std::shared_ptr<baldr::EdgeCostTable> table;
+  };
+  thread_local Cursor cursor;
+
+  const uint32_t time_key = baldr::GraphTile::SpeedTimeKey(flow_mask, seconds);
+  if (cursor.memo != tile->cost_memo() || cursor.generation != tile->cost_memo()->generation() ||
+      cursor.profile_id != profile_id || cursor.time_key != time_key) {
+    cursor.memo = tile->cost_memo();
+    cursor.generation = cursor.memo->generation();
+    cursor.profile_id = profile_id;
+    cursor.time_key = time_key;
+    cursor.table = cursor.memo->table(profile_id, time_key, tile->header()->directededgecount());
+  }
+  return cursor.table.get();
+}
+
+} // namespace sif
+} // namespace valhalla
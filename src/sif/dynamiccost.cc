@@ -40,7 +40,7 @@ namespace sif {
 
 DynamicCost::DynamicCost(const Options& options, const TravelMode mode)
     : pass_(0), allow_transit_connections_(false), allow_destination_only_(true), travel_mode_(mode),
-      flow_mask_(kDefaultFlowMask) {
+      flow_mask_(kDefaultFlowMask), profile_id_(0) {
   // Parse property tree to get hierarchy limits
   // TODO - get the number of levels
   uint32_t n_levels = sizeof(kDefaultMaxUpTransitions) / sizeof(kDefaultMaxUpTransitions[0]);
@@ -49,9 +49,7 @@ DynamicCost::DynamicCost(const Options& options, const TravelMode mode)
   }
 
   // Add avoid edges to internal set
-  for (auto& edge : options.avoid_edges()) {
-    user_avoid_edges_.insert({GraphId(edge.id()), edge.percent_along()});
-  }
+  AddUserAvoidEdges(options);
 }
 
 DynamicCost::~DynamicCost() {
@@ -198,6 +196,13 @@ void DynamicCost::AddUserAvoidEdges(const std::vector<AvoidEdge>& avoid_edges) {
   }
 }
 
+// Adds the avoid edges of the request to the user specified avoid list.
+void DynamicCost::AddUserAvoidEdges(const Options& options) {
+  for (auto& edge : options.avoid_edges()) {
+    user_avoid_edges_.insert({GraphId(edge.id()), edge.percent_along()});
+  }
+}
+
 void ParseCostOptions(const rapidjson::Value& value, CostingOptions* pbf_costing_options) {
   auto speed_types = rapidjson::get_child_optional(value, "/speed_types");
   pbf_costing_options->set_flow_mask(SpeedMask_Parse(speed_types));
@@ -126,6 +126,14 @@ public:
 
   virtual ~MotorcycleCost();
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<MotorcycleCost>(*this);
+  }
+
   /**
    * Does the costing method allow multiple passes (with relaxed hierarchy
    * limits).
@@ -165,6 +165,14 @@ public:
   virtual ~MotorScooterCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<MotorScooterCost>(*this);
+  }
+
   /**
    * Does the costing method allow multiple passes (with relaxed hierarchy
    * limits).
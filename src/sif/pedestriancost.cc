@@ -164,6 +164,14 @@ public:
   virtual ~PedestrianCost() {
   }
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<PedestrianCost>(*this);
+  }
+
   /**
    * Does the costing method allow multiple passes (with relaxed hierarchy
    * limits).
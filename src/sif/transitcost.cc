@@ -67,6 +67,14 @@ public:
 
   virtual ~TransitCost();
 
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<TransitCost>(*this);
+  }
+
   /**
    * Get the wheelchair required flag.
    * @return  Returns true if wheelchair is required.
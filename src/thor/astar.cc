@@ -23,7 +23,7 @@ constexpr uint32_t kMaxIterationsWithoutConvergence = 200000;
 // Default constructor
 AStarPathAlgorithm::AStarPathAlgorithm()
     : PathAlgorithm(), mode_(TravelMode::kDrive), travel_type_(0), adjacencylist_(nullptr),
-      max_label_count_(std::numeric_limits<uint32_t>::max()) {
+      max_label_count_(std::numeric_limits<uint32_t>::max()), arcflags_mask_(kAllArcFlags) {
 }
 
 // Destructor
@@ -33,6 +33,11 @@ AStarPathAlgorithm::~AStarPathAlgorithm() {
 
 // Clear the temporary information generated during path construction.
 void AStarPathAlgorithm::Clear() {
+  // Release the memory of the search from the budget
+  if (memory_) {
+    memory_->Release(memory_held_);
+  }
+
   // Clear the edge labels and destination list. Reset the adjacency list
   // and clear edge status.
   edgelabels_.clear();
@@ -44,6 +49,25 @@ void AStarPathAlgorithm::Clear() {
   has_ferry_ = false;
 }
 
+// Report the memory held by the search.
+void AStarPathAlgorithm::UpdateMemory() {
+  if (memory_) {
+    memory_->Update(memory_held_, edgelabels_.capacity() * sizeof(EdgeLabel) +
+                                      (adjacencylist_ ? adjacencylist_->memory() : 0) +
+                                      edgestatus_.memory());
+  }
+}
+
+// Get the counters of the search since it was last initialized.
+SearchStats AStarPathAlgorithm::stats() const {
+  SearchStats stats;
+  if (adjacencylist_) {
+    stats.Add(*adjacencylist_);
+  }
+  stats.Add(hierarchy_limits_);
+  return stats;
+}
+
 // Initialize prior to finding best path
 void AStarPathAlgorithm::Init(const midgard::PointLL& origll, const midgard::PointLL& destll) {
   LOG_TRACE("Orig LL = " + std::to_string(origll.lat()) + "," + std::to_string(origll.lng()));
@@ -150,6 +174,13 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
       continue;
     }
 
+    // Skip edges that do not lie on a shortest path towards the destination region.
+    // Destination edges are never pruned.
+    if (!(tile->arcflags(edgeid.id()) & arcflags_mask_) &&
+        destinations_percent_along_.find(edgeid) == destinations_percent_along_.end()) {
+      continue;
+    }
+
     // Skip this edge if permanently labeled (best path already found to this
     // directed edge), if no access is allowed to this edge (based on costing method),
     // or if a complex restriction exists.
@@ -265,9 +296,16 @@ AStarPathAlgorithm::GetBestPath(valhalla::Location& origin,
   // destination first in case the origin edge includes a destination edge.
   uint32_t density = SetDestination(graphreader, destination);
   SetOrigin(graphreader, origin, destination, kInvalidSecondsOfWeek);
+  const uint8_t local_level = TileHierarchy::levels().rbegin()->first;
+  arcflags_mask_ = GetArcFlagsMask(graphreader, destination, true,
+                                   hierarchy_limits_[local_level].expansion_within_dist);
 
   // Update hierarchy limits
   ModifyHierarchyLimits(mindist, density);
+  RelaxArcFlagHierarchyLimits(hierarchy_limits_, arcflags_mask_);
+
+  // Report the memory reserved for the search
+  UpdateMemory();
 
   // Find shortest path
   uint32_t nc = 0; // Count of iterations with no convergence
@@ -275,11 +313,13 @@ AStarPathAlgorithm::GetBestPath(valhalla::Location& origin,
   std::pair<int32_t, float> best_path = std::make_pair(-1, 0.0f);
   size_t total_labels = 0;
   while (true) {
-    // Allow this process to be aborted
+    // Allow this process to be aborted, check the memory it holds
     size_t current_labels = edgelabels_.size();
-    if (interrupt &&
-        total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
-      (*interrupt)();
+    if (total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory();
     }
     total_labels = current_labels;
 
@@ -1,148 +1,184 @@
 #include <thor/attributes_controller.h>
 
 #include <string>
+#include <unordered_map>
 
 namespace valhalla {
 namespace thor {
 
 /*
- * Map of attributes that a user can request to enable or disable, and their defaults.
- * Most attributes are enabled by default but a few additional attributes are disabled
- * unless explicitly included with the filter attributes request option.
+ * Names of the attributes a user can request to enable or disable, in the order of
+ * the attribute keys.
  */
-const std::unordered_map<std::string, bool> AttributesController::kDefaultAttributes = {
-    // Edge keys
-    {kEdgeNames, true},
-    {kEdgeLength, true},
-    {kEdgeSpeed, true},
-    {kEdgeRoadClass, true},
-    {kEdgeBeginHeading, true},
-    {kEdgeEndHeading, true},
-    {kEdgeBeginShapeIndex, true},
-    {kEdgeEndShapeIndex, true},
-    {kEdgeTraversability, true},
-    {kEdgeUse, true},
-    {kEdgeToll, true},
-    {kEdgeUnpaved, true},
-    {kEdgeTunnel, true},
-    {kEdgeBridge, true},
-    {kEdgeRoundabout, true},
-    {kEdgeInternalIntersection, true},
-    {kEdgeDriveOnRight, true},
-    {kEdgeSurface, true},
-    {kEdgeSignExitNumber, true},
-    {kEdgeSignExitBranch, true},
-    {kEdgeSignExitToward, true},
-    {kEdgeSignExitName, true},
-    {kEdgeSignGuideBranch, true},
-    {kEdgeSignGuideToward, true},
-    {kEdgeSignJunctionName, true},
-    {kEdgeTravelMode, true},
-    {kEdgeVehicleType, true},
-    {kEdgePedestrianType, true},
-    {kEdgeBicycleType, true},
-    {kEdgeTransitType, true},
-    {kEdgeTransitRouteInfoOnestopId, true},
-    {kEdgeTransitRouteInfoBlockId, true},
-    {kEdgeTransitRouteInfoTripId, true},
-    {kEdgeTransitRouteInfoShortName, true},
-    {kEdgeTransitRouteInfoLongName, true},
-    {kEdgeTransitRouteInfoHeadsign, true},
-    {kEdgeTransitRouteInfoColor, true},
-    {kEdgeTransitRouteInfoTextColor, true},
-    {kEdgeTransitRouteInfoDescription, true},
-    {kEdgeTransitRouteInfoOperatorOnestopId, true},
-    {kEdgeTransitRouteInfoOperatorName, true},
-    {kEdgeTransitRouteInfoOperatorUrl, true},
-    {kEdgeId, true},
-    {kEdgeWayId, true},
-    {kEdgeWeightedGrade, true},
-    {kEdgeMaxUpwardGrade, true},
-    {kEdgeMaxDownwardGrade, true},
-    {kEdgeMeanElevation, true},
-    {kEdgeLaneCount, true},
-    {kEdgeLaneConnectivity, true},
-    {kEdgeCycleLane, true},
-    {kEdgeBicycleNetwork, true},
-    {kEdgeSidewalk, true},
-    {kEdgeDensity, true},
-    {kEdgeSpeedLimit, true},
-    {kEdgeTruckSpeed, true},
-    {kEdgeTruckRoute, true},
+const std::array<std::string, kAttributeCount> AttributesController::kAttributeNames = {{
+    "edge.names",
+    "edge.length",
+    "edge.speed",
+    "edge.road_class",
+    "edge.begin_heading",
+    "edge.end_heading",
+    "edge.begin_shape_index",
+    "edge.end_shape_index",
+    "edge.traversability",
+    "edge.use",
+    "edge.toll",
+    "edge.unpaved",
+    "edge.tunnel",
+    "edge.bridge",
+    "edge.roundabout",
+    "edge.internal_intersection",
+    "edge.drive_on_right",
+    "edge.surface",
+    "edge.sign.exit_number",
+    "edge.sign.exit_branch",
+    "edge.sign.exit_toward",
+    "edge.sign.exit_name",
+    "edge.sign.guide_branch",
+    "edge.sign.guide_toward",
+    "edge.sign.junction_name",
+    "edge.travel_mode",
+    "edge.vehicle_type",
+    "edge.pedestrian_type",
+    "edge.bicycle_type",
+    "edge.transit_type",
+    "edge.transit_route_info.onestop_id",
+    "edge.transit_route_info.block_id",
+    "edge.transit_route_info.trip_id",
+    "edge.transit_route_info.short_name",
+    "edge.transit_route_info.long_name",
+    "edge.transit_route_info.headsign",
+    "edge.transit_route_info.color",
+    "edge.transit_route_info.text_color",
+    "edge.transit_route_info.description",
+    "edge.transit_route_info.operator_onestop_id",
+    "edge.transit_route_info.operator_name",
+    "edge.transit_route_info.operator_url",
+    "edge.id",
+    "edge.way_id",
+    "edge.weighted_grade",
+    "edge.max_upward_grade",
+    "edge.max_downward_grade",
+    "edge.mean_elevation",
+    "edge.lane_count",
+    "edge.lane_connectivity",
+    "edge.cycle_lane",
+    "edge.bicycle_network",
+    "edge.sidewalk",
+    "edge.density",
+    "edge.speed_limit",
+    "edge.truck_speed",
+    "edge.truck_route",
+    "node.intersecting_edge.begin_heading",
+    "node.intersecting_edge.from_edge_name_consistency",
+    "node.intersecting_edge.to_edge_name_consistency",
+    "node.intersecting_edge.driveability",
+    "node.intersecting_edge.cyclability",
+    "node.intersecting_edge.walkability",
+    "node.intersecting_edge.use",
+    "node.intersecting_edge.road_class",
+    "node.elapsed_time",
+    "node.admin_index",
+    "node.type",
+    "node.fork",
+    "node.transit_platform_info.type",
+    "node.transit_platform_info.onestop_id",
+    "node.transit_platform_info.name",
+    "node.transit_platform_info.station_onestop_id",
+    "node.transit_platform_info.station_name",
+    "node.transit_platform_info.arrival_date_time",
+    "node.transit_platform_info.departure_date_time",
+    "node.transit_platform_info.is_parent_stop",
+    "node.transit_platform_info.assumed_schedule",
+    "node.transit_platform_info.lat_lon",
+    "node.transit_station_info.onestop_id",
+    "node.transit_station_info.name",
+    "node.transit_station_info.lat_lon",
+    "node.transit_egress_info.onestop_id",
+    "node.transit_egress_info.name",
+    "node.transit_egress_info.lat_lon",
+    "node.time_zone",
+    "osm_changeset",
+    "admin.country_code",
+    "admin.country_text",
+    "admin.state_code",
+    "admin.state_text",
+    "shape",
+    "matched.point",
+    "matched.type",
+    "matched.edge_index",
+    "matched.begin_route_discontinuity",
+    "matched.end_route_discontinuity",
+    "matched.distance_along_edge",
+    "matched.distance_from_trace_point",
+    "confidence_score",
+    "raw_score",
+    "shape_attributes.time",
+    "shape_attributes.length",
+    "shape_attributes.speed",
+}};
 
-    // Node keys
-    {kNodeIntersectingEdgeBeginHeading, true},
-    {kNodeIntersectingEdgeFromEdgeNameConsistency, true},
-    {kNodeIntersectingEdgeToEdgeNameConsistency, true},
-    {kNodeIntersectingEdgeDriveability, true},
-    {kNodeIntersectingEdgeCyclability, true},
-    {kNodeIntersectingEdgeWalkability, true},
-    {kNodeIntersectingEdgeUse, true},
-    {kNodeIntersectingEdgeRoadClass, true},
-    {kNodeElapsedTime, true},
-    {kNodeaAdminIndex, true},
-    {kNodeType, true},
-    {kNodeFork, true},
-    {kNodeTransitPlatformInfoType, true},
-    {kNodeTransitPlatformInfoOnestopId, true},
-    {kNodeTransitPlatformInfoName, true},
-    {kNodeTransitPlatformInfoStationOnestopId, true},
-    {kNodeTransitPlatformInfoStationName, true},
-    {kNodeTransitPlatformInfoArrivalDateTime, true},
-    {kNodeTransitPlatformInfoDepartureDateTime, true},
-    {kNodeTransitPlatformInfoIsParentStop, true},
-    {kNodeTransitPlatformInfoAssumedSchedule, true},
-    {kNodeTransitPlatformInfoLatLon, true},
-    {kNodeTransitStationInfoOnestopId, true},
-    {kNodeTransitStationInfoName, true},
-    {kNodeTransitStationInfoLatLon, true},
-    {kNodeTransitEgressInfoOnestopId, true},
-    {kNodeTransitEgressInfoName, true},
-    {kNodeTransitEgressInfoLatLon, true},
-    {kNodeTimeZone, true},
+namespace {
 
-    // Top level: admin list, full shape, and shape bounding box keys
-    {kOsmChangeset, true},
-    {kAdminCountryCode, true},
-    {kAdminCountryText, true},
-    {kAdminStateCode, true},
-    {kAdminStateText, true},
-    {kShape, true},
-    {kMatchedPoint, true},
-    {kMatchedType, true},
-    {kMatchedEdgeIndex, true},
-    {kMatchedBeginRouteDiscontinuity, true},
-    {kMatchedEndRouteDiscontinuity, true},
-    {kMatchedDistanceAlongEdge, true},
-    {kMatchedDistanceFromTracePoint, true},
-    {kConfidenceScore, true},
-    {kRawScore, true},
+// Attribute keys by name, to resolve the filter attributes of a request
+const std::unordered_map<std::string, AttributeKey> kAttributeKeys = []() {
+  std::unordered_map<std::string, AttributeKey> keys;
+  for (uint8_t key = 0; key < kAttributeCount; ++key) {
+    keys.emplace(AttributesController::kAttributeNames[key], static_cast<AttributeKey>(key));
+  }
+  return keys;
+}();
+
+} // namespace
 
-    // Per-shape attributes
-    {kShapeAttributesTime, false},
-    {kShapeAttributesLength, false},
-    {kShapeAttributesSpeed, false}};
+/*
+ * Attributes enabled by default. Most attributes are enabled by default but a few
+ * additional attributes are disabled unless explicitly included with the filter
+ * attributes request option.
+ */
+const AttributeMask AttributesController::kDefaultAttributes = []() {
+  AttributeMask defaults;
+  defaults.set();
+  defaults.reset(kShapeAttributesTime);
+  defaults.reset(kShapeAttributesLength);
+  defaults.reset(kShapeAttributesSpeed);
+  return defaults;
+}();
 
-AttributesController::AttributesController() {
-  attributes = kDefaultAttributes;
+const AttributeMask kNodeCategory = AttributesController::category("node.");
+const AttributeMask kAdminCategory = AttributesController::category("admin.");
+const AttributeMask kMatchedCategory = AttributesController::category("matched.");
+const AttributeMask kShapeAttributesCategory = AttributesController::category("shape_attributes.");
+const AttributeMask kEdgeSignCategory = AttributesController::category("edge.sign.");
+const AttributeMask kEdgeTransitRouteInfoCategory =
+    AttributesController::category("edge.transit_route_info.");
+const AttributeMask kNodeIntersectingEdgeCategory =
+    AttributesController::category("node.intersecting_edge.");
+
+AttributesController::AttributesController() : attributes(kDefaultAttributes) {
 }
 
 void AttributesController::disable_all() {
-  for (auto& pair : attributes) {
-    pair.second = false;
+  attributes.reset();
+}
+
+bool AttributesController::set_attribute(const std::string& name, const bool enabled) {
+  auto key = kAttributeKeys.find(name);
+  if (key == kAttributeKeys.end()) {
+    return false;
   }
+  attributes.set(key->second, enabled);
+  return true;
 }
 
-// Used to check if any keys starting with the `category` string are enabled.
-bool AttributesController::category_attribute_enabled(const std::string& category) const {
-  for (const auto& pair : attributes) {
-    // if the key starts with the specified category and it is enabled
-    // then return true
-    if ((pair.first.compare(0, category.size(), category) == 0) && pair.second) {
-      return true;
+// Used to get the attributes whose name starts with the `prefix` string.
+AttributeMask AttributesController::category(const std::string& prefix) {
+  AttributeMask mask;
+  for (uint8_t key = 0; key < kAttributeCount; ++key) {
+    if (kAttributeNames[key].compare(0, prefix.size(), prefix) == 0) {
+      mask.set(key);
     }
   }
-  return false;
+  return mask;
 }
 
 } // namespace thor
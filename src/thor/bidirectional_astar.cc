@@ -4,9 +4,15 @@
 #include "baldr/graphid.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "sif/costdispatch.h"
 #include "sif/edgelabel.h"
+#include "thor/edgebatch.h"
 #include <algorithm>
+#include <exception>
 #include <map>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -25,6 +31,24 @@ constexpr uint64_t kInitialEdgeLabelCountBD = 1000000;
 // cost creates large performance drops - so perhaps some other metric can be found?
 constexpr float kThresholdDelta = 420.0f;
 
+// Edge labels one expansion can add (edges from the node and its transitions).
+// Concurrent searches stop before the edge label vectors would be reallocated
+// since the opposing search reads the labels of settled edges.
+constexpr size_t kMaxLabelsPerExpansion = 1024;
+
+// Get the cost along the edges of a path that are in the set of edges.
+float SharedCost(const std::vector<valhalla::thor::PathInfo>& path,
+                 const std::unordered_set<GraphId>& edges) {
+  float shared = 0.0f, prior = 0.0f;
+  for (const auto& info : path) {
+    if (edges.count(info.edgeid)) {
+      shared += info.elapsed_cost - prior;
+    }
+    prior = info.elapsed_cost;
+  }
+  return shared;
+}
+
 } // namespace
 
 namespace valhalla {
@@ -33,12 +57,22 @@ namespace thor {
 // Default constructor
 BidirectionalAStar::BidirectionalAStar() : PathAlgorithm() {
   threshold_ = 0;
+  desired_alternates_ = 0;
   mode_ = TravelMode::kDrive;
   access_mode_ = kAutoAccess;
   travel_type_ = 0;
   cost_diff_ = 0.0f;
   adjacencylist_forward_ = nullptr;
   adjacencylist_reverse_ = nullptr;
+  arcflags_forward_mask_ = kAllArcFlags;
+  arcflags_reverse_mask_ = kAllArcFlags;
+  expand_forward_ = &BidirectionalAStar::ExpandForward<DynamicCost>;
+  expand_reverse_ = &BidirectionalAStar::ExpandReverse<DynamicCost>;
+  shared_best_cost_ = std::numeric_limits<float>::max();
+  shared_threshold_ = std::numeric_limits<float>::max();
+  stop_parallel_ = false;
+  parallel_min_distance_ = kParallelMinDistance;
+  memory_held_reverse_ = 0;
 }
 
 // Destructor
@@ -48,17 +82,53 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
+  // Release the memory of both searches from the budget
+  if (memory_) {
+    memory_->Release(memory_held_);
+    memory_->Release(memory_held_reverse_);
+  }
+
   edgelabels_forward_.clear();
   edgelabels_reverse_.clear();
   adjacencylist_forward_.reset();
   adjacencylist_reverse_.reset();
   edgestatus_forward_.clear();
   edgestatus_reverse_.clear();
+  settled_forward_.clear();
+  settled_reverse_.clear();
+  candidates_.clear();
 
   // Set the ferry flag to false
   has_ferry_ = false;
 }
 
+// Report the memory held by the forward or the reverse search.
+void BidirectionalAStar::UpdateMemory(const bool forward) {
+  if (!memory_) {
+    return;
+  }
+  const auto& edgelabels = forward ? edgelabels_forward_ : edgelabels_reverse_;
+  const auto& adjacencylist = forward ? adjacencylist_forward_ : adjacencylist_reverse_;
+  const auto& edgestatus = forward ? edgestatus_forward_ : edgestatus_reverse_;
+  memory_->Update(forward ? memory_held_ : memory_held_reverse_,
+                  edgelabels.capacity() * sizeof(BDEdgeLabel) +
+                      (adjacencylist ? adjacencylist->memory() : 0) + edgestatus.memory());
+}
+
+// Get the counters of the forward and reverse searches.
+SearchStats BidirectionalAStar::stats() const {
+  SearchStats stats;
+  if (adjacencylist_forward_) {
+    stats.Add(*adjacencylist_forward_);
+  }
+  if (adjacencylist_reverse_) {
+    stats.Add(*adjacencylist_reverse_);
+  }
+  stats.Add(hierarchy_limits_forward_);
+  stats.Add(hierarchy_limits_reverse_);
+  return stats;
+}
+
 // Initialize the A* heuristic and adjacency lists for both the forward
 // and reverse search.
 void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
@@ -98,6 +168,7 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 
   // Initialize best connection with max cost
   best_connection_ = {GraphId(), GraphId(), std::numeric_limits<float>::max()};
+  candidates_.clear();
 
   // Set the cost threshold to the maximum float value. Once the initial connection is found
   // the threshold is set.
@@ -109,6 +180,7 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 }
 
 // Returns true if function ended up adding an edge for expansion
+template <class CostT>
 bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
                                        const GraphId& node,
                                        BDEdgeLabel& pred,
@@ -121,13 +193,21 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
     return false;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!sif::CostCalls<CostT>(*costing_).Allowed(nodeinfo)) {
     return false;
   }
 
   uint32_t shortcuts = 0;
   EdgeMetadata meta = EdgeMetadata::make(node, nodeinfo, tile, edgestatus_forward_);
 
+  // With a specialized costing evaluate all the edges of the node at once and
+  // skip the ones without access below
+  constexpr bool batched = !std::is_same<CostT, DynamicCost>::value;
+  EdgeBatch batch;
+  if (batched) {
+    batch.Evaluate(meta.edge, nodeinfo->edge_count(), access_mode_, true, tile);
+  }
+
   bool found_valid_edge = false;
   bool found_uturn = false;
   EdgeMetadata uturn_meta = {};
@@ -144,9 +224,12 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
       found_uturn = true;
       continue;
     }
+    if (batched && !batch.candidate(i)) {
+      continue;
+    }
 
     found_valid_edge =
-        ExpandForwardInner(graphreader, pred, nodeinfo, pred_idx, meta, shortcuts, tile) ||
+        ExpandForwardInner<CostT>(graphreader, pred, nodeinfo, pred_idx, meta, shortcuts, tile) ||
         found_valid_edge;
   }
 
@@ -157,10 +240,12 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
       if (trans->up()) {
         hierarchy_limits_forward_[node.level()].up_transition_count++;
         found_valid_edge =
-            ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true) || found_valid_edge;
+            ExpandForward<CostT>(graphreader, trans->endnode(), pred, pred_idx, true) ||
+            found_valid_edge;
       } else if (!hierarchy_limits_forward_[trans->endnode().level()].StopExpanding()) {
         found_valid_edge =
-            ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true) || found_valid_edge;
+            ExpandForward<CostT>(graphreader, trans->endnode(), pred, pred_idx, true) ||
+            found_valid_edge;
       }
     }
   }
@@ -184,8 +269,8 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
         found_valid_edge = true;
       } else {
         // We didn't add any shortcut of the uturn, therefore evaluate the regular uturn instead
-        bool uturn_added =
-            ExpandForwardInner(graphreader, pred, nodeinfo, pred_idx, uturn_meta, shortcuts, tile);
+        bool uturn_added = ExpandForwardInner<CostT>(graphreader, pred, nodeinfo, pred_idx,
+                                                     uturn_meta, shortcuts, tile);
         found_valid_edge = found_valid_edge || uturn_added;
       }
     }
@@ -200,6 +285,7 @@ bool BidirectionalAStar::ExpandForward(GraphReader& graphreader,
 // TODO: Merge this with ExpandReverseInner
 //
 // Returns true if any edge _could_ have been expanded after restrictions etc.
+template <class CostT>
 inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
                                                    const BDEdgeLabel& pred,
                                                    const NodeInfo* nodeinfo,
@@ -227,15 +313,25 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
   if (meta.edge_status->set() == EdgeSet::kPermanent) {
     return true; // This is an edge we _could_ have expanded, so return true
   }
+
+  // Skip edges that do not lie on a shortest path towards the destination region
+  // (the edges of the destination itself are always expanded, like in AStar)
+  if (!(tile->arcflags(meta.edge_id.id()) & arcflags_forward_mask_) &&
+      std::find(arcflags_exempt_forward_.begin(), arcflags_exempt_forward_.end(),
+                meta.edge_id) == arcflags_exempt_forward_.end()) {
+    return false;
+  }
+
+  const sif::CostCalls<CostT> costing(*costing_);
   bool has_time_restrictions = false;
-  if (!costing_->Allowed(meta.edge, pred, tile, meta.edge_id, 0, 0, has_time_restrictions) ||
+  if (!costing.Allowed(meta.edge, pred, tile, meta.edge_id, 0, 0, has_time_restrictions) ||
       costing_->Restricted(meta.edge, pred, edgelabels_forward_, tile, meta.edge_id, true)) {
     return false;
   }
 
   // Get cost. Separate out transition cost.
-  Cost tc = costing_->TransitionCost(meta.edge, nodeinfo, pred);
-  Cost newcost = pred.cost() + tc + costing_->EdgeCost(meta.edge, tile, kConstrainedFlowSecondOfDay);
+  Cost tc = costing.TransitionCost(meta.edge, nodeinfo, pred);
+  Cost newcost = pred.cost() + tc + costing.EdgeCost(meta.edge, tile, kConstrainedFlowSecondOfDay);
 
   // Check if edge is temporarily labeled and this path has less cost. If
   // less cost the predecessor is updated and the sort cost is decremented
@@ -284,6 +380,7 @@ inline bool BidirectionalAStar::ExpandForwardInner(GraphReader& graphreader,
 // Expand from a node in reverse direction.
 //
 // Returns true if function ended up adding an edge for expansion
+template <class CostT>
 bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
                                        const GraphId& node,
                                        BDEdgeLabel& pred,
@@ -297,13 +394,21 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     return false;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!sif::CostCalls<CostT>(*costing_).Allowed(nodeinfo)) {
     return false;
   }
 
   uint32_t shortcuts = 0;
   EdgeMetadata meta = EdgeMetadata::make(node, nodeinfo, tile, edgestatus_reverse_);
 
+  // With a specialized costing evaluate all the edges of the node at once and
+  // skip the ones without access below
+  constexpr bool batched = !std::is_same<CostT, DynamicCost>::value;
+  EdgeBatch batch;
+  if (batched) {
+    batch.Evaluate(meta.edge, nodeinfo->edge_count(), access_mode_, false, tile);
+  }
+
   bool edge_was_added = false;
   bool found_uturn = false;
   EdgeMetadata uturn_meta = {};
@@ -320,9 +425,12 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
       found_uturn = true;
       continue;
     }
+    if (batched && !batch.candidate(i)) {
+      continue;
+    }
 
-    edge_was_added = ExpandReverseInner(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx, meta,
-                                        shortcuts, tile) ||
+    edge_was_added = ExpandReverseInner<CostT>(graphreader, pred, opp_pred_edge, nodeinfo,
+                                               pred_idx, meta, shortcuts, tile) ||
                      edge_was_added;
   }
 
@@ -332,13 +440,13 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
       if (trans->up()) {
         hierarchy_limits_reverse_[node.level()].up_transition_count++;
-        edge_was_added =
-            ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true) ||
-            edge_was_added;
+        edge_was_added = ExpandReverse<CostT>(graphreader, trans->endnode(), pred, pred_idx,
+                                              opp_pred_edge, true) ||
+                         edge_was_added;
       } else if (!hierarchy_limits_reverse_[trans->endnode().level()].StopExpanding()) {
-        edge_was_added =
-            ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true) ||
-            edge_was_added;
+        edge_was_added = ExpandReverse<CostT>(graphreader, trans->endnode(), pred, pred_idx,
+                                              opp_pred_edge, true) ||
+                         edge_was_added;
       }
     }
   }
@@ -362,8 +470,8 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
         edge_was_added = true;
       } else {
         // We didn't add any shortcut of the uturn, therefore evaluate the regular uturn instead
-        edge_was_added = ExpandReverseInner(graphreader, pred, opp_pred_edge, nodeinfo, pred_idx,
-                                            uturn_meta, shortcuts, tile) ||
+        edge_was_added = ExpandReverseInner<CostT>(graphreader, pred, opp_pred_edge, nodeinfo,
+                                                   pred_idx, uturn_meta, shortcuts, tile) ||
                          edge_was_added;
       }
     }
@@ -377,6 +485,7 @@ bool BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
 // TODO: Merge this with ExpandForwardInner
 //
 // Returns true if any edge _could_ have been expanded after restrictions etc.
+template <class CostT>
 inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
                                                    const BDEdgeLabel& pred,
                                                    const DirectedEdge* opp_pred_edge,
@@ -419,11 +528,21 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   GraphId opp_edge_id = t2->GetOpposingEdgeId(meta.edge);
   const DirectedEdge* opp_edge = t2->directededge(opp_edge_id);
 
+  // Skip edges that do not lie on a shortest path leaving the origin region. The
+  // flags are stored on the edge in the direction of travel (the opposing edge),
+  // the edges of the origin itself are always expanded.
+  if (!(t2->arcflags(opp_edge_id.id()) & arcflags_reverse_mask_) &&
+      std::find(arcflags_exempt_reverse_.begin(), arcflags_exempt_reverse_.end(), opp_edge_id) ==
+          arcflags_exempt_reverse_.end()) {
+    return false;
+  }
+
   // Skip this edge if no access is allowed (based on costing method)
   // or if a complex restriction prevents transition onto this edge.
+  const sif::CostCalls<CostT> costing(*costing_);
   bool has_time_restrictions = false;
-  if (!costing_->AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, 0, 0,
-                                has_time_restrictions) ||
+  if (!costing.AllowedReverse(meta.edge, pred, opp_edge, t2, opp_edge_id, 0, 0,
+                              has_time_restrictions) ||
       costing_->Restricted(meta.edge, pred, edgelabels_reverse_, tile, meta.edge_id, false)) {
     return false;
   }
@@ -431,8 +550,8 @@ inline bool BidirectionalAStar::ExpandReverseInner(GraphReader& graphreader,
   // Get cost. Use opposing edge for EdgeCost. Separate the transition seconds so we
   // can properly recover elapsed time on the reverse path.
   Cost tc =
-      costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge, opp_pred_edge);
-  Cost newcost = pred.cost() + costing_->EdgeCost(opp_edge, t2, kConstrainedFlowSecondOfDay);
+      costing.TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge, opp_pred_edge);
+  Cost newcost = pred.cost() + costing.EdgeCost(opp_edge, t2, kConstrainedFlowSecondOfDay);
   newcost.cost += tc.cost;
 
   // Check if edge is temporarily labeled and this path has less cost. If
@@ -485,6 +604,17 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   travel_type_ = costing_->travel_type();
   access_mode_ = costing_->access_mode();
+  desired_alternates_ = options.alternates();
+
+  // Use the expansion loops specialized for the costing, if any
+  expand_forward_ =
+      SelectByCostType<ExpandForwardFn>(*costing_, &BidirectionalAStar::ExpandForward<AutoCost>,
+                                        &BidirectionalAStar::ExpandForward<TruckCost>,
+                                        &BidirectionalAStar::ExpandForward<DynamicCost>);
+  expand_reverse_ =
+      SelectByCostType<ExpandReverseFn>(*costing_, &BidirectionalAStar::ExpandReverse<AutoCost>,
+                                        &BidirectionalAStar::ExpandReverse<TruckCost>,
+                                        &BidirectionalAStar::ExpandReverse<DynamicCost>);
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   PointLL origin_new(origin.path_edges(0).ll().lng(), origin.path_edges(0).ll().lat());
@@ -499,6 +629,43 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   SetOrigin(graphreader, origin);
   SetDestination(graphreader, destination);
 
+  // Report the memory reserved for the searches
+  UpdateMemory(true);
+  UpdateMemory(false);
+
+  const float local_radius =
+      hierarchy_limits_forward_[TileHierarchy::levels().rbegin()->first].expansion_within_dist;
+  arcflags_forward_mask_ = GetArcFlagsMask(graphreader, destination, true, local_radius);
+  arcflags_reverse_mask_ = GetArcFlagsMask(graphreader, origin, false, local_radius);
+  RelaxArcFlagHierarchyLimits(hierarchy_limits_forward_, arcflags_forward_mask_);
+  RelaxArcFlagHierarchyLimits(hierarchy_limits_reverse_, arcflags_reverse_mask_);
+  arcflags_exempt_forward_.clear();
+  for (const auto& edge : destination.path_edges()) {
+    arcflags_exempt_forward_.emplace_back(edge.graph_id());
+  }
+  arcflags_exempt_reverse_.clear();
+  for (const auto& edge : origin.path_edges()) {
+    arcflags_exempt_reverse_.emplace_back(edge.graph_id());
+  }
+
+  // Run the forward and reverse searches concurrently if enabled. Short routes are
+  // expanded on this thread, as are searches reporting expansion (the callback is
+  // not thread safe) and searches for alternates (which keep all connections).
+  if (reverse_reader_ && !expansion_callback_ && desired_alternates_ == 0 &&
+      origin_new.Distance(destination_new) > parallel_min_distance_) {
+    if (ExpandParallel(graphreader)) {
+      if (best_connection_.cost == std::numeric_limits<float>::max()) {
+        // No route found.
+        LOG_ERROR("Bi-directional route failure - search exhausted: n = " +
+                  std::to_string(edgelabels_forward_.size()) + "," +
+                  std::to_string(edgelabels_reverse_.size()));
+        return {};
+      }
+      return FormPath(graphreader, options);
+    }
+    // Otherwise one of the searches ran out of room - continue both below
+  }
+
   // Find shortest path. Switch between a forward direction and a reverse
   // direction search based on the current costs. Alternating like this
   // prevents one tree from expanding much more quickly (if in a sparser
@@ -510,9 +677,13 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
   bool expand_forward = true;
   bool expand_reverse = true;
   while (true) {
-    // Allow this process to be aborted
-    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
-      (*interrupt)();
+    // Allow this process to be aborted, check the memory it holds
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory(true);
+      UpdateMemory(false);
     }
 
     // Get the next predecessor (based on which direction was expanded in prior step)
@@ -528,9 +699,10 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
         // Check if the edge on the forward search connects to a settled edge on the
         // reverse search tree. Do not expand further past this edge since it will just
-        // result in other connections.
+        // result in other connections - unless looking for alternates, which need the
+        // search trees to overlap.
         if (edgestatus_reverse_.Get(fwd_pred.opp_edgeid()).set() == EdgeSet::kPermanent) {
-          if (SetForwardConnection(graphreader, fwd_pred)) {
+          if (SetForwardConnection(graphreader, fwd_pred) && desired_alternates_ == 0) {
             continue;
           }
         }
@@ -558,9 +730,9 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
 
         // Check if the edge on the reverse search connects to a settled edge on the
         // forward search tree. Do not expand further past this edge since it will just
-        // result in other connections.
+        // result in other connections - unless looking for alternates.
         if (edgestatus_forward_.Get(rev_pred.opp_edgeid()).set() == EdgeSet::kPermanent) {
-          if (SetReverseConnection(graphreader, rev_pred)) {
+          if (SetReverseConnection(graphreader, rev_pred) && desired_alternates_ == 0) {
             continue;
           }
         }
@@ -599,7 +771,7 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
       }
 
       // Expand from the end node in forward direction.
-      ExpandForward(graphreader, fwd_pred.endnode(), fwd_pred, forward_pred_idx, false);
+      (this->*expand_forward_)(graphreader, fwd_pred.endnode(), fwd_pred, forward_pred_idx, false);
     } else {
       // Expand reverse - set to get next edge from reverse adj. list on the next pass
       expand_forward = false;
@@ -625,8 +797,8 @@ BidirectionalAStar::GetBestPath(valhalla::Location& origin,
           graphreader.GetGraphTile(rev_pred.opp_edgeid())->directededge(rev_pred.opp_edgeid());
 
       // Expand from the end node in reverse direction.
-      ExpandReverse(graphreader, rev_pred.endnode(), rev_pred, reverse_pred_idx, opp_pred_edge,
-                    false);
+      (this->*expand_reverse_)(graphreader, rev_pred.endnode(), rev_pred, reverse_pred_idx,
+                               opp_pred_edge, false);
     }
   }
   return {}; // If we are here the route failed
@@ -645,31 +817,23 @@ bool BidirectionalAStar::SetForwardConnection(GraphReader& graphreader, const BD
 
   // Get the opposing edge - a candidate shortest path has been found to the
   // end node of this directed edge. Get total cost.
-  float c;
   GraphId oppedge = pred.opp_edgeid();
-  EdgeStatusInfo oppedgestatus = edgestatus_reverse_.Get(oppedge);
-  if (pred.predecessor() != kInvalidLabel) {
-    // Get the start of the predecessor edge on the forward path. Cost is to
-    // the end this edge, plus the cost to the end of the reverse predecessor,
-    // plus the transition cost.
-    c = edgelabels_forward_[pred.predecessor()].cost().cost +
-        edgelabels_reverse_[oppedgestatus.index()].cost().cost + pred.transition_cost();
-  } else {
-    // If no predecessor on the forward path get the predecessor on
-    // the reverse path to form the cost.
-    uint32_t predidx = edgelabels_reverse_[oppedgestatus.index()].predecessor();
-    float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels_reverse_[predidx].cost().cost;
-    c = pred.cost().cost + oppcost + edgelabels_reverse_[oppedgestatus.index()].transition_cost();
-  }
+  float c = ForwardConnectionCost(pred, edgestatus_reverse_.Get(oppedge).index());
 
   // Set best_connection if cost is less than the best cost so far.
   if (c < best_connection_.cost) {
     best_connection_ = {pred.edgeid(), oppedge, c};
   }
+  if (desired_alternates_ > 0) {
+    candidates_.push_back({pred.edgeid(), oppedge, c});
+  }
 
-  // Set a threshold to extend search
+  // Set a threshold to extend search. Alternates may cost more than the best path.
   if (threshold_ == std::numeric_limits<float>::max()) {
     threshold_ = pred.sortcost() + cost_diff_ + kThresholdDelta;
+    if (desired_alternates_ > 0) {
+      threshold_ += c * kAlternateMaxStretch;
+    }
   }
 
   // setting this edge as connected
@@ -693,31 +857,23 @@ bool BidirectionalAStar::SetReverseConnection(GraphReader& graphreader, const BD
 
   // Get the opposing edge - a candidate shortest path has been found to the
   // end node of this directed edge. Get total cost.
-  float c;
   GraphId oppedge = pred.opp_edgeid();
-  EdgeStatusInfo oppedgestatus = edgestatus_forward_.Get(oppedge);
-  if (pred.predecessor() != kInvalidLabel) {
-    // Get the start of the predecessor edge on the reverse path. Cost is to
-    // the end this edge, plus the cost to the end of the forward predecessor,
-    // plus the transition cost.
-    c = edgelabels_reverse_[pred.predecessor()].cost().cost +
-        edgelabels_forward_[oppedgestatus.index()].cost().cost + pred.transition_cost();
-  } else {
-    // If no predecessor on the reverse path get the predecessor on
-    // the forward path to form the cost.
-    uint32_t predidx = edgelabels_forward_[oppedgestatus.index()].predecessor();
-    float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels_forward_[predidx].cost().cost;
-    c = pred.cost().cost + oppcost + edgelabels_forward_[oppedgestatus.index()].transition_cost();
-  }
+  float c = ReverseConnectionCost(pred, edgestatus_forward_.Get(oppedge).index());
 
   // Set best_connection if cost is less than the best cost so far.
   if (c < best_connection_.cost) {
     best_connection_ = {oppedge, pred.edgeid(), c};
   }
+  if (desired_alternates_ > 0) {
+    candidates_.push_back({oppedge, pred.edgeid(), c});
+  }
 
-  // Set a threshold to extend search
+  // Set a threshold to extend search. Alternates may cost more than the best path.
   if (threshold_ == std::numeric_limits<float>::max()) {
     threshold_ = pred.sortcost() + kThresholdDelta;
+    if (desired_alternates_ > 0) {
+      threshold_ += c * kAlternateMaxStretch;
+    }
   }
 
   // setting this edge as connected, sending the opposing because this is the reverse tree
@@ -728,6 +884,229 @@ bool BidirectionalAStar::SetReverseConnection(GraphReader& graphreader, const BD
   return true;
 }
 
+// Get the cost of the path through a forward edge label connecting to a
+// settled edge on the reverse search tree.
+float BidirectionalAStar::ForwardConnectionCost(const BDEdgeLabel& pred,
+                                                const uint32_t opp_idx) const {
+  if (pred.predecessor() != kInvalidLabel) {
+    // Get the start of the predecessor edge on the forward path. Cost is to
+    // the end this edge, plus the cost to the end of the reverse predecessor,
+    // plus the transition cost.
+    return edgelabels_forward_[pred.predecessor()].cost().cost +
+           edgelabels_reverse_[opp_idx].cost().cost + pred.transition_cost();
+  }
+
+  // If no predecessor on the forward path get the predecessor on
+  // the reverse path to form the cost.
+  uint32_t predidx = edgelabels_reverse_[opp_idx].predecessor();
+  float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels_reverse_[predidx].cost().cost;
+  return pred.cost().cost + oppcost + edgelabels_reverse_[opp_idx].transition_cost();
+}
+
+// Get the cost of the path through a reverse edge label connecting to a
+// settled edge on the forward search tree.
+float BidirectionalAStar::ReverseConnectionCost(const BDEdgeLabel& pred,
+                                                const uint32_t opp_idx) const {
+  if (pred.predecessor() != kInvalidLabel) {
+    // Get the start of the predecessor edge on the reverse path. Cost is to
+    // the end this edge, plus the cost to the end of the forward predecessor,
+    // plus the transition cost.
+    return edgelabels_reverse_[pred.predecessor()].cost().cost +
+           edgelabels_forward_[opp_idx].cost().cost + pred.transition_cost();
+  }
+
+  // If no predecessor on the reverse path get the predecessor on
+  // the forward path to form the cost.
+  uint32_t predidx = edgelabels_forward_[opp_idx].predecessor();
+  float oppcost = (predidx == kInvalidLabel) ? 0 : edgelabels_forward_[predidx].cost().cost;
+  return pred.cost().cost + oppcost + edgelabels_forward_[opp_idx].transition_cost();
+}
+
+// Run the forward search on this thread and the reverse search on another.
+bool BidirectionalAStar::ExpandParallel(GraphReader& graphreader) {
+  settled_forward_.clear();
+  settled_reverse_.clear();
+  shared_best_cost_ = best_connection_.cost;
+  shared_threshold_ = threshold_;
+  stop_parallel_ = false;
+  best_reverse_connection_ = best_connection_;
+
+  // Expand the reverse search on another thread. Any exception is passed back
+  // to this thread once joined.
+  SearchState reverse_state = SearchState::kStopped;
+  std::exception_ptr reverse_exception;
+  std::thread reverse_thread([this, &reverse_state, &reverse_exception]() {
+    try {
+      reverse_state = ParallelReverse(*reverse_reader_);
+    } catch (...) {
+      reverse_exception = std::current_exception();
+      stop_parallel_ = true;
+    }
+  });
+
+  // Expand the forward search on this thread. If interrupted stop the reverse
+  // search before passing the exception on.
+  SearchState forward_state;
+  try {
+    forward_state = ParallelForward(graphreader);
+  } catch (...) {
+    stop_parallel_ = true;
+    reverse_thread.join();
+    throw;
+  }
+  reverse_thread.join();
+  if (reverse_exception) {
+    std::rethrow_exception(reverse_exception);
+  }
+
+  // Keep the best connection found by either search
+  if (best_reverse_connection_.cost < best_connection_.cost) {
+    best_connection_ = best_reverse_connection_;
+  }
+  threshold_ = shared_threshold_;
+
+  // Complete if either search is exhausted or both exceeded the threshold
+  return forward_state == SearchState::kExhausted || reverse_state == SearchState::kExhausted ||
+         (forward_state == SearchState::kThreshold && reverse_state == SearchState::kThreshold);
+}
+
+// Expand the forward search until it exceeds the shared threshold or is stopped.
+BidirectionalAStar::SearchState BidirectionalAStar::ParallelForward(GraphReader& graphreader) {
+  int n = 0;
+  while (!stop_parallel_) {
+    // Allow this process to be aborted, check the memory it holds
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory(true);
+    }
+
+    // Stop if the edge labels could be reallocated or settled edges could not be
+    // published. The searches are then continued on one thread.
+    if (edgelabels_forward_.capacity() - edgelabels_forward_.size() < kMaxLabelsPerExpansion ||
+        settled_forward_.full()) {
+      stop_parallel_ = true;
+      return SearchState::kOverflow;
+    }
+
+    // Get the next predecessor. Stop both searches if exhausted.
+    uint32_t pred_idx = adjacencylist_forward_->pop();
+    if (pred_idx == kInvalidLabel) {
+      stop_parallel_ = true;
+      return SearchState::kExhausted;
+    }
+    BDEdgeLabel pred = edgelabels_forward_[pred_idx];
+
+    // Terminate if the cost threshold has been exceeded.
+    if (pred.sortcost() + cost_diff_ > shared_threshold_) {
+      return SearchState::kThreshold;
+    }
+
+    // Settle this edge and publish it before checking if it connects to a settled
+    // edge on the reverse search tree. Since both searches publish before they
+    // check, at least one of them sees the connection. Do not expand further past
+    // a connection.
+    edgestatus_forward_.Update(pred.edgeid(), EdgeSet::kPermanent);
+    settled_forward_.Set(pred.edgeid(), pred_idx, graphreader.GetGraphTile(pred.edgeid()));
+    uint32_t opp_idx;
+    if (!pred.on_complex_rest() && settled_reverse_.Get(pred.opp_edgeid(), opp_idx)) {
+      float c = ForwardConnectionCost(pred, opp_idx);
+      if (UpdateSharedConnection(c, pred.sortcost() + cost_diff_ + kThresholdDelta)) {
+        best_connection_ = {pred.edgeid(), pred.opp_edgeid(), c};
+      }
+      continue;
+    }
+
+    // Prune path if predecessor is not a through edge or if the maximum
+    // number of upward transitions has been exceeded on this hierarchy level.
+    if ((pred.not_thru() && pred.not_thru_pruning()) ||
+        hierarchy_limits_forward_[pred.endnode().level()].StopExpanding()) {
+      continue;
+    }
+
+    // Expand from the end node in forward direction.
+    (this->*expand_forward_)(graphreader, pred.endnode(), pred, pred_idx, false);
+  }
+  return SearchState::kStopped;
+}
+
+// Expand the reverse search until it exceeds the shared threshold or is stopped.
+BidirectionalAStar::SearchState BidirectionalAStar::ParallelReverse(GraphReader& graphreader) {
+  int n = 0;
+  while (!stop_parallel_) {
+    // Check the memory this search holds, the interrupt is only called from the
+    // forward search thread
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      UpdateMemory(false);
+    }
+
+    // Stop if the edge labels could be reallocated or settled edges could not be
+    // published. The searches are then continued on one thread.
+    if (edgelabels_reverse_.capacity() - edgelabels_reverse_.size() < kMaxLabelsPerExpansion ||
+        settled_reverse_.full()) {
+      stop_parallel_ = true;
+      return SearchState::kOverflow;
+    }
+
+    // Get the next predecessor. Stop both searches if exhausted.
+    uint32_t pred_idx = adjacencylist_reverse_->pop();
+    if (pred_idx == kInvalidLabel) {
+      stop_parallel_ = true;
+      return SearchState::kExhausted;
+    }
+    BDEdgeLabel pred = edgelabels_reverse_[pred_idx];
+
+    // Terminate if the cost threshold has been exceeded.
+    if (pred.sortcost() > shared_threshold_) {
+      return SearchState::kThreshold;
+    }
+
+    // Settle this edge and publish it before checking if it connects to a settled
+    // edge on the forward search tree.
+    edgestatus_reverse_.Update(pred.edgeid(), EdgeSet::kPermanent);
+    settled_reverse_.Set(pred.edgeid(), pred_idx, graphreader.GetGraphTile(pred.edgeid()));
+    uint32_t opp_idx;
+    if (!pred.on_complex_rest() && settled_forward_.Get(pred.opp_edgeid(), opp_idx)) {
+      float c = ReverseConnectionCost(pred, opp_idx);
+      if (UpdateSharedConnection(c, pred.sortcost() + kThresholdDelta)) {
+        best_reverse_connection_ = {pred.opp_edgeid(), pred.edgeid(), c};
+      }
+      continue;
+    }
+
+    // Prune path if predecessor is not a through edge
+    if ((pred.not_thru() && pred.not_thru_pruning()) ||
+        hierarchy_limits_reverse_[pred.endnode().level()].StopExpanding()) {
+      continue;
+    }
+
+    // Get the opposing predecessor directed edge. Need to make sure we get
+    // the correct one if a transition occurred
+    const DirectedEdge* opp_pred_edge =
+        graphreader.GetGraphTile(pred.opp_edgeid())->directededge(pred.opp_edgeid());
+
+    // Expand from the end node in reverse direction.
+    (this->*expand_reverse_)(graphreader, pred.endnode(), pred, pred_idx, opp_pred_edge, false);
+  }
+  return SearchState::kStopped;
+}
+
+// Lower the shared best connection cost and set the shared threshold on the
+// first connection.
+bool BidirectionalAStar::UpdateSharedConnection(const float cost, const float threshold) {
+  float max_threshold = std::numeric_limits<float>::max();
+  shared_threshold_.compare_exchange_strong(max_threshold, threshold);
+
+  float best = shared_best_cost_;
+  while (cost < best) {
+    if (shared_best_cost_.compare_exchange_weak(best, cost)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Add edges at the origin to the forward adjacency list.
 void BidirectionalAStar::SetOrigin(GraphReader& graphreader, valhalla::Location& origin) {
   // Only skip inbound edges if we have other options
@@ -878,28 +1257,100 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader, const valhalla
   }
 }
 
-// Form the path from the adjacency list.
+// Check whether a path goes along an edge or through a node more than once.
+bool PathLoops(GraphReader& graphreader, const std::vector<PathInfo>& path) {
+  std::unordered_set<GraphId> edges, nodes;
+  for (size_t i = 0; i < path.size(); ++i) {
+    if (!edges.insert(path[i].edgeid).second) {
+      return true;
+    }
+    if (i + 1 < path.size()) {
+      const GraphTile* tile = graphreader.GetGraphTile(path[i].edgeid);
+      if (tile == nullptr) {
+        continue;
+      }
+      if (!nodes.insert(tile->directededge(path[i].edgeid)->endnode()).second) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Form the path from the adjacency list. If alternates are requested add the
+// paths through the other connections that pass the alternate tests.
 std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& graphreader,
                                                                 const valhalla::Options&) {
-  // Get the indexes where the connection occurs.
-  uint32_t idx1 = edgestatus_forward_.Get(best_connection_.edgeid).index();
-  uint32_t idx2 = edgestatus_reverse_.Get(best_connection_.opp_edgeid).index();
-
-  // Metrics (TODO - more accurate cost)
-  uint32_t pathcost = edgelabels_forward_[idx1].cost().cost + edgelabels_reverse_[idx2].cost().cost;
-  LOG_DEBUG("path_cost::" + std::to_string(pathcost));
+  LOG_DEBUG("path_cost::" + std::to_string(best_connection_.cost));
   LOG_DEBUG("FormPath path_iterations::" + std::to_string(edgelabels_forward_.size()) + "," +
             std::to_string(edgelabels_reverse_.size()));
 
+  std::vector<std::vector<PathInfo>> paths(1);
+  std::vector<GraphId> opp_edges;
+  FormConnectionPath(best_connection_, paths.front(), opp_edges);
+  if (desired_alternates_ == 0 || candidates_.empty()) {
+    return paths;
+  }
+
+  // Edges used by the paths chosen so far
+  std::unordered_set<GraphId> used;
+  for (const auto& info : paths.front()) {
+    used.insert(info.edgeid);
+  }
+
+  // Try the connections from the least cost up. Connections on a chosen path
+  // give paths sharing too much with it and are skipped.
+  const float best_cost = paths.front().back().elapsed_cost;
+  const float max_cost = best_cost * (1.0f + kAlternateMaxStretch);
+  std::sort(candidates_.begin(), candidates_.end());
+  std::vector<PathInfo> path;
+  for (const auto& candidate : candidates_) {
+    if (paths.size() > desired_alternates_ || candidate.cost > max_cost) {
+      break;
+    }
+    if (used.count(candidate.edgeid)) {
+      continue;
+    }
+
+    // No loops, bounded stretch, limited sharing and local optimality. The search
+    // trees can meet at a detour off a path, e.g. into a dead end and back.
+    const bool has_ferry = has_ferry_;
+    const size_t via_idx = FormConnectionPath(candidate, path, opp_edges);
+    if (PathLoops(graphreader, path) || path.back().elapsed_cost > max_cost ||
+        SharedCost(path, used) > best_cost * kAlternateMaxSharing ||
+        PlateauCost(path, opp_edges, via_idx) < best_cost * kAlternateMinPlateau) {
+      has_ferry_ = has_ferry;
+      continue;
+    }
+    for (const auto& info : path) {
+      used.insert(info.edgeid);
+    }
+    paths.emplace_back(std::move(path));
+    path.clear();
+  }
+  LOG_DEBUG("FormPath alternates::" + std::to_string(paths.size() - 1) + " of " +
+            std::to_string(candidates_.size()) + " connections");
+  return paths;
+}
+
+// Form the path through a connection of the forward and reverse search trees.
+size_t BidirectionalAStar::FormConnectionPath(const CandidateConnection& connection,
+                                              std::vector<PathInfo>& path,
+                                              std::vector<GraphId>& opp_edges) {
+  path.clear();
+  opp_edges.clear();
+
+  // Get the indexes where the connection occurs.
+  uint32_t idx1 = edgestatus_forward_.Get(connection.edgeid).index();
+  uint32_t idx2 = edgestatus_reverse_.Get(connection.opp_edgeid).index();
+
   // Work backwards on the forward path
-  std::vector<std::vector<PathInfo>> paths;
-  paths.emplace_back();
-  std::vector<PathInfo>& path = paths.back();
   for (auto edgelabel_index = idx1; edgelabel_index != kInvalidLabel;
        edgelabel_index = edgelabels_forward_[edgelabel_index].predecessor()) {
     const BDEdgeLabel& edgelabel = edgelabels_forward_[edgelabel_index];
     path.emplace_back(edgelabel.mode(), edgelabel.cost().secs, edgelabel.edgeid(), 0,
                       edgelabel.cost().cost, edgelabel.has_time_restriction());
+    opp_edges.push_back(edgelabel.opp_edgeid());
 
     // Check if this is a ferry
     if (edgelabel.use() == Use::kFerry) {
@@ -909,6 +1360,8 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
 
   // Reverse the list
   std::reverse(path.begin(), path.end());
+  std::reverse(opp_edges.begin(), opp_edges.end());
+  const size_t via_idx = path.size() - 1;
 
   // Special case code if the last edge of the forward path is
   // the destination edge - update the elapsed time
@@ -924,7 +1377,7 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
       path.back().elapsed_time = edgelabels_reverse_[idx2].cost().secs;
       path.back().elapsed_cost = edgelabels_reverse_[idx2].cost().cost;
     }
-    return paths;
+    return via_idx;
   }
 
   // Get the elapsed time at the end of the forward path. NOTE: PathInfo
@@ -954,6 +1407,7 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     cost += tc;
     path.emplace_back(edgelabel.mode(), cost.secs, edgelabel.opp_edgeid(), 0, cost.cost,
                       edgelabel.has_time_restriction());
+    opp_edges.push_back(edgelabel.edgeid());
 
     // Check if this is a ferry
     if (edgelabel.use() == Use::kFerry) {
@@ -965,7 +1419,41 @@ std::vector<std::vector<PathInfo>> BidirectionalAStar::FormPath(GraphReader& gra
     tc.secs = edgelabel.transition_secs();
     tc.cost = edgelabel.transition_cost();
   }
-  return paths;
+  return via_idx;
+}
+
+// Get the cost of the plateau around the connecting edge of a path: the edges
+// before it whose opposing edges are on the reverse search tree and the edges
+// after it that are on the forward search tree, following the path.
+float BidirectionalAStar::PlateauCost(const std::vector<PathInfo>& path,
+                                      const std::vector<GraphId>& opp_edges,
+                                      const size_t via_idx) const {
+  size_t first = via_idx;
+  while (first > 0) {
+    EdgeStatusInfo status = edgestatus_reverse_.Get(opp_edges[first - 1]);
+    if (status.set() == EdgeSet::kUnreached) {
+      break;
+    }
+    uint32_t predidx = edgelabels_reverse_[status.index()].predecessor();
+    if (predidx == kInvalidLabel || edgelabels_reverse_[predidx].edgeid() != opp_edges[first]) {
+      break;
+    }
+    --first;
+  }
+
+  size_t last = via_idx;
+  while (last + 1 < path.size()) {
+    EdgeStatusInfo status = edgestatus_forward_.Get(path[last + 1].edgeid);
+    if (status.set() == EdgeSet::kUnreached) {
+      break;
+    }
+    uint32_t predidx = edgelabels_forward_[status.index()].predecessor();
+    if (predidx == kInvalidLabel || edgelabels_forward_[predidx].edgeid() != path[last].edgeid) {
+      break;
+    }
+    ++last;
+  }
+  return path[last].elapsed_cost - (first > 0 ? path[first - 1].elapsed_cost : 0.0f);
 }
 
 } // namespace thor
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+
+#include "midgard/logging.h"
+#include "sif/costdispatch.h"
+#include "thor/bucketmatrix.h"
+#include "worker.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+// Protect against a forward search never ending. This should never occur.
+constexpr uint32_t kMaxSearchIterations = 2000000;
+
+// Run a function for each index in [0, count) on the calling thread and one
+// thread per additional graph reader. Indexes are interleaved over the threads.
+// The calling thread checks the interrupt before each of its indexes, the other
+// threads the thread safe interrupt. After an exception the threads stop taking
+// indexes, it is rethrown on the calling thread once all threads are joined.
+void ParallelFor(const uint32_t count,
+                 GraphReader& graphreader,
+                 const std::vector<std::shared_ptr<GraphReader>>& readers,
+                 const std::function<void()>* interrupt,
+                 const std::function<void()>* thread_interrupt,
+                 const std::function<void(uint32_t, GraphReader&)>& func) {
+  uint32_t thread_count =
+      std::max(std::min(static_cast<uint32_t>(readers.size() + 1), count), static_cast<uint32_t>(1));
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::atomic<bool> failed(false);
+  auto work = [&](const uint32_t thread) {
+    GraphReader& reader = thread == 0 ? graphreader : *readers[thread - 1];
+    try {
+      for (uint32_t i = thread; i < count && !failed; i += thread_count) {
+        const auto* check = thread == 0 ? interrupt : thread_interrupt;
+        if (check) {
+          (*check)();
+        }
+        func(i, reader);
+      }
+    } catch (...) {
+      errors[thread] = std::current_exception();
+      failed = true;
+    }
+  };
+
+  std::vector<std::shared_ptr<std::thread>> threads(thread_count - 1);
+  for (uint32_t i = 1; i < thread_count; ++i) {
+    threads[i - 1].reset(new std::thread(work, i));
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+// Form a time distance matrix from the set of source locations
+// to the set of target locations.
+std::vector<TimeDistance> BucketMatrix::SourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    GraphReader& graphreader,
+    const std::shared_ptr<DynamicCost>* mode_costing,
+    const TravelMode mode,
+    const float max_matrix_distance) {
+  // Set the mode and costing
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  access_mode_ = costing_->access_mode();
+
+  current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+
+  // Set the source and target locations and initialize best connections
+  // and status.
+  Clear();
+  SetSources(graphreader, source_location_list);
+  SetTargets(graphreader, target_location_list);
+  Initialize(source_location_list, target_location_list);
+  truncated_.assign(target_count_, false);
+
+  // Bound the backward search of each target by the cost threshold of its
+  // farthest source, forward searches connect past the edges it settles
+  for (uint32_t target = 0; target < target_count_; target++) {
+    const auto& ll = target_location_list.Get(target).ll();
+    const PointLL target_ll(ll.lng(), ll.lat());
+    float max_distance = 0.0f;
+    for (const auto& source : source_location_list) {
+      max_distance =
+          std::max(max_distance, target_ll.Distance(PointLL(source.ll().lng(), source.ll().lat())));
+    }
+    target_cost_threshold_[target] =
+        std::min(current_cost_threshold_, GetCostThreshold(max_distance));
+  }
+
+  // Use the search loops specialized for the costing, if any
+  forward_search_ = SelectByCostType(*costing_, &BucketMatrix::ForwardSearch<AutoCost>,
+                                     &BucketMatrix::ForwardSearch<TruckCost>,
+                                     &BucketMatrix::ForwardSearch<DynamicCost>);
+  backward_search_ = SelectByCostType(*costing_, &BucketMatrix::BackwardSearch<AutoCost>,
+                                      &BucketMatrix::BackwardSearch<TruckCost>,
+                                      &BucketMatrix::BackwardSearch<DynamicCost>);
+
+  // Fill the buckets from all targets. The edges reached by each target are
+  // added to the buckets in target order once all backward searches are done.
+  ParallelFor(target_count_, graphreader, thread_readers_, interrupt_, thread_interrupt_,
+              [this](const uint32_t index, GraphReader& reader) { FillBuckets(index, reader); });
+  for (uint32_t i = 0; i < target_count_; i++) {
+    for (const auto& edgeid : target_reached_[i]) {
+      AddTarget(edgeid, i);
+    }
+    target_reached_[i].clear();
+  }
+  UpdateTargetsMemory();
+
+  // Scan the buckets from all sources. Each source only updates its own
+  // status and row of best connections.
+  ParallelFor(source_count_, graphreader, thread_readers_, interrupt_, thread_interrupt_,
+              [this](const uint32_t index, GraphReader& reader) { ScanBuckets(index, reader); });
+
+  // Pairs that are not connected may be because the backward search of their
+  // target was cut short. Compute them with CostMatrix, only the sources not
+  // connected to each such target.
+  auto td = FormTimeDistanceMatrix();
+  CostMatrix matrix;
+  matrix.set_thread_readers(thread_readers_);
+  matrix.set_interrupt(interrupt_);
+  matrix.set_thread_interrupt(thread_interrupt_);
+  matrix.set_memory(memory_);
+  for (uint32_t target = 0; target < target_count_; target++) {
+    if (!truncated_[target]) {
+      continue;
+    }
+    std::vector<uint32_t> sources;
+    google::protobuf::RepeatedPtrField<valhalla::Location> retry_sources, retry_target;
+    for (uint32_t source = 0; source < source_count_; source++) {
+      if (best_connection_[source * target_count_ + target].cost.cost == kMaxCost) {
+        sources.push_back(source);
+        retry_sources.Add()->CopyFrom(source_location_list.Get(source));
+      }
+    }
+    if (sources.empty()) {
+      continue;
+    }
+    LOG_DEBUG("BucketMatrix retries " + std::to_string(sources.size()) + " sources to target " +
+              std::to_string(target));
+    retry_target.Add()->CopyFrom(target_location_list.Get(target));
+    auto retry = matrix.SourceToTarget(retry_sources, retry_target, graphreader, mode_costing, mode,
+                                       max_matrix_distance);
+    for (uint32_t i = 0; i < sources.size(); i++) {
+      td[sources[i] * target_count_ + target] = retry[i];
+    }
+  }
+  return td;
+}
+
+// Expand the backward search from a target.
+void BucketMatrix::FillBuckets(const uint32_t index, GraphReader& graphreader) {
+  // Nothing to connect to this target
+  if (target_status_[index].remaining_locations.empty()) {
+    return;
+  }
+
+  while (target_status_[index].threshold > 0) {
+    if (max_bucket_labels_ > 0 && target_edgelabel_[index].size() >= max_bucket_labels_) {
+      truncated_[index] = true;
+      break;
+    }
+    target_status_[index].threshold--;
+    (this->*backward_search_)(index, graphreader);
+    UpdateMemory(false, index);
+  }
+
+  // Stopping at a cost threshold lower than the one of the matrix cuts the search short too
+  if (!target_exhausted_[index] && target_cost_threshold_[index] < current_cost_threshold_) {
+    truncated_[index] = true;
+  }
+  target_exhausted_[index] = false;
+}
+
+// Expand the forward search from a source.
+void BucketMatrix::ScanBuckets(const uint32_t index, GraphReader& graphreader) {
+  // Nothing to connect to this source
+  if (source_status_[index].remaining_locations.empty()) {
+    return;
+  }
+
+  // Target status is not used once the buckets are filled so updates of it
+  // are dropped
+  uint32_t n = 0;
+  while (source_status_[index].threshold > 0) {
+    source_status_[index].threshold--;
+    (this->*forward_search_)(index, n, graphreader);
+    UpdateMemory(true, index);
+    target_updates_[index].clear();
+    if (++n >= kMaxSearchIterations) {
+      throw valhalla_exception_t{430};
+    }
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
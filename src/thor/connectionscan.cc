@@ -0,0 +1,508 @@
+#include "thor/connectionscan.h"
+#include "baldr/datetime.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "midgard/util.h"
+#include <algorithm>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+// Seconds to change trips at the stop the first trip arrives at
+constexpr uint32_t kInStationTransferTime = 30;
+
+// Default constructor
+ConnectionScan::ConnectionScan()
+    : PathAlgorithm(), start_time_(0), start_tz_index_(0), max_transfer_distance_(0),
+      best_arrival_(kUnreachedTime), adjacencylist_(nullptr) {
+}
+
+// Destructor
+ConnectionScan::~ConnectionScan() {
+  Clear();
+}
+
+// Clear the temporary information generated during path construction.
+void ConnectionScan::Clear() {
+  // Release the memory of the search from the budget
+  if (memory_) {
+    memory_->Release(memory_held_);
+  }
+
+  walks_.clear();
+  trips_.clear();
+  best_stops_.clear();
+  destinations_.clear();
+  adjacencylist_.reset();
+  edgestatus_.clear();
+  walk_stats_ = {};
+  has_ferry_ = false;
+}
+
+// Report the memory held by the search.
+void ConnectionScan::UpdateMemory() {
+  if (!memory_) {
+    return;
+  }
+  size_t bytes = best_stops_.capacity() * sizeof(uint32_t) + edgestatus_.memory() +
+                 (adjacencylist_ ? adjacencylist_->memory() : 0);
+  for (const auto& walk : walks_) {
+    bytes += walk.edgelabels.capacity() * sizeof(EdgeLabel) +
+             walk.seeds.capacity() * sizeof(uint32_t) + walk.stops.capacity() * sizeof(StopArrival);
+  }
+  for (const auto& trips : trips_) {
+    bytes += trips.capacity() * sizeof(TripArrival);
+  }
+  memory_->Update(memory_held_, bytes);
+}
+
+// Get the counters of the search since it was last initialized.
+SearchStats ConnectionScan::stats() const {
+  SearchStats stats = walk_stats_;
+  if (adjacencylist_) {
+    stats.Add(*adjacencylist_);
+  }
+  return stats;
+}
+
+// Calculate the best path and the other Pareto optimal options.
+std::vector<std::vector<PathInfo>>
+ConnectionScan::GetBestPath(valhalla::Location& origin,
+                            valhalla::Location& destination,
+                            GraphReader& graphreader,
+                            const std::shared_ptr<DynamicCost>* mode_costing,
+                            const TravelMode mode,
+                            const Options& options) {
+  // Walks use the pedestrian costing, allowing transit connections
+  const auto& pc = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  pc->SetAllowTransitConnections(true);
+  pc->UseMaxMultiModalDistance();
+  const auto& tc = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  max_transfer_distance_ = mode_costing[static_cast<uint32_t>(mode)]->GetMaxTransferDistanceMM();
+
+  // For now the date_time must be set on the origin.
+  if (!origin.has_date_time()) {
+    return {};
+  }
+
+  // Walk from the origin (round 0)
+  Clear();
+  walks_.emplace_back();
+  SetDestination(graphreader, destination, pc);
+  SetOrigin(graphreader, origin, destination, pc);
+  if (walks_[0].edgelabels.empty()) {
+    return {};
+  }
+  start_time_ = DateTime::seconds_from_midnight(origin.date_time());
+  start_tz_index_ = GetTimezone(graphreader, walks_[0].edgelabels[0].endnode());
+  if (start_tz_index_ == 0) {
+    LOG_ERROR("Could not get the timezone at the origin location");
+    return {};
+  }
+  LoadTimetable(graphreader, origin, destination, tc);
+  best_stops_.assign(timetable_->stops().size(), kUnreachedTime);
+  best_arrival_ = kUnreachedTime;
+  walks_[0].stops.resize(timetable_->stops().size());
+  WalkRound(graphreader, 0, pc, tc);
+
+  // Take one more trip each round, then walk from the stops it reaches
+  for (uint32_t round = 1; round <= kMaxTransitRounds; ++round) {
+    float transfer = round == 1 ? tc->DefaultTransferCost().cost : tc->TransferCost().cost;
+    trips_.emplace_back(timetable_->stops().size());
+    UpdateMemory();
+    if (!timetable_->ScanRound(walks_.back().stops, start_time_, transfer, allowed_lines_,
+                               tc->wheelchair(), tc->bicycle(), trips_.back())) {
+      break;
+    }
+    walks_.emplace_back();
+    if (!SetSeeds(graphreader, round)) {
+      walks_.pop_back();
+      break;
+    }
+    WalkRound(graphreader, round, pc, tc);
+  }
+
+  // Each round reaching the destination is a Pareto optimal option, the
+  // lowest cost is the best path and the others are alternates
+  std::vector<uint32_t> rounds;
+  for (uint32_t round = 0; round < walks_.size(); ++round) {
+    if (walks_[round].destination != kInvalidLabel) {
+      rounds.push_back(round);
+    }
+  }
+  if (rounds.empty()) {
+    LOG_ERROR("Route failed after " + std::to_string(walks_.size()) + " rounds");
+    return {};
+  }
+  auto best = std::min_element(rounds.begin(), rounds.end(), [this](uint32_t a, uint32_t b) {
+    return walks_[a].destination_cost < walks_[b].destination_cost;
+  });
+  std::rotate(rounds.begin(), best, best + 1);
+  rounds.resize(std::min<size_t>(rounds.size(), options.alternates() + 1));
+
+  std::vector<std::vector<PathInfo>> paths;
+  for (const auto round : rounds) {
+    paths.emplace_back(FormPath(round));
+  }
+  return paths;
+}
+
+// Get the timetable of the region and day, reusing the last one if the same.
+void ConnectionScan::LoadTimetable(GraphReader& graphreader,
+                                   const valhalla::Location& origin,
+                                   const valhalla::Location& destination,
+                                   const std::shared_ptr<DynamicCost>& tc) {
+  midgard::PointLL origin_ll(origin.ll().lng(), origin.ll().lat());
+  midgard::PointLL destination_ll(destination.ll().lng(), destination.ll().lat());
+  midgard::AABB2<midgard::PointLL> bbox(origin_ll, origin_ll);
+  bbox.Expand(destination_ll);
+  bbox = midgard::ExpandMeters(bbox, kTimetableMargin);
+
+  // The dataset id of each tile is in the key so the timetable is rebuilt when
+  // the tiles are reloaded from another build of the graph
+  const auto& level = TileHierarchy::GetTransitLevel();
+  std::vector<GraphId> tiles;
+  std::string key = origin.date_time().substr(0, 10) + ":" + std::to_string(start_tz_index_);
+  for (const auto tileid : level.tiles.TileList(bbox)) {
+    GraphId tile_id(tileid, level.level, 0);
+    const GraphTile* tile =
+        graphreader.DoesTileExist(tile_id) ? graphreader.GetGraphTile(tile_id) : nullptr;
+    if (tile != nullptr) {
+      tiles.push_back(tile_id);
+      key += ":" + std::to_string(tileid) + "@" + std::to_string(tile->header()->dataset_id());
+    }
+  }
+  if (!timetable_ || key != timetable_key_) {
+    timetable_ = std::make_shared<TransitTimetable>(graphreader, tiles, origin.date_time(),
+                                                    start_tz_index_);
+    timetable_key_ = key;
+  }
+
+  // Lines allowed by the costing (transit modes, excluded operators, routes and stops)
+  for (const auto& tile_id : tiles) {
+    const GraphTile* tile = graphreader.GetGraphTile(tile_id);
+    if (tile != nullptr) {
+      tc->AddToExcludeList(tile);
+    }
+  }
+  EdgeLabel pred;
+  allowed_lines_.assign(timetable_->lines().size(), false);
+  for (uint32_t i = 0; i < allowed_lines_.size(); ++i) {
+    const GraphId& edgeid = timetable_->lines()[i];
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    bool has_time_restrictions;
+    allowed_lines_[i] =
+        tc->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) &&
+        !tc->IsExcluded(tile, directededge);
+  }
+}
+
+// Add the edges at the origin to the walk of round 0.
+void ConnectionScan::SetOrigin(GraphReader& graphreader,
+                               valhalla::Location& origin,
+                               const valhalla::Location& destination,
+                               const std::shared_ptr<DynamicCost>& costing) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : origin.path_edges()) {
+    has_other_edges = has_other_edges || !edge.end_node();
+  }
+
+  Walk& walk = walks_[0];
+  const NodeInfo* closest_ni = nullptr;
+  for (const auto& edge : origin.path_edges()) {
+    // If origin is at a node - skip any inbound edge (dist = 1)
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.end_node()) ||
+        costing->AvoidAsOriginEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // Skip the edge if the tile at its end node is not found
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    const GraphTile* endtile = graphreader.GetGraphTile(directededge->endnode());
+    if (endtile == nullptr) {
+      continue;
+    }
+    if (closest_ni == nullptr) {
+      closest_ni = endtile->node(directededge->endnode());
+    }
+
+    // Penalize the location based on its distance from the input (assumes 1m/s)
+    Cost cost = costing->EdgeCost(directededge, tile) * (1.0f - edge.percent_along());
+    cost.cost += edge.distance();
+    uint32_t d = static_cast<uint32_t>(directededge->length() * (1.0f - edge.percent_along()));
+    uint32_t idx = walk.edgelabels.size();
+    walk.edgelabels.emplace_back(kInvalidLabel, edgeid, directededge, cost, cost.cost, 0.0f,
+                                 TravelMode::kPedestrian, d);
+
+    // The destination is reached along the origin edge if it is further along
+    auto p = destinations_.find(edgeid);
+    if (p != destinations_.end() && IsTrivial(edgeid, origin, destination)) {
+      Cost trivial = cost - p->second;
+      if (trivial.secs < walk.destination_time) {
+        walk.destination = idx;
+        walk.destination_time = static_cast<uint32_t>(std::max(0.0f, trivial.secs));
+        walk.destination_cost = std::max(0.0f, trivial.cost);
+      }
+    }
+  }
+
+  // Set the origin timezone
+  if (closest_ni != nullptr && origin.date_time() == "current") {
+    origin.set_date_time(
+        DateTime::iso_date_time(DateTime::get_tz_db().from_index(closest_ni->timezone())));
+  }
+}
+
+// Set the destination edge(s).
+void ConnectionScan::SetDestination(GraphReader& graphreader,
+                                    const valhalla::Location& dest,
+                                    const std::shared_ptr<DynamicCost>& costing) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : dest.path_edges()) {
+    has_other_edges = has_other_edges || !edge.begin_node();
+  }
+
+  for (const auto& edge : dest.path_edges()) {
+    GraphId edgeid(edge.graph_id());
+    if ((has_other_edges && edge.begin_node()) ||
+        costing->AvoidAsDestinationEdge(edgeid, edge.percent_along())) {
+      continue;
+    }
+
+    // Keep the cost of the remainder of the edge, it is subtracted from the
+    // cost to the end of the edge. Penalize the distance from the input.
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    const DirectedEdge* dest_diredge = tile->directededge(edgeid);
+    destinations_[edge.graph_id()] =
+        costing->EdgeCost(dest_diredge, tile) * (1.0f - edge.percent_along());
+    destinations_[edge.graph_id()].cost += edge.distance();
+  }
+}
+
+// Seed the walk of a round with the stops its trips reach first.
+bool ConnectionScan::SetSeeds(GraphReader& graphreader, const uint32_t round) {
+  Walk& walk = walks_[round];
+  walk.stops.resize(timetable_->stops().size());
+  const auto& trips = trips_[round - 1];
+  for (uint32_t stop = 0; stop < trips.size(); ++stop) {
+    const TripArrival& arrival = trips[stop];
+    if (arrival.time >= best_stops_[stop] || arrival.time >= best_arrival_) {
+      continue;
+    }
+
+    // The seed is the line edge of the trip arriving at the stop
+    const GraphId& edgeid = timetable_->lines()[timetable_->connections()[arrival.connection].line];
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    Cost cost(arrival.cost, arrival.time - start_time_);
+    walk.edgelabels.emplace_back(kInvalidLabel, edgeid, tile->directededge(edgeid), cost, cost.cost,
+                                 0.0f, TravelMode::kPublicTransit, 0);
+    walk.seeds.push_back(stop);
+  }
+  return !walk.seeds.empty();
+}
+
+// Walk from the labels of a round.
+void ConnectionScan::WalkRound(GraphReader& graphreader,
+                               const uint32_t round,
+                               const std::shared_ptr<DynamicCost>& pc,
+                               const std::shared_ptr<DynamicCost>& tc) {
+  Walk& walk = walks_[round];
+  if (adjacencylist_) {
+    walk_stats_.Add(*adjacencylist_);
+  }
+  const auto edgecost = [&walk](const uint32_t label) { return walk.edgelabels[label].sortcost(); };
+  uint32_t bucketsize = pc->UnitSize();
+  float range = kBucketCount * bucketsize;
+  adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
+  edgestatus_.clear();
+  for (uint32_t idx = 0; idx < walk.edgelabels.size(); ++idx) {
+    adjacencylist_->add(idx);
+  }
+
+  // Time to enter a stop, small on top of the walk to it
+  const Cost transfer = round == 0 ? tc->DefaultTransferCost() : tc->TransferCost();
+  if (walk.destination != kInvalidLabel) {
+    best_arrival_ = std::min(best_arrival_, start_time_ + walk.destination_time);
+  }
+
+  size_t n = 0;
+  uint32_t predindex;
+  while ((predindex = adjacencylist_->pop()) != kInvalidLabel) {
+    // Allow this process to be aborted, check the memory it holds
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory();
+    }
+
+    // Nothing reached later than the destination can improve on it
+    EdgeLabel pred = walk.edgelabels[predindex];
+    uint32_t time = start_time_ + static_cast<uint32_t>(pred.cost().secs);
+    if (time >= best_arrival_) {
+      continue;
+    }
+    const bool seed = predindex < walk.seeds.size();
+    const bool origin = round == 0 && pred.predecessor() == kInvalidLabel;
+    if (!seed && !origin) {
+      edgestatus_.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+      // Keep the earliest arrival at the destination
+      auto p = destinations_.find(pred.edgeid());
+      if (p != destinations_.end()) {
+        Cost cost = pred.cost() - p->second;
+        uint32_t arrival = start_time_ + static_cast<uint32_t>(std::max(0.0f, cost.secs));
+        if (arrival < best_arrival_) {
+          walk.destination = predindex;
+          walk.destination_time = arrival - start_time_;
+          walk.destination_cost = cost.cost;
+          best_arrival_ = arrival;
+        }
+      }
+    }
+
+    // Keep the earliest arrival at a stop. Staying at the stop the trip
+    // arrived at is an in-station transfer, walking to another stop of a
+    // later round must be within the transfer distance.
+    const GraphTile* tile = graphreader.GetGraphTile(pred.endnode());
+    if (tile == nullptr) {
+      continue;
+    }
+    const NodeInfo* nodeinfo = tile->node(pred.endnode());
+    if (nodeinfo->type() == NodeType::kMultiUseTransitPlatform &&
+        (round == 0 || seed || pred.path_distance() <= max_transfer_distance_) &&
+        !tc->IsExcluded(tile, nodeinfo)) {
+      uint32_t stop = timetable_->stop_index(pred.endnode());
+      if (stop != kUnreachedTime) {
+        uint32_t stop_time =
+            time + (seed ? kInStationTransferTime : static_cast<uint32_t>(transfer.secs));
+        if (stop_time < best_stops_[stop]) {
+          best_stops_[stop] = stop_time;
+          walk.stops[stop] = {stop_time, pred.cost().cost, predindex};
+        }
+      }
+    }
+
+    ExpandForward(graphreader, walk, pred.endnode(), pred, predindex, pc, false);
+  }
+}
+
+// Expand the walk from a node.
+void ConnectionScan::ExpandForward(GraphReader& graphreader,
+                                   Walk& walk,
+                                   const GraphId& node,
+                                   const EdgeLabel& pred,
+                                   const uint32_t pred_idx,
+                                   const std::shared_ptr<DynamicCost>& pc,
+                                   const bool from_transition) {
+  // Skip if tile is null (can happen with regional data sets) or if no access at the node.
+  const GraphTile* tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr) {
+    return;
+  }
+  const NodeInfo* nodeinfo = tile->node(node);
+  if (!pc->Allowed(nodeinfo)) {
+    return;
+  }
+
+  GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+  EdgeStatusInfo* es = edgestatus_.GetPtr(edgeid, tile);
+  const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid, ++es) {
+    // Skip shortcuts, transit lines (taken by the connection scan) and edges
+    // that are permanently labeled. The pedestrian costing limits the distance.
+    bool has_time_restrictions;
+    if (directededge->is_shortcut() || directededge->IsTransitLine() ||
+        es->set() == EdgeSet::kPermanent ||
+        !pc->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions)) {
+      continue;
+    }
+
+    Cost newcost = pred.cost() + pc->EdgeCost(directededge, tile) +
+                   pc->TransitionCost(directededge, nodeinfo, pred);
+    uint32_t walking_distance = pred.path_distance() + directededge->length();
+
+    // Check if lower cost path
+    if (es->set() == EdgeSet::kTemporary) {
+      EdgeLabel& lab = walk.edgelabels[es->index()];
+      if (newcost.cost < lab.cost().cost) {
+        float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+        adjacencylist_->decrease(es->index(), newsortcost);
+        lab.Update(pred_idx, newcost, newsortcost, walking_distance, has_time_restrictions);
+      }
+      continue;
+    }
+
+    // Add edge label, add to the adjacency list and set edge status
+    uint32_t idx = walk.edgelabels.size();
+    walk.edgelabels.emplace_back(pred_idx, edgeid, directededge, newcost, newcost.cost, 0.0f,
+                                 TravelMode::kPedestrian, walking_distance, has_time_restrictions);
+    *es = {EdgeSet::kTemporary, idx};
+    adjacencylist_->add(idx);
+  }
+
+  // Handle transitions - expand from the end node each transition
+  if (!from_transition && nodeinfo->transition_count() > 0) {
+    const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
+    for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
+      ExpandForward(graphreader, walk, trans->endnode(), pred, pred_idx, pc, true);
+    }
+  }
+}
+
+// Form the path reaching the destination in a round.
+std::vector<PathInfo> ConnectionScan::FormPath(const uint32_t round) {
+  // Work backwards from the destination
+  std::vector<PathInfo> path;
+  uint32_t label = walks_[round].destination;
+  for (uint32_t r = round;; --r) {
+    // Walk back to the origin or to the seed of the stop the trip arrived at
+    const Walk& walk = walks_[r];
+    uint32_t idx = label;
+    for (; r == 0 || idx >= walk.seeds.size(); idx = walk.edgelabels[idx].predecessor()) {
+      const EdgeLabel& edgelabel = walk.edgelabels[idx];
+      path.emplace_back(TravelMode::kPedestrian, edgelabel.cost().secs, edgelabel.edgeid(), 0,
+                        edgelabel.cost().cost, edgelabel.has_time_restriction());
+      has_ferry_ = has_ferry_ || edgelabel.use() == Use::kFerry;
+      if (edgelabel.predecessor() == kInvalidLabel) {
+        break;
+      }
+    }
+    if (r == 0) {
+      break;
+    }
+
+    // The connections of the trip, the cost includes the wait at the boarding stop
+    const TripArrival& arrival = trips_[r - 1][walk.seeds[idx]];
+    const auto trip = timetable_->TripConnections(arrival);
+    for (auto c = trip.rbegin(); c != trip.rend(); ++c) {
+      const TransitConnection& connection = timetable_->connections()[*c];
+      path.emplace_back(TravelMode::kPublicTransit, connection.arrival_time - start_time_,
+                        timetable_->lines()[connection.line], connection.tripid,
+                        arrival.cost - (arrival.time - connection.arrival_time), false);
+    }
+    label = walks_[r - 1].stops[timetable_->connections()[arrival.boarding].departure_stop].label;
+  }
+
+  // The destination is part way along the last edge
+  if (!path.empty()) {
+    path.front().elapsed_time = walks_[round].destination_time;
+    path.front().elapsed_cost = walks_[round].destination_cost;
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
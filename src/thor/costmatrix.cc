@@ -1,9 +1,17 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "midgard/logging.h"
+#include "sif/costdispatch.h"
 #include "thor/costmatrix.h"
+#include "thor/pathalgorithm.h"
 #include "worker.h"
 
 using namespace valhalla::baldr;
@@ -19,6 +27,41 @@ int GetThreshold(const TravelMode mode, const int n) {
   return (mode == TravelMode::kDrive) ? std::min(2700, std::max(100, n / 3)) : 500;
 }
 
+// Minimum number of locations per thread to expand the searches on multiple threads.
+// Each round of the searches is synchronized so fewer locations do not pay off.
+constexpr uint32_t kMinLocationsPerThread = 8;
+
+// Edges expanded by each search in a round when the searches can run on multiple
+// threads. Threads synchronize 4 times a round, expanding a single edge per search
+// between those costs more than it saves.
+constexpr uint32_t kThreadedExpansionsPerRound = 32;
+
+// Blocks threads until all of them have arrived. Reusable across rounds.
+class Barrier {
+public:
+  explicit Barrier(const size_t count) : count_(count), waiting_(0), generation_(0) {
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t generation = generation_;
+    if (++waiting_ == count_) {
+      waiting_ = 0;
+      ++generation_;
+      cv_.notify_all();
+    } else {
+      cv_.wait(lock, [this, generation] { return generation != generation_; });
+    }
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  size_t count_;
+  size_t waiting_;
+  size_t generation_;
+};
+
 bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
   return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
          (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
@@ -32,7 +75,16 @@ namespace thor {
 // Constructor with cost threshold.
 CostMatrix::CostMatrix()
     : mode_(TravelMode::kDrive), access_mode_(kAutoAccess), source_count_(0), remaining_sources_(0),
-      target_count_(0), remaining_targets_(0), current_cost_threshold_(0) {
+      target_count_(0), remaining_targets_(0), current_cost_threshold_(0), interrupt_(nullptr),
+      thread_interrupt_(nullptr), memory_(nullptr), targets_memory_(0), target_entries_(0) {
+}
+
+CostMatrix::~CostMatrix() {
+  if (memory_) {
+    memory_->Release(source_memory_);
+    memory_->Release(target_memory_);
+    memory_->Release(targets_memory_);
+  }
 }
 
 float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
@@ -58,8 +110,18 @@ float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void CostMatrix::Clear() {
+  // Release the memory of the searches from the budget
+  if (memory_) {
+    memory_->Release(source_memory_);
+    memory_->Release(target_memory_);
+    memory_->Release(targets_memory_);
+  }
+  source_memory_.clear();
+  target_memory_.clear();
+
   // Clear the target edge markings
   targets_.clear();
+  target_entries_ = 0;
 
   // Clear all source adjacency lists, edge labels, and edge status
   for (auto& adj : source_adjacency_) {
@@ -97,6 +159,58 @@ void CostMatrix::Clear() {
   target_hierarchy_limits_.clear();
   source_status_.clear();
   target_status_.clear();
+  target_reached_.clear();
+  target_exhausted_.clear();
+  target_cost_threshold_.clear();
+  target_updates_.clear();
+}
+
+// Get the counters of the source and target searches.
+SearchStats CostMatrix::stats() const {
+  SearchStats stats;
+  for (const auto& adjacency : {&source_adjacency_, &target_adjacency_}) {
+    for (const auto& adj : *adjacency) {
+      if (adj) {
+        stats.Add(*adj);
+      }
+    }
+  }
+  for (const auto& hierarchy_limits : {&source_hierarchy_limits_, &target_hierarchy_limits_}) {
+    for (const auto& limits : *hierarchy_limits) {
+      stats.Add(limits);
+    }
+  }
+  return stats;
+}
+
+// Report the memory held by a source or target search. Each search is only
+// expanded by one thread at a time so its reported bytes need no lock.
+void CostMatrix::UpdateMemory(const bool forward, const uint32_t index) {
+  if (!memory_) {
+    return;
+  }
+  const auto& edgelabels = forward ? source_edgelabel_[index] : target_edgelabel_[index];
+  const auto& adjacency = forward ? source_adjacency_[index] : target_adjacency_[index];
+  const auto& edgestatus = forward ? source_edgestatus_[index] : target_edgestatus_[index];
+  // The edges a target reached in the round, not yet in the target edge markings
+  const size_t reached = !forward && index < target_reached_.size()
+                             ? target_reached_[index].capacity() * sizeof(GraphId)
+                             : 0;
+  memory_->Update(forward ? source_memory_[index] : target_memory_[index],
+                  edgelabels.capacity() * sizeof(BDEdgeLabel) + adjacency->memory() +
+                      edgestatus.memory() + reached);
+}
+
+void CostMatrix::UpdateTargetsMemory() {
+  if (!memory_) {
+    return;
+  }
+  // Each marked edge is a node of the map holding the edge, its vector of
+  // target indexes and the link to the next node
+  using entry_t = std::pair<const GraphId, std::vector<uint32_t>>;
+  memory_->Update(targets_memory_, targets_.bucket_count() * sizeof(void*) +
+                                       targets_.size() * (sizeof(entry_t) + sizeof(void*)) +
+                                       target_entries_ * sizeof(uint32_t));
 }
 
 // Form a time distance matrix from the set of source locations
@@ -127,57 +241,214 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
 
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
-  // spaces is checked during the forward search.
+  // spaces is checked during the forward search. Each round the searches
+  // can be expanded on multiple threads: a search only changes its own
+  // state, what it changes of the other searches is applied in location
+  // order after each half of the round so results do not depend on the
+  // number of threads. With additional threads every search expands a batch
+  // of edges per round, also when there are too few locations to use them,
+  // so the results only depend on whether the matrix has thread readers.
+  const uint32_t expansions = thread_readers_.empty() ? 1 : kThreadedExpansionsPerRound;
+  uint32_t thread_count = std::min(static_cast<uint32_t>(thread_readers_.size() + 1),
+                                   (source_count_ + target_count_) / kMinLocationsPerThread);
+  thread_count = std::max(thread_count, 1u);
+  auto reader = [&](const uint32_t thread) -> GraphReader& {
+    return thread == 0 ? graphreader : *thread_readers_[thread - 1];
+  };
+
+  // Use the search loops specialized for the costing, if any
+  const auto forward_search = SelectByCostType(*costing_, &CostMatrix::ForwardSearch<AutoCost>,
+                                               &CostMatrix::ForwardSearch<TruckCost>,
+                                               &CostMatrix::ForwardSearch<DynamicCost>);
+  const auto backward_search = SelectByCostType(*costing_, &CostMatrix::BackwardSearch<AutoCost>,
+                                                &CostMatrix::BackwardSearch<TruckCost>,
+                                                &CostMatrix::BackwardSearch<DynamicCost>);
+
+  // Iterate all target locations in a backwards search. A search stops its
+  // batch early once its threshold is reached.
   int n = 0;
-  while (true) {
-    // Iterate all target locations in a backwards search
-    for (uint32_t i = 0; i < target_count_; i++) {
+  auto backward = [&](const uint32_t thread) {
+    for (uint32_t i = thread; i < target_count_; i += thread_count) {
       if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
+        for (uint32_t k = 0; k < expansions && target_status_[i].threshold > 0; k++) {
+          target_status_[i].threshold--;
+          (this->*backward_search)(i, reader(thread));
         }
+        UpdateMemory(false, i);
       }
     }
+  };
 
-    // Iterate all source locations in a forward search
-    for (uint32_t i = 0; i < source_count_; i++) {
+  // Iterate all source locations in a forward search. The iteration counts
+  // the edges expanded so far by every search, connection thresholds use it.
+  auto forward = [&](const uint32_t thread) {
+    for (uint32_t i = thread; i < source_count_; i += thread_count) {
       if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
+        for (uint32_t k = 0; k < expansions && source_status_[i].threshold > 0; k++) {
+          source_status_[i].threshold--;
+          (this->*forward_search)(i, n * expansions + k, reader(thread));
         }
+        UpdateMemory(true, i);
       }
     }
+  };
 
-    // Break out when remaining sources and targets to expand are both 0
-    if (remaining_sources_ == 0 && remaining_targets_ == 0) {
-      LOG_DEBUG("SourceToTarget iterations: n = " + std::to_string(n));
-      break;
+  // Update targets after the backward searches
+  auto finish_backward = [&]() {
+    for (uint32_t i = 0; i < target_count_; i++) {
+      for (const auto& edgeid : target_reached_[i]) {
+        AddTarget(edgeid, i);
+      }
+      target_reached_[i].clear();
+
+      // Backward search is exhausted - update so we don't extend searches
+      // more than we need to
+      if (target_exhausted_[i]) {
+        target_exhausted_[i] = false;
+        for (uint32_t source = 0; source < source_count_; source++) {
+          UpdateSourceStatus(source, i);
+          UpdateTargetStatus(i, source, source_edgelabel_[source].size());
+        }
+      }
+      if (target_status_[i].threshold == 0) {
+        target_status_[i].threshold = -1;
+        if (remaining_targets_ > 0) {
+          remaining_targets_--;
+        }
+      }
+    }
+    UpdateTargetsMemory();
+  };
+
+  // Update sources and targets after the forward searches. Returns true when
+  // remaining sources and targets to expand are both 0
+  auto finish_forward = [&]() {
+    for (uint32_t i = 0; i < source_count_; i++) {
+      for (const auto& update : target_updates_[i]) {
+        UpdateTargetStatus(update.first, i, update.second);
+      }
+      target_updates_[i].clear();
+      if (source_status_[i].threshold == 0) {
+        source_status_[i].threshold = -1;
+        if (remaining_sources_ > 0) {
+          remaining_sources_--;
+        }
+      }
+    }
+    return remaining_sources_ == 0 && remaining_targets_ == 0;
+  };
+
+  // Allow the matrix to be aborted about every kInterruptIterationsInterval labels expanded, each
+  // round expands a batch of labels from every location still searching
+  const size_t interrupt_rounds =
+      std::max(kInterruptIterationsInterval /
+                   (std::max(source_count_ + target_count_, 1u) * expansions),
+               static_cast<size_t>(1));
+  auto interrupted = [&](const uint32_t) {
+    if (interrupt_ && n % interrupt_rounds == 0) {
+      (*interrupt_)();
+    }
+  };
+
+  if (thread_count == 1) {
+    while (true) {
+      interrupted(0);
+      backward(0);
+      finish_backward();
+      forward(0);
+      if (finish_forward()) {
+        LOG_DEBUG("SourceToTarget iterations: n = " + std::to_string(n));
+        break;
+      }
+
+      // Protect against edge cases that may lead to never breaking out of
+      // this loop. This should never occur but lets make sure.
+      if (n * expansions >= kMaxMatrixIterations) {
+        throw valhalla_exception_t{430};
+      }
+      n++;
+    }
+  } else {
+    // Every thread expands its share of the targets and then of the sources. This
+    // thread finishes each half of the round while the others wait. Exceptions are
+    // passed to this thread which stops the others at the end of the round.
+    Barrier barrier(thread_count);
+    std::atomic<bool> done(false);
+    std::vector<std::exception_ptr> errors(thread_count);
+    auto run = [&](const uint32_t thread, const std::function<void(uint32_t)>& expand) {
+      try {
+        if (!errors[thread]) {
+          expand(thread);
+        }
+      } catch (...) { errors[thread] = std::current_exception(); }
+    };
+    auto work = [&](const uint32_t thread) {
+      while (true) {
+        barrier.wait();
+        if (done) {
+          return;
+        }
+        run(thread, backward);
+        barrier.wait();
+        barrier.wait();
+        run(thread, forward);
+        barrier.wait();
+      }
+    };
+    std::vector<std::shared_ptr<std::thread>> threads(thread_count - 1);
+    for (uint32_t i = 1; i < thread_count; ++i) {
+      threads[i - 1].reset(new std::thread(work, i));
+    }
+
+    bool too_many_iterations = false;
+    while (true) {
+      barrier.wait();
+      run(0, backward);
+      barrier.wait();
+      finish_backward();
+      barrier.wait();
+      run(0, forward);
+      barrier.wait();
+      bool complete = finish_forward();
+      if (!complete) {
+        run(0, interrupted);
+      }
+      bool failed = std::any_of(errors.begin(), errors.end(),
+                                [](const std::exception_ptr& e) { return e != nullptr; });
+      too_many_iterations = !complete && n * expansions >= kMaxMatrixIterations;
+      if (complete || failed || too_many_iterations) {
+        LOG_DEBUG("SourceToTarget iterations: n = " + std::to_string(n));
+        break;
+      }
+      n++;
     }
 
-    // Protect against edge cases that may lead to never breaking out of
-    // this loop. This should never occur but lets make sure.
-    if (n >= kMaxMatrixIterations) {
+    // Release and join the other threads
+    done = true;
+    barrier.wait();
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    if (too_many_iterations) {
       throw valhalla_exception_t{430};
     }
-    n++;
   }
 
   // Form the time, distance matrix from the destinations list
-  uint32_t idx = 0;
+  return FormTimeDistanceMatrix();
+}
+
+// Form a time/distance matrix from the best connections.
+std::vector<TimeDistance> CostMatrix::FormTimeDistanceMatrix() {
   std::vector<TimeDistance> td;
+  td.reserve(best_connection_.size());
   for (const auto& connection : best_connection_) {
     td.emplace_back(std::round(connection.cost.secs), std::round(connection.distance));
-    idx++;
   }
   return td;
 }
@@ -196,6 +467,10 @@ void CostMatrix::Initialize(
   for (uint32_t i = 0; i < target_count_; i++) {
     target_status_.emplace_back(kMaxThreshold);
   }
+  target_reached_.resize(target_count_);
+  target_exhausted_.resize(target_count_, false);
+  target_cost_threshold_.resize(target_count_, current_cost_threshold_);
+  target_updates_.resize(source_count_);
 
   // Initialize best connection
   bool all_the_same = true;
@@ -232,7 +507,10 @@ void CostMatrix::Initialize(
 }
 
 // Iterate the forward search from the source/origin location.
+template <class CostT>
 void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphReader& graphreader) {
+  const CostCalls<CostT> costing(*costing_);
+
   // Get the next edge from the adjacency list for this source location
   auto& adj = source_adjacency_[index];
   auto& edgelabels = source_edgelabel_[index];
@@ -309,14 +587,14 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
       // Skip this edge if no access is allowed (based on costing method)
       // or if a complex restriction prevents transition onto this edge.
       bool has_time_restrictions = false;
-      if (!costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
+      if (!costing.Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
           costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, true)) {
         continue;
       }
 
       // Get cost. Separate out transition cost.
-      Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-      Cost newcost = pred.cost() + tc + costing_->EdgeCost(directededge, tile);
+      Cost tc = costing.TransitionCost(directededge, nodeinfo, pred);
+      Cost newcost = pred.cost() + tc + costing.EdgeCost(directededge, tile);
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -374,7 +652,7 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n, GraphRead
   const GraphTile* tile = graphreader.GetGraphTile(node);
   if (tile != nullptr) {
     const NodeInfo* nodeinfo = tile->node(node);
-    if (costing_->Allowed(nodeinfo)) {
+    if (costing.Allowed(nodeinfo)) {
       expand(tile, node, nodeinfo, pred, pred_idx, false);
     }
   }
@@ -466,8 +744,15 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
   }
 }
 
-// Update status when a connection is found.
+// Update status when a connection is found on the forward search. The target
+// status is updated after the forward searches of the current round.
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
+  UpdateSourceStatus(source, target);
+  target_updates_[source].emplace_back(target, source_edgelabel_[source].size());
+}
+
+// Remove the target from the source status.
+void CostMatrix::UpdateSourceStatus(const uint32_t source, const uint32_t target) {
   // Remove the target from the source status
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
@@ -480,40 +765,46 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
           GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
     }
   }
+}
 
+// Remove the source from the target status.
+void CostMatrix::UpdateTargetStatus(const uint32_t target,
+                                    const uint32_t source,
+                                    const size_t source_label_count) {
   // Remove the source from the target status
   auto& t = target_status_[target].remaining_locations;
-  it = t.find(source);
+  auto it = t.find(source);
   if (it != t.end()) {
     t.erase(it);
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
       target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+          GetThreshold(mode_, source_label_count + target_edgelabel_[target].size());
     }
   }
 }
 
 // Expand the backwards search trees.
+template <class CostT>
 void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader) {
+  const CostCalls<CostT> costing(*costing_);
+
   // Get the next edge from the adjacency list for this target location
   auto& adj = target_adjacency_[index];
   auto& edgelabels = target_edgelabel_[index];
   uint32_t pred_idx = adj->pop();
   if (pred_idx == kInvalidLabel) {
-    // Backward search is exhausted - mark this and update so we don't
-    // extend searches more than we need to
-    for (uint32_t source = 0; source < source_count_; source++) {
-      UpdateStatus(source, index);
-    }
+    // Backward search is exhausted - mark this so the status is updated
+    // after the backward searches of the current round
+    target_exhausted_[index] = true;
     target_status_[index].threshold = 0;
     return;
   }
 
   // Copy predecessor, check cost threshold
   BDEdgeLabel pred = edgelabels[pred_idx];
-  if (pred.cost().secs > current_cost_threshold_) {
+  if (pred.cost().secs > target_cost_threshold_[index]) {
     target_status_[index].threshold = 0;
     return;
   }
@@ -581,17 +872,17 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
       // or if a complex restriction prevents transition onto this edge.
       const DirectedEdge* opp_edge = t2->directededge(oppedge);
       bool has_time_restrictions = false;
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedge, 0, 0,
-                                    has_time_restrictions) ||
+      if (!costing.AllowedReverse(directededge, pred, opp_edge, t2, oppedge, 0, 0,
+                                  has_time_restrictions) ||
           costing_->Restricted(directededge, pred, edgelabels, tile, edgeid, false)) {
         continue;
       }
 
       // Get cost. Use opposing edge for EdgeCost. Separate the transition seconds so
       // we can properly recover elapsed time on the reverse path.
-      Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
-                                                opp_pred_edge);
-      Cost newcost = pred.cost() + tc + costing_->EdgeCost(opp_edge, tile);
+      Cost tc = costing.TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
+                                              opp_pred_edge);
+      Cost newcost = pred.cost() + tc + costing.EdgeCost(opp_edge, tile);
 
       // Check if edge is temporarily labeled and this path has less cost. If
       // less cost the predecessor is updated along with new cost and distance.
@@ -614,8 +905,8 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               has_time_restrictions);
       adj->add(idx);
 
-      // Add to the list of targets that have reached this edge
-      targets_[edgeid].push_back(index);
+      // Add to the list of edges this target has reached in the current round
+      target_reached_[index].push_back(edgeid);
     }
 
     // Handle transitions - expand from the end node of the transition
@@ -644,7 +935,7 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
   const GraphTile* tile = graphreader.GetGraphTile(node);
   if (tile != nullptr) {
     const NodeInfo* nodeinfo = tile->node(node);
-    if (costing_->Allowed(nodeinfo)) {
+    if (costing.Allowed(nodeinfo)) {
       // Get the opposing predecessor directed edge. Need to make sure we get
       // the correct one if a transition occurred
       const DirectedEdge* opp_pred_edge;
@@ -668,6 +959,7 @@ void CostMatrix::SetSources(GraphReader& graphreader,
   source_edgelabel_.resize(source_count_);
   source_edgestatus_.resize(source_count_);
   source_adjacency_.resize(source_count_);
+  source_memory_.resize(source_count_, 0);
   source_hierarchy_limits_.resize(source_count_);
 
   // Go through each source location
@@ -732,6 +1024,7 @@ void CostMatrix::SetSources(GraphReader& graphreader,
       source_adjacency_[index]->add(idx);
       source_edgestatus_[index].Set(edgeid, EdgeSet::kUnreached, idx, tile);
     }
+    UpdateMemory(true, index);
     index++;
   }
 }
@@ -745,6 +1038,7 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
   target_edgelabel_.resize(targets.size());
   target_edgestatus_.resize(targets.size());
   target_adjacency_.resize(targets.size());
+  target_memory_.resize(targets.size(), 0);
   target_hierarchy_limits_.resize(targets.size());
 
   // Go through each target location
@@ -819,11 +1113,20 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
       target_adjacency_[index]->add(idx);
       target_edgestatus_[index].Set(opp_edge_id, EdgeSet::kUnreached, idx,
                                     graphreader.GetGraphTile(opp_edge_id));
-      targets_[opp_edge_id].push_back(index);
+      AddTarget(opp_edge_id, index);
     }
+    UpdateMemory(false, index);
     index++;
   }
 }
 
+// The searches specialized for each costing, also used by BucketMatrix
+template void CostMatrix::ForwardSearch<AutoCost>(const uint32_t, const uint32_t, GraphReader&);
+template void CostMatrix::ForwardSearch<TruckCost>(const uint32_t, const uint32_t, GraphReader&);
+template void CostMatrix::ForwardSearch<DynamicCost>(const uint32_t, const uint32_t, GraphReader&);
+template void CostMatrix::BackwardSearch<AutoCost>(const uint32_t, GraphReader&);
+template void CostMatrix::BackwardSearch<TruckCost>(const uint32_t, GraphReader&);
+template void CostMatrix::BackwardSearch<DynamicCost>(const uint32_t, GraphReader&);
+
 } // namespace thor
 } // namespace valhalla
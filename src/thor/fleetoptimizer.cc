@@ -0,0 +1,326 @@
+#include "thor/fleetoptimizer.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr float kInfeasible = std::numeric_limits<float>::infinity();
+
+// Improvements smaller than this are ignored so rounding errors cannot make
+// the local search cycle.
+constexpr float kMinImprovement = 1e-3f;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+// Assign jobs to vehicles and order them.
+FleetSolution FleetOptimizer::Solve(const uint32_t count,
+                                    const std::vector<float>& costs,
+                                    const google::protobuf::RepeatedPtrField<Vehicle>& vehicles,
+                                    const google::protobuf::RepeatedPtrField<Job>& jobs) {
+  count_ = count;
+  costs_ = &costs;
+  vehicles_ = &vehicles;
+  jobs_ = &jobs;
+  tours_.assign(vehicles.size(), {});
+  tour_costs_.assign(vehicles.size(), 0.0f);
+  unassigned_.clear();
+  for (int i = 0; i < jobs.size(); i++) {
+    unassigned_.push_back(i);
+  }
+
+  // Insert the jobs then improve the routes. Jobs that could not be inserted
+  // may fit once the routes are improved.
+  Insert();
+  do {
+    LocalSearch();
+  } while (Insert());
+
+  FleetSolution solution;
+  float total = 0.0f;
+  for (uint32_t v = 0; v < tours_.size(); v++) {
+    if (tours_[v].empty()) {
+      continue;
+    }
+    FleetRoute route{v, tours_[v], {}, 0.0f};
+    route.cost = TourCost(v, tours_[v], &route.arrivals);
+    total += route.cost;
+    solution.routes.emplace_back(std::move(route));
+  }
+  solution.unassigned = unassigned_;
+  std::sort(solution.unassigned.begin(), solution.unassigned.end());
+  LOG_DEBUG("Fleet cost = " + std::to_string(total) + " unassigned jobs = " +
+            std::to_string(solution.unassigned.size()));
+  return solution;
+}
+
+// Get the travel time of a vehicle doing a sequence of jobs.
+float FleetOptimizer::TourCost(const uint32_t vehicle,
+                               const std::vector<uint32_t>& tour,
+                               std::vector<uint32_t>* arrivals) const {
+  // An unused vehicle does not travel
+  if (tour.empty()) {
+    return 0.0f;
+  }
+
+  const auto& v = vehicles_->Get(vehicle);
+  double shift_end = v.has_time_window_end() ? v.time_window_end() : kInfeasible;
+  if (v.has_capacity()) {
+    uint32_t load = 0;
+    for (auto job : tour) {
+      load += jobs_->Get(job).demand();
+    }
+    if (load > v.capacity()) {
+      return kInfeasible;
+    }
+  }
+
+  if (arrivals) {
+    arrivals->clear();
+  }
+  double time = v.time_window_start();
+  double cost = 0.0;
+  uint32_t location = v.start();
+  for (auto job : tour) {
+    const auto& j = jobs_->Get(job);
+    float c = Cost(location, j.location());
+    if (!std::isfinite(c)) {
+      return kInfeasible;
+    }
+    cost += c;
+    time += c;
+    if (arrivals) {
+      arrivals->push_back(static_cast<uint32_t>(time + 0.5));
+    }
+
+    // Wait for the time window to open, the service must start before it closes
+    time = std::max(time, static_cast<double>(j.time_window_start()));
+    if (j.has_time_window_end() && time > j.time_window_end()) {
+      return kInfeasible;
+    }
+    time += j.service();
+    location = j.location();
+  }
+
+  if (v.has_end()) {
+    float c = Cost(location, v.end());
+    if (!std::isfinite(c)) {
+      return kInfeasible;
+    }
+    cost += c;
+    time += c;
+  }
+  return time > shift_end ? kInfeasible : static_cast<float>(cost);
+}
+
+// Insert unassigned jobs by regret insertion until none can be inserted.
+bool FleetOptimizer::Insert() {
+  bool inserted = false;
+  std::vector<uint32_t> tour;
+  while (!unassigned_.empty()) {
+    // Find the job with the largest regret: the difference between its best
+    // insertion and its best insertion in any other vehicle
+    uint32_t best_index = 0, best_vehicle = 0, best_position = 0;
+    float best_regret = -1.0f, best_delta = kInfeasible;
+    for (uint32_t i = 0; i < unassigned_.size(); i++) {
+      float delta1 = kInfeasible, delta2 = kInfeasible;
+      uint32_t vehicle1 = 0, position1 = 0;
+      for (uint32_t v = 0; v < tours_.size(); v++) {
+        float vehicle_delta = kInfeasible;
+        uint32_t vehicle_position = 0;
+        for (uint32_t p = 0; p <= tours_[v].size(); p++) {
+          tour = tours_[v];
+          tour.insert(tour.begin() + p, unassigned_[i]);
+          float delta = TourCost(v, tour) - tour_costs_[v];
+          if (delta < vehicle_delta) {
+            vehicle_delta = delta;
+            vehicle_position = p;
+          }
+        }
+        if (vehicle_delta < delta1) {
+          delta2 = delta1;
+          delta1 = vehicle_delta;
+          vehicle1 = v;
+          position1 = vehicle_position;
+        } else if (vehicle_delta < delta2) {
+          delta2 = vehicle_delta;
+        }
+      }
+      if (!std::isfinite(delta1)) {
+        continue;
+      }
+
+      // Jobs only one vehicle can take go first
+      float regret = std::isfinite(delta2) ? delta2 - delta1 : std::numeric_limits<float>::max();
+      if (regret > best_regret || (regret == best_regret && delta1 < best_delta)) {
+        best_regret = regret;
+        best_delta = delta1;
+        best_index = i;
+        best_vehicle = vehicle1;
+        best_position = position1;
+      }
+    }
+
+    // No job can be inserted
+    if (best_regret < 0.0f) {
+      break;
+    }
+    auto& best_tour = tours_[best_vehicle];
+    best_tour.insert(best_tour.begin() + best_position, unassigned_[best_index]);
+    tour_costs_[best_vehicle] = TourCost(best_vehicle, best_tour);
+    unassigned_.erase(unassigned_.begin() + best_index);
+    inserted = true;
+  }
+  return inserted;
+}
+
+// Improve the routes until no move reduces the total travel time.
+void FleetOptimizer::LocalSearch() {
+  while (Relocate() || Swap() || TwoOptStar() || TwoOpt()) {
+  }
+}
+
+// Replace the tours of 2 vehicles (or of one if a == b) if it reduces the
+// total travel time.
+bool FleetOptimizer::Improve(const uint32_t a,
+                             std::vector<uint32_t>& tour_a,
+                             const uint32_t b,
+                             std::vector<uint32_t>& tour_b) {
+  float cost_a = TourCost(a, tour_a);
+  if (!std::isfinite(cost_a)) {
+    return false;
+  }
+  float before = tour_costs_[a];
+  float after = cost_a;
+  float cost_b = 0.0f;
+  if (a != b) {
+    cost_b = TourCost(b, tour_b);
+    if (!std::isfinite(cost_b)) {
+      return false;
+    }
+    before += tour_costs_[b];
+    after += cost_b;
+  }
+  if (after > before - kMinImprovement) {
+    return false;
+  }
+  tours_[a].swap(tour_a);
+  tour_costs_[a] = cost_a;
+  if (a != b) {
+    tours_[b].swap(tour_b);
+    tour_costs_[b] = cost_b;
+  }
+  return true;
+}
+
+// Move a job to another position or vehicle.
+bool FleetOptimizer::Relocate() {
+  std::vector<uint32_t> tour_a, tour_b;
+  for (uint32_t a = 0; a < tours_.size(); a++) {
+    for (uint32_t i = 0; i < tours_[a].size(); i++) {
+      uint32_t job = tours_[a][i];
+      for (uint32_t b = 0; b < tours_.size(); b++) {
+        if (a == b) {
+          for (uint32_t p = 0; p < tours_[a].size(); p++) {
+            if (p == i) {
+              continue;
+            }
+            tour_a = tours_[a];
+            tour_a.erase(tour_a.begin() + i);
+            tour_a.insert(tour_a.begin() + p, job);
+            if (Improve(a, tour_a, a, tour_a)) {
+              return true;
+            }
+          }
+          continue;
+        }
+        for (uint32_t p = 0; p <= tours_[b].size(); p++) {
+          tour_a = tours_[a];
+          tour_a.erase(tour_a.begin() + i);
+          tour_b = tours_[b];
+          tour_b.insert(tour_b.begin() + p, job);
+          if (Improve(a, tour_a, b, tour_b)) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Exchange 2 jobs of the same or of different vehicles.
+bool FleetOptimizer::Swap() {
+  std::vector<uint32_t> tour_a, tour_b;
+  for (uint32_t a = 0; a < tours_.size(); a++) {
+    for (uint32_t i = 0; i < tours_[a].size(); i++) {
+      for (uint32_t b = a; b < tours_.size(); b++) {
+        for (uint32_t k = (a == b ? i + 1 : 0); k < tours_[b].size(); k++) {
+          tour_a = tours_[a];
+          if (a == b) {
+            std::swap(tour_a[i], tour_a[k]);
+          } else {
+            tour_b = tours_[b];
+            std::swap(tour_a[i], tour_b[k]);
+          }
+          if (Improve(a, tour_a, b, tour_b)) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Exchange the ends of the tours of 2 vehicles.
+bool FleetOptimizer::TwoOptStar() {
+  std::vector<uint32_t> tour_a, tour_b;
+  for (uint32_t a = 0; a < tours_.size(); a++) {
+    for (uint32_t b = a + 1; b < tours_.size(); b++) {
+      const auto& ta = tours_[a];
+      const auto& tb = tours_[b];
+      for (uint32_t i = 0; i <= ta.size(); i++) {
+        for (uint32_t k = 0; k <= tb.size(); k++) {
+          // Exchanging nothing
+          if (i == ta.size() && k == tb.size()) {
+            continue;
+          }
+          tour_a.assign(ta.begin(), ta.begin() + i);
+          tour_a.insert(tour_a.end(), tb.begin() + k, tb.end());
+          tour_b.assign(tb.begin(), tb.begin() + k);
+          tour_b.insert(tour_b.end(), ta.begin() + i, ta.end());
+          if (Improve(a, tour_a, b, tour_b)) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Reverse part of the tour of a vehicle.
+bool FleetOptimizer::TwoOpt() {
+  std::vector<uint32_t> tour;
+  for (uint32_t a = 0; a < tours_.size(); a++) {
+    for (uint32_t i = 0; i < tours_[a].size(); i++) {
+      for (uint32_t k = i + 2; k <= tours_[a].size(); k++) {
+        tour = tours_[a];
+        std::reverse(tour.begin() + i, tour.begin() + k);
+        if (Improve(a, tour, a, tour)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -2,6 +2,8 @@
 #include "baldr/datetime.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
+#include "sif/costdispatch.h"
+#include "thor/pathalgorithm.h"
 #include <algorithm>
 #include <iostream> // TODO remove if not needed
 #include <map>
@@ -40,13 +42,13 @@ uint32_t GetOperatorId(const GraphTile* tile,
 namespace valhalla {
 namespace thor {
 
-constexpr uint32_t kBucketCount = 20000;
 constexpr uint32_t kInitialEdgeLabelCount = 500000;
 
 // Default constructor
 Isochrone::Isochrone()
     : has_date_time_(false), start_tz_index_(0), access_mode_(kAutoAccess), shape_interval_(50.0f),
-      mode_(TravelMode::kDrive), adjacencylist_(nullptr) {
+      mode_(TravelMode::kDrive), adjacencylist_(nullptr), interrupt_(nullptr), memory_(nullptr),
+      memory_held_(0) {
 }
 
 // Destructor
@@ -56,6 +58,11 @@ Isochrone::~Isochrone() {
 
 // Clear the temporary information generated during path construction.
 void Isochrone::Clear() {
+  // Release the memory of the search from the budget
+  if (memory_) {
+    memory_->Release(memory_held_);
+  }
+
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
   edgelabels_.clear();
@@ -65,6 +72,25 @@ void Isochrone::Clear() {
   edgestatus_.clear();
 }
 
+// Report the memory held by the search.
+void Isochrone::UpdateMemory() {
+  if (memory_) {
+    memory_->Update(memory_held_, edgelabels_.capacity() * sizeof(EdgeLabel) +
+                                      bdedgelabels_.capacity() * sizeof(BDEdgeLabel) +
+                                      mmedgelabels_.capacity() * sizeof(MMEdgeLabel) +
+                                      adjacencylist_->memory() + edgestatus_.memory());
+  }
+}
+
+// Get the counters of the search of the last computed grid.
+SearchStats Isochrone::stats() const {
+  SearchStats stats;
+  if (adjacencylist_) {
+    stats.Add(*adjacencylist_);
+  }
+  return stats;
+}
+
 // Construct the isotile. Use a fixed grid size. Convert time in minutes to
 // a max distance in meters based on an estimate of max average speed for
 // the travel mode.
@@ -190,6 +216,7 @@ void Isochrone::InitializeMultiModal(const uint32_t bucketsize) {
 }
 
 // Expand from a node in the forward direction
+template <class CostT>
 void Isochrone::ExpandForward(GraphReader& graphreader,
                               const GraphId& node,
                               const EdgeLabel& pred,
@@ -197,6 +224,8 @@ void Isochrone::ExpandForward(GraphReader& graphreader,
                               const bool from_transition,
                               uint64_t localtime,
                               int32_t seconds_of_week) {
+  const CostCalls<CostT> costing(*costing_);
+
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
   const GraphTile* tile = graphreader.GetGraphTile(node);
@@ -211,7 +240,7 @@ void Isochrone::ExpandForward(GraphReader& graphreader,
     float secs0 = (idx == kInvalidLabel) ? 0 : edgelabels_[idx].cost().secs;
     UpdateIsoTile(pred, graphreader, tile->get_node_ll(node), secs0);
   }
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!costing.Allowed(nodeinfo)) {
     return;
   }
 
@@ -244,15 +273,15 @@ void Isochrone::ExpandForward(GraphReader& graphreader,
     if (has_date_time_) {
       // With date time we check time dependent restrictions and access as well as get
       // traffic based speed if it exists
-      if (!costing_->Allowed(directededge, pred, tile, edgeid, localtime, nodeinfo->timezone(),
-                             has_time_restrictions) ||
+      if (!costing.Allowed(directededge, pred, tile, edgeid, localtime, nodeinfo->timezone(),
+                           has_time_restrictions) ||
           costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true, localtime,
                                nodeinfo->timezone())) {
         continue;
       }
     } else {
       // TODO merge these two branches
-      if (!costing_->Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
+      if (!costing.Allowed(directededge, pred, tile, edgeid, 0, 0, has_time_restrictions) ||
           costing_->Restricted(directededge, pred, edgelabels_, tile, edgeid, true)) {
         continue;
       }
@@ -261,9 +290,9 @@ void Isochrone::ExpandForward(GraphReader& graphreader,
     // Compute the cost to the end of this edge
     Cost newcost =
         pred.cost() +
-        costing_->EdgeCost(directededge, tile,
-                           has_date_time_ ? seconds_of_week : kConstrainedFlowSecondOfDay) +
-        costing_->TransitionCost(directededge, nodeinfo, pred);
+        costing.EdgeCost(directededge, tile,
+                         has_date_time_ ? seconds_of_week : kConstrainedFlowSecondOfDay) +
+        costing.TransitionCost(directededge, nodeinfo, pred);
 
     // Check if edge is temporarily labeled and this path has less cost. If
     // less cost the predecessor is updated and the sort cost is decremented
@@ -290,7 +319,8 @@ void Isochrone::ExpandForward(GraphReader& graphreader,
   if (!from_transition && nodeinfo->transition_count() > 0) {
     const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
-      ExpandForward(graphreader, trans->endnode(), pred, pred_idx, true, localtime, seconds_of_week);
+      ExpandForward<CostT>(graphreader, trans->endnode(), pred, pred_idx, true, localtime,
+                           seconds_of_week);
     }
   }
 }
@@ -340,6 +370,11 @@ Isochrone::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origi
     has_date_time_ = true;
   }
 
+  // Use the expansion loop specialized for the costing, if any
+  const auto expand_forward = SelectByCostType(*costing_, &Isochrone::ExpandForward<AutoCost>,
+                                               &Isochrone::ExpandForward<TruckCost>,
+                                               &Isochrone::ExpandForward<DynamicCost>);
+
   // Compute the isotile
   uint32_t n = 0;
   while (true) {
@@ -362,9 +397,18 @@ Isochrone::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origi
     }
 
     // Expand from the end node in forward direction.
-    ExpandForward(graphreader, pred.endnode(), pred, predindex, false, localtime, seconds_of_week);
+    (this->*expand_forward)(graphreader, pred.endnode(), pred, predindex, false, localtime,
+                            seconds_of_week);
     n++;
 
+    // Allow this process to be aborted, check the memory it holds
+    if ((n % kInterruptIterationsInterval) == 0) {
+      if (interrupt_) {
+        (*interrupt_)();
+      }
+      UpdateMemory();
+    }
+
     // Return after the time interval has been met
     if (pred.cost().secs > max_seconds || pred.cost().cost > max_seconds * 4) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
@@ -375,6 +419,7 @@ Isochrone::Compute(google::protobuf::RepeatedPtrField<valhalla::Location>& origi
 }
 
 // Expand from a node in reverse direction.
+template <class CostT>
 void Isochrone::ExpandReverse(GraphReader& graphreader,
                               const GraphId& node,
                               const BDEdgeLabel& pred,
@@ -383,6 +428,8 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
                               const bool from_transition,
                               uint64_t localtime,
                               int32_t seconds_of_week) {
+  const CostCalls<CostT> costing(*costing_);
+
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
   const GraphTile* tile = graphreader.GetGraphTile(node);
@@ -397,7 +444,7 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
     float secs0 = (idx == kInvalidLabel) ? 0 : bdedgelabels_[idx].cost().secs;
     UpdateIsoTile(pred, graphreader, tile->get_node_ll(node), secs0);
   }
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!costing.Allowed(nodeinfo)) {
     return;
   }
 
@@ -437,26 +484,26 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
     if (has_date_time_) {
       // With date time we check time dependent restrictions and access as well as get
       // traffic based speed if it exists
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedge, localtime,
-                                    nodeinfo->timezone(), has_time_restrictions) ||
+      if (!costing.AllowedReverse(directededge, pred, opp_edge, t2, oppedge, localtime,
+                                  nodeinfo->timezone(), has_time_restrictions) ||
           costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, false, localtime,
                                nodeinfo->timezone())) {
         continue;
       }
     } else {
-      if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedge, 0, 0,
-                                    has_time_restrictions) ||
+      if (!costing.AllowedReverse(directededge, pred, opp_edge, t2, oppedge, 0, 0,
+                                  has_time_restrictions) ||
           costing_->Restricted(directededge, pred, bdedgelabels_, tile, edgeid, false)) {
         continue;
       }
     }
 
     // Compute the cost to the end of this edge with separate transition cost
-    Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
-                                              opp_pred_edge);
+    Cost tc = costing.TransitionCostReverse(directededge->localedgeidx(), nodeinfo, opp_edge,
+                                            opp_pred_edge);
     Cost newcost = pred.cost() +
-                   costing_->EdgeCost(opp_edge, t2,
-                                      has_date_time_ ? seconds_of_week : kConstrainedFlowSecondOfDay);
+                   costing.EdgeCost(opp_edge, t2,
+                                    has_date_time_ ? seconds_of_week : kConstrainedFlowSecondOfDay);
     newcost.cost += tc.cost;
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -484,8 +531,8 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
   if (!from_transition && nodeinfo->transition_count() > 0) {
     const NodeTransition* trans = tile->transition(nodeinfo->transition_index());
     for (uint32_t i = 0; i < nodeinfo->transition_count(); ++i, ++trans) {
-      ExpandReverse(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true, localtime,
-                    seconds_of_week);
+      ExpandReverse<CostT>(graphreader, trans->endnode(), pred, pred_idx, opp_pred_edge, true,
+                           localtime, seconds_of_week);
     }
   }
 }
@@ -535,6 +582,11 @@ Isochrone::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Location>
     has_date_time_ = true;
   }
 
+  // Use the expansion loop specialized for the costing, if any
+  const auto expand_reverse = SelectByCostType(*costing_, &Isochrone::ExpandReverse<AutoCost>,
+                                               &Isochrone::ExpandReverse<TruckCost>,
+                                               &Isochrone::ExpandReverse<DynamicCost>);
+
   // Compute the isotile
   uint32_t n = 0;
   while (true) {
@@ -560,10 +612,18 @@ Isochrone::ComputeReverse(google::protobuf::RepeatedPtrField<valhalla::Location>
         start_seconds_of_week - static_cast<uint32_t>(pred.cost().secs));
 
     // Expand from the end node in forward direction.
-    ExpandReverse(graphreader, pred.endnode(), pred, predindex, opp_pred_edge, false, localtime,
-                  seconds_of_week);
+    (this->*expand_reverse)(graphreader, pred.endnode(), pred, predindex, opp_pred_edge, false,
+                            localtime, seconds_of_week);
     n++;
 
+    // Allow this process to be aborted, check the memory it holds
+    if ((n % kInterruptIterationsInterval) == 0) {
+      if (interrupt_) {
+        (*interrupt_)();
+      }
+      UpdateMemory();
+    }
+
     // Return after the time interval has been met
     if (pred.cost().secs > max_seconds || pred.cost().cost > max_seconds * 4) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
@@ -701,9 +761,8 @@ bool Isochrone::ExpandForwardMM(GraphReader& graphreader,
       }
 
       // Look up the next departure along this edge
-      const TransitDeparture* departure =
-          tile->GetNextDeparture(directededge->lineid(), localtime, day_, dow_, date_before_tile_,
-                                 tc->wheelchair(), tc->bicycle());
+      auto departure = tile->GetNextDeparture(directededge->lineid(), localtime, day_, dow_,
+                                              date_before_tile_, tc->wheelchair(), tc->bicycle());
       if (departure) {
         // Check if there has been a mode change
         mode_change = (mode_ == TravelMode::kPedestrian);
@@ -748,7 +807,7 @@ bool Isochrone::ExpandForwardMM(GraphReader& graphreader,
 
         // Change mode and costing to transit. Add edge cost.
         mode_ = TravelMode::kPublicTransit;
-        newcost += tc->EdgeCost(directededge, departure, localtime);
+        newcost += tc->EdgeCost(directededge, departure.get_ptr(), localtime);
       } else {
         // No matching departures found for this edge
         continue;
@@ -910,7 +969,16 @@ Isochrone::ComputeMultiModal(google::protobuf::RepeatedPtrField<valhalla::Locati
 
   // Expand using adjacency list until we exceed threshold
   const GraphTile* tile;
+  size_t n = 0;
   while (true) {
+    // Allow this process to be aborted, check the memory it holds
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      if (interrupt_) {
+        (*interrupt_)();
+      }
+      UpdateMemory();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
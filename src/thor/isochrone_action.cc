@@ -1,3 +1,8 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "thor/worker.h"
 
 #include "tyr/serializers.h"
@@ -31,19 +36,119 @@ std::string thor_worker_t::isochrones(Api& request) {
   // Cost (including penalties) is used when adding to the adjacency list but the elapsed
   // time in seconds is used when terminating the search. The + 10 minutes adds a buffer for edges
   // where there has been a higher cost that might still be marked in the isochrone
+  isochrone_gen.set_interrupt(interrupt);
+  auto start = std::chrono::steady_clock::now();
   auto grid = (costing == "multimodal" || costing == "transit")
                   ? isochrone_gen.ComputeMultiModal(*options.mutable_locations(),
                                                     contours.back() + 10, *reader, mode_costing, mode)
                   : isochrone_gen.Compute(*options.mutable_locations(), contours.back() + 10, *reader,
                                           mode_costing, mode);
+  add_search_stats(isochrone_gen.stats(), start);
 
   // turn it into geojson
-  auto isolines =
-      grid->GenerateContours(contours, options.polygons(), options.denoise(), options.generalize());
+  start = std::chrono::steady_clock::now();
+  auto isolines = grid->GenerateContours(contours, options.polygons(), options.denoise(),
+                                         options.generalize(), contour_concurrency);
+  add_contour_stats(start);
+  set_search_stats(request);
 
   return tyr::serializeIsochrones<PointLL>(request, isolines, options.polygons(), colors,
                                            options.show_locations());
 }
 
+std::string thor_worker_t::batch_isochrones(Api& request) {
+  std::string jsonl;
+  batch_isochrones(request, [&jsonl](const std::string& line) { jsonl += line; });
+  return jsonl;
+}
+
+void thor_worker_t::batch_isochrones(Api& request,
+                                     const std::function<void(const std::string&)>& writer) {
+  parse_locations(request);
+  auto costing = parse_costing(request);
+  auto& options = *request.mutable_options();
+
+  std::vector<float> contours;
+  std::unordered_map<float, std::string> colors;
+  for (const auto& contour : options.contours()) {
+    contours.push_back(contour.time());
+    colors[contours.back()] = contour.color();
+  }
+  if (!options.has_generalize()) {
+    options.set_generalize(kOptimalGeneralization);
+  }
+
+  // The multimodal search excludes transit operators on the shared costing so
+  // those origins are done one at a time
+  bool multimodal = costing == "multimodal" || costing == "transit";
+  size_t origin_count = options.locations_size();
+  size_t thread_count =
+      multimodal ? 1 : std::min(isochrone_generators.size() + 1, std::max(origin_count, size_t(1)));
+
+  // Each origin is a separate search whose contours are written as soon as they are done
+  std::mutex writer_lock;
+  std::atomic<bool> stop{false};
+  std::vector<std::exception_ptr> errors(thread_count);
+  isochrone_gen.set_interrupt(interrupt);
+  for (auto& generator : isochrone_generators) {
+    generator->isochrone.set_interrupt(thread_interrupt);
+  }
+  auto work = [&](const size_t thread) {
+    try {
+      auto& isochrone = thread == 0 ? isochrone_gen : isochrone_generators[thread - 1]->isochrone;
+      auto& graphreader = thread == 0 ? *reader : *isochrone_generators[thread - 1]->reader;
+      for (size_t i = thread; i < origin_count && !stop; i += thread_count) {
+        // The interrupt is bound to the request thread, the other threads only check the
+        // deadline which is thread safe
+        const auto* check = thread == 0 ? interrupt : thread_interrupt;
+        if (check) {
+          (*check)();
+        }
+
+        std::string line;
+        if (options.locations(i).path_edges_size() == 0) {
+          line = tyr::serializeBatchIsochroneError(request, i, valhalla_exception_t{171});
+        } else {
+          google::protobuf::RepeatedPtrField<valhalla::Location> origin;
+          origin.Add()->CopyFrom(options.locations(i));
+          auto start = std::chrono::steady_clock::now();
+          auto grid = multimodal ? isochrone.ComputeMultiModal(origin, contours.back() + 10,
+                                                               graphreader, mode_costing, mode)
+                                 : isochrone.Compute(origin, contours.back() + 10, graphreader,
+                                                     mode_costing, mode);
+          add_search_stats(isochrone.stats(), start);
+          isochrone.Clear();
+          start = std::chrono::steady_clock::now();
+          auto isolines = grid->GenerateContours(contours, options.polygons(), options.denoise(),
+                                                 options.generalize(), contour_concurrency);
+          add_contour_stats(start);
+          line = tyr::serializeBatchIsochrone<PointLL>(request, i, isolines, options.polygons(),
+                                                       colors, options.show_locations());
+        }
+        std::lock_guard<std::mutex> lock(writer_lock);
+        writer(line);
+      }
+    } catch (...) {
+      errors[thread] = std::current_exception();
+      stop = true;
+    }
+  };
+
+  std::vector<std::shared_ptr<std::thread>> threads;
+  for (size_t thread = 1; thread < thread_count; ++thread) {
+    threads.emplace_back(new std::thread(work, thread));
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  set_search_stats(request);
+}
+
 } // namespace thor
 } // namespace valhalla
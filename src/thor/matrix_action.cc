@@ -1,6 +1,9 @@
+#include <chrono>
+
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -16,7 +19,12 @@ using namespace valhalla::thor;
 namespace {
 
 constexpr double kMilePerMeter = 0.000621371;
+
+// Parse out units; if none specified, use kilometers
+double distance_scale(const Options& options) {
+  return options.units() == Options::miles ? kMilePerMeter : kKmPerMeter;
 }
+} // namespace
 
 namespace valhalla {
 namespace thor {
@@ -24,6 +32,29 @@ namespace thor {
 constexpr uint32_t kCostMatrixThreshold = 5;
 
 std::string thor_worker_t::matrix(Api& request) {
+  // Json lines are written line by line as the rows are done
+  if (request.options().format() == Options::jsonl) {
+    std::string jsonl;
+    matrix(request, [&jsonl](const std::string& line) { jsonl += line; });
+    return jsonl;
+  }
+
+  auto time_distances = compute_matrix(request, nullptr);
+  return tyr::serializeMatrix(request, time_distances, distance_scale(request.options()));
+}
+
+void thor_worker_t::matrix(Api& request, const std::function<void(const std::string&)>& writer) {
+  writer(tyr::serializeMatrixHeader(request));
+  double scale = distance_scale(request.options());
+  compute_matrix(request, [&](const std::vector<TimeDistance>& time_distances,
+                              const uint32_t source) {
+    writer(tyr::serializeMatrixRow(request, time_distances, source, scale));
+  });
+}
+
+std::vector<TimeDistance> thor_worker_t::compute_matrix(
+    Api& request,
+    const std::function<void(const std::vector<TimeDistance>&, uint32_t)>& row_done) {
   parse_locations(request);
   auto costing = parse_costing(request);
   const auto& options = request.options();
@@ -33,24 +64,48 @@ std::string thor_worker_t::matrix(Api& request) {
                                     " [ANALYTICS] ");
   }
 
-  // Parse out units; if none specified, use kilometers
-  double distance_scale = kKmPerMeter;
-  if (options.units() == Options::miles) {
-    distance_scale = kMilePerMeter;
-  }
-
-  json::MapPtr json;
   // do the real work
   std::vector<TimeDistance> time_distances;
+  bool rows_reported = false;
   auto costmatrix = [&]() {
     thor::CostMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+    matrix.set_thread_readers(matrix_readers);
+    matrix.set_interrupt(interrupt);
+    matrix.set_thread_interrupt(thread_interrupt);
+    matrix.set_memory(&search_memory);
+    auto start = std::chrono::steady_clock::now();
+    auto td = matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing,
+                                    mode, max_matrix_distance.find(costing)->second);
+    add_search_stats(matrix.stats(), start);
+    return td;
+  };
+  auto bucketmatrix = [&]() {
+    thor::BucketMatrix matrix;
+    matrix.set_max_bucket_labels(bucket_matrix_max_labels);
+    matrix.set_thread_readers(matrix_readers);
+    matrix.set_interrupt(interrupt);
+    matrix.set_thread_interrupt(thread_interrupt);
+    matrix.set_memory(&search_memory);
+    auto start = std::chrono::steady_clock::now();
+    auto td = matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing,
+                                    mode, max_matrix_distance.find(costing)->second);
+    add_search_stats(matrix.stats(), start);
+    return td;
   };
   auto timedistancematrix = [&]() {
     thor::TimeDistanceMatrix matrix;
-    return matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
-                                 max_matrix_distance.find(costing)->second);
+    matrix.set_thread_readers(matrix_readers);
+    matrix.set_interrupt(interrupt);
+    matrix.set_thread_interrupt(thread_interrupt);
+    matrix.set_memory(&search_memory);
+    matrix.set_share_searches(matrix_share_searches);
+    matrix.set_row_callback(row_done);
+    rows_reported = true;
+    auto start = std::chrono::steady_clock::now();
+    auto td = matrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing,
+                                    mode, max_matrix_distance.find(costing)->second);
+    add_search_stats(matrix.stats(), start);
+    return td;
   };
   switch (source_to_target_algorithm) {
     case SELECT_OPTIMAL:
@@ -80,8 +135,19 @@ std::string thor_worker_t::matrix(Api& request) {
     case TIME_DISTANCE_MATRIX:
       time_distances = timedistancematrix();
       break;
+    case BUCKET_MATRIX:
+      time_distances = bucketmatrix();
+      break;
+  }
+
+  // Report all rows at once if the algorithm did not report them when done
+  if (row_done && !rows_reported) {
+    for (int source = 0; source < options.sources_size(); ++source) {
+      row_done(time_distances, source);
+    }
   }
-  return tyr::serializeMatrix(request, time_distances, distance_scale);
+  set_search_stats(request);
+  return time_distances;
 }
 } // namespace thor
 } // namespace valhalla
@@ -79,6 +79,11 @@ void MultiModalPathAlgorithm::Init(const midgard::PointLL& origll,
 
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
+  // Release the memory of the search from the budget
+  if (memory_) {
+    memory_->Release(memory_held_);
+  }
+
   // Clear the edge labels and destination list
   edgelabels_.clear();
   destinations_.clear();
@@ -93,6 +98,25 @@ void MultiModalPathAlgorithm::Clear() {
   has_ferry_ = false;
 }
 
+// Report the memory held by the search.
+void MultiModalPathAlgorithm::UpdateMemory() {
+  if (memory_) {
+    memory_->Update(memory_held_, edgelabels_.capacity() * sizeof(MMEdgeLabel) +
+                                      (adjacencylist_ ? adjacencylist_->memory() : 0) +
+                                      edgestatus_.memory());
+  }
+}
+
+// Get the counters of the search since it was last initialized.
+SearchStats MultiModalPathAlgorithm::stats() const {
+  SearchStats stats;
+  if (adjacencylist_) {
+    stats.Add(*adjacencylist_);
+  }
+  stats.Add(hierarchy_limits_);
+  return stats;
+}
+
 // Calculate best path using multiple modes (e.g. transit).
 std::vector<std::vector<PathInfo>>
 MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
@@ -169,17 +193,22 @@ MultiModalPathAlgorithm::GetBestPath(valhalla::Location& origin,
   operators_.clear();
   processed_tiles_.clear();
 
+  // Report the memory reserved for the search
+  UpdateMemory();
+
   // Find shortest path
   uint32_t nc = 0; // Count of iterations with no convergence
                    // towards destination
   const GraphTile* tile;
   size_t total_labels = 0;
   while (true) {
-    // Allow this process to be aborted
+    // Allow this process to be aborted, check the memory it holds
     size_t current_labels = edgelabels_.size();
-    if (interrupt &&
-        total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
-      (*interrupt)();
+    if (total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory();
     }
     total_labels = current_labels;
 
@@ -368,9 +397,8 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
       }
 
       // Look up the next departure along this edge
-      const TransitDeparture* departure =
-          tile->GetNextDeparture(directededge->lineid(), localtime, day_, dow_, date_before_tile_,
-                                 tc->wheelchair(), tc->bicycle());
+      auto departure = tile->GetNextDeparture(directededge->lineid(), localtime, day_, dow_,
+                                              date_before_tile_, tc->wheelchair(), tc->bicycle());
 
       if (departure) {
         // Check if there has been a mode change
@@ -416,7 +444,7 @@ bool MultiModalPathAlgorithm::ExpandForward(GraphReader& graphreader,
 
         // Change mode and costing to transit. Add edge cost.
         mode_ = TravelMode::kPublicTransit;
-        newcost += tc->EdgeCost(directededge, departure, localtime);
+        newcost += tc->EdgeCost(directededge, departure.get_ptr(), localtime);
       } else {
         // No matching departures found for this edge
         continue;
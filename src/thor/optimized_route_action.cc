@@ -6,8 +6,13 @@
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
 #include "thor/costmatrix.h"
+#include "thor/fleetoptimizer.h"
 #include "thor/optimizer.h"
 
+#include <chrono>
+#include <cmath>
+#include <limits>
+
 using namespace valhalla;
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -29,9 +34,13 @@ void thor_worker_t::optimized_route(Api& request) {
 
   // Use CostMatrix to find costs from each location to every other location
   CostMatrix costmatrix;
+  costmatrix.set_interrupt(interrupt);
+  costmatrix.set_memory(&search_memory);
+  auto start = std::chrono::steady_clock::now();
   std::vector<thor::TimeDistance> td =
       costmatrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
                                 max_matrix_distance.find(costing)->second);
+  add_search_stats(costmatrix.stats(), start);
 
   // Return an error if any locations are totally unreachable
   const auto& correlated =
@@ -54,6 +63,8 @@ void thor_worker_t::optimized_route(Api& request) {
   }
 
   Optimizer optimizer;
+  optimizer.set_threads(optimizer_concurrency);
+  optimizer.set_time_budget(optimizer_time_budget);
   // returns the optimal order of the path_locations
   auto optimal_order = optimizer.Solve(correlated.size(), time_costs);
   // put the optimal order into the locations array
@@ -64,6 +75,73 @@ void thor_worker_t::optimized_route(Api& request) {
 
   // run the route
   path_depart_at(request, costing);
+  set_search_stats(request);
+}
+
+void thor_worker_t::optimized_routes(Api& request) {
+  parse_locations(request);
+  parse_filter_attributes(request);
+  auto costing = parse_costing(request);
+  auto& options = *request.mutable_options();
+
+  if (!options.do_not_track()) {
+    valhalla::midgard::logging::Log("matrix_type::optimized_routes", " [ANALYTICS] ");
+  }
+
+  // Use CostMatrix to find costs from each location to every other location
+  CostMatrix costmatrix;
+  costmatrix.set_interrupt(interrupt);
+  costmatrix.set_memory(&search_memory);
+  costmatrix.set_thread_readers(matrix_readers);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<thor::TimeDistance> td =
+      costmatrix.SourceToTarget(options.sources(), options.targets(), *reader, mode_costing, mode,
+                                max_matrix_distance.find(costing)->second);
+  add_search_stats(costmatrix.stats(), start);
+
+  // Set time costs to send to the FleetOptimizer, unreachable pairs get an
+  // infinite cost
+  std::vector<float> time_costs;
+  for (const auto& t : td) {
+    time_costs.emplace_back(t.time == kMaxCost ? std::numeric_limits<float>::infinity()
+                                               : static_cast<float>(t.time));
+  }
+
+  // Assign the jobs to the vehicles
+  FleetOptimizer optimizer;
+  auto solution =
+      optimizer.Solve(options.sources_size(), time_costs, options.vehicles(), options.jobs());
+
+  // Route each vehicle from its start through its jobs to its end. Each stop
+  // is a leg of the route of the vehicle
+  const auto correlated = options.sources();
+  for (const auto& fleet_route : solution.routes) {
+    const auto& vehicle = options.vehicles(fleet_route.vehicle);
+    options.mutable_locations()->Clear();
+    options.mutable_locations()->Add()->CopyFrom(correlated.Get(vehicle.start()));
+    for (auto job : fleet_route.jobs) {
+      options.mutable_locations()->Add()->CopyFrom(correlated.Get(options.jobs(job).location()));
+    }
+    if (vehicle.has_end()) {
+      options.mutable_locations()->Add()->CopyFrom(correlated.Get(vehicle.end()));
+    }
+    for (auto& location : *options.mutable_locations()) {
+      location.set_type(valhalla::Location::kBreak);
+    }
+    path_depart_at(request, costing);
+
+    // Keep which vehicle and jobs the route is for
+    auto& route = *request.mutable_trip()->mutable_routes()->rbegin();
+    route.set_vehicle(fleet_route.vehicle);
+    for (size_t i = 0; i < fleet_route.jobs.size(); ++i) {
+      route.add_jobs(fleet_route.jobs[i]);
+      route.add_arrival_times(fleet_route.arrivals[i]);
+    }
+  }
+  for (auto job : solution.unassigned) {
+    request.mutable_trip()->add_unassigned_jobs(job);
+  }
+  set_search_stats(request);
 }
 
 } // namespace thor
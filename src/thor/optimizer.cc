@@ -1,25 +1,481 @@
 #include "thor/optimizer.h"
 #include "midgard/logging.h"
 
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// Improvements smaller than this are ignored so rounding errors cannot make
+// the local search cycle.
+constexpr double kMinImprovement = 1e-3;
+
+// Longest segment moved by an Or-opt move
+constexpr uint32_t kMaxOrOptLength = 3;
+
+// Local search (2-opt and Or-opt with neighbor lists and don't look bits) on a
+// tour with fixed first and last locations. Only reads the costs and neighbor
+// lists so several can run on different threads.
+class LocalSearch {
+public:
+  LocalSearch(const uint32_t count,
+              const std::vector<float>& costs,
+              const std::vector<uint32_t>& neighbors_out,
+              const std::vector<uint32_t>& neighbors_in,
+              const uint32_t neighbor_count)
+      : count_(count), costs_(costs), neighbors_out_(neighbors_out), neighbors_in_(neighbors_in),
+        neighbor_count_(neighbor_count), pos_(count), forward_(count), reverse_(count),
+        active_(count, 0) {
+  }
+
+  // Set the tour
+  void Set(const std::vector<uint32_t>& tour) {
+    tour_ = tour;
+    Update(0, count_ - 1);
+  }
+
+  // Set the tour and improve it, looking at all locations
+  void Optimize(const std::vector<uint32_t>& tour) {
+    Set(tour);
+    for (uint32_t i = 0; i < count_ - 1; i++) {
+      Activate(tour_[i]);
+    }
+    Run();
+  }
+
+  // Exchange random adjacent segments of the tour (once or twice) and improve
+  // it, looking only at the locations whose connections changed
+  void Perturb(std::mt19937_64& generator) {
+    std::uniform_int_distribution<uint32_t> dist(0, count_ - 2);
+    uint32_t exchanges = 1 + generator() % 2;
+    for (uint32_t i = 0; i < exchanges; i++) {
+      // Pick 0 <= p < q < r <= count - 2
+      uint32_t p, q, r;
+      do {
+        p = dist(generator);
+        q = dist(generator);
+        r = dist(generator);
+      } while (p == q || p == r || q == r);
+      if (p > q) {
+        std::swap(p, q);
+      }
+      if (q > r) {
+        std::swap(q, r);
+      }
+      if (p > q) {
+        std::swap(p, q);
+      }
+      Exchange(p, q, r);
+    }
+    Run();
+  }
+
+  const std::vector<uint32_t>& tour() const {
+    return tour_;
+  }
+
+  double cost() const {
+    return forward_[count_ - 1];
+  }
+
+private:
+  // A move of the tour: reverse (p+1..q) or exchange (p+1..q) with (q+1..r)
+  struct Move {
+    bool exchange;
+    uint32_t p, q, r;
+    double delta;
+  };
+
+  uint32_t count_;
+  const std::vector<float>& costs_;
+  const std::vector<uint32_t>& neighbors_out_;
+  const std::vector<uint32_t>& neighbors_in_;
+  uint32_t neighbor_count_;
+
+  std::vector<uint32_t> tour_;   // Order of locations
+  std::vector<uint32_t> pos_;    // Index of each location in the tour
+  std::vector<double> forward_;  // Cost from the start of the tour to each index
+  std::vector<double> reverse_;  // Same but traversing each connection backwards
+  std::vector<uint8_t> active_;  // Don't look bits (0 = don't look)
+  std::deque<uint32_t> queue_;   // Locations to look at
+
+  double c(const uint32_t a, const uint32_t b) const {
+    return costs_[a * count_ + b];
+  }
+
+  // Cost of the tour between 2 indexes, forwards and backwards
+  double forward(const uint32_t i, const uint32_t j) const {
+    return forward_[j] - forward_[i];
+  }
+  double reverse(const uint32_t i, const uint32_t j) const {
+    return reverse_[j] - reverse_[i];
+  }
+
+  void Activate(const uint32_t location) {
+    if (!active_[location]) {
+      active_[location] = 1;
+      queue_.push_back(location);
+    }
+  }
+
+  // Update positions and costs between 2 tour indexes (inclusive)
+  void Update(const uint32_t from, const uint32_t to) {
+    for (uint32_t i = from; i <= to; i++) {
+      pos_[tour_[i]] = i;
+    }
+    for (uint32_t i = std::max(from, 1u); i < count_; i++) {
+      forward_[i] = forward_[i - 1] + c(tour_[i - 1], tour_[i]);
+      reverse_[i] = reverse_[i - 1] + c(tour_[i], tour_[i - 1]);
+    }
+  }
+
+  // Change in cost from reversing tour indexes p+1..q
+  double ReverseDelta(const uint32_t p, const uint32_t q) const {
+    return c(tour_[p], tour_[q]) + c(tour_[p + 1], tour_[q + 1]) - c(tour_[p], tour_[p + 1]) -
+           c(tour_[q], tour_[q + 1]) + reverse(p + 1, q) - forward(p + 1, q);
+  }
+
+  // Change in cost from exchanging tour indexes p+1..q with q+1..r
+  double ExchangeDelta(const uint32_t p, const uint32_t q, const uint32_t r) const {
+    return c(tour_[p], tour_[q + 1]) + c(tour_[r], tour_[p + 1]) + c(tour_[q], tour_[r + 1]) -
+           c(tour_[p], tour_[p + 1]) - c(tour_[q], tour_[q + 1]) - c(tour_[r], tour_[r + 1]);
+  }
+
+  void Reverse(const uint32_t p, const uint32_t q) {
+    Activate(tour_[p]);
+    Activate(tour_[p + 1]);
+    Activate(tour_[q]);
+    Activate(tour_[q + 1]);
+    std::reverse(tour_.begin() + p + 1, tour_.begin() + q + 1);
+    Update(p + 1, q);
+  }
+
+  void Exchange(const uint32_t p, const uint32_t q, const uint32_t r) {
+    Activate(tour_[p]);
+    Activate(tour_[p + 1]);
+    Activate(tour_[q]);
+    Activate(tour_[q + 1]);
+    Activate(tour_[r]);
+    Activate(tour_[r + 1]);
+    std::rotate(tour_.begin() + p + 1, tour_.begin() + q + 1, tour_.begin() + r + 1);
+    Update(p + 1, r);
+  }
+
+  void Consider(Move& best,
+                const bool exchange,
+                const uint32_t p,
+                const uint32_t q,
+                const uint32_t r) {
+    double delta = exchange ? ExchangeDelta(p, q, r) : ReverseDelta(p, q);
+    if (delta < best.delta) {
+      best = {exchange, p, q, r, delta};
+    }
+  }
+
+  // Find the best move adding the connection from location a to location b.
+  // The tour is 0..n-1, moves need p >= 0 and q, r <= n-2.
+  void ConsiderConnection(Move& best, const uint32_t a, const uint32_t b) {
+    const uint32_t x = pos_[a];
+    const uint32_t y = pos_[b];
+    const uint32_t last = count_ - 2;
+    if (x + 1 == y) {
+      return;
+    }
+
+    // Reverse p+1..q adds p->q and p+1->q+1
+    if (x + 1 < y && y <= last) {
+      Consider(best, false, x, y, 0);
+    }
+    if (x >= 1 && x + 1 < y) {
+      Consider(best, false, x - 1, y - 1, 0);
+    }
+
+    // Exchange p+1..q with q+1..r adds p->q+1, r->p+1 and q->r+1. One of
+    // the 2 segments is kept short (Or-opt).
+    if (x + 1 < y) {
+      // p = x, q = y - 1
+      for (uint32_t r = y; r <= last && r < y + kMaxOrOptLength; r++) {
+        Consider(best, true, x, y - 1, r);
+      }
+    }
+    if (y >= 1 && y < x && x <= last) {
+      // r = x, p = y - 1
+      for (uint32_t q = y; q < x && q < y + kMaxOrOptLength; q++) {
+        Consider(best, true, y - 1, q, x);
+      }
+      uint32_t first = std::max(y + kMaxOrOptLength, x > kMaxOrOptLength ? x - kMaxOrOptLength : 0);
+      for (uint32_t q = first; q < x; q++) {
+        Consider(best, true, y - 1, q, x);
+      }
+    }
+    if (x + 1 < y) {
+      // q = x, r = y - 1
+      uint32_t r = y - 1;
+      for (uint32_t p = x; p-- > 0 && p + kMaxOrOptLength >= x;) {
+        Consider(best, true, p, x, r);
+      }
+    }
+  }
+
+  // Look at locations until no improving move is found
+  void Run() {
+    while (!queue_.empty()) {
+      uint32_t a = queue_.front();
+      queue_.pop_front();
+      active_[a] = 0;
+
+      // Find the best move adding a connection from a to one of its nearest
+      // locations or to a from one of its nearest locations
+      Move best{false, 0, 0, 0, -kMinImprovement};
+      const uint32_t* out = &neighbors_out_[a * neighbor_count_];
+      const uint32_t* in = &neighbors_in_[a * neighbor_count_];
+      for (uint32_t i = 0; i < neighbor_count_; i++) {
+        ConsiderConnection(best, a, out[i]);
+        ConsiderConnection(best, in[i], a);
+      }
+      if (best.delta < -kMinImprovement) {
+        if (best.exchange) {
+          Exchange(best.p, best.q, best.r);
+        } else {
+          Reverse(best.p, best.q);
+        }
+        Activate(a);
+      }
+    }
+  }
+};
+
+// Nearest locations to each location, by cost from it (out) or to it (in).
+// The origin is never reached and the destination is never left so they are
+// left out of in and out lists respectively.
+void NearestNeighbors(const uint32_t count,
+                      const std::vector<float>& costs,
+                      const uint32_t neighbor_count,
+                      std::vector<uint32_t>& neighbors_out,
+                      std::vector<uint32_t>& neighbors_in) {
+  neighbors_out.resize(count * neighbor_count);
+  neighbors_in.resize(count * neighbor_count);
+  std::vector<uint32_t> candidates;
+  for (uint32_t a = 0; a < count; a++) {
+    candidates.clear();
+    for (uint32_t b = 1; b < count; b++) {
+      if (b != a) {
+        candidates.push_back(b);
+      }
+    }
+    auto by_out = [&](const uint32_t b1, const uint32_t b2) {
+      float c1 = costs[a * count + b1];
+      float c2 = costs[a * count + b2];
+      return c1 < c2 || (c1 == c2 && b1 < b2);
+    };
+    std::partial_sort(candidates.begin(), candidates.begin() + neighbor_count, candidates.end(),
+                      by_out);
+    std::copy(candidates.begin(), candidates.begin() + neighbor_count,
+              neighbors_out.begin() + a * neighbor_count);
+
+    candidates.clear();
+    for (uint32_t b = 0; b < count - 1; b++) {
+      if (b != a) {
+        candidates.push_back(b);
+      }
+    }
+    auto by_in = [&](const uint32_t b1, const uint32_t b2) {
+      float c1 = costs[b1 * count + a];
+      float c2 = costs[b2 * count + a];
+      return c1 < c2 || (c1 == c2 && b1 < b2);
+    };
+    std::partial_sort(candidates.begin(), candidates.begin() + neighbor_count, candidates.end(),
+                      by_in);
+    std::copy(candidates.begin(), candidates.begin() + neighbor_count,
+              neighbors_in.begin() + a * neighbor_count);
+  }
+}
+
+} // namespace
+
 namespace valhalla {
 namespace thor {
 
+Optimizer::Optimizer() : seed_(0), threads_(1), time_budget_(0), count_(0) {
+}
+
 // Optimize the tour through a set of locations given the cost matrix
 // among all locations. The first location (origin) and last location
 // (destination) remain fixed in the tour.
 std::vector<uint32_t> Optimizer::Solve(const uint32_t count, const std::vector<float>& costs) {
   // Handle trivial cases.
   count_ = count;
-  if (count == 2) {
+  auto tour = SolveTrivial(costs);
+  if (!tour.empty()) {
+    return tour;
+  }
+
+  // Nearest neighbors of each location. The origin has no in neighbors and
+  // the destination no out neighbors so there are count - 2 of each.
+  uint32_t neighbor_count = std::min(kNeighborCount, count_ - 2);
+  std::vector<uint32_t> neighbors_out, neighbors_in;
+  NearestNeighbors(count_, costs, neighbor_count, neighbors_out, neighbors_in);
+
+  // Build an initial tour and improve it
+  LocalSearch initial(count_, costs, neighbors_out, neighbors_in, neighbor_count);
+  initial.Optimize(CheapestInsertion(costs));
+  const std::vector<uint32_t> initial_tour = initial.tour();
+
+  // Restarts perturb the best tour they found and improve it again. Each
+  // restart has its own seed so the result only depends on the seed.
+  uint32_t perturbations = std::min(kPerturbationsPerLocation * count_, kMaxPerturbations);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_budget_);
+  std::vector<std::vector<uint32_t>> tours(kRestarts);
+  std::vector<double> tour_costs(kRestarts, std::numeric_limits<double>::max());
+  auto restart = [&](const uint32_t index) {
+    std::mt19937_64 generator(seed_ + index);
+    LocalSearch search(count_, costs, neighbors_out, neighbors_in, neighbor_count);
+    search.Optimize(initial_tour);
+    tours[index] = search.tour();
+    tour_costs[index] = search.cost();
+    for (uint32_t i = 0; i < perturbations; i++) {
+      if (time_budget_ > 0 && (i % 16) == 0 && std::chrono::steady_clock::now() > deadline) {
+        break;
+      }
+      search.Perturb(generator);
+      if (search.cost() < tour_costs[index] - kMinImprovement) {
+        tours[index] = search.tour();
+        tour_costs[index] = search.cost();
+      } else if (search.tour() != tours[index]) {
+        search.Set(tours[index]);
+      }
+    }
+  };
+
+  uint32_t thread_count = std::min(threads_, kRestarts);
+  std::vector<std::exception_ptr> errors(thread_count);
+  auto work = [&](const uint32_t thread) {
+    try {
+      for (uint32_t i = thread; i < kRestarts; i += thread_count) {
+        restart(i);
+      }
+    } catch (...) { errors[thread] = std::current_exception(); }
+  };
+  std::vector<std::shared_ptr<std::thread>> threads(thread_count - 1);
+  for (uint32_t i = 1; i < thread_count; ++i) {
+    threads[i - 1].reset(new std::thread(work, i));
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Return the best tour. Ties go to the lowest restart.
+  uint32_t best = std::min_element(tour_costs.begin(), tour_costs.end()) - tour_costs.begin();
+  LOG_DEBUG("Best tour cost = " + std::to_string(tour_costs[best]));
+  return tours[best];
+}
+
+// Handle trivial cases.
+std::vector<uint32_t> Optimizer::SolveTrivial(const std::vector<float>& costs) const {
+  if (count_ == 2) {
     return {0, 1};
   } else if (count_ == 3) {
     return {0, 1, 2};
-  } else if (count == 4) {
+  } else if (count_ == 4) {
     // Only one possible way to alter the path.
     std::vector<uint32_t> tour1 = {0, 1, 2, 3};
     std::vector<uint32_t> tour2 = {0, 2, 1, 3};
     return (TourCost(costs, tour1) < TourCost(costs, tour2)) ? tour1 : tour2;
   }
+  return {};
+}
+
+// Build a tour by cheapest insertion. The cheapest place to insert each
+// location is cached and only recomputed when the connection it would
+// replace was removed.
+std::vector<uint32_t> Optimizer::CheapestInsertion(const std::vector<float>& costs) const {
+  // The tour is kept as a linked list of successors
+  std::vector<uint32_t> next(count_, count_);
+  next[0] = count_ - 1;
+
+  // Cheapest insertion (after the location) and its added cost for each
+  // location not in the tour
+  std::vector<uint32_t> after(count_);
+  std::vector<float> added(count_);
+  auto find_insertion = [&](const uint32_t loc) {
+    added[loc] = std::numeric_limits<float>::max();
+    for (uint32_t a = 0; a != count_ - 1; a = next[a]) {
+      float c = Cost(costs, a, loc) + Cost(costs, loc, next[a]) - Cost(costs, a, next[a]);
+      if (c < added[loc]) {
+        added[loc] = c;
+        after[loc] = a;
+      }
+    }
+  };
+  std::vector<uint32_t> remaining;
+  for (uint32_t loc = 1; loc < count_ - 1; loc++) {
+    remaining.push_back(loc);
+    find_insertion(loc);
+  }
+
+  while (!remaining.empty()) {
+    // Insert the location adding the least cost
+    auto it = std::min_element(remaining.begin(), remaining.end(),
+                               [&](const uint32_t a, const uint32_t b) {
+                                 return added[a] < added[b] || (added[a] == added[b] && a < b);
+                               });
+    uint32_t loc = *it;
+    remaining.erase(it);
+    uint32_t a = after[loc];
+    uint32_t b = next[a];
+    next[a] = loc;
+    next[loc] = b;
+
+    // Locations that were to be inserted between a and b need a new place.
+    // Others only need to check the 2 new connections.
+    for (auto other : remaining) {
+      if (after[other] == a) {
+        find_insertion(other);
+        continue;
+      }
+      float c = Cost(costs, a, other) + Cost(costs, other, loc) - Cost(costs, a, loc);
+      if (c < added[other]) {
+        added[other] = c;
+        after[other] = a;
+      }
+      c = Cost(costs, loc, other) + Cost(costs, other, b) - Cost(costs, loc, b);
+      if (c < added[other]) {
+        added[other] = c;
+        after[other] = loc;
+      }
+    }
+  }
+
+  std::vector<uint32_t> tour;
+  for (uint32_t a = 0; a != count_; a = next[a]) {
+    tour.push_back(a);
+    if (a == count_ - 1) {
+      break;
+    }
+  }
+  return tour;
+}
+
+// Optimize the tour with simulated annealing.
+std::vector<uint32_t> Optimizer::SolveAnnealing(const uint32_t count,
+                                                const std::vector<float>& costs) {
+  // Handle trivial cases.
+  count_ = count;
+  auto tour = SolveTrivial(costs);
+  if (!tour.empty()) {
+    return tour;
+  }
 
   // Populate the initial tour with a random order. The first and last
   // locations must remain fixed as the tour begin and end locations do not
@@ -106,7 +562,7 @@ void Optimizer::CreateRandomTour() {
   for (uint32_t i = 1; i < count_ - 1; i++) {
     tour_.push_back(i);
   }
-  std::random_shuffle(tour_.begin(), tour_.end());
+  std::shuffle(tour_.begin(), tour_.end(), random_generator_);
   tour_.insert(tour_.begin(), 0);
   tour_.push_back(count_ - 1);
 }
@@ -169,10 +625,12 @@ float Optimizer::TemperatureDifference(const std::vector<float>& costs,
 }
 
 // Get the cost for the specified tour (order of locations).
-float Optimizer::TourCost(const std::vector<float>& costs, const std::vector<uint32_t>& tour) const {
+float Optimizer::TourCost(const uint32_t count,
+                          const std::vector<float>& costs,
+                          const std::vector<uint32_t>& tour) {
   float c = 0;
-  for (uint32_t i = 0; i < count_ - 1; i++) {
-    c += costs[(tour[i] * count_) + tour[i + 1]];
+  for (uint32_t i = 0; i < count - 1; i++) {
+    c += costs[(tour[i] * count) + tour[i + 1]];
   }
   return c;
 }
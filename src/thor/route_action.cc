@@ -1,5 +1,10 @@
 #include "thor/worker.h"
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <future>
+#include <list>
+#include <thread>
 
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
@@ -26,6 +31,55 @@ namespace {
 // A* can take excessive time for longer paths - so exclude them to protect the service.
 constexpr float kPedestrianMultipassThreshold = 50000.0f; // 50km
 
+/**
+ * Check if a request routes with exactly the profile the arc flags were computed with:
+ * default auto costing options, no avoids and no date time (so no time dependent
+ * speeds). Pruning with the flags could miss the best path with any other profile.
+ */
+bool is_arcflags_profile(const Options& options) {
+  if (options.costing() != Costing::auto_ || options.avoid_edges_size() > 0 ||
+      options.has_date_time_type() ||
+      options.costing_options_size() <= static_cast<int>(Costing::auto_)) {
+    return false;
+  }
+  for (const auto& location : options.locations()) {
+    if (location.has_date_time()) {
+      return false;
+    }
+  }
+
+  // Options parsed from a request without auto costing options nor date time (which
+  // disables the time dependent speeds, as the flags are computed)
+  static const std::string kDefaultOptions = []() {
+    rapidjson::Document doc;
+    doc.SetObject();
+    CostingOptions costing_options;
+    ParseAutoCostOptions(doc, "/costing_options/auto", &costing_options);
+    costing_options.set_flow_mask(static_cast<uint8_t>(costing_options.flow_mask()) &
+                                  ~(kPredictedFlowMask | kCurrentFlowMask));
+    return costing_options.SerializeAsString();
+  }();
+  return options.costing_options(static_cast<int>(Costing::auto_)).SerializeAsString() ==
+         kDefaultOptions;
+}
+
+/**
+ * Check if a location routes as it did: it has the same candidate edges, in the same
+ * order, and the same date time.
+ */
+bool same_route_location(const valhalla::Location& a, const valhalla::Location& b) {
+  if (a.has_date_time() != b.has_date_time() || a.date_time() != b.date_time() ||
+      a.path_edges_size() != b.path_edges_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.path_edges_size(); ++i) {
+    if (a.path_edges(i).graph_id() != b.path_edges(i).graph_id()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /**
  * Check if the paths meet at opposing edges (but not at a node). If so, add a route discontinuity
  * so that the shape / distance along the path is adjusted at the location.
@@ -211,11 +265,22 @@ void thor_worker_t::route(Api& request) {
   auto costing = parse_costing(request);
   auto& options = *request.mutable_options();
 
-  // get all the legs
-  if (options.has_date_time_type() && options.date_time_type() == Options::arrive_by) {
-    path_arrive_by(request, costing);
-  } else {
-    path_depart_at(request, costing);
+  // get all the legs, unless the results of an identical request are cached
+  std::string cache_key;
+  uint64_t graph_dataset_id = 0;
+  if (route_cache) {
+    cache_key = RouteCache::Key(options);
+    graph_dataset_id = dataset_id(options);
+  }
+  if (!route_cache || !route_cache->Get(cache_key, graph_dataset_id, request)) {
+    if (options.has_date_time_type() && options.date_time_type() == Options::arrive_by) {
+      path_arrive_by(request, costing);
+    } else {
+      path_depart_at(request, costing);
+    }
+    if (route_cache) {
+      route_cache->Put(cache_key, graph_dataset_id, request);
+    }
   }
   // log admin areas
   if (!options.do_not_track()) {
@@ -225,13 +290,28 @@ void thor_worker_t::route(Api& request) {
       }
     }
   }
+  set_search_stats(request);
 }
 
 thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routetype,
                                                        const valhalla::Location& origin,
-                                                       const valhalla::Location& destination) {
-  // Have to use multimodal for transit based routing
+                                                       const valhalla::Location& destination,
+                                                       const Options& options,
+                                                       leg_router_t* router) {
+  // Legs computed on a leg router thread use the searches and graph reader of that
+  // thread, which can only check the deadline of the request
+  AStarPathAlgorithm& astar = router ? router->astar : this->astar;
+  BidirectionalAStar& bidir_astar = router ? router->bidir_astar : this->bidir_astar;
+  GraphReader& graphreader = router ? *router->reader : *reader;
+  const auto* interrupt = router ? thread_interrupt : this->interrupt;
+
+  // Have to use multimodal for transit based routing, the request can ask for the round based
+  // connection scan instead of the time dependent search
   if (routetype == "multimodal" || routetype == "transit") {
+    if (options.transit_algorithm() == Options::connection_scan) {
+      connection_scan.set_interrupt(interrupt);
+      return &connection_scan;
+    }
     multi_modal_astar.set_interrupt(interrupt);
     return &multi_modal_astar;
   }
@@ -265,7 +345,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
   for (auto& edge1 : origin.path_edges()) {
     for (auto& edge2 : destination.path_edges()) {
       if (edge1.graph_id() == edge2.graph_id() ||
-          reader->AreEdgesConnected(GraphId(edge1.graph_id()), GraphId(edge2.graph_id()))) {
+          graphreader.AreEdgesConnected(GraphId(edge1.graph_id()), GraphId(edge2.graph_id()))) {
         astar.set_interrupt(interrupt);
         return &astar;
       }
@@ -280,14 +360,31 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
                                                                  valhalla::Location& destination,
                                                                  const std::string& costing,
                                                                  const Options& options) {
+  return get_path(path_algorithm, origin, destination, costing, options, *reader, mode_costing);
+}
+
+std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm* path_algorithm,
+                                                                 valhalla::Location& origin,
+                                                                 valhalla::Location& destination,
+                                                                 const std::string& costing,
+                                                                 const Options& options,
+                                                                 GraphReader& graphreader,
+                                                                 const sif::cost_ptr_t* costings) {
   // Find the path. If bidirectional A* disable use of destination only edges on the
   // first pass. If there is a failure, we allow them on the second pass.
-  valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
-  if (path_algorithm == &bidir_astar) {
+  valhalla::sif::cost_ptr_t cost = costings[static_cast<uint32_t>(mode)];
+  if (dynamic_cast<BidirectionalAStar*>(path_algorithm)) {
     cost->set_allow_destination_only(false);
   }
   cost->set_pass(0);
-  auto paths = path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+  // Arc flags are computed with the default auto costing so only prune routes using it
+  path_algorithm->set_use_arcflags(use_arcflags && costing == "auto" &&
+                                   is_arcflags_profile(options));
+  auto start = std::chrono::steady_clock::now();
+  auto paths =
+      path_algorithm->GetBestPath(origin, destination, graphreader, costings, mode, options);
+  add_search_stats(path_algorithm->stats(), start);
+  path_algorithm->set_use_arcflags(false);
 
   // Check if we should run a second pass pedestrian route with different A*
   // (to look for better routes where a ferry is taken)
@@ -311,15 +408,17 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
 
     path_algorithm->Clear();
     cost->set_pass(1);
-    bool using_astar = (path_algorithm == &astar);
+    bool using_astar = dynamic_cast<AStarPathAlgorithm*>(path_algorithm) != nullptr;
     float relax_factor = using_astar ? 16.0f : 8.0f;
     float expansion_within_factor = using_astar ? 4.0f : 2.0f;
     cost->RelaxHierarchyLimits(relax_factor, expansion_within_factor);
     cost->set_allow_destination_only(true);
 
     // Get the best path. Return if not empty (else return the original path)
+    start = std::chrono::steady_clock::now();
     auto relaxed_paths =
-        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+        path_algorithm->GetBestPath(origin, destination, graphreader, costings, mode, options);
+    add_search_stats(path_algorithm->stats(), start);
     if (!relaxed_paths.empty()) {
       return relaxed_paths;
     }
@@ -332,35 +431,154 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   return paths;
 }
 
+// Take a leg computed ahead of time if its locations are unchanged (an earlier leg may
+// have added the filtered edges to a location shared with this leg, or set its time).
+// Updates the locations as routing the leg would have.
+bool thor_worker_t::leg_paths_t::take(valhalla::Location& origin,
+                                      valhalla::Location& destination,
+                                      std::vector<std::vector<PathInfo>>& leg_paths) {
+  if (!computed || !same_route_location(origin, origin_start) ||
+      !same_route_location(destination, destination_start)) {
+    return false;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  origin.mutable_path_edges()->Swap(this->origin.mutable_path_edges());
+  destination.mutable_path_edges()->Swap(this->destination.mutable_path_edges());
+  leg_paths = std::move(paths);
+  return true;
+}
+
+// Compute the legs between consecutive locations on the leg router threads. Legs that
+// depend on an adjacent leg are left to the sequential pass: those continuing through a
+// location (only the edge the adjacent leg used is allowed) and time dependent routes
+// (the time at a location depends on the previous leg).
+std::vector<thor_worker_t::leg_paths_t>
+thor_worker_t::compute_legs(Api& api, const std::string& costing, bool arrive_by) {
+  const auto& options = api.options();
+  const auto& locations = options.locations();
+  std::vector<leg_paths_t> legs;
+  if (leg_routers.empty() || locations.size() < 3 || options.action() == Options::expansion ||
+      costing == "multimodal" || costing == "transit") {
+    return legs;
+  }
+  for (const auto& location : locations) {
+    if (location.has_date_time()) {
+      return legs;
+    }
+  }
+
+  // Copy the locations of each leg that does not depend on an adjacent leg
+  std::vector<size_t> jobs;
+  legs.resize(locations.size() - 1);
+  for (int i = 0; i < locations.size() - 1; ++i) {
+    const auto& through = arrive_by ? locations.Get(i + 1) : locations.Get(i);
+    bool first = arrive_by ? i == locations.size() - 2 : i == 0;
+    if (!first && (through.type() == valhalla::Location::kThrough ||
+                   through.type() == valhalla::Location::kBreakThrough)) {
+      continue;
+    }
+    legs[i].origin = legs[i].origin_start = locations.Get(i);
+    legs[i].destination = legs[i].destination_start = locations.Get(i + 1);
+    jobs.push_back(i);
+  }
+  if (jobs.size() < 2) {
+    legs.clear();
+    return legs;
+  }
+
+  // Each thread takes the next leg until all of them are done. Errors are kept with the leg
+  // so they are raised in order when the legs are assembled.
+  std::atomic<size_t> next_job(0);
+  std::atomic<bool> cancel(false);
+  auto compute = [&](leg_router_t& router, std::promise<void>& result) {
+    size_t job;
+    while (!cancel && (job = next_job++) < jobs.size()) {
+      auto& leg = legs[jobs[job]];
+      try {
+        // Each leg gets its own costing since computing a path changes it (pass, hierarchy limits)
+        sif::cost_ptr_t leg_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+        leg_costing[static_cast<uint32_t>(mode)] = factory.Create(options.costing(), options);
+
+        PathAlgorithm* path_algorithm =
+            get_path_algorithm(costing, leg.origin, leg.destination, options, &router);
+        path_algorithm->Clear();
+        leg.paths = get_path(path_algorithm, leg.origin, leg.destination, costing, options,
+                             *router.reader, leg_costing);
+      } catch (...) { leg.error = std::current_exception(); }
+      leg.computed = true;
+    }
+    result.set_value();
+  };
+
+  std::vector<std::shared_ptr<std::thread>> threads(std::min(leg_routers.size(), jobs.size()));
+  std::list<std::promise<void>> results;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    results.emplace_back();
+    threads[i].reset(
+        new std::thread(compute, std::ref(*leg_routers[i]), std::ref(results.back())));
+  }
+
+  // Wait for the threads, allowing the request to be interrupted meanwhile
+  try {
+    for (auto& result : results) {
+      auto future = result.get_future();
+      while (future.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+        if (interrupt) {
+          (*interrupt)();
+        }
+      }
+    }
+  } catch (...) {
+    cancel = true;
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    throw;
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  return legs;
+}
+
 void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
   // Things we'll need
   TripRoute* route = nullptr;
   GraphId first_edge;
   std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>> vias;
   std::vector<thor::PathInfo> path;
+  auto legs = compute_legs(api, costing, true);
   auto& correlated = *api.mutable_options()->mutable_locations();
 
   // For each pair of locations
   for (auto origin = ++correlated.rbegin(); origin != correlated.rend(); ++origin) {
-    // Get the algorithm type for this location pair
     auto destination = std::prev(origin);
-    thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing, *origin, *destination);
-    path_algorithm->Clear();
 
-    // TODO: delete this and send all cases to the function above
-    // If we are continuing through a location we need to make sure we
-    // only allow the edge that was used previously (avoid u-turns)
-    bool through = destination->type() == valhalla::Location::kThrough ||
-                   destination->type() == valhalla::Location::kBreakThrough;
-    while (through && first_edge.Is_Valid() && destination->path_edges_size() > 1) {
-      if (destination->path_edges().rbegin()->graph_id() == first_edge) {
-        destination->mutable_path_edges()->SwapElements(0, destination->path_edges_size() - 1);
+    // Get best path and keep it. Use the leg if it was computed ahead of time
+    std::vector<std::vector<PathInfo>> temp_paths;
+    size_t leg_index = correlated.rend() - origin - 1;
+    if (leg_index >= legs.size() || !legs[leg_index].take(*origin, *destination, temp_paths)) {
+      // Get the algorithm type for this location pair
+      thor::PathAlgorithm* path_algorithm =
+          get_path_algorithm(costing, *origin, *destination, api.options());
+      path_algorithm->Clear();
+
+      // TODO: delete this and send all cases to the function above
+      // If we are continuing through a location we need to make sure we
+      // only allow the edge that was used previously (avoid u-turns)
+      bool through = destination->type() == valhalla::Location::kThrough ||
+                     destination->type() == valhalla::Location::kBreakThrough;
+      while (through && first_edge.Is_Valid() && destination->path_edges_size() > 1) {
+        if (destination->path_edges().rbegin()->graph_id() == first_edge) {
+          destination->mutable_path_edges()->SwapElements(0, destination->path_edges_size() - 1);
+        }
+        destination->mutable_path_edges()->RemoveLast();
       }
-      destination->mutable_path_edges()->RemoveLast();
-    }
 
-    // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+      temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    }
     for (auto& temp_path : temp_paths) {
       // back propagate time information
       if (destination->has_date_time()) {
@@ -409,7 +627,7 @@ void thor_worker_t::path_arrive_by(Api& api, const std::string& costing) {
         vias.swap(flipped);
 
         // Form output information based on path edges
-        if (api.trip().routes_size() == 0 || api.options().alternates() > 0)
+        if (route == nullptr || api.options().alternates() > 0)
           route = api.mutable_trip()->mutable_routes()->Add();
         auto& leg = *route->mutable_legs()->Add();
         TripLegBuilder::Build(controller, *reader, mode_costing, path.begin(), path.end(), *origin,
@@ -431,29 +649,36 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
   std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>> vias;
   std::vector<thor::PathInfo> path;
   std::list<valhalla::TripLeg> trip_paths;
+  auto legs = compute_legs(api, costing, false);
   auto& correlated = *api.mutable_options()->mutable_locations();
 
   // For each pair of locations
   for (auto destination = ++correlated.begin(); destination != correlated.end(); ++destination) {
-    // Get the algorithm type for this location pair
     auto origin = std::prev(destination);
-    thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing, *origin, *destination);
-    path_algorithm->Clear();
 
-    // TODO: delete this and send all cases to the function above
-    // If we are continuing through a location we need to make sure we
-    // only allow the edge that was used previously (avoid u-turns)
-    bool through = origin->type() == valhalla::Location::kThrough ||
-                   origin->type() == valhalla::Location::kBreakThrough;
-    while (through && last_edge.Is_Valid() && origin->path_edges_size() > 1) {
-      if (origin->path_edges().rbegin()->graph_id() == last_edge) {
-        origin->mutable_path_edges()->SwapElements(0, origin->path_edges_size() - 1);
+    // Get best path and keep it. Use the leg if it was computed ahead of time
+    std::vector<std::vector<PathInfo>> temp_paths;
+    size_t leg_index = origin - correlated.begin();
+    if (leg_index >= legs.size() || !legs[leg_index].take(*origin, *destination, temp_paths)) {
+      // Get the algorithm type for this location pair
+      thor::PathAlgorithm* path_algorithm =
+          get_path_algorithm(costing, *origin, *destination, api.options());
+      path_algorithm->Clear();
+
+      // TODO: delete this and send all cases to the function above
+      // If we are continuing through a location we need to make sure we
+      // only allow the edge that was used previously (avoid u-turns)
+      bool through = origin->type() == valhalla::Location::kThrough ||
+                     origin->type() == valhalla::Location::kBreakThrough;
+      while (through && last_edge.Is_Valid() && origin->path_edges_size() > 1) {
+        if (origin->path_edges().rbegin()->graph_id() == last_edge) {
+          origin->mutable_path_edges()->SwapElements(0, origin->path_edges_size() - 1);
+        }
+        origin->mutable_path_edges()->RemoveLast();
       }
-      origin->mutable_path_edges()->RemoveLast();
-    }
 
-    // Get best path and keep it
-    auto temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+      temp_paths = get_path(path_algorithm, *origin, *destination, costing, api.options());
+    }
     for (auto& temp_path : temp_paths) {
       // forward propagate time information
       if (origin->has_date_time()) {
@@ -497,7 +722,7 @@ void thor_worker_t::path_depart_at(Api& api, const std::string& costing) {
         }
 
         // Form output information based on path edges. vias are a route discontinuity map
-        if (api.trip().routes_size() == 0 || api.options().alternates() > 0)
+        if (route == nullptr || api.options().alternates() > 0)
           route = api.mutable_trip()->mutable_routes()->Add();
         auto& leg = *route->mutable_legs()->Add();
         thor::TripLegBuilder::Build(controller, *reader, mode_costing, path.begin(), path.end(),
@@ -0,0 +1,106 @@
+#include "thor/routecache.h"
+
+namespace valhalla {
+namespace thor {
+
+RouteCache::RouteCache(const size_t max_entries)
+    : max_entries_(max_entries), dataset_id_(0), hits_(0), misses_(0) {
+}
+
+std::string RouteCache::Key(const Options& options, const std::time_t now) {
+  // Drop what only changes the serialization of the response
+  Options canonical(options);
+  canonical.clear_id();
+  canonical.clear_jsonp();
+  canonical.clear_format();
+  canonical.clear_units();
+  canonical.clear_language();
+  canonical.clear_directions_type();
+  canonical.clear_shape_format();
+  canonical.clear_do_not_track();
+  canonical.clear_search_stats();
+  std::string key = canonical.SerializeAsString();
+
+  // Results for the current time are kept for the current time bucket
+  bool current = options.has_date_time_type() && options.date_time_type() == Options::current;
+  for (const auto& location : options.locations()) {
+    current = current || (location.has_date_time() && location.date_time() == "current");
+  }
+  if (current) {
+    key += ":" + std::to_string(now / kRouteCacheCurrentTimeBucket);
+  }
+  return key;
+}
+
+bool RouteCache::Get(const std::string& key, const uint64_t dataset_id, Api& request) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CheckDataset(dataset_id);
+  auto found = index_.find(key);
+  if (found == index_.end()) {
+    ++misses_;
+    return false;
+  }
+
+  // Move the entry to the front of the list, it is the most recently used
+  entries_.splice(entries_.begin(), entries_, found->second);
+  const Entry& entry = found->second->second;
+  request.mutable_trip()->CopyFrom(entry.trip);
+  request.mutable_options()->mutable_locations()->CopyFrom(entry.locations);
+  ++hits_;
+  return true;
+}
+
+void RouteCache::Put(const std::string& key, const uint64_t dataset_id, const Api& request) {
+  if (max_entries_ == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CheckDataset(dataset_id);
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    entries_.erase(found->second);
+    index_.erase(found);
+  }
+
+  // Evict the least recently used entries
+  while (entries_.size() >= max_entries_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+
+  entries_.emplace_front(key, Entry{request.trip(), request.options().locations()});
+  index_.emplace(key, entries_.begin());
+}
+
+size_t RouteCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+uint64_t RouteCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+uint64_t RouteCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+void RouteCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+}
+
+void RouteCache::CheckDataset(const uint64_t dataset_id) {
+  if (dataset_id != dataset_id_) {
+    entries_.clear();
+    index_.clear();
+    dataset_id_ = dataset_id;
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -0,0 +1,64 @@
+#include "thor/searchmemory.h"
+#include "worker.h"
+
+#include <string>
+
+namespace {
+
+std::string megabytes(const size_t bytes) {
+  return std::to_string((bytes + (1 << 19)) >> 20) + " MB";
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+std::atomic<size_t> SearchMemory::process_used_(0);
+
+SearchMemory::SearchMemory(const size_t request_limit, const size_t process_limit)
+    : request_limit_(request_limit), process_limit_(process_limit), used_(0), peak_(0) {
+}
+
+void SearchMemory::Release(size_t& held) {
+  if (held > 0) {
+    Set(held, 0);
+  }
+}
+
+void SearchMemory::Release(std::vector<size_t>& held) {
+  for (auto& bytes : held) {
+    Release(bytes);
+  }
+}
+
+void SearchMemory::ResetPeak() {
+  peak_ = used_.load();
+}
+
+void SearchMemory::Set(size_t& held, const size_t bytes) {
+  // Unsigned arithmetic wraps so a decrease is added as its complement
+  const bool grew = bytes > held;
+  const size_t delta = bytes - held;
+  held = bytes;
+  const size_t used = used_ += delta;
+  const size_t process_used = process_used_ += delta;
+  if (!grew) {
+    return;
+  }
+
+  size_t peak = peak_;
+  while (used > peak && !peak_.compare_exchange_weak(peak, used)) {
+  }
+  if (request_limit_ > 0 && used > request_limit_) {
+    throw valhalla_exception_t{447, "(" + megabytes(used) + "). The limit is " +
+                                        megabytes(request_limit_)};
+  }
+  if (process_limit_ > 0 && process_used > process_limit_) {
+    throw valhalla_exception_t{448, "(" + megabytes(process_used) + "). The limit is " +
+                                        megabytes(process_limit_)};
+  }
+}
+
+} // namespace thor
+} // namespace valhalla
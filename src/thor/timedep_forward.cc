@@ -162,7 +162,8 @@ inline bool TimeDepForward::ExpandForwardInner(GraphReader& graphreader,
     return false;
   }
 
-  // Compute the cost to the end of this edge
+  // Compute the cost to the end of this edge. It is not memoized: the time changes along the
+  // route so its many speed time keys would only churn the cost tables of the tiles
   auto edge_cost = costing_->EdgeCost(meta.edge, tile, seconds_of_week);
   Cost newcost = pred.cost() + edge_cost + costing_->TransitionCost(meta.edge, nodeinfo, pred);
 
@@ -283,6 +284,9 @@ TimeDepForward::GetBestPath(valhalla::Location& origin,
   // Update hierarchy limits
   ModifyHierarchyLimits(mindist, density);
 
+  // Report the memory reserved for the search
+  UpdateMemory();
+
   // Find shortest path
   uint32_t nc = 0; // Count of iterations with no convergence
                    // towards destination
@@ -290,11 +294,13 @@ TimeDepForward::GetBestPath(valhalla::Location& origin,
   const GraphTile* tile;
   size_t total_labels = 0;
   while (true) {
-    // Allow this process to be aborted
+    // Allow this process to be aborted, check the memory it holds
     size_t current_labels = edgelabels_.size();
-    if (interrupt &&
-        total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
-      (*interrupt)();
+    if (total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory();
     }
     total_labels = current_labels;
 
@@ -39,6 +39,16 @@ void TimeDepReverse::Clear() {
   edgelabels_rev_.clear();
 }
 
+// Report the memory held by the search.
+void TimeDepReverse::UpdateMemory() {
+  if (memory_) {
+    memory_->Update(memory_held_, edgelabels_.capacity() * sizeof(EdgeLabel) +
+                                      edgelabels_rev_.capacity() * sizeof(BDEdgeLabel) +
+                                      (adjacencylist_ ? adjacencylist_->memory() : 0) +
+                                      edgestatus_.memory());
+  }
+}
+
 // Initialize prior to finding best path
 void TimeDepReverse::Init(const midgard::PointLL& origll, const midgard::PointLL& destll) {
   // Set the origin lat,lon (since this is reverse path) and cost factor
@@ -217,6 +227,7 @@ inline bool TimeDepReverse::ExpandReverseInner(GraphReader& graphreader,
 
   Cost tc =
       costing_->TransitionCostReverse(meta.edge->localedgeidx(), nodeinfo, opp_edge, opp_pred_edge);
+  // Not memoized, the time changes along the route (see TimeDepForward)
   auto edge_cost = costing_->EdgeCost(opp_edge, t2, seconds_of_week);
   Cost newcost = pred.cost() + edge_cost;
   newcost.cost += tc.cost;
@@ -342,6 +353,9 @@ TimeDepReverse::GetBestPath(valhalla::Location& origin,
       DateTime::seconds_since_epoch(destination.date_time(),
                                     DateTime::get_tz_db().from_index(dest_tz_index_));
 
+  // Report the memory reserved for the search
+  UpdateMemory();
+
   // Find shortest path
   uint32_t nc = 0; // Count of iterations with no convergence
                    // towards destination
@@ -349,11 +363,13 @@ TimeDepReverse::GetBestPath(valhalla::Location& origin,
   const GraphTile* tile;
   size_t total_labels = 0;
   while (true) {
-    // Allow this process to be aborted
+    // Allow this process to be aborted, check the memory it holds
     size_t current_labels = edgelabels_rev_.size();
-    if (interrupt &&
-        total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
-      (*interrupt)();
+    if (total_labels / kInterruptIterationsInterval < current_labels / kInterruptIterationsInterval) {
+      if (interrupt) {
+        (*interrupt)();
+      }
+      UpdateMemory();
     }
     total_labels = current_labels;
 
@@ -1,6 +1,10 @@
 #include "thor/timedistancematrix.h"
 #include "midgard/logging.h"
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 using namespace valhalla::baldr;
@@ -22,13 +26,39 @@ static bool IsTrivial(const uint64_t& edgeid,
   }
   return false;
 }
+
+// Returns true if both locations are correlated to the same edges. A one to
+// many (or many to one) search from them has the same results.
+bool SameEdges(const valhalla::Location& a, const valhalla::Location& b) {
+  if (a.path_edges_size() != b.path_edges_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.path_edges_size(); ++i) {
+    const auto& e1 = a.path_edges(i);
+    const auto& e2 = b.path_edges(i);
+    if (e1.graph_id() != e2.graph_id() || e1.percent_along() != e2.percent_along() ||
+        e1.begin_node() != e2.begin_node() || e1.end_node() != e2.end_node() ||
+        e1.distance() != e2.distance()) {
+      return false;
+    }
+  }
+  return true;
+}
 } // namespace
 namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
 TimeDistanceMatrix::TimeDistanceMatrix()
-    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0) {
+    : mode_(TravelMode::kDrive), settled_count_(0), current_cost_threshold_(0),
+      share_searches_(false), interrupt_(nullptr), thread_interrupt_(nullptr), memory_(nullptr),
+      memory_held_(0) {
+}
+
+TimeDistanceMatrix::~TimeDistanceMatrix() {
+  if (memory_) {
+    memory_->Release(memory_held_);
+  }
 }
 
 float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) const {
@@ -51,6 +81,11 @@ float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) cons
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void TimeDistanceMatrix::Clear() {
+  // Release the memory of the search from the budget
+  if (memory_) {
+    memory_->Release(memory_held_);
+  }
+
   // Clear the edge labels and destination list
   edgelabels_.clear();
   destinations_.clear();
@@ -63,6 +98,14 @@ void TimeDistanceMatrix::Clear() {
   edgestatus_.clear();
 }
 
+// Report the memory held by the search.
+void TimeDistanceMatrix::UpdateMemory() {
+  if (memory_) {
+    memory_->Update(memory_held_, edgelabels_.capacity() * sizeof(EdgeLabel) +
+                                      adjacencylist_->memory() + edgestatus_.memory());
+  }
+}
+
 // Expand from a node in the forward direction
 void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
                                        const GraphId& node,
@@ -166,7 +209,16 @@ TimeDistanceMatrix::OneToMany(const valhalla::Location& origin,
 
   // Find shortest path
   const GraphTile* tile;
+  size_t n = 0;
   while (true) {
+    // Allow this process to be aborted, check the memory it holds
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      if (interrupt_) {
+        (*interrupt_)();
+      }
+      UpdateMemory();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -327,7 +379,16 @@ TimeDistanceMatrix::ManyToOne(const valhalla::Location& dest,
 
   // Find shortest path
   const GraphTile* tile;
+  size_t n = 0;
   while (true) {
+    // Allow this process to be aborted, check the memory it holds
+    if ((++n % kInterruptIterationsInterval) == 0) {
+      if (interrupt_) {
+        (*interrupt_)();
+      }
+      UpdateMemory();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -387,21 +448,121 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
     const std::shared_ptr<sif::DynamicCost>* mode_costing,
     const sif::TravelMode mode,
     const float max_matrix_distance) {
-  // Run a series of one to many calls and concatenate the results.
-  std::vector<TimeDistance> many_to_many;
-  if (source_location_list.size() <= target_location_list.size()) {
-    for (const auto& origin : source_location_list) {
-      std::vector<TimeDistance> td = OneToMany(origin, target_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
-      Clear();
-    }
-  } else {
-    for (const auto& destination : target_location_list) {
-      std::vector<TimeDistance> td = ManyToOne(destination, source_location_list, graphreader,
-                                               mode_costing, mode, max_matrix_distance);
-      many_to_many.insert(many_to_many.end(), td.begin(), td.end());
-      Clear();
+  // Run a series of one to many (or many to one) calls, each writes its row
+  // (or column) of the matrix.
+  const bool one_to_many = source_location_list.size() <= target_location_list.size();
+  const auto& origins = one_to_many ? source_location_list : target_location_list;
+  const auto& locations = one_to_many ? target_location_list : source_location_list;
+  const uint32_t target_count = target_location_list.size();
+  std::vector<TimeDistance> many_to_many(source_location_list.size() * target_count);
+  stats_ = {};
+  auto write = [&](const uint32_t origin, const uint32_t location, const TimeDistance& td) {
+    uint32_t idx =
+        one_to_many ? origin * target_count + location : location * target_count + origin;
+    many_to_many[idx] = td;
+  };
+
+  // Origins correlated to the same edges as an earlier origin share its search
+  std::vector<uint32_t> searches;
+  std::vector<std::pair<uint32_t, uint32_t>> shared;
+  for (int i = 0; i < origins.size(); ++i) {
+    auto same = share_searches_
+                    ? std::find_if(searches.begin(), searches.end(),
+                                   [&](const uint32_t j) {
+                                     return SameEdges(origins.Get(i), origins.Get(j));
+                                   })
+                    : searches.end();
+    if (same == searches.end()) {
+      searches.push_back(i);
+    } else {
+      shared.emplace_back(i, *same);
+    }
+  }
+
+  // Report a row when it is done. Rows of one to many searches are done as soon
+  // as their search is, otherwise all rows are done at the end.
+  std::mutex row_mutex;
+  auto row_done = [&](const uint32_t source) {
+    if (row_callback_) {
+      std::lock_guard<std::mutex> lock(row_mutex);
+      row_callback_(many_to_many, source);
+    }
+  };
+
+  // Searches are interleaved over this instance and one instance per additional
+  // graph reader, each on its own thread. The instances of the additional threads
+  // only check the thread safe interrupt. After an error (e.g. the interrupt threw
+  // on this thread) the threads stop starting searches
+  const uint32_t thread_count =
+      std::min(static_cast<uint32_t>(thread_readers_.size() + 1),
+               std::max(static_cast<uint32_t>(searches.size()), static_cast<uint32_t>(1)));
+  std::vector<std::exception_ptr> errors(thread_count);
+  std::vector<SearchStats> thread_stats(thread_count);
+  std::atomic<bool> failed(false);
+  auto work = [&](const uint32_t thread) {
+    std::unique_ptr<TimeDistanceMatrix> instance;
+    if (thread > 0) {
+      instance.reset(new TimeDistanceMatrix());
+      instance->set_interrupt(thread_interrupt_);
+      instance->set_memory(memory_);
+    }
+    TimeDistanceMatrix& matrix = thread == 0 ? *this : *instance;
+    GraphReader& reader = thread == 0 ? graphreader : *thread_readers_[thread - 1];
+    try {
+      for (uint32_t i = thread; i < searches.size() && !failed; i += thread_count) {
+        const auto& origin = origins.Get(searches[i]);
+        std::vector<TimeDistance> td =
+            one_to_many
+                ? matrix.OneToMany(origin, locations, reader, mode_costing, mode, max_matrix_distance)
+                : matrix.ManyToOne(origin, locations, reader, mode_costing, mode,
+                                   max_matrix_distance);
+        for (uint32_t j = 0; j < td.size(); ++j) {
+          write(searches[i], j, td[j]);
+        }
+        if (matrix.adjacencylist_) {
+          thread_stats[thread].Add(*matrix.adjacencylist_);
+        }
+        matrix.Clear();
+        if (one_to_many) {
+          row_done(searches[i]);
+        }
+      }
+    } catch (...) {
+      errors[thread] = std::current_exception();
+      failed = true;
+    }
+  };
+  std::vector<std::shared_ptr<std::thread>> threads(thread_count - 1);
+  for (uint32_t i = 1; i < thread_count; ++i) {
+    threads[i - 1].reset(new std::thread(work, i));
+  }
+  work(0);
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (const auto& stats : thread_stats) {
+    stats_.Add(stats);
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Copy the results of shared searches
+  for (const auto& origin : shared) {
+    for (int j = 0; j < locations.size(); ++j) {
+      uint32_t idx =
+          one_to_many ? origin.second * target_count + j : j * target_count + origin.second;
+      write(origin.first, j, many_to_many[idx]);
+    }
+    if (one_to_many) {
+      row_done(origin.first);
+    }
+  }
+  if (!one_to_many) {
+    for (int i = 0; i < source_location_list.size(); ++i) {
+      row_done(i);
     }
   }
   return many_to_many;
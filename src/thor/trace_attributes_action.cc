@@ -106,6 +106,7 @@ std::string thor_worker_t::trace_attributes(Api& request) {
       break;
   }
 
+  set_search_stats(request);
   return tyr::serializeTraceAttributes(request, controller, map_match_results);
 }
 
@@ -116,6 +116,7 @@ void thor_worker_t::trace_route(Api& request) {
       }
     }
   }
+  set_search_stats(request);
 }
 
 /*
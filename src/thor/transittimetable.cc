@@ -0,0 +1,205 @@
+#include "thor/transittimetable.h"
+#include "baldr/datetime.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+#include <algorithm>
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+// Build the timetable of the transit tiles of a region for the date at the origin.
+TransitTimetable::TransitTimetable(GraphReader& graphreader,
+                                   const std::vector<GraphId>& tiles,
+                                   const std::string& date_time,
+                                   const int origin_tz) {
+  const uint32_t date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(date_time));
+  const uint32_t dow = DateTime::day_of_week_mask(date_time);
+  const auto* origin_zone = DateTime::get_tz_db().from_index(origin_tz);
+  const uint64_t epoch = DateTime::seconds_since_epoch(date_time, origin_zone);
+
+  // Seconds to add to the local times of a time zone to get origin times
+  std::unordered_map<uint32_t, int> tz_offsets;
+  auto tz_offset = [&](const uint32_t tz) {
+    if (static_cast<int>(tz) == origin_tz) {
+      return 0;
+    }
+    auto offset = tz_offsets.find(tz);
+    if (offset == tz_offsets.end()) {
+      int diff =
+          DateTime::timezone_diff(epoch, origin_zone, DateTime::get_tz_db().from_index(tz));
+      offset = tz_offsets.emplace(tz, -diff).first;
+    }
+    return offset->second;
+  };
+
+  for (const auto& tile_id : tiles) {
+    const GraphTile* tile = graphreader.GetGraphTile(tile_id);
+    if (tile == nullptr || tile->header()->departurecount() == 0) {
+      continue;
+    }
+
+    // Schedules are valid for days since the tile was created
+    const uint32_t date_created = tile->header()->date_created();
+    const bool date_before_tile = date < date_created;
+    const uint32_t day = date_before_tile ? 0 : date - date_created;
+
+    // The line edges leaving the platforms of the tile, by line Id
+    struct LineEdge {
+      uint32_t line;
+      uint32_t departure_stop;
+      uint32_t arrival_stop;
+      int offset;
+    };
+    std::unordered_map<uint32_t, LineEdge> line_edges;
+    GraphId node_id(tile_id.tileid(), tile_id.level(), 0);
+    for (const auto& node : tile->GetNodes()) {
+      if (node.type() == NodeType::kMultiUseTransitPlatform) {
+        GraphId edgeid(tile_id.tileid(), tile_id.level(), node.edge_index());
+        for (const auto& edge : tile->GetDirectedEdges(node_id)) {
+          if (edge.IsTransitLine()) {
+            line_edges[edge.lineid()] = {AddLine(edgeid), AddStop(node_id), AddStop(edge.endnode()),
+                                         tz_offset(node.timezone())};
+          }
+          ++edgeid;
+        }
+      }
+      ++node_id;
+    }
+
+    // Connections of the departures running on the day
+    for (const auto& departure : tile->GetDepartures()) {
+      auto line = line_edges.find(departure.lineid());
+      if (line == line_edges.end() ||
+          !tile->GetTransitSchedule(departure.schedule_index())
+               ->IsValid(day, dow, date_before_tile)) {
+        continue;
+      }
+      const LineEdge& line_edge = line->second;
+      TransitConnection connection{0,
+                                   0,
+                                   line_edge.departure_stop,
+                                   line_edge.arrival_stop,
+                                   line_edge.line,
+                                   departure.tripid(),
+                                   0,
+                                   departure.wheelchair_accessible(),
+                                   departure.bicycle_accessible()};
+      auto add = [&](const uint32_t departure_time) {
+        int time = static_cast<int>(departure_time) + line_edge.offset;
+        if (time >= 0) {
+          connection.departure_time = time;
+          connection.arrival_time = time + departure.elapsed_time();
+          Add(connection);
+        }
+      };
+      if (departure.type() == kFixedSchedule) {
+        add(departure.departure_time());
+      } else {
+        // One connection per run of a frequency based departure
+        uint32_t departure_time = departure.departure_time();
+        do {
+          add(departure_time);
+          departure_time += departure.frequency();
+          connection.run++;
+        } while (departure.frequency() > 0 && departure_time < departure.end_time());
+      }
+    }
+  }
+  Sort();
+  LOG_DEBUG("Transit timetable: " + std::to_string(connections_.size()) + " connections, " +
+            std::to_string(stops_.size()) + " stops, " + std::to_string(lines_.size()) + " lines");
+}
+
+uint32_t TransitTimetable::AddStop(const GraphId& node) {
+  auto stop = stop_index_.emplace(node, stops_.size());
+  if (stop.second) {
+    stops_.push_back(node);
+  }
+  return stop.first->second;
+}
+
+uint32_t TransitTimetable::AddLine(const GraphId& edgeid) {
+  auto line = line_index_.emplace(edgeid, lines_.size());
+  if (line.second) {
+    lines_.push_back(edgeid);
+  }
+  return line.first->second;
+}
+
+void TransitTimetable::Add(const TransitConnection& connection) {
+  connections_.push_back(connection);
+}
+
+void TransitTimetable::Sort() {
+  std::stable_sort(connections_.begin(), connections_.end(),
+                   [](const TransitConnection& a, const TransitConnection& b) {
+                     return a.departure_time < b.departure_time ||
+                            (a.departure_time == b.departure_time &&
+                             a.arrival_time < b.arrival_time);
+                   });
+}
+
+// Take one more trip from the stops reached by the previous round.
+bool TransitTimetable::ScanRound(const std::vector<StopArrival>& from,
+                                 const uint32_t start_time,
+                                 const float transfer,
+                                 const std::vector<bool>& allowed,
+                                 const bool wheelchair,
+                                 const bool bicycle,
+                                 std::vector<TripArrival>& to) const {
+  // Connection where each trip taken was boarded
+  std::unordered_map<uint64_t, uint32_t> boarded;
+  bool reached = false;
+  auto first = std::lower_bound(connections_.begin(), connections_.end(), start_time,
+                                [](const TransitConnection& c, const uint32_t time) {
+                                  return c.departure_time < time;
+                                });
+  for (auto c = first; c != connections_.end(); ++c) {
+    if (!allowed[c->line] || (wheelchair && !c->wheelchair_accessible) ||
+        (bicycle && !c->bicycle_accessible)) {
+      continue;
+    }
+
+    // Stay on a trip once boarded, board if the stop is reached in time
+    const uint32_t idx = static_cast<uint32_t>(c - connections_.begin());
+    auto trip = boarded.find(c->trip_key());
+    if (trip == boarded.end()) {
+      if (from[c->departure_stop].time > c->departure_time) {
+        continue;
+      }
+      trip = boarded.emplace(c->trip_key(), idx).first;
+    }
+
+    // Keep the earliest arrival at the stop. The cost includes the wait.
+    TripArrival& arrival = to[c->arrival_stop];
+    if (c->arrival_time < arrival.time) {
+      const StopArrival& stop = from[connections_[trip->second].departure_stop];
+      arrival.time = c->arrival_time;
+      arrival.cost = stop.cost + transfer + (c->arrival_time - stop.time);
+      arrival.connection = idx;
+      arrival.boarding = trip->second;
+      reached = true;
+    }
+  }
+  return reached;
+}
+
+// Get the connections of the trip taken to a stop, from boarding to arrival.
+std::vector<uint32_t> TransitTimetable::TripConnections(const TripArrival& arrival) const {
+  std::vector<uint32_t> trip;
+  const uint64_t key = connections_[arrival.connection].trip_key();
+  uint32_t stop = connections_[arrival.boarding].departure_stop;
+  for (uint32_t i = arrival.boarding; i <= arrival.connection; ++i) {
+    const TransitConnection& c = connections_[i];
+    if (c.trip_key() == key && c.departure_stop == stop) {
+      trip.push_back(i);
+      stop = c.arrival_stop;
+    }
+  }
+  return trip;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -30,6 +30,9 @@ using namespace valhalla::thor;
 
 namespace {
 
+// Number of edges added to the trip leg between checks of the interrupt
+constexpr size_t kInterruptEdgeInterval = 1000;
+
 void TrimShape(std::vector<PointLL>& shape,
                const float start,
                const PointLL& start_vertex,
@@ -106,22 +109,22 @@ void AssignAdmins(const AttributesController& controller,
       TripLeg_Admin* trip_admin = trip_path.add_admin();
 
       // Set country code if requested
-      if (controller.attributes.at(kAdminCountryCode)) {
+      if (controller.attributes[kAdminCountryCode]) {
         trip_admin->set_country_code(admin_info.country_iso());
       }
 
       // Set country text if requested
-      if (controller.attributes.at(kAdminCountryText)) {
+      if (controller.attributes[kAdminCountryText]) {
         trip_admin->set_country_text(admin_info.country_text());
       }
 
       // Set state code if requested
-      if (controller.attributes.at(kAdminStateCode)) {
+      if (controller.attributes[kAdminStateCode]) {
         trip_admin->set_state_code(admin_info.state_iso());
       }
 
       // Set state text if requested
-      if (controller.attributes.at(kAdminStateText)) {
+      if (controller.attributes[kAdminStateText]) {
         trip_admin->set_state_text(admin_info.state_text());
       }
     }
@@ -150,19 +153,19 @@ void SetShapeAttributes(const AttributesController& controller,
       double time = edge_time * distance_pct;                      // seconds
 
       // Set shape attributes time per shape point if requested
-      if (controller.attributes.at(kShapeAttributesTime)) {
+      if (controller.attributes[kShapeAttributesTime]) {
         // convert time to milliseconds and then round to an integer
         trip_path.mutable_shape_attributes()->add_time((time * kMillisecondPerSec) + 0.5);
       }
 
       // Set shape attributes length per shape point if requested
-      if (controller.attributes.at(kShapeAttributesLength)) {
+      if (controller.attributes[kShapeAttributesLength]) {
         // convert length to decimeters and then round to an integer
         trip_path.mutable_shape_attributes()->add_length((distance * kDecimeterPerMeter) + 0.5);
       }
 
       // Set shape attributes speed per shape point if requested
-      if (controller.attributes.at(kShapeAttributesSpeed)) {
+      if (controller.attributes[kShapeAttributesSpeed]) {
         // convert speed to decimeters per sec and then round to an integer
         trip_path.mutable_shape_attributes()->add_speed((distance * kDecimeterPerMeter / time) + 0.5);
       }
@@ -432,13 +435,13 @@ void SetHeadings(TripLeg_Edge* trip_edge,
                  const DirectedEdge* edge,
                  const std::vector<PointLL>& shape,
                  const uint32_t begin_index) {
-  if (controller.attributes.at(kEdgeBeginHeading) || controller.attributes.at(kEdgeEndHeading)) {
+  if (controller.attributes[kEdgeBeginHeading] || controller.attributes[kEdgeEndHeading]) {
     float offset = GetOffsetForHeading(edge->classification(), edge->use());
-    if (controller.attributes.at(kEdgeBeginHeading)) {
+    if (controller.attributes[kEdgeBeginHeading]) {
       trip_edge->set_begin_heading(
           std::round(PointLL::HeadingAlongPolyline(shape, offset, begin_index, shape.size() - 1)));
     }
-    if (controller.attributes.at(kEdgeEndHeading)) {
+    if (controller.attributes[kEdgeEndHeading]) {
       trip_edge->set_end_heading(
           std::round(PointLL::HeadingAtEndOfPolyline(shape, offset, begin_index, shape.size() - 1)));
     }
@@ -468,20 +471,20 @@ void AddTransitNodes(TripLeg_Node* trip_node,
 
     if (transit_station) {
       // Set onstop_id if requested
-      if (controller.attributes.at(kNodeTransitStationInfoOnestopId) &&
+      if (controller.attributes[kNodeTransitStationInfoOnestopId] &&
           transit_station->one_stop_offset()) {
         transit_station_info->set_onestop_id(graphtile->GetName(transit_station->one_stop_offset()));
       }
 
       // Set name if requested
-      if (controller.attributes.at(kNodeTransitStationInfoName) && transit_station->name_offset()) {
+      if (controller.attributes[kNodeTransitStationInfoName] && transit_station->name_offset()) {
         transit_station_info->set_name(graphtile->GetName(transit_station->name_offset()));
       }
 
       // Set latitude and longitude
       LatLng* stop_ll = transit_station_info->mutable_ll();
       // Set transit stop lat/lon if requested
-      if (controller.attributes.at(kNodeTransitStationInfoLatLon)) {
+      if (controller.attributes[kNodeTransitStationInfoLatLon]) {
         PointLL ll = node->latlng(start_tile->header()->base_ll());
         stop_ll->set_lat(ll.lat());
         stop_ll->set_lng(ll.lng());
@@ -496,20 +499,20 @@ void AddTransitNodes(TripLeg_Node* trip_node,
 
     if (transit_egress) {
       // Set onstop_id if requested
-      if (controller.attributes.at(kNodeTransitEgressInfoOnestopId) &&
+      if (controller.attributes[kNodeTransitEgressInfoOnestopId] &&
           transit_egress->one_stop_offset()) {
         transit_egress_info->set_onestop_id(graphtile->GetName(transit_egress->one_stop_offset()));
       }
 
       // Set name if requested
-      if (controller.attributes.at(kNodeTransitEgressInfoName) && transit_egress->name_offset()) {
+      if (controller.attributes[kNodeTransitEgressInfoName] && transit_egress->name_offset()) {
         transit_egress_info->set_name(graphtile->GetName(transit_egress->name_offset()));
       }
 
       // Set latitude and longitude
       LatLng* stop_ll = transit_egress_info->mutable_ll();
       // Set transit stop lat/lon if requested
-      if (controller.attributes.at(kNodeTransitEgressInfoLatLon)) {
+      if (controller.attributes[kNodeTransitEgressInfoLatLon]) {
         PointLL ll = node->latlng(start_tile->header()->base_ll());
         stop_ll->set_lat(ll.lat());
         stop_ll->set_lng(ll.lng());
@@ -565,7 +568,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
 
   // Add names to edge if requested
-  if (controller.attributes.at(kEdgeNames)) {
+  if (controller.attributes[kEdgeNames]) {
     auto names_and_types = edgeinfo.GetNamesAndTypes();
     for (const auto& name_and_type : names_and_types) {
       auto* trip_edge_name = trip_edge->mutable_name()->Add();
@@ -579,7 +582,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 #endif
 
   // Set the exits (if the directed edge has exit sign information) and if requested
-  if (directededge->sign()) {
+  if (directededge->sign() && controller.category_attribute_enabled(kEdgeSignCategory)) {
     // Add the edge signs
     std::vector<SignInfo> edge_signs = graphtile->GetSigns(idx);
     if (!edge_signs.empty()) {
@@ -587,7 +590,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
       for (const auto& sign : edge_signs) {
         switch (sign.type()) {
           case Sign::Type::kExitNumber: {
-            if (controller.attributes.at(kEdgeSignExitNumber)) {
+            if (controller.attributes[kEdgeSignExitNumber]) {
               auto* trip_sign_exit_number = trip_sign->mutable_exit_numbers()->Add();
               trip_sign_exit_number->set_text(sign.text());
               trip_sign_exit_number->set_is_route_number(sign.is_route_num());
@@ -595,7 +598,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
             break;
           }
           case Sign::Type::kExitBranch: {
-            if (controller.attributes.at(kEdgeSignExitBranch)) {
+            if (controller.attributes[kEdgeSignExitBranch]) {
               auto* trip_sign_exit_onto_street = trip_sign->mutable_exit_onto_streets()->Add();
               trip_sign_exit_onto_street->set_text(sign.text());
               trip_sign_exit_onto_street->set_is_route_number(sign.is_route_num());
@@ -603,7 +606,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
             break;
           }
           case Sign::Type::kExitToward: {
-            if (controller.attributes.at(kEdgeSignExitToward)) {
+            if (controller.attributes[kEdgeSignExitToward]) {
               auto* trip_sign_exit_toward_location =
                   trip_sign->mutable_exit_toward_locations()->Add();
               trip_sign_exit_toward_location->set_text(sign.text());
@@ -612,7 +615,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
             break;
           }
           case Sign::Type::kExitName: {
-            if (controller.attributes.at(kEdgeSignExitName)) {
+            if (controller.attributes[kEdgeSignExitName]) {
               auto* trip_sign_exit_name = trip_sign->mutable_exit_names()->Add();
               trip_sign_exit_name->set_text(sign.text());
               trip_sign_exit_name->set_is_route_number(sign.is_route_num());
@@ -620,7 +623,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
             break;
           }
           case Sign::Type::kGuideBranch: {
-            if (controller.attributes.at(kEdgeSignGuideBranch)) {
+            if (controller.attributes[kEdgeSignGuideBranch]) {
               auto* trip_sign_guide_onto_street = trip_sign->mutable_guide_onto_streets()->Add();
               trip_sign_guide_onto_street->set_text(sign.text());
               trip_sign_guide_onto_street->set_is_route_number(sign.is_route_num());
@@ -628,7 +631,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
             break;
           }
           case Sign::Type::kGuideToward: {
-            if (controller.attributes.at(kEdgeSignGuideToward)) {
+            if (controller.attributes[kEdgeSignGuideToward]) {
               auto* trip_sign_guide_toward_location =
                   trip_sign->mutable_guide_toward_locations()->Add();
               trip_sign_guide_toward_location->set_text(sign.text());
@@ -642,7 +645,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Process the named junctions
-  if (has_junction_name && start_tile) {
+  if (has_junction_name && start_tile && controller.attributes[kEdgeSignJunctionName]) {
     // Add the node signs
     std::vector<SignInfo> node_signs = start_tile->GetSigns(start_node_idx, true);
     if (!node_signs.empty()) {
@@ -650,7 +653,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
       for (const auto& sign : node_signs) {
         switch (sign.type()) {
           case Sign::Type::kJunctionName: {
-            if (controller.attributes.at(kEdgeSignJunctionName)) {
+            if (controller.attributes[kEdgeSignJunctionName]) {
               auto* trip_sign_junction_name = trip_sign->mutable_junction_names()->Add();
               trip_sign_junction_name->set_text(sign.text());
               trip_sign_junction_name->set_is_route_number(sign.is_route_num());
@@ -672,18 +675,18 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Set road class if requested
-  if (controller.attributes.at(kEdgeRoadClass)) {
+  if (controller.attributes[kEdgeRoadClass]) {
     trip_edge->set_road_class(GetTripLegRoadClass(directededge->classification()));
   }
 
   // Set length if requested. Convert to km
-  if (controller.attributes.at(kEdgeLength)) {
+  if (controller.attributes[kEdgeLength]) {
     float km = std::max((directededge->length() * kKmPerMeter * length_percentage), 0.001f);
     trip_edge->set_length(km);
   }
 
   // Set speed if requested
-  if (controller.attributes.at(kEdgeSpeed)) {
+  if (controller.attributes[kEdgeSpeed]) {
     // TODO: could get better precision speed here by calling GraphTile::GetSpeed but we'd need to
     // know whether or not the costing actually cares about the speed of the edge. Perhaps a refactor
     // of costing to have a GetSpeed function which EdgeCost calls internally but which we can also
@@ -705,7 +708,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   // Test whether edge is traversed forward or reverse
   if (directededge->forward()) {
     // Set traversability for forward directededge if requested
-    if (controller.attributes.at(kEdgeTraversability)) {
+    if (controller.attributes[kEdgeTraversability]) {
       if ((directededge->forwardaccess() & kAccess) && (directededge->reverseaccess() & kAccess)) {
         trip_edge->set_traversability(TripLeg_Traversability::TripLeg_Traversability_kBoth);
       } else if ((directededge->forwardaccess() & kAccess) &&
@@ -720,7 +723,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   } else {
     // Set traversability for reverse directededge if requested
-    if (controller.attributes.at(kEdgeTraversability)) {
+    if (controller.attributes[kEdgeTraversability]) {
       if ((directededge->forwardaccess() & kAccess) && (directededge->reverseaccess() & kAccess)) {
         trip_edge->set_traversability(TripLeg_Traversability::TripLeg_Traversability_kBoth);
       } else if (!(directededge->forwardaccess() & kAccess) &&
@@ -740,47 +743,47 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Set the trip path use based on directed edge use if requested
-  if (controller.attributes.at(kEdgeUse)) {
+  if (controller.attributes[kEdgeUse]) {
     trip_edge->set_use(GetTripLegUse(directededge->use()));
   }
 
   // Set toll flag if requested
-  if (directededge->toll() && controller.attributes.at(kEdgeToll)) {
+  if (directededge->toll() && controller.attributes[kEdgeToll]) {
     trip_edge->set_toll(true);
   }
 
   // Set unpaved flag if requested
-  if (directededge->unpaved() && controller.attributes.at(kEdgeUnpaved)) {
+  if (directededge->unpaved() && controller.attributes[kEdgeUnpaved]) {
     trip_edge->set_unpaved(true);
   }
 
   // Set tunnel flag if requested
-  if (directededge->tunnel() && controller.attributes.at(kEdgeTunnel)) {
+  if (directededge->tunnel() && controller.attributes[kEdgeTunnel]) {
     trip_edge->set_tunnel(true);
   }
 
   // Set bridge flag if requested
-  if (directededge->bridge() && controller.attributes.at(kEdgeBridge)) {
+  if (directededge->bridge() && controller.attributes[kEdgeBridge]) {
     trip_edge->set_bridge(true);
   }
 
   // Set roundabout flag if requested
-  if (directededge->roundabout() && controller.attributes.at(kEdgeRoundabout)) {
+  if (directededge->roundabout() && controller.attributes[kEdgeRoundabout]) {
     trip_edge->set_roundabout(true);
   }
 
   // Set internal intersection flag if requested
-  if (directededge->internal() && controller.attributes.at(kEdgeInternalIntersection)) {
+  if (directededge->internal() && controller.attributes[kEdgeInternalIntersection]) {
     trip_edge->set_internal_intersection(true);
   }
 
   // Set drive_on_right if requested
-  if (controller.attributes.at(kEdgeDriveOnRight)) {
+  if (controller.attributes[kEdgeDriveOnRight]) {
     trip_edge->set_drive_on_right(drive_on_right);
   }
 
   // Set surface if requested
-  if (controller.attributes.at(kEdgeSurface)) {
+  if (controller.attributes[kEdgeSurface]) {
     trip_edge->set_surface(GetTripLegSurface(directededge->surface()));
   }
 
@@ -788,64 +791,64 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   if (mode == sif::TravelMode::kBicycle) {
     // Override bicycle mode with pedestrian if dismount flag or steps
     if (directededge->dismount() || directededge->use() == Use::kSteps) {
-      if (controller.attributes.at(kEdgeTravelMode)) {
+      if (controller.attributes[kEdgeTravelMode]) {
         trip_edge->set_travel_mode(TripLeg_TravelMode::TripLeg_TravelMode_kPedestrian);
       }
-      if (controller.attributes.at(kEdgePedestrianType)) {
+      if (controller.attributes[kEdgePedestrianType]) {
         trip_edge->set_pedestrian_type(TripLeg_PedestrianType::TripLeg_PedestrianType_kFoot);
       }
     } else {
-      if (controller.attributes.at(kEdgeTravelMode)) {
+      if (controller.attributes[kEdgeTravelMode]) {
         trip_edge->set_travel_mode(TripLeg_TravelMode::TripLeg_TravelMode_kBicycle);
       }
-      if (controller.attributes.at(kEdgeBicycleType)) {
+      if (controller.attributes[kEdgeBicycleType]) {
         trip_edge->set_bicycle_type(GetTripLegBicycleType(travel_type));
       }
     }
   } else if (mode == sif::TravelMode::kDrive) {
-    if (controller.attributes.at(kEdgeTravelMode)) {
+    if (controller.attributes[kEdgeTravelMode]) {
       trip_edge->set_travel_mode(TripLeg_TravelMode::TripLeg_TravelMode_kDrive);
     }
-    if (controller.attributes.at(kEdgeVehicleType)) {
+    if (controller.attributes[kEdgeVehicleType]) {
       trip_edge->set_vehicle_type(GetTripLegVehicleType(travel_type));
     }
   } else if (mode == sif::TravelMode::kPedestrian) {
-    if (controller.attributes.at(kEdgeTravelMode)) {
+    if (controller.attributes[kEdgeTravelMode]) {
       trip_edge->set_travel_mode(TripLeg_TravelMode::TripLeg_TravelMode_kPedestrian);
     }
-    if (controller.attributes.at(kEdgePedestrianType)) {
+    if (controller.attributes[kEdgePedestrianType]) {
       trip_edge->set_pedestrian_type(GetTripLegPedestrianType(travel_type));
     }
   } else if (mode == sif::TravelMode::kPublicTransit) {
-    if (controller.attributes.at(kEdgeTravelMode)) {
+    if (controller.attributes[kEdgeTravelMode]) {
       trip_edge->set_travel_mode(TripLeg_TravelMode::TripLeg_TravelMode_kTransit);
     }
   }
 
   // Set edge id (graphid value) if requested
-  if (controller.attributes.at(kEdgeId)) {
+  if (controller.attributes[kEdgeId]) {
     trip_edge->set_id(edge.value);
   }
 
   // Set way id (base data id) if requested
-  if (controller.attributes.at(kEdgeWayId)) {
+  if (controller.attributes[kEdgeWayId]) {
     trip_edge->set_way_id(edgeinfo.wayid());
   }
 
   // Set weighted grade if requested
-  if (controller.attributes.at(kEdgeWeightedGrade)) {
+  if (controller.attributes[kEdgeWeightedGrade]) {
     trip_edge->set_weighted_grade((directededge->weighted_grade() - 6.f) / 0.6f);
   }
 
   // Set maximum upward and downward grade if requested (set to kNoElevationData if unavailable)
-  if (controller.attributes.at(kEdgeMaxUpwardGrade)) {
+  if (controller.attributes[kEdgeMaxUpwardGrade]) {
     if (graphtile->header()->has_elevation()) {
       trip_edge->set_max_upward_grade(directededge->max_up_slope());
     } else {
       trip_edge->set_max_upward_grade(kNoElevationData);
     }
   }
-  if (controller.attributes.at(kEdgeMaxDownwardGrade)) {
+  if (controller.attributes[kEdgeMaxDownwardGrade]) {
     if (graphtile->header()->has_elevation()) {
       trip_edge->set_max_downward_grade(directededge->max_down_slope());
     } else {
@@ -854,7 +857,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
   }
 
   // Set mean elevation if requested (set to kNoElevationData if unavailable)
-  if (controller.attributes.at(kEdgeMeanElevation)) {
+  if (controller.attributes[kEdgeMeanElevation]) {
     if (graphtile->header()->has_elevation()) {
       trip_edge->set_mean_elevation(edgeinfo.mean_elevation());
     } else {
@@ -862,11 +865,11 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
-  if (controller.attributes.at(kEdgeLaneCount)) {
+  if (controller.attributes[kEdgeLaneCount]) {
     trip_edge->set_lane_count(directededge->lanecount());
   }
 
-  if (directededge->laneconnectivity() && controller.attributes.at(kEdgeLaneConnectivity)) {
+  if (directededge->laneconnectivity() && controller.attributes[kEdgeLaneConnectivity]) {
     for (const auto& l : graphtile->GetLaneConnectivity(idx)) {
       TripLeg_LaneConnectivity* path_lane = trip_edge->add_lane_connectivity();
       path_lane->set_from_way_id(l.from());
@@ -875,15 +878,15 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
-  if (directededge->cyclelane() != CycleLane::kNone && controller.attributes.at(kEdgeCycleLane)) {
+  if (directededge->cyclelane() != CycleLane::kNone && controller.attributes[kEdgeCycleLane]) {
     trip_edge->set_cycle_lane(GetTripLegCycleLane(directededge->cyclelane()));
   }
 
-  if (controller.attributes.at(kEdgeBicycleNetwork)) {
+  if (controller.attributes[kEdgeBicycleNetwork]) {
     trip_edge->set_bicycle_network(directededge->bike_network());
   }
 
-  if (controller.attributes.at(kEdgeSidewalk)) {
+  if (controller.attributes[kEdgeSidewalk]) {
     if (directededge->sidewalk_left() && directededge->sidewalk_right()) {
       trip_edge->set_sidewalk(TripLeg_Sidewalk::TripLeg_Sidewalk_kBothSides);
     } else if (directededge->sidewalk_left()) {
@@ -893,35 +896,37 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     }
   }
 
-  if (controller.attributes.at(kEdgeDensity)) {
+  if (controller.attributes[kEdgeDensity]) {
     trip_edge->set_density(directededge->density());
   }
 
-  if (controller.attributes.at(kEdgeSpeedLimit)) {
+  if (controller.attributes[kEdgeSpeedLimit]) {
     trip_edge->set_speed_limit(edgeinfo.speed_limit());
   }
 
-  if (controller.attributes.at(kEdgeTruckSpeed)) {
+  if (controller.attributes[kEdgeTruckSpeed]) {
     trip_edge->set_truck_speed(directededge->truck_speed());
   }
 
-  if (directededge->truck_route() && controller.attributes.at(kEdgeTruckRoute)) {
+  if (directededge->truck_route() && controller.attributes[kEdgeTruckRoute]) {
     trip_edge->set_truck_route(true);
   }
 
   /////////////////////////////////////////////////////////////////////////////
-  // Process transit information
-  if (trip_id && (directededge->use() == Use::kRail || directededge->use() == Use::kBus)) {
+  // Process transit information if any of it is requested
+  if (trip_id && (directededge->use() == Use::kRail || directededge->use() == Use::kBus) &&
+      (controller.category_attribute_enabled(kEdgeTransitRouteInfoCategory) ||
+       controller.attributes[kEdgeTransitType])) {
 
     TripLeg_TransitRouteInfo* transit_route_info = trip_edge->mutable_transit_route_info();
 
     // Set block_id if requested
-    if (controller.attributes.at(kEdgeTransitRouteInfoBlockId)) {
+    if (controller.attributes[kEdgeTransitRouteInfoBlockId]) {
       transit_route_info->set_block_id(block_id);
     }
 
     // Set trip_id if requested
-    if (controller.attributes.at(kEdgeTransitRouteInfoTripId)) {
+    if (controller.attributes[kEdgeTransitRouteInfoTripId]) {
       transit_route_info->set_trip_id(trip_id);
     }
 
@@ -932,7 +937,7 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
     if (transit_departure) {
 
       // Set headsign if requested
-      if (controller.attributes.at(kEdgeTransitRouteInfoHeadsign) &&
+      if (controller.attributes[kEdgeTransitRouteInfoHeadsign] &&
           transit_departure->headsign_offset()) {
         transit_route_info->set_headsign(graphtile->GetName(transit_departure->headsign_offset()));
       }
@@ -941,60 +946,60 @@ TripLeg_Edge* AddTripEdge(const AttributesController& controller,
 
       if (transit_route) {
         // Set transit type if requested
-        if (controller.attributes.at(kEdgeTransitType)) {
+        if (controller.attributes[kEdgeTransitType]) {
           trip_edge->set_transit_type(GetTripLegTransitType(transit_route->route_type()));
         }
 
         // Set onestop_id if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOnestopId) &&
+        if (controller.attributes[kEdgeTransitRouteInfoOnestopId] &&
             transit_route->one_stop_offset()) {
           transit_route_info->set_onestop_id(graphtile->GetName(transit_route->one_stop_offset()));
         }
 
         // Set short_name if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoShortName) &&
+        if (controller.attributes[kEdgeTransitRouteInfoShortName] &&
             transit_route->short_name_offset()) {
           transit_route_info->set_short_name(graphtile->GetName(transit_route->short_name_offset()));
         }
 
         // Set long_name if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoLongName) &&
+        if (controller.attributes[kEdgeTransitRouteInfoLongName] &&
             transit_route->long_name_offset()) {
           transit_route_info->set_long_name(graphtile->GetName(transit_route->long_name_offset()));
         }
 
         // Set color if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoColor)) {
+        if (controller.attributes[kEdgeTransitRouteInfoColor]) {
           transit_route_info->set_color(transit_route->route_color());
         }
 
         // Set text_color if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoTextColor)) {
+        if (controller.attributes[kEdgeTransitRouteInfoTextColor]) {
           transit_route_info->set_text_color(transit_route->route_text_color());
         }
 
         // Set description if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoDescription) &&
+        if (controller.attributes[kEdgeTransitRouteInfoDescription] &&
             transit_route->desc_offset()) {
           transit_route_info->set_description(graphtile->GetName(transit_route->desc_offset()));
         }
 
         // Set operator_onestop_id if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOperatorOnestopId) &&
+        if (controller.attributes[kEdgeTransitRouteInfoOperatorOnestopId] &&
             transit_route->op_by_onestop_id_offset()) {
           transit_route_info->set_operator_onestop_id(
               graphtile->GetName(transit_route->op_by_onestop_id_offset()));
         }
 
         // Set operator_name if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOperatorName) &&
+        if (controller.attributes[kEdgeTransitRouteInfoOperatorName] &&
             transit_route->op_by_name_offset()) {
           transit_route_info->set_operator_name(
               graphtile->GetName(transit_route->op_by_name_offset()));
         }
 
         // Set operator_url if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOperatorUrl) &&
+        if (controller.attributes[kEdgeTransitRouteInfoOperatorUrl] &&
             transit_route->op_by_website_offset()) {
           transit_route_info->set_operator_url(
               graphtile->GetName(transit_route->op_by_website_offset()));
@@ -1027,7 +1032,7 @@ void AddTripIntersectingEdge(const AttributesController& controller,
   TripLeg_IntersectingEdge* itersecting_edge = trip_node->add_intersecting_edge();
 
   // Set the heading for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeBeginHeading)) {
+  if (controller.attributes[kNodeIntersectingEdgeBeginHeading]) {
     itersecting_edge->set_begin_heading(nodeinfo->heading(local_edge_index));
   }
 
@@ -1043,7 +1048,7 @@ void AddTripIntersectingEdge(const AttributesController& controller,
                          : Traversability::kNone;
   }
   // Set the walkability flag for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeWalkability)) {
+  if (controller.attributes[kNodeIntersectingEdgeWalkability]) {
     itersecting_edge->set_walkability(GetTripLegTraversability(traversability));
   }
 
@@ -1057,35 +1062,35 @@ void AddTripIntersectingEdge(const AttributesController& controller,
                                                                          : Traversability::kNone;
   }
   // Set the cyclability flag for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeCyclability)) {
+  if (controller.attributes[kNodeIntersectingEdgeCyclability]) {
     itersecting_edge->set_cyclability(GetTripLegTraversability(traversability));
   }
 
   // Set the driveability flag for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeDriveability)) {
+  if (controller.attributes[kNodeIntersectingEdgeDriveability]) {
     itersecting_edge->set_driveability(
         GetTripLegTraversability(nodeinfo->local_driveability(local_edge_index)));
   }
 
   // Set the previous/intersecting edge name consistency if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeFromEdgeNameConsistency)) {
+  if (controller.attributes[kNodeIntersectingEdgeFromEdgeNameConsistency]) {
     bool name_consistency =
         (prev_de == nullptr) ? false : prev_de->name_consistency(local_edge_index);
     itersecting_edge->set_prev_name_consistency(name_consistency);
   }
 
   // Set the current/intersecting edge name consistency if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeToEdgeNameConsistency)) {
+  if (controller.attributes[kNodeIntersectingEdgeToEdgeNameConsistency]) {
     itersecting_edge->set_curr_name_consistency(directededge->name_consistency(local_edge_index));
   }
 
   // Set the use for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeUse)) {
+  if (controller.attributes[kNodeIntersectingEdgeUse]) {
     itersecting_edge->set_use(GetTripLegUse(intersecting_de->use()));
   }
 
   // Set the road class for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeRoadClass)) {
+  if (controller.attributes[kNodeIntersectingEdgeRoadClass]) {
     itersecting_edge->set_road_class(GetTripLegRoadClass(intersecting_de->classification()));
   }
 }
@@ -1243,11 +1248,11 @@ void TripLegBuilder::Build(
                     startnode.id(), false, nullptr, path_begin->has_time_restrictions);
 
     // Set begin shape index if requested
-    if (controller.attributes.at(kEdgeBeginShapeIndex)) {
+    if (controller.attributes[kEdgeBeginShapeIndex]) {
       trip_edge->set_begin_shape_index(0);
     }
     // Set end shape index if requested
-    if (controller.attributes.at(kEdgeEndShapeIndex)) {
+    if (controller.attributes[kEdgeEndShapeIndex]) {
       trip_edge->set_end_shape_index(shape.size() - 1);
     }
 
@@ -1261,17 +1266,17 @@ void TripLegBuilder::Build(
     SetHeadings(trip_edge, controller, edge, shape, 0);
 
     auto* node = trip_path.add_node();
-    if (controller.attributes.at(kNodeElapsedTime)) {
+    if (controller.attributes[kNodeElapsedTime]) {
       node->set_elapsed_time(path_begin->elapsed_time - trim_begin - trim_end);
     }
 
     const GraphTile* end_tile = graphreader.GetGraphTile(edge->endnode());
     if (end_tile == nullptr) {
-      if (controller.attributes.at(kNodeaAdminIndex)) {
+      if (controller.attributes[kNodeaAdminIndex]) {
         node->set_admin_index(0);
       }
     } else {
-      if (controller.attributes.at(kNodeaAdminIndex)) {
+      if (controller.attributes[kNodeaAdminIndex]) {
         node->set_admin_index(
             GetAdminIndex(end_tile->admininfo(end_tile->node(edge->endnode())->admin_index()),
                           admin_info_map, admin_info_list));
@@ -1282,11 +1287,11 @@ void TripLegBuilder::Build(
     SetBoundingBox(trip_path, shape);
 
     // Set shape if requested
-    if (controller.attributes.at(kShape)) {
+    if (controller.attributes[kShape]) {
       trip_path.set_shape(encode<std::vector<PointLL>>(shape));
     }
 
-    if (controller.attributes.at(kOsmChangeset)) {
+    if (controller.attributes[kOsmChangeset]) {
       trip_path.set_osm_changeset(tile->header()->dataset_id());
     }
 
@@ -1314,6 +1319,11 @@ void TripLegBuilder::Build(
   TransitPlatformInfo_Type prev_transit_node_type = TransitPlatformInfo_Type_kStop;
 
   for (auto edge_itr = path_begin; edge_itr != path_end; ++edge_itr, ++edge_index) {
+    // Allow building long trips to be aborted
+    if (interrupt_callback && edge_index > 0 && (edge_index % kInterruptEdgeInterval) == 0) {
+      (*interrupt_callback)();
+    }
+
     const GraphId& edge = edge_itr->edgeid;
     const uint32_t trip_id = edge_itr->trip_id;
     graphtile = graphreader.GetGraphTile(edge, graphtile);
@@ -1327,7 +1337,7 @@ void TripLegBuilder::Build(
     start_tile = graphreader.GetGraphTile(startnode, start_tile);
     const NodeInfo* node = start_tile->node(startnode);
 
-    if (osmchangeset == 0 && controller.attributes.at(kOsmChangeset)) {
+    if (osmchangeset == 0 && controller.attributes[kOsmChangeset]) {
       osmchangeset = start_tile->header()->dataset_id();
     }
 
@@ -1349,18 +1359,18 @@ void TripLegBuilder::Build(
     // Add a node to the trip path and set its attributes.
     TripLeg_Node* trip_node = trip_path.add_node();
 
-    if (controller.attributes.at(kNodeType)) {
+    if (controller.attributes[kNodeType]) {
       trip_node->set_type(GetTripLegNodeType(node->type()));
     }
 
     if (node->intersection() == IntersectionType::kFork) {
-      if (controller.attributes.at(kNodeFork)) {
+      if (controller.attributes[kNodeFork]) {
         trip_node->set_fork(true);
       }
     }
 
     // Assign the elapsed time from the start of the leg
-    if (controller.attributes.at(kNodeElapsedTime)) {
+    if (controller.attributes[kNodeElapsedTime]) {
       trip_node->set_elapsed_time(elapsedtime);
     }
 
@@ -1371,12 +1381,12 @@ void TripLegBuilder::Build(
     }
 
     // Assign the admin index
-    if (controller.attributes.at(kNodeaAdminIndex)) {
+    if (controller.attributes[kNodeaAdminIndex]) {
       trip_node->set_admin_index(
           GetAdminIndex(start_tile->admininfo(node->admin_index()), admin_info_map, admin_info_list));
     }
 
-    if (controller.attributes.at(kNodeTimeZone)) {
+    if (controller.attributes[kNodeTimeZone]) {
       auto tz = DateTime::get_tz_db().from_index(node->timezone());
       if (tz) {
         trip_node->set_time_zone(tz->name());
@@ -1398,18 +1408,18 @@ void TripLegBuilder::Build(
       // Set type
       if (directededge->use() == Use::kRail) {
         // Set node transit info type if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoType)) {
+        if (controller.attributes[kNodeTransitPlatformInfoType]) {
           transit_platform_info->set_type(TransitPlatformInfo_Type_kStation);
         }
         prev_transit_node_type = TransitPlatformInfo_Type_kStation;
       } else if (directededge->use() == Use::kPlatformConnection) {
         // Set node transit info type if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoType)) {
+        if (controller.attributes[kNodeTransitPlatformInfoType]) {
           transit_platform_info->set_type(prev_transit_node_type);
         }
       } else { // bus logic
         // Set node transit info type if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoType)) {
+        if (controller.attributes[kNodeTransitPlatformInfoType]) {
           transit_platform_info->set_type(TransitPlatformInfo_Type_kStop);
         }
         prev_transit_node_type = TransitPlatformInfo_Type_kStop;
@@ -1417,14 +1427,14 @@ void TripLegBuilder::Build(
 
       if (transit_platform) {
         // Set onstop_id if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoOnestopId) &&
+        if (controller.attributes[kNodeTransitPlatformInfoOnestopId] &&
             transit_platform->one_stop_offset()) {
           transit_platform_info->set_onestop_id(
               graphtile->GetName(transit_platform->one_stop_offset()));
         }
 
         // Set name if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoName) &&
+        if (controller.attributes[kNodeTransitPlatformInfoName] &&
             transit_platform->name_offset()) {
           transit_platform_info->set_name(graphtile->GetName(transit_platform->name_offset()));
         }
@@ -1439,14 +1449,14 @@ void TripLegBuilder::Build(
             const TransitStop* transit_station = endtile->GetTransitStop(nodeinfo2->stop_index());
 
             // Set station onstop_id if requested
-            if (controller.attributes.at(kNodeTransitPlatformInfoStationOnestopId) &&
+            if (controller.attributes[kNodeTransitPlatformInfoStationOnestopId] &&
                 transit_station->one_stop_offset()) {
               transit_platform_info->set_station_onestop_id(
                   endtile->GetName(transit_station->one_stop_offset()));
             }
 
             // Set station name if requested
-            if (controller.attributes.at(kNodeTransitPlatformInfoStationName) &&
+            if (controller.attributes[kNodeTransitPlatformInfoStationName] &&
                 transit_station->name_offset()) {
               transit_platform_info->set_station_name(
                   endtile->GetName(transit_station->name_offset()));
@@ -1460,7 +1470,7 @@ void TripLegBuilder::Build(
         // Set latitude and longitude
         LatLng* stop_ll = transit_platform_info->mutable_ll();
         // Set transit stop lat/lon if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoLatLon)) {
+        if (controller.attributes[kNodeTransitPlatformInfoLatLon]) {
           PointLL ll = node->latlng(start_tile->header()->base_ll());
           stop_ll->set_lat(ll.lat());
           stop_ll->set_lng(ll.lng());
@@ -1469,7 +1479,7 @@ void TripLegBuilder::Build(
 
       // Set the arrival time at this node (based on schedule from last trip
       // departure) if requested
-      if (controller.attributes.at(kNodeTransitPlatformInfoArrivalDateTime) &&
+      if (controller.attributes[kNodeTransitPlatformInfoArrivalDateTime] &&
           !arrival_time.empty()) {
         transit_platform_info->set_arrival_date_time(arrival_time);
       }
@@ -1488,7 +1498,7 @@ void TripLegBuilder::Build(
 
           if (graphtile->header()->date_created() > date) {
             // Set assumed schedule if requested
-            if (controller.attributes.at(kNodeTransitPlatformInfoAssumedSchedule)) {
+            if (controller.attributes[kNodeTransitPlatformInfoAssumedSchedule]) {
               transit_platform_info->set_assumed_schedule(true);
             }
             assumed_schedule = true;
@@ -1496,7 +1506,7 @@ void TripLegBuilder::Build(
             day = date - graphtile->header()->date_created();
             if (day > graphtile->GetTransitSchedule(transit_departure->schedule_index())->end_day()) {
               // Set assumed schedule if requested
-              if (controller.attributes.at(kNodeTransitPlatformInfoAssumedSchedule)) {
+              if (controller.attributes[kNodeTransitPlatformInfoAssumedSchedule]) {
                 transit_platform_info->set_assumed_schedule(true);
               }
               assumed_schedule = true;
@@ -1520,7 +1530,7 @@ void TripLegBuilder::Build(
           }
 
           // Set departure time from this transit stop if requested
-          if (controller.attributes.at(kNodeTransitPlatformInfoDepartureDateTime)) {
+          if (controller.attributes[kNodeTransitPlatformInfoDepartureDateTime]) {
             transit_platform_info->set_departure_date_time(dt);
           }
 
@@ -1550,7 +1560,7 @@ void TripLegBuilder::Build(
         block_id = 0;
 
         // Set assumed schedule if requested
-        if (controller.attributes.at(kNodeTransitPlatformInfoAssumedSchedule) && assumed_schedule) {
+        if (controller.attributes[kNodeTransitPlatformInfoAssumedSchedule] && assumed_schedule) {
           transit_platform_info->set_assumed_schedule(true);
         }
         assumed_schedule = false;
@@ -1649,12 +1659,12 @@ void TripLegBuilder::Build(
     }
 
     // Set begin shape index if requested
-    if (controller.attributes.at(kEdgeBeginShapeIndex)) {
+    if (controller.attributes[kEdgeBeginShapeIndex]) {
       trip_edge->set_begin_shape_index(begin_index);
     }
 
     // Set end shape index if requested
-    if (controller.attributes.at(kEdgeEndShapeIndex)) {
+    if (controller.attributes[kEdgeEndShapeIndex]) {
       trip_edge->set_end_shape_index(trip_shape.size() - 1);
     }
 
@@ -1685,7 +1695,10 @@ void TripLegBuilder::Build(
     //          A || \\ G
     //            ||  \\
     //            (1)  (X)
-    if (startnode.Is_Valid()) {
+    //
+    // Intersecting edges are skipped entirely when none of their attributes are requested
+    if (startnode.Is_Valid() &&
+        controller.category_attribute_enabled(kNodeIntersectingEdgeCategory)) {
       // Iterate through edges on this level to find any intersecting edges
       // Follow any upwards or downward transitions
       const DirectedEdge* de = start_tile->directededge(node->edge_index());
@@ -1753,13 +1766,13 @@ void TripLegBuilder::Build(
 
   // Add the last node
   auto* node = trip_path.add_node();
-  if (controller.attributes.at(kNodeaAdminIndex)) {
+  if (controller.attributes[kNodeaAdminIndex]) {
     auto* last_tile = graphreader.GetGraphTile(startnode);
     node->set_admin_index(
         GetAdminIndex(last_tile->admininfo(last_tile->node(startnode)->admin_index()), admin_info_map,
                       admin_info_list));
   }
-  if (controller.attributes.at(kNodeElapsedTime)) {
+  if (controller.attributes[kNodeElapsedTime]) {
     node->set_elapsed_time(elapsedtime);
   }
 
@@ -1770,11 +1783,11 @@ void TripLegBuilder::Build(
   SetBoundingBox(trip_path, trip_shape);
 
   // Set shape if requested
-  if (controller.attributes.at(kShape)) {
+  if (controller.attributes[kShape]) {
     trip_path.set_shape(encode<std::vector<PointLL>>(trip_shape));
   }
 
-  if (osmchangeset != 0 && controller.attributes.at(kOsmChangeset)) {
+  if (osmchangeset != 0 && controller.attributes[kOsmChangeset]) {
     trip_path.set_osm_changeset(osmchangeset);
   }
 }
@@ -11,6 +11,8 @@
 #include "midgard/logging.h"
 #include <boost/property_tree/ptree.hpp>
 
+#include "sif/costcache.h"
+#include "thor/bucketmatrix.h"
 #include "thor/isochrone.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
@@ -58,7 +60,9 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
                              const std::shared_ptr<baldr::GraphReader>& graph_reader)
     : mode(valhalla::sif::TravelMode::kPedestrian), matcher_factory(config, graph_reader),
       reader(graph_reader), controller{},
-      long_request(config.get<float>("thor.logging.long_request")) {
+      long_request(config.get<float>("thor.logging.long_request")),
+      search_memory(config.get<size_t>("service_limits.max_search_memory", 0) << 20,
+                    config.get<size_t>("thor.max_total_search_memory", 0) << 20) {
   // If we weren't provided with a graph reader make our own
   if (!reader)
     reader = matcher_factory.graphreader();
@@ -72,7 +76,8 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
   for (const auto& kv : config.get_child("service_limits")) {
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" ||
-        kv.first == "max_alternates") {
+        kv.first == "max_alternates" || kv.first == "max_timeout" ||
+        kv.first == "max_search_memory") {
       continue;
     }
     if (kv.first != "skadi" && kv.first != "trace" && kv.first != "isochrone") {
@@ -85,12 +90,102 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucketmatrix") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
 
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
+
+  // Prune route expansion with arc flags (only when the tiles have them)
+  use_arcflags = config.get<bool>("thor.arc_flags", false);
+
+  // Run the forward and reverse bidirectional searches on separate threads. The
+  // reverse search needs its own graph reader.
+  if (config.get<bool>("thor.parallel_bidirectional", false)) {
+    reverse_reader = std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"));
+    bidir_astar.set_reverse_reader(reverse_reader,
+                                   config.get<float>("thor.parallel_bidirectional_min_distance",
+                                                     kParallelMinDistance));
+  }
+
+  // Compute the legs of multi-location routes on up to this many threads. Each thread
+  // has its own graph reader, all of them sharing a synchronized tile cache.
+  auto leg_concurrency = config.get<unsigned int>("thor.leg_concurrency", 1);
+  if (leg_concurrency > 1) {
+    auto leg_reader_config = config.get_child("mjolnir");
+    leg_reader_config.put("global_synchronized_cache", true);
+    for (unsigned int i = 0; i < leg_concurrency; ++i) {
+      leg_routers.emplace_back(new leg_router_t());
+      leg_routers.back()->reader = std::make_shared<baldr::GraphReader>(leg_reader_config);
+    }
+  }
+
+  // Expand the cost matrix searches on up to this many threads. Each additional
+  // thread has its own graph reader, all of them sharing a synchronized tile cache.
+  auto matrix_concurrency = config.get<unsigned int>("thor.matrix_concurrency", 1);
+  if (matrix_concurrency > 1) {
+    auto matrix_reader_config = config.get_child("mjolnir");
+    matrix_reader_config.put("global_synchronized_cache", true);
+    for (unsigned int i = 1; i < matrix_concurrency; ++i) {
+      matrix_readers.push_back(std::make_shared<baldr::GraphReader>(matrix_reader_config));
+    }
+  }
+
+  // Let matrix locations correlated to the same edges share one search
+  matrix_share_searches = config.get<bool>("thor.matrix_share_searches", false);
+
+  // Edge labels of each backward search of the bucket matrix
+  bucket_matrix_max_labels =
+      config.get<unsigned int>("thor.bucket_matrix_max_labels", kDefaultMaxBucketLabels);
+
+  // Threads and time budget of the restarts of the optimized route solver
+  optimizer_concurrency = config.get<unsigned int>("thor.optimizer_concurrency", 1);
+  optimizer_time_budget = config.get<unsigned int>("thor.optimizer_time_budget", 0);
+
+  // Generate isochrone contours on bands of grid rows on up to this many threads
+  contour_concurrency = config.get<unsigned int>("thor.contour_concurrency", 1);
+
+  // Compute the isochrones of batch requests on up to this many threads
+  auto isochrone_concurrency = config.get<unsigned int>("thor.isochrone_concurrency", 1);
+  if (isochrone_concurrency > 1) {
+    auto isochrone_reader_config = config.get_child("mjolnir");
+    isochrone_reader_config.put("global_synchronized_cache", true);
+    for (unsigned int i = 1; i < isochrone_concurrency; ++i) {
+      isochrone_generators.emplace_back(new isochrone_generator_t());
+      isochrone_generators.back()->reader =
+          std::make_shared<baldr::GraphReader>(isochrone_reader_config);
+    }
+  }
+
+  // Account the memory of the route and isochrone searches, the matrix searches
+  // are given the budget as they are created
+  for (PathAlgorithm* algorithm : std::vector<PathAlgorithm*>{&astar, &bidir_astar,
+                                                              &multi_modal_astar, &connection_scan,
+                                                              &timedep_forward, &timedep_reverse}) {
+    algorithm->set_memory(&search_memory);
+  }
+  for (auto& leg_router : leg_routers) {
+    leg_router->astar.set_memory(&search_memory);
+    leg_router->bidir_astar.set_memory(&search_memory);
+  }
+  isochrone_gen.set_memory(&search_memory);
+  for (auto& isochrone_generator : isochrone_generators) {
+    isochrone_generator->isochrone.set_memory(&search_memory);
+  }
+
+  // Keep the results of this many route requests
+  auto route_cache_size = config.get<size_t>("thor.route_cache_size", 0);
+  if (route_cache_size > 0) {
+    route_cache = std::make_shared<RouteCache>(route_cache_size);
+  }
+
+  // Memoize the edge costs of the cached costing profiles in the tiles. The cache is
+  // process wide, the profiles are only dropped if the setting changes
+  sif::CostCache::GetInstance().set_edge_cost_memo(config.get<bool>("thor.edge_cost_memo", false));
+  request_stats.tiles_start = tile_counts();
 }
 
 thor_worker_t::~thor_worker_t() {
@@ -111,15 +206,19 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
     request.ParseFromArray(job.front().data(), job.front().size());
     const auto& options = request.options();
 
-    // Set the interrupt function
+    // Set the interrupt function, checking the deadline of the request
     service_worker_t::set_interrupt(interrupt_function);
+    service_worker_t::set_deadline(request);
 
     prime_server::worker_t::result_t result{true};
     double denominator = 0;
     // do request specific processing
     switch (options.action()) {
       case Options::sources_to_targets:
-        result = to_response_json(matrix(request), info, request);
+        // A worker returns one message per response, so json lines are gathered into
+        // one body here. Only library callers of the writer overloads get rows early
+        result = options.format() == Options::jsonl ? to_response_jsonl(matrix(request), info, request)
+                                                    : to_response_json(matrix(request), info, request);
         denominator = options.sources_size() + options.targets_size();
         break;
       case Options::optimized_route: {
@@ -128,10 +227,20 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
         denominator = std::max(options.sources_size(), options.targets_size());
         break;
       }
+      case Options::optimized_routes: {
+        optimized_routes(request);
+        result.messages.emplace_back(request.SerializeAsString());
+        denominator = std::max(options.sources_size(), options.targets_size());
+        break;
+      }
       case Options::isochrone:
         result = to_response_json(isochrones(request), info, request);
         denominator = options.sources_size() * options.targets_size();
         break;
+      case Options::batch_isochrone:
+        result = to_response_jsonl(batch_isochrones(request), info, request);
+        denominator = options.locations_size();
+        break;
       case Options::route: {
         route(request);
         result.messages.emplace_back(request.SerializeAsString());
@@ -172,6 +281,10 @@ thor_worker_t::work(const std::list<zmq::message_t>& job,
     return result;
   } catch (const valhalla_exception_t& e) {
     valhalla::midgard::logging::Log("400::" + std::string(e.what()), " [ANALYTICS] ");
+    // Report what the searches got done before the request ran out of time or memory
+    if (e.code == 446 || e.code == 447 || e.code == 448) {
+      set_search_stats(request);
+    }
     return jsonify_error(e, info, request);
   } catch (const std::exception& e) {
     valhalla::midgard::logging::Log("400::" + std::string(e.what()), " [ANALYTICS] ");
@@ -335,17 +448,17 @@ void thor_worker_t::parse_filter_attributes(const Api& request, bool is_strict_f
         if (is_strict_filter)
           controller.disable_all();
         for (const auto& filter_attribute : options.filter_attributes()) {
-          try {
-            controller.attributes.at(filter_attribute) = true;
-          } catch (...) { LOG_ERROR("Invalid filter attribute " + filter_attribute); }
+          if (!controller.set_attribute(filter_attribute, true)) {
+            LOG_ERROR("Invalid filter attribute " + filter_attribute);
+          }
         }
         break;
       }
       case (FilterAction::exclude): {
         for (const auto& filter_attribute : options.filter_attributes()) {
-          try {
-            controller.attributes.at(filter_attribute) = false;
-          } catch (...) { LOG_ERROR("Invalid filter attribute " + filter_attribute); }
+          if (!controller.set_attribute(filter_attribute, false)) {
+            LOG_ERROR("Invalid filter attribute " + filter_attribute);
+          }
         }
         break;
       }
@@ -359,12 +472,110 @@ void thor_worker_t::cleanup() {
   timedep_forward.Clear();
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
+  connection_scan.Clear();
   trace.clear();
   isochrone_gen.Clear();
   matcher_factory.ClearFullCache();
   if (reader->OverCommitted()) {
     reader->Trim();
   }
+  if (reverse_reader && reverse_reader->OverCommitted()) {
+    reverse_reader->Trim();
+  }
+  for (auto& leg_router : leg_routers) {
+    leg_router->astar.Clear();
+    leg_router->bidir_astar.Clear();
+    if (leg_router->reader->OverCommitted()) {
+      leg_router->reader->Trim();
+    }
+  }
+  for (auto& matrix_reader : matrix_readers) {
+    if (matrix_reader->OverCommitted()) {
+      matrix_reader->Trim();
+    }
+  }
+  for (auto& isochrone_generator : isochrone_generators) {
+    isochrone_generator->isochrone.Clear();
+    if (isochrone_generator->reader->OverCommitted()) {
+      isochrone_generator->reader->Trim();
+    }
+  }
+  request_stats = request_stats_t{};
+  request_stats.tiles_start = tile_counts();
+  search_memory.ResetPeak();
+}
+
+// Add the counters of a search to the stats of the request.
+void thor_worker_t::add_search_stats(const SearchStats& stats,
+                                     const std::chrono::steady_clock::time_point& start) {
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  std::lock_guard<std::mutex> lock(request_stats_lock);
+  request_stats.search.Add(stats);
+  request_stats.search_ms += elapsed.count();
+}
+
+// Add the time since the contour generation started to the stats of the request.
+void thor_worker_t::add_contour_stats(const std::chrono::steady_clock::time_point& start) {
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  std::lock_guard<std::mutex> lock(request_stats_lock);
+  request_stats.contour_ms += elapsed.count();
+}
+
+// Set the stats of the request if it asked for them.
+void thor_worker_t::set_search_stats(Api& request) {
+  if (!request.options().search_stats()) {
+    return;
+  }
+  auto tiles = tile_counts();
+  auto* stats = request.mutable_stats();
+  stats->set_edges_settled(request_stats.search.edges_settled);
+  stats->set_labels_created(request_stats.search.labels_created);
+  stats->set_queue_decreases(request_stats.search.queue_decreases);
+  stats->set_transitions(request_stats.search.transitions);
+  stats->set_tile_lookups(tiles.first - request_stats.tiles_start.first);
+  stats->set_tile_cache_misses(tiles.second - request_stats.tiles_start.second);
+  stats->set_search_ms(request_stats.search_ms);
+  stats->set_contour_ms(request_stats.contour_ms);
+  stats->set_peak_search_bytes(search_memory.peak());
+  if (route_cache) {
+    stats->set_route_cache_hits(route_cache->hits());
+    stats->set_route_cache_misses(route_cache->misses());
+  }
+}
+
+// Get the tile lookups and cache misses of all the graph readers.
+std::pair<uint64_t, uint64_t> thor_worker_t::tile_counts() const {
+  std::pair<uint64_t, uint64_t> counts{0, 0};
+  auto add = [&counts](const baldr::GraphReader& graphreader) {
+    counts.first += graphreader.tile_lookups();
+    counts.second += graphreader.tile_cache_misses();
+  };
+  if (reader) {
+    add(*reader);
+  }
+  if (reverse_reader) {
+    add(*reverse_reader);
+  }
+  for (const auto& leg_router : leg_routers) {
+    add(*leg_router->reader);
+  }
+  for (const auto& matrix_reader : matrix_readers) {
+    add(*matrix_reader);
+  }
+  for (const auto& isochrone_generator : isochrone_generators) {
+    add(*isochrone_generator->reader);
+  }
+  return counts;
+}
+
+// Get the dataset id of the routing graph at the first correlated location.
+uint64_t thor_worker_t::dataset_id(const Options& options) const {
+  if (options.locations_size() == 0 || options.locations(0).path_edges_size() == 0) {
+    return 0;
+  }
+  GraphId edgeid(options.locations(0).path_edges(0).graph_id());
+  const GraphTile* tile = reader->GetGraphTile(edgeid);
+  return tile == nullptr ? 0 : tile->header()->dataset_id();
 }
 
 } // namespace thor
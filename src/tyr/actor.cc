@@ -23,6 +23,10 @@ struct actor_t::pimpl_t {
     thor_worker.set_interrupt(interrupt_function);
     odin_worker.set_interrupt(interrupt_function);
   }
+  void set_deadlines(const Api& request) {
+    thor_worker.set_deadline(request);
+    odin_worker.set_deadline(request);
+  }
   void cleanup() {
     loki_worker.cleanup();
     thor_worker.cleanup();
@@ -50,6 +54,7 @@ std::string actor_t::route(const std::string& request_str, const std::function<v
   ParseApi(request_str, Options::route, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.route(request);
+  pimpl->set_deadlines(request);
   // route between the locations in the graph to find the best path
   pimpl->thor_worker.route(request);
   // get some directions back from them
@@ -86,6 +91,7 @@ std::string actor_t::matrix(const std::string& request_str, const std::function<
   ParseApi(request_str, Options::sources_to_targets, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.matrix(request);
+  pimpl->set_deadlines(request);
   // compute the matrix
   auto json = pimpl->thor_worker.matrix(request);
   // if they want you do to do the cleanup automatically
@@ -95,6 +101,25 @@ std::string actor_t::matrix(const std::string& request_str, const std::function<
   return json;
 }
 
+void actor_t::matrix(const std::string& request_str,
+                     const std::function<void()>& interrupt,
+                     const std::function<void(const std::string&)>& writer) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::sources_to_targets, request);
+  // check the request and locate the locations in the graph
+  pimpl->loki_worker.matrix(request);
+  pimpl->set_deadlines(request);
+  // compute the matrix writing each row when it is done
+  pimpl->thor_worker.matrix(request, writer);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+}
+
 std::string actor_t::optimized_route(const std::string& request_str,
                                      const std::function<void()>& interrupt) {
   // set the interrupts
@@ -104,6 +129,7 @@ std::string actor_t::optimized_route(const std::string& request_str,
   ParseApi(request_str, Options::optimized_route, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.matrix(request);
+  pimpl->set_deadlines(request);
   // compute compute all pairs and then the shortest path through them all
   pimpl->thor_worker.optimized_route(request);
   // get some directions back from them
@@ -117,6 +143,29 @@ std::string actor_t::optimized_route(const std::string& request_str,
   return bytes;
 }
 
+std::string actor_t::optimized_routes(const std::string& request_str,
+                                      const std::function<void()>& interrupt) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::optimized_routes, request);
+  // check the request and locate the locations in the graph
+  pimpl->loki_worker.matrix(request);
+  pimpl->set_deadlines(request);
+  // compute all pairs and then assign the jobs to the vehicles and route them
+  pimpl->thor_worker.optimized_routes(request);
+  // get some directions back from them
+  pimpl->odin_worker.narrate(request);
+  // serialize them out to json string
+  auto bytes = tyr::serializeDirections(request);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+  return bytes;
+}
+
 std::string actor_t::isochrone(const std::string& request_str,
                                const std::function<void()>& interrupt) {
   // set the interrupts
@@ -126,6 +175,7 @@ std::string actor_t::isochrone(const std::string& request_str,
   ParseApi(request_str, Options::isochrone, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.isochrones(request);
+  pimpl->set_deadlines(request);
   // compute the isochrones
   auto json = pimpl->thor_worker.isochrones(request);
   // if they want you do to do the cleanup automatically
@@ -135,6 +185,32 @@ std::string actor_t::isochrone(const std::string& request_str,
   return json;
 }
 
+std::string actor_t::batch_isochrone(const std::string& request_str,
+                                     const std::function<void()>& interrupt) {
+  std::string jsonl;
+  batch_isochrone(request_str, interrupt, [&jsonl](const std::string& line) { jsonl += line; });
+  return jsonl;
+}
+
+void actor_t::batch_isochrone(const std::string& request_str,
+                              const std::function<void()>& interrupt,
+                              const std::function<void(const std::string&)>& writer) {
+  // set the interrupts
+  pimpl->set_interrupts(interrupt);
+  // parse the request
+  Api request;
+  ParseApi(request_str, Options::batch_isochrone, request);
+  // check the request and locate the locations in the graph
+  pimpl->loki_worker.batch_isochrones(request);
+  pimpl->set_deadlines(request);
+  // compute the isochrones of each location writing each one when it is done
+  pimpl->thor_worker.batch_isochrones(request, writer);
+  // if they want you do to do the cleanup automatically
+  if (auto_cleanup) {
+    cleanup();
+  }
+}
+
 std::string actor_t::trace_route(const std::string& request_str,
                                  const std::function<void()>& interrupt) {
   // set the interrupts
@@ -144,6 +220,7 @@ std::string actor_t::trace_route(const std::string& request_str,
   ParseApi(request_str, Options::trace_route, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.trace(request);
+  pimpl->set_deadlines(request);
   // route between the locations in the graph to find the best path
   pimpl->thor_worker.trace_route(request);
   // get some directions back from them
@@ -166,6 +243,7 @@ std::string actor_t::trace_attributes(const std::string& request_str,
   ParseApi(request_str, Options::trace_attributes, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.trace(request);
+  pimpl->set_deadlines(request);
   // get the path and turn it into attribution along it
   auto json = pimpl->thor_worker.trace_attributes(request);
   // if they want you do to do the cleanup automatically
@@ -215,6 +293,7 @@ std::string actor_t::expansion(const std::string& request_str,
   ParseApi(request_str, Options::expansion, request);
   // check the request and locate the locations in the graph
   pimpl->loki_worker.route(request);
+  pimpl->set_deadlines(request);
   // route between the locations in the graph to find the best path
   auto json = pimpl->thor_worker.expansion(request);
   // if they want you do to do the cleanup automatically
@@ -13,21 +13,16 @@ using namespace valhalla::baldr::json;
 
 namespace {
 using rgba_t = std::tuple<float, float, float>;
-}
-
-namespace valhalla {
-namespace tyr {
 
+// Add a feature for each contour of each interval
 template <class coord_t>
-std::string
-serializeIsochrones(const Api& request,
-                    const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
-                    bool polygons,
-                    const std::unordered_map<float, std::string>& colors,
-                    bool show_locations) {
+void addContourFeatures(
+    Jarray& features,
+    const typename valhalla::midgard::GriddedData<coord_t>::contours_t& grid_contours,
+    bool polygons,
+    const std::unordered_map<float, std::string>& colors) {
   // for each contour interval
   int i = 0;
-  auto features = array({});
   for (const auto& interval : grid_contours) {
     auto color_itr = colors.find(interval.first);
     // color was supplied
@@ -67,7 +62,7 @@ serializeIsochrones(const Api& request,
         }
       }
       // add a feature
-      features->emplace_back(map({
+      features.emplace_back(map({
           {"type", std::string("Feature")},
           {"geometry", map({
                            {"type", std::string(polygons ? "Polygon" : "LineString")},
@@ -85,15 +80,35 @@ serializeIsochrones(const Api& request,
       }));
     }
   }
+}
+
+// The location as a point feature
+MapPtr pointFeature(const valhalla::Location& location) {
+  return map({{"type", std::string("Feature")},
+              {"properties", map({})},
+              {"geometry", map({{"type", std::string("Point")},
+                                {"coordinates", array({fp_t{location.ll().lng(), 6},
+                                                       fp_t{location.ll().lat(), 6}})}})}});
+}
+
+} // namespace
+
+namespace valhalla {
+namespace tyr {
+
+template <class coord_t>
+std::string
+serializeIsochrones(const Api& request,
+                    const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
+                    bool polygons,
+                    const std::unordered_map<float, std::string>& colors,
+                    bool show_locations) {
+  auto features = array({});
+  addContourFeatures<coord_t>(*features, grid_contours, polygons, colors);
   // Add original locations to the geojson
   if (show_locations) {
     for (const auto& location : request.options().locations()) {
-      features->emplace_back(
-          map({{"type", std::string("Feature")},
-               {"properties", map({})},
-               {"geometry", map({{"type", std::string("Point")},
-                                 {"coordinates", array({fp_t{location.ll().lng(), 6},
-                                                        fp_t{location.ll().lat(), 6}})}})}}));
+      features->emplace_back(pointFeature(location));
     }
   }
   // make the collection
@@ -124,5 +139,66 @@ serializeIsochrones<midgard::PointLL>(const Api&,
                                       const std::unordered_map<float, std::string>&,
                                       bool);
 
+template <class coord_t>
+std::string
+serializeBatchIsochrone(const Api& request,
+                        size_t origin_index,
+                        const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
+                        bool polygons,
+                        const std::unordered_map<float, std::string>& colors,
+                        bool show_locations) {
+  auto features = array({});
+  addContourFeatures<coord_t>(*features, grid_contours, polygons, colors);
+  if (show_locations) {
+    features->emplace_back(pointFeature(request.options().locations(origin_index)));
+  }
+  auto feature_collection = map({
+      {"type", std::string("FeatureCollection")},
+      {"origin", static_cast<uint64_t>(origin_index)},
+      {"features", features},
+  });
+
+  if (request.options().has_id()) {
+    feature_collection->emplace("id", request.options().id());
+  }
+
+  std::stringstream ss;
+  ss << *feature_collection << '\n';
+  return ss.str();
+}
+
+template std::string
+serializeBatchIsochrone<midgard::Point2>(const Api&,
+                                         size_t,
+                                         const midgard::GriddedData<midgard::Point2>::contours_t&,
+                                         bool,
+                                         const std::unordered_map<float, std::string>&,
+                                         bool);
+template std::string
+serializeBatchIsochrone<midgard::PointLL>(const Api&,
+                                          size_t,
+                                          const midgard::GriddedData<midgard::PointLL>::contours_t&,
+                                          bool,
+                                          const std::unordered_map<float, std::string>&,
+                                          bool);
+
+std::string serializeBatchIsochroneError(const Api& request,
+                                         size_t origin_index,
+                                         const valhalla_exception_t& error) {
+  auto json_error = map({
+      {"origin", static_cast<uint64_t>(origin_index)},
+      {"error_code", static_cast<uint64_t>(error.code)},
+      {"error", error.message},
+  });
+
+  if (request.options().has_id()) {
+    json_error->emplace("id", request.options().id());
+  }
+
+  std::stringstream ss;
+  ss << *json_error << '\n';
+  return ss.str();
+}
+
 } // namespace tyr
 } // namespace valhalla
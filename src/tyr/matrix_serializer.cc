@@ -151,5 +151,36 @@ std::string serializeMatrix(const Api& request,
   return ss.str();
 }
 
+std::string serializeMatrixHeader(const Api& request) {
+  const auto& options = request.options();
+  auto json = json::map({
+      {"units", Options_Units_Enum_Name(options.units())},
+      {"targets", json::array({valhalla_serializers::locations(options.targets())})},
+      {"sources", json::array({valhalla_serializers::locations(options.sources())})},
+  });
+  if (options.has_id()) {
+    json->emplace("id", options.id());
+  }
+
+  std::stringstream ss;
+  ss << *json << '\n';
+  return ss.str();
+}
+
+std::string serializeMatrixRow(const Api& request,
+                               const std::vector<TimeDistance>& time_distances,
+                               size_t source_index,
+                               double distance_scale) {
+  const auto& options = request.options();
+  auto row = valhalla_serializers::serialize_row(time_distances,
+                                                 source_index * options.targets_size(),
+                                                 options.targets_size(), source_index, 0,
+                                                 distance_scale);
+
+  std::stringstream ss;
+  ss << *json::map({{"sources_to_targets", row}}) << '\n';
+  return ss.str();
+}
+
 } // namespace tyr
 } // namespace valhalla
@@ -77,6 +77,11 @@ namespace valhalla {
 namespace tyr {
 
 std::string serializeDirections(Api& request) {
+  // the routes of multiple vehicles are only serialized as valhalla json
+  if (request.options().action() == Options::optimized_routes) {
+    return valhalla_serializers::serialize(request);
+  }
+
   // serialize them
   switch (request.options().format()) {
     case Options_Format_osrm:
@@ -86,7 +91,8 @@ std::string serializeDirections(Api& request) {
     case Options_Format_json:
       return valhalla_serializers::serialize(request);
     default:
-      throw;
+      throw valhalla_exception_t{107, "'" + Options_Format_Enum_Name(request.options().format()) +
+                                          "'"};
   }
 }
 
@@ -561,16 +561,55 @@ legs(const google::protobuf::RepeatedPtrField<valhalla::DirectionsLeg>& directio
   return legs;
 }
 
+json::MapPtr trip(const Api& api, const valhalla::DirectionsRoute& route) {
+  return json::map({{"locations", locations(route.legs())},
+                    {"summary", summary(route.legs())},
+                    {"legs", legs(route.legs())},
+                    {"status_message", string("Found route between points")},
+                    {"status", static_cast<uint64_t>(0)}, // 0 success
+                    {"units", valhalla::Options_Units_Enum_Name(api.options().units())},
+                    {"language", api.options().language()}});
+}
+
+// the trip of each vehicle with the jobs it does and the jobs no vehicle could take
+json::MapPtr vehicle_routes(const Api& api) {
+  auto routes = json::array({});
+  for (int i = 0; i < api.directions().routes_size(); ++i) {
+    const auto& trip_route = api.trip().routes(i);
+    auto jobs = json::array({});
+    for (auto job : trip_route.jobs()) {
+      jobs->emplace_back(static_cast<uint64_t>(job));
+    }
+    auto arrival_times = json::array({});
+    for (auto arrival_time : trip_route.arrival_times()) {
+      arrival_times->emplace_back(static_cast<uint64_t>(arrival_time));
+    }
+    routes->emplace_back(json::map({{"vehicle", static_cast<uint64_t>(trip_route.vehicle())},
+                                    {"jobs", jobs},
+                                    {"arrival_times", arrival_times},
+                                    {"trip", trip(api, api.directions().routes(i))}}));
+  }
+  auto unassigned = json::array({});
+  for (auto job : api.trip().unassigned_jobs()) {
+    unassigned->emplace_back(static_cast<uint64_t>(job));
+  }
+  return json::map({{"routes", routes}, {"unassigned", unassigned}});
+}
+
 std::string serialize(const Api& api) {
   // build up the json object
-  auto json = json::map(
-      {{"trip", json::map({{"locations", locations(api.directions().routes(0).legs())},
-                           {"summary", summary(api.directions().routes(0).legs())},
-                           {"legs", legs(api.directions().routes(0).legs())},
-                           {"status_message", string("Found route between points")},
-                           {"status", static_cast<uint64_t>(0)}, // 0 success
-                           {"units", valhalla::Options_Units_Enum_Name(api.options().units())},
-                           {"language", api.options().language()}})}});
+  auto json = api.options().action() == Options::optimized_routes
+                  ? vehicle_routes(api)
+                  : json::map({{"trip", trip(api, api.directions().routes(0))}});
+
+  // The routes after the first are alternates to it
+  if (api.options().action() != Options::optimized_routes && api.directions().routes_size() > 1) {
+    auto alternates = json::array({});
+    for (int i = 1; i < api.directions().routes_size(); ++i) {
+      alternates->emplace_back(json::map({{"trip", trip(api, api.directions().routes(i))}}));
+    }
+    json->emplace("alternates", alternates);
+  }
   if (api.options().has_id()) {
     json->emplace("id", api.options().id());
   }
@@ -345,13 +345,13 @@ json::ArrayPtr serialize_matched_points(const AttributesController& controller,
     auto match_points_map = json::map({});
 
     // Process matched point
-    if (controller.attributes.at(kMatchedPoint)) {
+    if (controller.attributes[kMatchedPoint]) {
       match_points_map->emplace("lon", json::fp_t{match_result.lnglat.first, 6});
       match_points_map->emplace("lat", json::fp_t{match_result.lnglat.second, 6});
     }
 
     // Process matched type
-    if (controller.attributes.at(kMatchedType)) {
+    if (controller.attributes[kMatchedType]) {
       switch (match_result.type) {
         case thor::MatchResult::Type::kMatched:
           match_points_map->emplace("type", std::string("matched"));
@@ -366,32 +366,32 @@ json::ArrayPtr serialize_matched_points(const AttributesController& controller,
     }
 
     // Process matched point edge index
-    if (controller.attributes.at(kMatchedEdgeIndex) && match_result.HasEdgeIndex()) {
+    if (controller.attributes[kMatchedEdgeIndex] && match_result.HasEdgeIndex()) {
       match_points_map->emplace("edge_index", static_cast<uint64_t>(match_result.edge_index));
     }
 
     // Process matched point begin route discontinuity
-    if (controller.attributes.at(kMatchedBeginRouteDiscontinuity) &&
+    if (controller.attributes[kMatchedBeginRouteDiscontinuity] &&
         match_result.begin_route_discontinuity) {
       match_points_map->emplace("begin_route_discontinuity",
                                 static_cast<bool>(match_result.begin_route_discontinuity));
     }
 
     // Process matched point end route discontinuity
-    if (controller.attributes.at(kMatchedEndRouteDiscontinuity) &&
+    if (controller.attributes[kMatchedEndRouteDiscontinuity] &&
         match_result.end_route_discontinuity) {
       match_points_map->emplace("end_route_discontinuity",
                                 static_cast<bool>(match_result.end_route_discontinuity));
     }
 
     // Process matched point distance along edge
-    if (controller.attributes.at(kMatchedDistanceAlongEdge) &&
+    if (controller.attributes[kMatchedDistanceAlongEdge] &&
         (match_result.type != thor::MatchResult::Type::kUnmatched)) {
       match_points_map->emplace("distance_along_edge", json::fp_t{match_result.distance_along, 3});
     }
 
     // Process matched point distance from trace point
-    if (controller.attributes.at(kMatchedDistanceFromTracePoint) &&
+    if (controller.attributes[kMatchedDistanceFromTracePoint] &&
         (match_result.type != thor::MatchResult::Type::kUnmatched)) {
       match_points_map->emplace("distance_from_trace_point",
                                 json::fp_t{match_result.distance_from, 3});
@@ -405,7 +405,7 @@ json::ArrayPtr serialize_matched_points(const AttributesController& controller,
 json::MapPtr serialize_shape_attributes(const AttributesController& controller,
                                         const TripLeg& trip_path) {
   auto attributes_map = json::map({});
-  if (controller.attributes.at(kShapeAttributesTime)) {
+  if (controller.attributes[kShapeAttributesTime]) {
     auto times_array = json::array({});
     for (const auto& time : trip_path.shape_attributes().time()) {
       // milliseconds (ms) to seconds (sec)
@@ -413,7 +413,7 @@ json::MapPtr serialize_shape_attributes(const AttributesController& controller,
     }
     attributes_map->emplace("time", times_array);
   }
-  if (controller.attributes.at(kShapeAttributesLength)) {
+  if (controller.attributes[kShapeAttributesLength]) {
     auto lengths_array = json::array({});
     for (const auto& length : trip_path.shape_attributes().length()) {
       // decimeters (dm) to kilometer (km)
@@ -421,7 +421,7 @@ json::MapPtr serialize_shape_attributes(const AttributesController& controller,
     }
     attributes_map->emplace("length", lengths_array);
   }
-  if (controller.attributes.at(kShapeAttributesSpeed)) {
+  if (controller.attributes[kShapeAttributesSpeed]) {
     auto speeds_array = json::array({});
     for (const auto& speed : trip_path.shape_attributes().speed()) {
       // dm/s to km/h
@@ -452,13 +452,13 @@ void append_trace_info(
   }
 
   // Add confidence_score
-  if (controller.attributes.at(kConfidenceScore)) {
+  if (controller.attributes[kConfidenceScore]) {
     json->emplace("confidence_score",
                   json::fp_t{std::get<kConfidenceScoreIndex>(map_match_result), 3});
   }
 
   // Add raw_score
-  if (controller.attributes.at(kRawScore)) {
+  if (controller.attributes[kRawScore]) {
     json->emplace("raw_score", json::fp_t{std::get<kRawScoreIndex>(map_match_result), 3});
   }
 
@@ -0,0 +1,242 @@
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "config.h"
+#include "loki/worker.h"
+#include "midgard/logging.h"
+#include "sif/autocost.h"
+#include "sif/truckcost.h"
+#include "thor/bidirectional_astar.h"
+#include "thor/costmatrix.h"
+#include "thor/edgebatch.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::sif;
+using namespace valhalla::loki;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// A costing that behaves exactly like CostT but is of a different type, so the
+// path algorithms use their generic expansion loops (virtual costing calls).
+template <class CostT> class GenericCost : public CostT {
+public:
+  GenericCost(const Costing costing, const Options& options) : CostT(costing, options) {
+  }
+};
+
+struct Result {
+  double cost = 0.0;
+  double ms = 0.0;
+};
+
+// Route between consecutive locations and compute the matrix of all locations
+// the given number of times, accumulating costs and times
+void Benchmark(baldr::GraphReader& reader,
+               const Options& options,
+               const std::shared_ptr<DynamicCost>& costing,
+               const uint32_t iterations,
+               const float max_matrix_distance,
+               Result& route,
+               Result& matrix) {
+  std::shared_ptr<DynamicCost> mode_costing[static_cast<uint32_t>(TravelMode::kMaxTravelMode)];
+  const TravelMode mode = costing->travel_mode();
+  mode_costing[static_cast<uint32_t>(mode)] = costing;
+
+  BidirectionalAStar bd;
+  CostMatrix costmatrix;
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (int j = 0; j + 1 < options.locations_size(); j++) {
+      Location origin = options.locations(j);
+      Location destination = options.locations(j + 1);
+      auto start = std::chrono::steady_clock::now();
+      const auto paths = bd.GetBestPath(origin, destination, reader, mode_costing, mode, options);
+      auto end = std::chrono::steady_clock::now();
+      bd.Clear();
+      route.ms += std::chrono::duration<double, std::milli>(end - start).count();
+      if (!paths.empty() && !paths.front().empty()) {
+        route.cost += paths.front().back().elapsed_cost;
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const auto times = costmatrix.SourceToTarget(options.locations(), options.locations(), reader,
+                                                 mode_costing, mode, max_matrix_distance);
+    auto end = std::chrono::steady_clock::now();
+    costmatrix.Clear();
+    matrix.ms += std::chrono::duration<double, std::milli>(end - start).count();
+    for (const auto& td : times) {
+      matrix.cost += td.time;
+    }
+  }
+}
+
+// Find the outgoing edges with auto access of every node in the given tiles,
+// one edge at a time or with an EdgeBatch. Returns the number of edges found.
+uint64_t EdgeKernel(baldr::GraphReader& reader,
+                    const std::vector<baldr::GraphId>& tiles,
+                    const bool batched,
+                    double& ms) {
+  uint64_t found = 0;
+  EdgeBatch batch;
+  for (const auto& tile_id : tiles) {
+    const baldr::GraphTile* tile = reader.GetGraphTile(tile_id);
+    if (tile == nullptr) {
+      continue;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < tile->header()->nodecount(); n++) {
+      const baldr::NodeInfo* node = tile->node(n);
+      const baldr::DirectedEdge* edges = tile->directededge(node->edge_index());
+      if (batched) {
+        batch.Evaluate(edges, node->edge_count(), baldr::kAutoAccess, true, tile);
+      }
+      for (uint32_t i = 0; i < node->edge_count(); i++) {
+        const bool candidate = batched ? batch.candidate(i)
+                                       : (edges[i].forwardaccess() & baldr::kAutoAccess) ||
+                                             edges[i].is_shortcut();
+        found += candidate;
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    ms += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+  return found;
+}
+
+void Report(const std::string& name, const Result& result, const uint32_t iterations) {
+  LOG_INFO(name + ": average cost " + std::to_string(result.cost / iterations) + " in " +
+           std::to_string(result.ms / iterations) + " ms");
+}
+
+} // namespace
+
+/**
+ * Benchmark of the expansion loops specialized per costing. Routes between the
+ * locations of a request and computes their matrix with auto and truck costing,
+ * once with the specialized loops and once with the generic loops that call the
+ * costing through its virtual methods. Both must give the same costs. Also times
+ * the evaluation of the outgoing edges of all nodes one at a time and batched.
+ */
+int main(int argc, char* argv[]) {
+  std::string json, config;
+  uint32_t iterations = 10;
+
+  bpo::options_description options(
+      "valhalla " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_benchmark_costing [options] <config>\n"
+      "\n"
+      "valhalla_benchmark_costing compares run times of the routes and matrix between the "
+      "locations of a request using the expansion loops specialized for auto and truck costing "
+      "to the generic expansion loops."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "json,j", bpo::value<std::string>(&json),
+      "Route request with the locations, costing options are used for both costings.")(
+      "iterations,i", bpo::value<uint32_t>(&iterations), "Number of times to run each search.")(
+      "config", bpo::value<std::string>(&config), "Valhalla configuration file");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("config", 1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    bpo::notify(vm);
+
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_costing " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("json") || !vm.count("config") || iterations == 0) {
+    std::cerr << "A configuration file, a request and at least one iteration are required\n";
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config.c_str(), pt);
+  baldr::GraphReader reader(pt.get_child("mjolnir"));
+  loki_worker_t loki(pt);
+  const float max_matrix_distance = pt.get<float>("service_limits.auto.max_distance");
+
+  // Time the per node edge evaluation over all tiles, outside of any search
+  std::vector<baldr::GraphId> tiles;
+  for (const auto& tile_id : reader.GetTileSet()) {
+    tiles.push_back(tile_id);
+  }
+  double single_ms = 0.0, batch_ms = 0.0;
+  uint64_t single_found = 0, batch_found = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    single_found += EdgeKernel(reader, tiles, false, single_ms);
+    batch_found += EdgeKernel(reader, tiles, true, batch_ms);
+  }
+  LOG_INFO("edge evaluation (single): " + std::to_string(single_ms / iterations) + " ms");
+  LOG_INFO("edge evaluation (batched): " + std::to_string(batch_ms / iterations) + " ms");
+  if (single_found != batch_found) {
+    LOG_ERROR("single and batched edge evaluation differ");
+    return EXIT_FAILURE;
+  }
+
+  for (const auto costing : {Costing::auto_, Costing::truck}) {
+    // Correlate the locations for this costing
+    Api request;
+    ParseApi(json, Options::route, request);
+    request.mutable_options()->set_costing(costing);
+    loki.route(request);
+    const auto& opts = request.options();
+
+    std::shared_ptr<DynamicCost> specialized, generic;
+    if (costing == Costing::auto_) {
+      specialized = std::make_shared<AutoCost>(costing, opts);
+      generic = std::make_shared<GenericCost<AutoCost>>(costing, opts);
+    } else {
+      specialized = std::make_shared<TruckCost>(costing, opts);
+      generic = std::make_shared<GenericCost<TruckCost>>(costing, opts);
+    }
+
+    // Run the generic loops first so both runs see the same tile cache
+    Result generic_route, generic_matrix, route, matrix;
+    Benchmark(reader, opts, generic, iterations, max_matrix_distance, generic_route,
+              generic_matrix);
+    Benchmark(reader, opts, specialized, iterations, max_matrix_distance, route, matrix);
+
+    const std::string name = Costing_Enum_Name(costing);
+    Report(name + " route (generic)", generic_route, iterations);
+    Report(name + " route (specialized)", route, iterations);
+    Report(name + " matrix (generic)", generic_matrix, iterations);
+    Report(name + " matrix (specialized)", matrix, iterations);
+    if (route.cost != generic_route.cost || matrix.cost != generic_matrix.cost) {
+      LOG_ERROR(name + ": specialized and generic costs differ");
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
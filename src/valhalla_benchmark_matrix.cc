@@ -0,0 +1,171 @@
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "config.h"
+#include "loki/worker.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "thor/bucketmatrix.h"
+#include "thor/costmatrix.h"
+#include "worker.h"
+
+using namespace valhalla;
+using namespace valhalla::loki;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// Compute the matrix of the sources and targets of a request the given number
+// of times. Returns the times of the last run, adds the run times to ms.
+template <class MatrixT>
+std::vector<TimeDistance> Benchmark(MatrixT& matrix,
+                                    baldr::GraphReader& reader,
+                                    const Options& options,
+                                    const std::shared_ptr<DynamicCost>* mode_costing,
+                                    const TravelMode mode,
+                                    const uint32_t iterations,
+                                    const float max_matrix_distance,
+                                    double& ms) {
+  std::vector<TimeDistance> times;
+  for (uint32_t i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    times = matrix.SourceToTarget(options.sources(), options.targets(), reader, mode_costing, mode,
+                                  max_matrix_distance);
+    auto end = std::chrono::steady_clock::now();
+    matrix.Clear();
+    ms += std::chrono::duration<double, std::milli>(end - start).count();
+  }
+  return times;
+}
+
+} // namespace
+
+/**
+ * Benchmark of the bucket matrix. Computes the matrix of a request with
+ * CostMatrix and with BucketMatrix, reports their run times and how many pairs
+ * differ. Fails if BucketMatrix misses a pair CostMatrix connects.
+ */
+int main(int argc, char* argv[]) {
+  std::string json, config;
+  uint32_t iterations = 5;
+  uint32_t max_labels = kDefaultMaxBucketLabels;
+
+  bpo::options_description options(
+      "valhalla " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_benchmark_matrix [options] <config>\n"
+      "\n"
+      "valhalla_benchmark_matrix compares the run times and results of the cost matrix and "
+      "the bucket matrix for the sources and targets of a matrix request."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "json,j", bpo::value<std::string>(&json), "Matrix request with the sources and targets.")(
+      "iterations,i", bpo::value<uint32_t>(&iterations), "Number of times to compute each matrix.")(
+      "max-labels,m", bpo::value<uint32_t>(&max_labels),
+      "Maximum number of edge labels of each backward search of the bucket matrix.")(
+      "config", bpo::value<std::string>(&config), "Valhalla configuration file");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("config", 1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(),
+               vm);
+    bpo::notify(vm);
+
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_matrix " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("json") || !vm.count("config") || iterations == 0) {
+    std::cerr << "A configuration file, a request and at least one iteration are required\n";
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree pt;
+  rapidjson::read_json(config.c_str(), pt);
+  baldr::GraphReader reader(pt.get_child("mjolnir"));
+  loki_worker_t loki(pt);
+
+  // Correlate the sources and targets
+  Api request;
+  ParseApi(json, Options::sources_to_targets, request);
+  loki.matrix(request);
+  const auto& opts = request.options();
+  const std::string costing_name = Costing_Enum_Name(opts.costing());
+  const float max_matrix_distance =
+      pt.get<float>("service_limits." + costing_name + ".max_matrix_distance");
+
+  CostFactory<DynamicCost> factory;
+  factory.RegisterStandardCostingModels();
+  std::shared_ptr<DynamicCost> mode_costing[static_cast<uint32_t>(TravelMode::kMaxTravelMode)];
+  auto costing = factory.Create(opts.costing(), opts);
+  const TravelMode mode = costing->travel_mode();
+  mode_costing[static_cast<uint32_t>(mode)] = costing;
+
+  // Run the cost matrix first so both matrices see the same tile cache
+  double cost_ms = 0.0, bucket_ms = 0.0;
+  CostMatrix costmatrix;
+  BucketMatrix bucketmatrix;
+  bucketmatrix.set_max_bucket_labels(max_labels);
+  const auto expected = Benchmark(costmatrix, reader, opts, mode_costing, mode, iterations,
+                                  max_matrix_distance, cost_ms);
+  const auto times = Benchmark(bucketmatrix, reader, opts, mode_costing, mode, iterations,
+                               max_matrix_distance, bucket_ms);
+
+  LOG_INFO(std::to_string(opts.sources_size()) + "x" + std::to_string(opts.targets_size()) + " " +
+           costing_name + " matrix");
+  LOG_INFO("cost matrix: " + std::to_string(cost_ms / iterations) + " ms");
+  LOG_INFO("bucket matrix: " + std::to_string(bucket_ms / iterations) + " ms (" +
+           std::to_string(cost_ms / std::max(bucket_ms, 1e-3)) + "x)");
+
+  // The searches meet on different edges so costs may differ slightly
+  uint32_t differ = 0, missing = 0;
+  uint32_t max_difference = 0;
+  for (size_t i = 0; i < expected.size(); i++) {
+    const uint32_t difference = std::abs(static_cast<int64_t>(times[i].time) - expected[i].time);
+    if (difference > 0) {
+      differ++;
+      max_difference = std::max(max_difference, difference);
+    }
+    if (times[i].time == static_cast<uint32_t>(std::round(kMaxCost)) &&
+        expected[i].time != times[i].time) {
+      missing++;
+    }
+  }
+  LOG_INFO(std::to_string(differ) + " of " + std::to_string(expected.size()) +
+           " pairs differ, by at most " + std::to_string(max_difference) + " seconds");
+  if (missing > 0) {
+    LOG_ERROR(std::to_string(missing) + " pairs are not connected by the bucket matrix");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
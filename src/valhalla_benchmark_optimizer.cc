@@ -0,0 +1,161 @@
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "midgard/logging.h"
+#include "thor/optimizer.h"
+
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// Create a random asymmetric cost matrix: distances between random points
+// scaled by a random factor per direction (like one way streets and turns).
+std::vector<float> RandomCosts(const uint32_t count, std::mt19937& gen) {
+  std::uniform_real_distribution<float> coord(0.0f, 10000.0f);
+  std::uniform_real_distribution<float> factor(1.0f, 1.5f);
+  std::vector<float> x(count), y(count);
+  for (uint32_t i = 0; i < count; i++) {
+    x[i] = coord(gen);
+    y[i] = coord(gen);
+  }
+  std::vector<float> costs(count * count, 0.0f);
+  for (uint32_t i = 0; i < count; i++) {
+    for (uint32_t j = 0; j < count; j++) {
+      if (i != j) {
+        costs[i * count + j] = std::hypot(x[i] - x[j], y[i] - y[j]) * factor(gen);
+      }
+    }
+  }
+  return costs;
+}
+
+// Read a square cost matrix (whitespace separated, row by row) from a file,
+// for example the times of a matrix request.
+std::vector<float> ReadCosts(const std::string& file, uint32_t& count) {
+  std::ifstream in(file);
+  std::vector<float> costs;
+  float cost;
+  while (in >> cost) {
+    costs.push_back(cost);
+  }
+  count = static_cast<uint32_t>(std::sqrt(static_cast<double>(costs.size())) + 0.5);
+  if (count * count != costs.size() || count < 2) {
+    throw std::runtime_error("Cost matrix in " + file + " is not square");
+  }
+  return costs;
+}
+
+struct Result {
+  double cost = 0.0;
+  double ms = 0.0;
+};
+
+// Solve with both solvers and accumulate costs and times
+void Benchmark(const uint32_t count,
+               const std::vector<float>& costs,
+               const uint32_t concurrency,
+               Result& local_search,
+               Result& annealing) {
+  Optimizer optimizer;
+  optimizer.set_threads(concurrency);
+  auto start = std::chrono::steady_clock::now();
+  auto tour = optimizer.Solve(count, costs);
+  auto end = std::chrono::steady_clock::now();
+  local_search.cost += Optimizer::TourCost(count, costs, tour);
+  local_search.ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+  Optimizer annealer;
+  start = std::chrono::steady_clock::now();
+  tour = annealer.SolveAnnealing(count, costs);
+  end = std::chrono::steady_clock::now();
+  annealing.cost += Optimizer::TourCost(count, costs, tour);
+  annealing.ms += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+} // namespace
+
+/**
+ * Benchmark of the optimizer used by optimized_route. Compares tour costs and
+ * run times of the local search solver to the simulated annealing solver on
+ * random cost matrices or on a cost matrix read from a file.
+ */
+int main(int argc, char* argv[]) {
+  uint32_t count = 100;
+  uint32_t iterations = 10;
+  uint32_t concurrency = 1;
+  std::string matrix_file;
+
+  bpo::options_description options(
+      "valhalla " VALHALLA_VERSION "\n"
+      "\n"
+      " Usage: valhalla_benchmark_optimizer [options]\n"
+      "\n"
+      "valhalla_benchmark_optimizer compares tour costs and run times of the optimized route "
+      "solver to the former simulated annealing solver."
+      "\n"
+      "\n");
+
+  options.add_options()("help,h", "Print this help message.")("version,v",
+                                                              "Print the version of this software.")(
+      "locations,n", bpo::value<uint32_t>(&count), "Number of locations of random matrices.")(
+      "iterations,i", bpo::value<uint32_t>(&iterations), "Number of random matrices.")(
+      "concurrency,j", bpo::value<uint32_t>(&concurrency),
+      "Number of threads running the restarts of the solver.")(
+      "matrix,m", bpo::value<std::string>(&matrix_file),
+      "File with a square cost matrix (whitespace separated, row by row) to use instead of "
+      "random matrices.");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception& e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n"
+              << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_optimizer " << VALHALLA_VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  Result local_search, annealing;
+  if (vm.count("matrix")) {
+    auto costs = ReadCosts(matrix_file, count);
+    iterations = 1;
+    Benchmark(count, costs, concurrency, local_search, annealing);
+  } else {
+    if (count < 2) {
+      std::cerr << "At least 2 locations are required\n";
+      return EXIT_FAILURE;
+    }
+    std::mt19937 gen(count);
+    for (uint32_t i = 0; i < iterations; i++) {
+      Benchmark(count, RandomCosts(count, gen), concurrency, local_search, annealing);
+    }
+  }
+
+  LOG_INFO(std::to_string(iterations) + " matrices of " + std::to_string(count) + " locations");
+  LOG_INFO("Local search: average cost " + std::to_string(local_search.cost / iterations) +
+           " in " + std::to_string(local_search.ms / iterations) + " ms");
+  LOG_INFO("Annealing: average cost " + std::to_string(annealing.cost / iterations) + " in " +
+           std::to_string(annealing.ms / iterations) + " ms");
+  return EXIT_SUCCESS;
+}
@@ -238,11 +238,9 @@ int main(int argc, char* argv[]) {
   int32_t max_row = 0;
   int32_t min_col = isotile->ncolumns();
   int32_t max_col = 0;
-  const auto& iso_data = isotile->data();
   for (int32_t row = 0; row < isotile->nrows(); row++) {
     for (int32_t col = 0; col < isotile->ncolumns(); col++) {
-      int id = isotile->TileId(col, row);
-      if (iso_data[id] < max_minutes + 5) {
+      if (isotile->Get(col, row) < max_minutes + 5) {
         min_row = std::min(row, min_row);
         max_row = std::max(row, max_row);
         min_col = std::min(col, min_col);
@@ -252,7 +250,8 @@ int main(int argc, char* argv[]) {
     }
   }
   LOG_INFO("Marked " + std::to_string(nv) + " cells in the isotile" +
-           " size= " + std::to_string(iso_data.size()));
+           " size= " + std::to_string(isotile->nrows() * isotile->ncolumns()) +
+           " allocated= " + std::to_string(isotile->allocated()));
   LOG_INFO("Rows = " + std::to_string(isotile->nrows()) + " min = " + std::to_string(min_row) +
            " max = " + std::to_string(max_row));
   LOG_INFO("Cols = " + std::to_string(isotile->ncolumns()) + " min = " + std::to_string(min_col) +
@@ -198,7 +198,8 @@ int main(int argc, char* argv[]) {
     // Skip over any service limits that are not for a costing method
     if (kv.first == "max_avoid_locations" || kv.first == "max_reachability" ||
         kv.first == "max_radius" || kv.first == "max_timedep_distance" || kv.first == "skadi" ||
-        kv.first == "trace" || kv.first == "isochrone") {
+        kv.first == "trace" || kv.first == "isochrone" || kv.first == "max_timeout" ||
+        kv.first == "max_search_memory") {
       continue;
     }
     max_matrix_distance.emplace(kv.first,
@@ -587,7 +587,8 @@ int main(int argc, char* argv[]) {
 
   auto t0 = std::chrono::high_resolution_clock::now();
 
-  // Construct costing
+  // Construct costing, memoizing edge costs if enabled so runs can be compared
+  CostCache::GetInstance().set_edge_cost_memo(pt.get<bool>("thor.edge_cost_memo", false));
   CostFactory<DynamicCost> factory;
   factory.RegisterStandardCostingModels();
   // Get the costing method - pass the JSON configuration
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <unordered_map>
@@ -88,18 +89,18 @@ const std::unordered_map<unsigned, std::string> HTTP_STATUS_CODES{
 const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
     {100, 400}, {101, 405}, {106, 404}, {107, 501},
 
-    {110, 400}, {111, 400}, {112, 400}, {113, 400}, {114, 400},
+    {110, 400}, {111, 400}, {112, 400}, {113, 400}, {114, 400}, {115, 400},
 
     {120, 400}, {121, 400}, {122, 400}, {123, 400}, {124, 400}, {125, 400}, {126, 400},
 
-    {130, 400}, {131, 400}, {132, 400}, {133, 400}, {136, 400},
+    {130, 400}, {131, 400}, {132, 400}, {133, 400}, {136, 400}, {137, 400}, {138, 400},
 
     {140, 400}, {141, 501}, {142, 501},
 
     {150, 400}, {151, 400}, {152, 400}, {153, 400}, {154, 400}, {155, 400}, {156, 400},
     {157, 400}, {158, 400}, {159, 400},
 
-    {160, 400}, {161, 400}, {162, 400}, {163, 400}, {164, 400},
+    {160, 400}, {161, 400}, {162, 400}, {163, 400}, {164, 400}, {165, 400},
 
     {170, 400}, {171, 400}, {172, 400},
 
@@ -127,7 +128,8 @@ const std::unordered_map<unsigned, unsigned> ERROR_TO_STATUS{
 
     {430, 400},
 
-    {440, 400}, {441, 400}, {442, 400}, {443, 400}, {444, 400}, {445, 400},
+    {440, 400}, {441, 400}, {442, 400}, {443, 400}, {444, 400}, {445, 400}, {446, 504},
+    {447, 400}, {448, 503},
 
     {499, 400},
 
@@ -147,6 +149,7 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
     {112, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
     {113, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
     {114, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
+    {115, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
 
     {120, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
     {121, R"({"code":"InvalidOptions","message":"Options are invalid."})"},
@@ -170,6 +173,10 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
     {136,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {137,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+    {138,
+     R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
 
     {140,
      R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
@@ -268,6 +275,12 @@ const std::unordered_map<unsigned, std::string> OSRM_ERRORS_CODES{
     {444,
      R"({"code":"NoSegment","message":"One of the supplied input coordinates could not snap to street segment."})"},
     {445, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
+    // OSRM has no equivalent message for this case so we return our own
+    {446, R"({"code":"Timeout","message":"Request exceeded its timeout."})"},
+    {447,
+     R"({"code":"TooBig","message":"The request size violates one of the service specific request size restrictions."})"},
+    // OSRM has no equivalent message for this case so we return our own
+    {448, R"({"code":"Overloaded","message":"Not enough memory left to compute the request."})"},
 
     {499, R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
 
@@ -508,6 +521,77 @@ void parse_contours(const rapidjson::Document& doc,
   }
 }
 
+// Get a [start, end] time window in seconds. Throws if it is not a pair of increasing times.
+bool parse_time_window(const rapidjson::Value& value, uint32_t& start, uint32_t& end) {
+  auto time_window = rapidjson::get_optional<rapidjson::Value::ConstArray>(value, "/time_window");
+  if (!time_window) {
+    return false;
+  }
+  if (time_window->Size() != 2 || !(*time_window)[0].IsUint() || !(*time_window)[1].IsUint() ||
+      (*time_window)[0].GetUint() > (*time_window)[1].GetUint()) {
+    throw std::runtime_error("time_window must be [start, end] in seconds");
+  }
+  start = (*time_window)[0].GetUint();
+  end = (*time_window)[1].GetUint();
+  return true;
+}
+
+void parse_vehicles_and_jobs(const rapidjson::Document& doc, Options& options) {
+  // vehicles and jobs refer to locations by index
+  auto location_index = [&options](const rapidjson::Value& value, const char* key) {
+    auto index = rapidjson::get_optional<unsigned int>(value, key);
+    if (!index || *index >= static_cast<unsigned int>(options.locations_size())) {
+      throw std::runtime_error(std::string(key + 1) + " is not the index of a location");
+    }
+    return *index;
+  };
+
+  auto vehicles = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/vehicles");
+  if (vehicles) {
+    for (const auto& r_vehicle : *vehicles) {
+      try {
+        auto* vehicle = options.add_vehicles();
+        vehicle->set_start(location_index(r_vehicle, "/start"));
+        if (rapidjson::get_child_optional(r_vehicle, "/end")) {
+          vehicle->set_end(location_index(r_vehicle, "/end"));
+        }
+        auto capacity = rapidjson::get_optional<unsigned int>(r_vehicle, "/capacity");
+        if (capacity) {
+          vehicle->set_capacity(*capacity);
+        }
+        uint32_t start, end;
+        if (parse_time_window(r_vehicle, start, end)) {
+          vehicle->set_time_window_start(start);
+          vehicle->set_time_window_end(end);
+        }
+      } catch (...) { throw valhalla_exception_t{137}; }
+    }
+  }
+
+  auto jobs = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/jobs");
+  if (jobs) {
+    for (const auto& r_job : *jobs) {
+      try {
+        auto* job = options.add_jobs();
+        job->set_location(location_index(r_job, "/location"));
+        auto demand = rapidjson::get_optional<unsigned int>(r_job, "/demand");
+        if (demand) {
+          job->set_demand(*demand);
+        }
+        auto service = rapidjson::get_optional<unsigned int>(r_job, "/service");
+        if (service) {
+          job->set_service(*service);
+        }
+        uint32_t start, end;
+        if (parse_time_window(r_job, start, end)) {
+          job->set_time_window_start(start);
+          job->set_time_window_end(end);
+        }
+      } catch (...) { throw valhalla_exception_t{138}; }
+    }
+  }
+}
+
 void from_json(rapidjson::Document& doc, Options& options) {
   bool track = !options.has_do_not_track() || !options.do_not_track();
 
@@ -529,6 +613,11 @@ void from_json(rapidjson::Document& doc, Options& options) {
   auto fmt = rapidjson::get_optional<std::string>(doc, "/format");
   Options::Format format;
   if (fmt && Options_Format_Enum_Parse(*fmt, &format)) {
+    // only the matrix and the batch isochrones are serialized line by line
+    if (format == Options::jsonl && options.action() != Options::sources_to_targets &&
+        options.action() != Options::batch_isochrone) {
+      throw valhalla_exception_t{165, "'" + *fmt + "'"};
+    }
     options.set_format(format);
   }
 
@@ -542,6 +631,8 @@ void from_json(rapidjson::Document& doc, Options& options) {
     options.set_jsonp(*jsonp);
   }
 
+  options.set_search_stats(rapidjson::get(doc, "/search_stats", false));
+
   auto units = rapidjson::get_optional<std::string>(doc, "/units");
   if (units) {
     if ((*units == "miles") || (*units == "mi")) {
@@ -789,6 +880,9 @@ void from_json(rapidjson::Document& doc, Options& options) {
   // get the avoids in there
   parse_locations(doc, options, "avoid_locations", 133, track);
 
+  // get the vehicles and jobs in there
+  parse_vehicles_and_jobs(doc, options);
+
   // if not a time dependent route/mapmatch disable time dependent edge speed/flow data sources
   // TODO: this is because bidirectional a* defaults to middle of the day time for speed lookup
   if (!options.has_date_time_type() && (options.shape_size() == 0 || options.shape(0).time() == -1)) {
@@ -901,6 +995,20 @@ void from_json(rapidjson::Document& doc, Options& options) {
   if (options.locations_size() > 2)
     options.set_alternates(0);
 
+  // if specified, get the seconds the request may take, loki turns them into a deadline
+  auto timeout = rapidjson::get_optional<float>(doc, "/timeout");
+  if (timeout && *timeout > 0.f) {
+    options.set_timeout(static_cast<uint32_t>(*timeout * 1000.f + .5f));
+  }
+
+  // if specified, get the algorithm used for multimodal and transit routes
+  auto transit_algorithm_str = rapidjson::get_optional<std::string>(doc, "/transit_algorithm");
+  Options::TransitAlgorithm transit_algorithm;
+  if (transit_algorithm_str &&
+      valhalla::Options_TransitAlgorithm_Enum_Parse(*transit_algorithm_str, &transit_algorithm)) {
+    options.set_transit_algorithm(transit_algorithm);
+  }
+
   // force these into the output so its obvious what we did to the user
   doc.AddMember({"language", allocator}, {options.language(), allocator}, allocator);
   doc.AddMember({"format", allocator},
@@ -917,7 +1025,9 @@ bool Options_Action_Enum_Parse(const std::string& action, Options::Action* a) {
       {"locate", Options::locate},
       {"sources_to_targets", Options::sources_to_targets},
       {"optimized_route", Options::optimized_route},
+      {"optimized_routes", Options::optimized_routes},
       {"isochrone", Options::isochrone},
+      {"batch_isochrone", Options::batch_isochrone},
       {"trace_route", Options::trace_route},
       {"trace_attributes", Options::trace_attributes},
       {"height", Options::height},
@@ -938,7 +1048,9 @@ const std::string& Options_Action_Enum_Name(const Options::Action action) {
       {Options::locate, "locate"},
       {Options::sources_to_targets, "sources_to_targets"},
       {Options::optimized_route, "optimized_route"},
+      {Options::optimized_routes, "optimized_routes"},
       {Options::isochrone, "isochrone"},
+      {Options::batch_isochrone, "batch_isochrone"},
       {Options::trace_route, "trace_route"},
       {Options::trace_attributes, "trace_attributes"},
       {Options::height, "height"},
@@ -1022,6 +1134,7 @@ bool Options_Format_Enum_Parse(const std::string& format, Options::Format* f) {
       {"json", Options::json},
       {"gpx", Options::gpx},
       {"osrm", Options::osrm},
+      {"jsonl", Options::jsonl},
   };
   auto i = formats.find(format);
   if (i == formats.cend())
@@ -1036,6 +1149,7 @@ const std::string& Options_Format_Enum_Name(const Options::Format match) {
       {Options::json, "json"},
       {Options::gpx, "gpx"},
       {Options::osrm, "osrm"},
+      {Options::jsonl, "jsonl"},
   };
   auto i = formats.find(match);
   return i == formats.cend() ? empty : i->second;
@@ -1086,6 +1200,19 @@ bool DirectionsType_Enum_Parse(const std::string& dtype, DirectionsType* t) {
   return true;
 }
 
+bool Options_TransitAlgorithm_Enum_Parse(const std::string& algorithm,
+                                         Options::TransitAlgorithm* a) {
+  static const std::unordered_map<std::string, Options::TransitAlgorithm> algorithms{
+      {"time_dependent", Options::time_dependent},
+      {"connection_scan", Options::connection_scan},
+  };
+  auto i = algorithms.find(algorithm);
+  if (i == algorithms.cend())
+    return false;
+  *a = i->second;
+  return true;
+}
+
 bool PreferredSide_Enum_Parse(const std::string& pside, valhalla::Location::PreferredSide* p) {
   static const std::unordered_map<std::string, valhalla::Location::PreferredSide> types{
       {"either", valhalla::Location::either},
@@ -1187,8 +1314,39 @@ const headers_t::value_type JSON_MIME{"Content-type", "application/json;charset=
 const headers_t::value_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 const headers_t::value_type XML_MIME{"Content-type", "text/xml;charset=utf-8"};
 const headers_t::value_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+const headers_t::value_type JSONL_MIME{"Content-type", "application/x-ndjson;charset=utf-8"};
 const headers_t::value_type ATTACHMENT{"Content-Disposition", "attachment; filename=route.gpx"};
 
+namespace {
+// Add the counters of the searches of the request as a header if it asked for them, errors carry
+// those gathered before failing (e.g. when the request ran out of time or memory)
+headers_t with_stats(headers_t headers, const Api& request) {
+  if (request.has_stats()) {
+    const auto& stats = request.stats();
+    auto json = baldr::json::map({
+        {"edges_settled", static_cast<uint64_t>(stats.edges_settled())},
+        {"labels_created", static_cast<uint64_t>(stats.labels_created())},
+        {"queue_decreases", static_cast<uint64_t>(stats.queue_decreases())},
+        {"transitions", static_cast<uint64_t>(stats.transitions())},
+        {"tile_lookups", static_cast<uint64_t>(stats.tile_lookups())},
+        {"tile_cache_misses", static_cast<uint64_t>(stats.tile_cache_misses())},
+        {"search_ms", baldr::json::fp_t{stats.search_ms(), 3}},
+        {"contour_ms", baldr::json::fp_t{stats.contour_ms(), 3}},
+        {"peak_search_bytes", static_cast<uint64_t>(stats.peak_search_bytes())},
+    });
+    if (stats.has_route_cache_hits()) {
+      json->emplace("route_cache_hits", static_cast<uint64_t>(stats.route_cache_hits()));
+      json->emplace("route_cache_misses", static_cast<uint64_t>(stats.route_cache_misses()));
+    }
+    std::ostringstream stream;
+    stream << *json;
+    headers.emplace("X-Search-Stats", stream.str());
+    headers.emplace("Access-Control-Expose-Headers", "X-Search-Stats");
+  }
+  return headers;
+}
+} // namespace
+
 worker_t::result_t jsonify_error(const valhalla_exception_t& exception,
                                  http_request_info_t& request_info,
                                  const Api& request) {
@@ -1217,7 +1375,8 @@ worker_t::result_t jsonify_error(const valhalla_exception_t& exception,
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
   http_response_t response(exception.http_code, exception.http_message, body.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME});
+                           with_stats({CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME},
+                                      request));
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
 
@@ -1239,7 +1398,8 @@ worker_t::result_t to_response(const baldr::json::ArrayPtr& array,
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
   http_response_t response(200, "OK", stream.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME});
+                           with_stats({CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME},
+                                      request));
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
   return result;
@@ -1259,7 +1419,8 @@ to_response(const baldr::json::MapPtr& map, http_request_info_t& request_info, c
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
   http_response_t response(200, "OK", stream.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME});
+                           with_stats({CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME},
+                                      request));
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
   return result;
@@ -1279,16 +1440,28 @@ to_response_json(const std::string& json, http_request_info_t& request_info, con
 
   worker_t::result_t result{false, std::list<std::string>(), ""};
   http_response_t response(200, "OK", stream.str(),
-                           headers_t{CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME});
+                           with_stats({CORS, request.options().has_jsonp() ? JS_MIME : JSON_MIME},
+                                      request));
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
   return result;
 }
 
-worker_t::result_t
-to_response_xml(const std::string& xml, http_request_info_t& request_info, const Api&) {
+worker_t::result_t to_response_xml(const std::string& xml,
+                                   http_request_info_t& request_info,
+                                   const Api& request) {
+  worker_t::result_t result{false, std::list<std::string>(), ""};
+  http_response_t response(200, "OK", xml, with_stats({CORS, GPX_MIME, ATTACHMENT}, request));
+  response.from_info(request_info);
+  result.messages.emplace_back(response.to_string());
+  return result;
+}
+
+worker_t::result_t to_response_jsonl(const std::string& jsonl,
+                                     http_request_info_t& request_info,
+                                     const Api& request) {
   worker_t::result_t result{false, std::list<std::string>(), ""};
-  http_response_t response(200, "OK", xml, headers_t{CORS, GPX_MIME, ATTACHMENT});
+  http_response_t response(200, "OK", jsonl, with_stats({CORS, JSONL_MIME}, request));
   response.from_info(request_info);
   result.messages.emplace_back(response.to_string());
   return result;
@@ -1296,12 +1469,44 @@ to_response_xml(const std::string& xml, http_request_info_t& request_info, const
 
 #endif
 
-service_worker_t::service_worker_t() : interrupt(nullptr) {
+service_worker_t::service_worker_t()
+    : interrupt(nullptr), caller_interrupt(nullptr), thread_interrupt(nullptr) {
 }
 service_worker_t::~service_worker_t() {
 }
 void service_worker_t::set_interrupt(const std::function<void()>& interrupt_function) {
-  interrupt = &interrupt_function;
+  interrupt = caller_interrupt = &interrupt_function;
+  thread_interrupt = nullptr;
+}
+void service_worker_t::set_deadline(const Api& request) {
+  interrupt = caller_interrupt;
+  thread_interrupt = nullptr;
+  if (!request.options().has_deadline()) {
+    return;
+  }
+
+  // the deadline is wall clock time so that it means the same in every process of the pipeline
+  const auto* check_interrupt = caller_interrupt;
+  const uint64_t timeout = request.options().timeout();
+  const uint64_t deadline = request.options().deadline();
+  deadline_check = [timeout, deadline]() {
+    uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    if (now > deadline) {
+      throw valhalla_exception_t{446, "gave up after " + std::to_string(now + timeout - deadline) +
+                                          " ms of a " + std::to_string(timeout) + " ms timeout"};
+    }
+  };
+  deadline_interrupt = [check_interrupt, this]() {
+    if (check_interrupt && *check_interrupt) {
+      (*check_interrupt)();
+    }
+    deadline_check();
+  };
+  interrupt = &deadline_interrupt;
+  thread_interrupt = &deadline_check;
+  deadline_check();
 }
 
 } // namespace valhalla
@@ -1,11 +1,14 @@
 #include "test.h"
 
+#include <chrono>
 #include <stdexcept>
+#include <thread>
 
 #include "baldr/rapidjson_utils.h"
 #include <boost/property_tree/ptree.hpp>
 
 #include "tyr/actor.h"
+#include "worker.h"
 
 #if !defined(VALHALLA_SOURCE_DIR)
 #define VALHALLA_SOURCE_DIR
@@ -118,6 +121,31 @@ void test_interrupt() {
   // TODO: test the rest of them
 }
 
+void test_deadline() {
+  auto conf = make_conf();
+  tyr::actor_t actor(conf);
+  // Each call of the interrupt outlasts the shortest timeout
+  auto slow_interrupt = []() -> void { std::this_thread::sleep_for(std::chrono::milliseconds(5)); };
+
+  try {
+    actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+        {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto","timeout":0.001})",
+                slow_interrupt);
+    throw std::logic_error("this should have timed out already");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 446 || e.http_code != 504) {
+      throw std::logic_error("Expected a timeout error but got " + std::to_string(e.code));
+    }
+  }
+  actor.cleanup();
+
+  // Requests finishing in time are not affected
+  actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+      {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto","timeout":60})",
+              slow_interrupt);
+  actor.cleanup();
+}
+
 } // namespace
 
 int main() {
@@ -127,5 +155,7 @@ int main() {
 
   suite.test(TEST_CASE(test_interrupt));
 
+  suite.test(TEST_CASE(test_deadline));
+
   return suite.tear_down();
 }
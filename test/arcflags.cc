@@ -0,0 +1,332 @@
+#include "test.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/pointll.h"
+#include "mjolnir/arcflagsbuilder.h"
+#include "mjolnir/directededgebuilder.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "sif/autocost.h"
+#include "thor/astar.h"
+#include "thor/bidirectional_astar.h"
+#include "tyr/actor.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+const std::string kSourceDir = "test/data/utrecht_tiles";
+const std::string kTileDir = "test/data/utrecht_arcflags_tiles";
+
+boost::property_tree::ptree get_conf(const bool arc_flags) {
+  std::stringstream ss;
+  ss << R"({
+      "mjolnir":{"tile_dir":")"
+     << kTileDir << R"(", "concurrency": 1, "arc_flag_regions": 8},
+      "loki":{
+        "actions":["route"],
+        "logging":{"long_request": 100},
+        "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "heading_tolerance": 60}
+      },
+      "thor":{"logging":{"long_request": 110}, "arc_flags": )"
+     << (arc_flags ? "true" : "false") << R"(},
+      "odin":{"logging":{"long_request": 110}},
+      "skadi":{"actons":["height"],"logging":{"long_request": 5}},
+      "meili":{"customizable": ["turn_penalty_factor","max_route_distance_factor","max_route_time_factor","search_radius"],
+              "mode":"auto","grid":{"cache_size":100240,"size":500},
+              "default":{"beta":3,"breakage_distance":2000,"geometry":false,"gps_accuracy":5.0,"interpolation_distance":10,
+              "max_route_distance_factor":5,"max_route_time_factor":5,"max_search_radius":200,"route":true,
+              "search_radius":15.0,"sigma_z":4.07,"turn_penalty_factor":200}},
+      "service_limits": {
+        "auto": {"max_distance": 5000000.0, "max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "auto_shorter": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "bicycle": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+        "bus": {"max_distance": 5000000.0,"max_locations": 50,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "hov": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 1,"max_time": 120},
+        "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,"max_alternates":2,
+        "multimodal": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 0.0,"max_matrix_locations": 0},
+        "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
+        "skadi": {"max_shape": 750000,"min_resample": 10.0},
+        "trace": {"max_distance": 200000.0,"max_gps_accuracy": 100.0,"max_search_radius": 100,"max_shape": 16000,"max_best_paths":4,"max_best_paths_shape":100},
+        "transit": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+        "truck": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50}
+      }
+    })";
+  boost::property_tree::ptree conf;
+  rapidjson::read_json(ss, conf);
+  return conf;
+}
+
+// Copy the test tiles so adding the flags does not change the tiles of the other tests
+void copy_tiles(const boost::filesystem::path& from, const boost::filesystem::path& to) {
+  boost::filesystem::create_directories(to);
+  for (const auto& entry : boost::filesystem::directory_iterator(from)) {
+    const auto target = to / entry.path().filename();
+    if (boost::filesystem::is_directory(entry.status())) {
+      copy_tiles(entry.path(), target);
+    } else {
+      boost::filesystem::copy_file(entry.path(), target,
+                                   boost::filesystem::copy_option::overwrite_if_exists);
+    }
+  }
+}
+
+void BuildArcFlags() {
+  if (boost::filesystem::exists(kTileDir)) {
+    boost::filesystem::remove_all(kTileDir);
+  }
+  copy_tiles(kSourceDir, kTileDir);
+  auto conf = get_conf(true);
+  mjolnir::ArcFlagsBuilder::Build(conf);
+
+  // The arterial and highway edges must not all lie on shortest paths to every region
+  GraphReader reader(conf.get_child("mjolnir"));
+  size_t pruned = 0;
+  for (const auto& id : reader.GetTileSet(1)) {
+    const GraphTile* tile = reader.GetGraphTile(id);
+    if (!tile->has_arcflags()) {
+      throw std::logic_error("Level 1 tile " + std::to_string(id) + " has no arc flags");
+    }
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      pruned += tile->arcflags(i) != kAllArcFlags;
+    }
+  }
+  if (pruned == 0) {
+    throw std::logic_error("No edge can be pruned by the arc flags");
+  }
+}
+
+std::string route(tyr::actor_t& actor, const std::string& request) {
+  try {
+    return actor.route(request);
+  } catch (const std::exception& e) { return e.what(); }
+}
+
+void TestPrunedEqualsUnpruned() {
+  tyr::actor_t pruned(get_conf(true), true);
+  tyr::actor_t unpruned(get_conf(false), true);
+
+  // Short routes within a region and longer ones across regions (run bidirectionally)
+  const std::vector<std::string> locations = {
+      R"({"lat":52.09620,"lon":5.11520})", R"({"lat":52.09410,"lon":5.10929})",
+      R"({"lat":52.07850,"lon":5.11540})", R"({"lat":52.11460,"lon":5.05290})",
+      R"({"lat":52.06325,"lon":5.12770})", R"({"lat":52.12480,"lon":5.14130})",
+      R"({"lat":52.08450,"lon":5.17900})", R"({"lat":52.05260,"lon":5.06850})",
+  };
+  size_t routes = 0;
+  for (const auto& from : locations) {
+    for (const auto& to : locations) {
+      if (from == to) {
+        continue;
+      }
+      const std::string request =
+          R"({"locations":[)" + from + "," + to + R"(],"costing":"auto"})";
+      const auto expected = route(unpruned, request);
+      const auto got = route(pruned, request);
+      if (got != expected) {
+        throw std::logic_error("Pruned route differs for " + request + ":\n" + got +
+                               "\nexpected:\n" + expected);
+      }
+      routes += expected.find("\"trip\"") != std::string::npos;
+      pruned.cleanup();
+      unpruned.cleanup();
+    }
+  }
+  if (routes == 0) {
+    throw std::logic_error("No route was found");
+  }
+}
+
+// A level 1 tile where the turn costs change the shortest path. The two routes from p to q
+// are split into two regions with the destination beyond q:
+//
+//            x
+//  s---p----/ \---q---r---t1---t2---t3---t4---t5
+//       \---y---/
+//
+// p-x-q is a little shorter than p-y-q but the turn at x onto x-q is expensive, so with turn
+// costs the best route runs over y. Flags from shortest paths that ignore the turn costs do
+// not flag p-y for the eastern region.
+const std::string kTurnTileDir = "test/data/arcflags_turn_tiles";
+const GraphId kTurnTileId = TileHierarchy::GetGraphId({0.5, 0.5}, 1);
+enum TurnNode : uint32_t { s, p, x, y, q, r, t1, t2, t3, t4, t5 };
+const std::vector<PointLL> kTurnNodes = {{0.05, 0.50}, {0.15, 0.50}, {0.25, 0.50}, {0.25, 0.49},
+                                         {0.35, 0.50}, {0.55, 0.50}, {0.62, 0.50}, {0.69, 0.50},
+                                         {0.76, 0.50}, {0.83, 0.50}, {0.90, 0.50}};
+const std::vector<std::pair<uint32_t, uint32_t>> kTurnRoads = {{s, p},   {p, x},   {p, y},
+                                                               {x, q},   {y, q},   {q, r},
+                                                               {r, t1},  {t1, t2}, {t2, t3},
+                                                               {t3, t4}, {t4, t5}};
+
+// Nodes adjacent to each node, in the order of their edges
+std::vector<std::vector<uint32_t>> turn_adjacency() {
+  std::vector<std::vector<uint32_t>> adjacent(kTurnNodes.size());
+  for (const auto& road : kTurnRoads) {
+    adjacent[road.first].push_back(road.second);
+    adjacent[road.second].push_back(road.first);
+  }
+  return adjacent;
+}
+
+uint32_t local_index(const std::vector<uint32_t>& adjacent, const uint32_t node) {
+  return std::find(adjacent.begin(), adjacent.end(), node) - adjacent.begin();
+}
+
+GraphId turn_edge(const uint32_t from, const uint32_t to) {
+  const auto adjacent = turn_adjacency();
+  uint32_t index = 0;
+  for (uint32_t n = 0; n < from; ++n) {
+    index += adjacent[n].size();
+  }
+  return kTurnTileId + uint64_t(index + local_index(adjacent[from], to));
+}
+
+void make_turn_tile() {
+  if (boost::filesystem::exists(kTurnTileDir)) {
+    boost::filesystem::remove_all(kTurnTileDir);
+  }
+
+  mjolnir::GraphTileBuilder tile(kTurnTileDir, kTurnTileId, false);
+  const PointLL base_ll =
+      TileHierarchy::levels().find(1)->second.tiles.Base(kTurnTileId.tileid());
+  tile.header_builder().set_base_ll(base_ll);
+
+  const auto adjacent = turn_adjacency();
+  uint32_t edge_index = 0;
+  for (uint32_t u = 0; u < kTurnNodes.size(); ++u) {
+    for (uint32_t i = 0; i < adjacent[u].size(); ++i) {
+      const uint32_t v = adjacent[u][i];
+      const GraphId end_node(kTurnTileId.tileid(), kTurnTileId.level(), v);
+      mjolnir::DirectedEdgeBuilder edge({}, end_node, u < v,
+                                        kTurnNodes[u].Distance(kTurnNodes[v]) + .5, 100, 100,
+                                        Use::kRoad, RoadClass::kPrimary, i, false, 0, 0, false);
+      edge.set_opp_index(local_index(adjacent[v], u));
+      edge.set_opp_local_idx(local_index(adjacent[v], u));
+      edge.set_forwardaccess(kAllAccess);
+      edge.set_reverseaccess(kAllAccess);
+      if (u == x && v == q) {
+        edge.set_turntype(local_index(adjacent[x], p), Turn::Type::kSharpLeft);
+        edge.set_stopimpact(local_index(adjacent[x], p), 7);
+      }
+      const uint32_t a = std::min(u, v), b = std::max(u, v);
+      const uint32_t road = std::find(kTurnRoads.begin(), kTurnRoads.end(),
+                                      std::make_pair(a, b)) -
+                            kTurnRoads.begin();
+      bool added;
+      edge.set_edgeinfo_offset(
+          tile.AddEdgeInfo(road, GraphId(kTurnTileId.tileid(), kTurnTileId.level(), a),
+                           GraphId(kTurnTileId.tileid(), kTurnTileId.level(), b), road, 0, 0, 100,
+                           std::vector<PointLL>{kTurnNodes[a], kTurnNodes[b]},
+                           {std::to_string(road)}, 0, added));
+      tile.directededges().emplace_back(edge);
+    }
+    NodeInfo node;
+    node.set_latlng(base_ll, kTurnNodes[u]);
+    node.set_access(kAllAccess);
+    node.set_edge_index(edge_index);
+    node.set_edge_count(adjacent[u].size());
+    node.set_drive_on_right(true);
+    node.set_timezone(1);
+    edge_index += adjacent[u].size();
+    tile.nodes().emplace_back(node);
+  }
+  tile.StoreTileData();
+
+  mjolnir::GraphTileBuilder::tweeners_t tweeners;
+  GraphTile reloaded(kTurnTileDir, kTurnTileId);
+  auto bins = mjolnir::GraphTileBuilder::BinEdges(&reloaded, tweeners);
+  mjolnir::GraphTileBuilder::AddBins(kTurnTileDir, &reloaded, bins);
+}
+
+valhalla::Location turn_location(const uint32_t from, const uint32_t to) {
+  const PointLL ll = kTurnNodes[from].MidPoint(kTurnNodes[to]);
+  valhalla::Location location;
+  location.mutable_ll()->set_lng(ll.lng());
+  location.mutable_ll()->set_lat(ll.lat());
+  auto* edge = location.mutable_path_edges()->Add();
+  edge->set_graph_id(turn_edge(from, to));
+  edge->set_percent_along(0.5f);
+  edge->mutable_ll()->set_lng(ll.lng());
+  edge->mutable_ll()->set_lat(ll.lat());
+  edge->set_distance(0.0f);
+  return location;
+}
+
+std::vector<GraphId> turn_route(thor::PathAlgorithm& algorithm, const bool use_arcflags) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", kTurnTileDir);
+  GraphReader reader(conf);
+
+  Options options;
+  rapidjson::Document doc;
+  doc.SetObject();
+  sif::ParseAutoCostOptions(doc, "/costing_options/auto", options.add_costing_options());
+  sif::cost_ptr_t costs[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+  costs[static_cast<int>(sif::TravelMode::kDrive)] = sif::CreateAutoCost(Costing::auto_, options);
+
+  auto origin = turn_location(s, p);
+  auto destination = turn_location(t2, t3);
+  algorithm.set_use_arcflags(use_arcflags);
+  const auto paths =
+      algorithm.GetBestPath(origin, destination, reader, costs, sif::TravelMode::kDrive);
+  algorithm.Clear();
+  std::vector<GraphId> edges;
+  for (const auto& path : paths) {
+    for (const auto& info : path) {
+      edges.push_back(info.edgeid);
+    }
+  }
+  return edges;
+}
+
+void TestPrunedFollowsTurnCosts() {
+  make_turn_tile();
+  boost::property_tree::ptree conf;
+  conf.put("mjolnir.tile_dir", kTurnTileDir);
+  conf.put("mjolnir.concurrency", 1);
+  conf.put("mjolnir.arc_flag_regions", 2);
+  mjolnir::ArcFlagsBuilder::Build(conf);
+
+  GraphReader reader(conf.get_child("mjolnir"));
+  const GraphTile* tile = reader.GetGraphTile(kTurnTileId);
+  if (tile->arcflag_region(s) == tile->arcflag_region(t3) ||
+      tile->arcflag_region(q) != tile->arcflag_region(s)) {
+    throw std::logic_error("The test graph is not split between q and r");
+  }
+
+  thor::AStarPathAlgorithm astar;
+  thor::BidirectionalAStar bidirectional;
+  for (thor::PathAlgorithm* algorithm : std::vector<thor::PathAlgorithm*>{&astar, &bidirectional}) {
+    const auto expected = turn_route(*algorithm, false);
+    if (std::find(expected.begin(), expected.end(), turn_edge(p, y)) == expected.end()) {
+      throw std::logic_error("The turn cost at x should make the route run over y");
+    }
+    if (turn_route(*algorithm, true) != expected) {
+      throw std::logic_error("Pruned route does not follow the turn costs");
+    }
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("arcflags");
+
+  suite.test(TEST_CASE(BuildArcFlags));
+
+  suite.test(TEST_CASE(TestPrunedEqualsUnpruned));
+
+  suite.test(TEST_CASE(TestPrunedFollowsTurnCosts));
+
+  return suite.tear_down();
+}
@@ -476,6 +476,120 @@ void TestPartialDurationReverse() {
   vt::TimeDepReverse astar;
   TestPartialDuration(astar);
 }
+
+// Get the cost of the edges of a path that are also on another path
+float shared_cost(const std::vector<vt::PathInfo>& path, const std::vector<vt::PathInfo>& other) {
+  float shared = 0.0f, prior = 0.0f;
+  for (const auto& info : path) {
+    for (const auto& other_info : other) {
+      if (info.edgeid == other_info.edgeid) {
+        shared += info.elapsed_cost - prior;
+        break;
+      }
+    }
+    prior = info.elapsed_cost;
+  }
+  return shared;
+}
+
+// test that a path from A to D around one side of the square has the path
+// around the other side as its alternate
+void TestAlternates() {
+  using node::a;
+  using node::d;
+
+  valhalla::Location origin;
+  origin.mutable_ll()->set_lng(a.second.first);
+  origin.mutable_ll()->set_lat(a.second.second);
+  add(tile_id + uint64_t(0), 0.0f, a.second, origin);
+  add(tile_id + uint64_t(1), 0.0f, a.second, origin);
+  add(tile_id + uint64_t(2), 1.0f, a.second, origin);
+  add(tile_id + uint64_t(4), 1.0f, a.second, origin);
+
+  valhalla::Location dest;
+  dest.mutable_ll()->set_lng(d.second.first);
+  dest.mutable_ll()->set_lat(d.second.second);
+  add(tile_id + uint64_t(3), 1.0f, d.second, dest);
+  add(tile_id + uint64_t(5), 1.0f, d.second, dest);
+  add(tile_id + uint64_t(6), 0.0f, d.second, dest);
+  add(tile_id + uint64_t(7), 0.0f, d.second, dest);
+
+  bpt::ptree conf;
+  conf.put("tile_dir", test_dir);
+  vb::GraphReader reader(conf);
+
+  Options options;
+  create_costing_options(options);
+  options.set_alternates(1);
+  vs::cost_ptr_t costs[int(vs::TravelMode::kMaxTravelMode)];
+  costs[int(vs::TravelMode::kDrive)] = vs::CreateAutoCost(Costing::auto_, options);
+
+  vt::BidirectionalAStar astar;
+  auto paths = astar.GetBestPath(origin, dest, reader, costs, vs::TravelMode::kDrive, options);
+  if (paths.size() < 2) {
+    throw std::logic_error("Expected the best path and an alternate, got " +
+                           std::to_string(paths.size()) + " paths");
+  }
+
+  // Both go from A to D, the alternate around the other side of the square
+  const auto& best = paths[0];
+  const auto& alternate = paths[1];
+  for (const auto& path : paths) {
+    if (path.size() != 2 || path.front().edgeid.id() > 1 ||
+        (path.back().edgeid.id() != 3 && path.back().edgeid.id() != 5)) {
+      throw std::logic_error("Expected paths of 2 edges from A to D");
+    }
+  }
+
+  // Bounded stretch and limited sharing
+  const float best_cost = best.back().elapsed_cost;
+  if (alternate.back().elapsed_cost > best_cost * (1.0f + vt::kAlternateMaxStretch)) {
+    throw std::logic_error("The alternate costs more than the maximum stretch");
+  }
+  if (shared_cost(alternate, best) > best_cost * vt::kAlternateMaxSharing) {
+    throw std::logic_error("The alternate shares more than the maximum with the best path");
+  }
+  if (alternate.front().edgeid == best.front().edgeid) {
+    throw std::logic_error("The alternate should take the other side of the square");
+  }
+  for (const auto& path : paths) {
+    if (vt::PathLoops(reader, path)) {
+      throw std::logic_error("Paths should not go through a node twice");
+    }
+  }
+}
+
+// test that paths through the square going into a dead end and back, or along
+// an edge twice, loop and can not be alternates
+void TestPathLoops() {
+  bpt::ptree conf;
+  conf.put("tile_dir", test_dir);
+  vb::GraphReader reader(conf);
+
+  auto path = [](const std::vector<uint64_t>& edges) {
+    std::vector<vt::PathInfo> path;
+    for (const auto edge : edges) {
+      path.emplace_back(vs::TravelMode::kDrive, 0, tile_id + edge, 0, 0, false);
+    }
+    return path;
+  };
+
+  // A to D along either side of the square
+  if (vt::PathLoops(reader, path({0, 3})) || vt::PathLoops(reader, path({1, 5}))) {
+    throw std::logic_error("Paths from A to D should not loop");
+  }
+  // B to D and back to B treats D like a dead end, B is visited twice
+  if (!vt::PathLoops(reader, path({0, 3, 7, 2}))) {
+    throw std::logic_error("A detour into D and back should loop");
+  }
+  if (!vt::PathLoops(reader, path({0, 2, 0}))) {
+    throw std::logic_error("Going along A to B twice should loop");
+  }
+  // The origin and destination may be partway along the first and last edges
+  if (vt::PathLoops(reader, path({0, 3, 6, 4})) || vt::PathLoops(reader, path({2, 1, 5, 7}))) {
+    throw std::logic_error("Going around the square should not loop");
+  }
+}
 void trivial_path_no_uturns(const std::string& config_file) {
   boost::property_tree::ptree conf;
   rapidjson::read_json(config_file, conf);
@@ -706,6 +820,39 @@ void test_oneway_wrong_way() {
   }
 }
 
+void test_alternates() {
+  auto conf = get_conf("whitelion_tiles");
+  route_tester tester(conf);
+  std::string request =
+      R"({"locations":[{"lat":51.45562646682483,"lon":-2.5952598452568054},{"lat":51.456082740244824,"lon":-2.595050632953644}],"costing":"auto","alternates":2})";
+
+  auto response = tester.test(request);
+
+  // The best route and at most the requested number of alternates, each with directions.
+  // TestAlternates checks the alternates themselves on a graph known to have one.
+  const auto& routes = response.trip().routes();
+  if (routes.size() < 1 || routes.size() > 3) {
+    throw std::logic_error("Expected the best route and up to 2 alternates, got " +
+                           std::to_string(routes.size()) + " routes");
+  }
+  if (response.directions().routes_size() != routes.size()) {
+    throw std::logic_error("Every route should have directions");
+  }
+
+  // Alternates must differ from the best route and take at most 25% longer
+  const auto& best = routes.Get(0).legs(0);
+  const double best_time = best.node().rbegin()->elapsed_time();
+  for (int i = 1; i < routes.size(); ++i) {
+    const auto& leg = routes.Get(i).legs(0);
+    if (leg.shape() == best.shape()) {
+      throw std::logic_error("Alternate " + std::to_string(i) + " is the best route");
+    }
+    if (leg.node().rbegin()->elapsed_time() < best_time) {
+      throw std::logic_error("Alternate " + std::to_string(i) + " is faster than the best route");
+    }
+  }
+}
+
 void test_deadend() {
   auto conf = get_conf("whitelion_tiles");
   route_tester tester(conf);
@@ -976,6 +1123,8 @@ int main() {
   suite.test(TEST_CASE(TestPartialDurationTrivial));
   suite.test(TEST_CASE(TestPartialDurationForward));
   suite.test(TEST_CASE(TestPartialDurationReverse));
+  suite.test(TEST_CASE(TestAlternates));
+  suite.test(TEST_CASE(TestPathLoops));
 
   suite.test(TEST_CASE(DoConfig));
   suite.test(TEST_CASE(TestTrivialPathNoUturns));
@@ -985,6 +1134,7 @@ int main() {
   suite.test(TEST_CASE(test_deadend_timedep_reverse));
   suite.test(TEST_CASE(test_oneway));
   suite.test(TEST_CASE(test_oneway_wrong_way));
+  suite.test(TEST_CASE(test_alternates));
   suite.test(TEST_CASE(test_time_restricted_road));
 
   return suite.tear_down();
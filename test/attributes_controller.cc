@@ -34,10 +34,11 @@ void TestArgCtor() {
 void TryDisableAll() {
   AttributesController controller;
   controller.disable_all();
-  for (auto& pair : controller.attributes) {
-    // If any pair value is true then throw error
-    if (pair.second)
-      throw runtime_error("Incorrect disable_all value for " + pair.first);
+  for (uint8_t key = 0; key < kAttributeCount; ++key) {
+    // If any attribute is enabled then throw error
+    if (controller.attributes[key])
+      throw runtime_error("Incorrect disable_all value for " +
+                          AttributesController::kAttributeNames[key]);
   }
 }
 
@@ -46,7 +47,7 @@ void TestDisableAll() {
 }
 
 void TryCategoryAttributeEnabled(const AttributesController& controller,
-                                 const std::string& category,
+                                 const AttributeMask& category,
                                  bool expected_response) {
   // If category_attribute_enabled does not equal expected response then throw error
   if (controller.category_attribute_enabled(category) != expected_response) {
@@ -66,15 +67,15 @@ void TestNodeAttributeEnabled() {
   TryCategoryAttributeEnabled(controller, kNodeCategory, false);
 
   // Test one node enabled
-  controller.attributes.at(kNodeType) = true;
+  controller.attributes[kNodeType] = true;
   TryCategoryAttributeEnabled(controller, kNodeCategory, true);
 
   // Test some node enabled
-  controller.attributes.at(kNodeType) = false;
-  controller.attributes.at(kNodeIntersectingEdgeBeginHeading) = true;
-  controller.attributes.at(kNodeTransitPlatformInfoType) = true;
-  controller.attributes.at(kNodeElapsedTime) = true;
-  controller.attributes.at(kNodeFork) = true;
+  controller.attributes[kNodeType] = false;
+  controller.attributes[kNodeIntersectingEdgeBeginHeading] = true;
+  controller.attributes[kNodeTransitPlatformInfoType] = true;
+  controller.attributes[kNodeElapsedTime] = true;
+  controller.attributes[kNodeFork] = true;
   TryCategoryAttributeEnabled(controller, kNodeCategory, true);
 }
 
@@ -89,17 +90,59 @@ void TestAdminAttributeEnabled() {
   TryCategoryAttributeEnabled(controller, kAdminCategory, false);
 
   // Test one admin enabled
-  controller.attributes.at(kAdminCountryCode) = true;
+  controller.attributes[kAdminCountryCode] = true;
   TryCategoryAttributeEnabled(controller, kAdminCategory, true);
 
   // Test some admin enabled
-  controller.attributes.at(kAdminCountryCode) = false;
-  controller.attributes.at(kAdminCountryText) = true;
-  controller.attributes.at(kAdminStateCode) = false;
-  controller.attributes.at(kAdminStateText) = true;
+  controller.attributes[kAdminCountryCode] = false;
+  controller.attributes[kAdminCountryText] = true;
+  controller.attributes[kAdminStateCode] = false;
+  controller.attributes[kAdminStateText] = true;
   TryCategoryAttributeEnabled(controller, kAdminCategory, true);
 }
 
+void TestSetAttribute() {
+  AttributesController controller;
+  controller.disable_all();
+
+  // Names resolve to their keys
+  if (!controller.set_attribute("edge.names", true) || !controller.attributes[kEdgeNames] ||
+      controller.attributes.count() != 1)
+    throw runtime_error("Incorrect set_attribute for edge.names");
+  if (!controller.set_attribute("shape_attributes.speed", true) ||
+      !controller.attributes[kShapeAttributesSpeed])
+    throw runtime_error("Incorrect set_attribute for shape_attributes.speed");
+  if (!controller.set_attribute("edge.names", false) || controller.attributes[kEdgeNames])
+    throw runtime_error("Incorrect set_attribute disabling edge.names");
+
+  // Unknown names are rejected and leave the attributes unchanged
+  if (controller.set_attribute("edge.bogus", true) || controller.attributes.count() != 1)
+    throw runtime_error("Incorrect set_attribute for an unknown attribute");
+
+  // Every name maps back to its own key
+  for (uint8_t key = 0; key < kAttributeCount; ++key) {
+    controller.disable_all();
+    controller.set_attribute(AttributesController::kAttributeNames[key], true);
+    if (!controller.attributes[key] || controller.attributes.count() != 1)
+      throw runtime_error("Incorrect key for " + AttributesController::kAttributeNames[key]);
+  }
+}
+
+void TestCategories() {
+  // Categories hold exactly the attributes with the prefix
+  if (kEdgeSignCategory.count() != 7 || !kEdgeSignCategory[kEdgeSignJunctionName] ||
+      kEdgeSignCategory[kEdgeNames])
+    throw runtime_error("Incorrect edge sign category");
+  if (kNodeIntersectingEdgeCategory.count() != 8 ||
+      !kNodeIntersectingEdgeCategory[kNodeIntersectingEdgeRoadClass])
+    throw runtime_error("Incorrect intersecting edge category");
+  if ((kNodeIntersectingEdgeCategory & ~kNodeCategory).any())
+    throw runtime_error("Intersecting edge category is not within the node category");
+  if (kShapeAttributesCategory.count() != 3 ||
+      (kShapeAttributesCategory & AttributesController::kDefaultAttributes).any())
+    throw runtime_error("Shape attributes should be disabled by default");
+}
+
 } // namespace
 
 int main() {
@@ -120,5 +163,11 @@ int main() {
   // Test admin category_attribute_enabled
   suite.test(TEST_CASE(TestAdminAttributeEnabled));
 
+  // Test set_attribute by name
+  suite.test(TEST_CASE(TestSetAttribute));
+
+  // Test category masks
+  suite.test(TEST_CASE(TestCategories));
+
   return suite.tear_down();
 }
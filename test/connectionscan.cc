@@ -0,0 +1,324 @@
+#include "test.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "mjolnir/directededgebuilder.h"
+#include "mjolnir/graphtilebuilder.h"
+#include "sif/pedestriancost.h"
+#include "sif/transitcost.h"
+#include "thor/connectionscan.h"
+#include "worker.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// A line of stops in one transit tile, walking only at its ends:
+//
+//   o---a====b====c---d
+//        \\=======//
+//
+// o and d are street nodes, a, b and c transit platforms (stops 0, 1 and 2).
+// Trip 1 goes a -> b along line 0, trip 2 b -> c along line 1 and trip 3
+// directly a -> c along line 2. The timetable is made up by the tests.
+const std::string test_dir = "test/data/connectionscan_tiles";
+const std::string date_time = "2020-01-06T08:00";
+constexpr uint32_t kStartTime = 8 * 3600;
+constexpr uint64_t kDatasetId = 42;
+
+const auto& transit_level = TileHierarchy::GetTransitLevel();
+const GraphId tile_id(transit_level.tiles.TileId({0.125, 0.125}), transit_level.level, 0);
+
+namespace node {
+const std::pair<GraphId, PointLL> o({tile_id.tileid(), tile_id.level(), 0}, {0.100, 0.100});
+const std::pair<GraphId, PointLL> a({tile_id.tileid(), tile_id.level(), 1}, {0.101, 0.100});
+const std::pair<GraphId, PointLL> b({tile_id.tileid(), tile_id.level(), 2}, {0.110, 0.100});
+const std::pair<GraphId, PointLL> c({tile_id.tileid(), tile_id.level(), 3}, {0.120, 0.100});
+const std::pair<GraphId, PointLL> d({tile_id.tileid(), tile_id.level(), 4}, {0.121, 0.100});
+} // namespace node
+
+namespace edge {
+const GraphId oa(tile_id.tileid(), tile_id.level(), 0);
+const GraphId ab(tile_id.tileid(), tile_id.level(), 2); // line 0
+const GraphId ac(tile_id.tileid(), tile_id.level(), 3); // line 2
+const GraphId bc(tile_id.tileid(), tile_id.level(), 4); // line 1
+const GraphId cd(tile_id.tileid(), tile_id.level(), 5);
+} // namespace edge
+
+void make_tile() {
+  if (filesystem::exists(test_dir)) {
+    filesystem::remove_all(test_dir);
+  }
+
+  GraphTileBuilder tile(test_dir, tile_id, false);
+  const PointLL base_ll = transit_level.tiles.Base(tile_id.tileid());
+  tile.header_builder().set_base_ll(base_ll);
+  tile.header_builder().set_dataset_id(kDatasetId);
+
+  uint32_t edge_index = 0;
+  auto add_node = [&](const std::pair<GraphId, PointLL>& v, const uint32_t edge_count,
+                      const NodeType type) {
+    NodeInfo node_builder;
+    node_builder.set_latlng(base_ll, v.second);
+    node_builder.set_access(kAllAccess);
+    node_builder.set_type(type);
+    node_builder.set_edge_count(edge_count);
+    node_builder.set_edge_index(edge_index);
+    node_builder.set_timezone(1);
+    edge_index += edge_count;
+    tile.nodes().emplace_back(node_builder);
+  };
+  auto add_edge = [&](const std::pair<GraphId, PointLL>& u, const std::pair<GraphId, PointLL>& v,
+                      const uint32_t localedgeidx, const Use use) {
+    DirectedEdgeBuilder edge_builder({}, v.first, true, u.second.Distance(v.second) + .5, 5, 5, use,
+                                     RoadClass::kServiceOther, localedgeidx, false, 0, 0, false);
+    edge_builder.set_forwardaccess(kAllAccess);
+    edge_builder.set_reverseaccess(kAllAccess);
+    bool added;
+    const std::vector<PointLL> shape{u.second, v.second};
+    uint32_t edge_info_offset =
+        tile.AddEdgeInfo(tile.directededges().size(), u.first, v.first, 123, 0, 0, 5, shape,
+                         {std::to_string(tile.directededges().size())}, 0, added);
+    edge_builder.set_edgeinfo_offset(edge_info_offset);
+    tile.directededges().emplace_back(edge_builder);
+  };
+
+  add_edge(node::o, node::a, 0, Use::kFootway);
+  add_node(node::o, 1, NodeType::kStreetIntersection);
+
+  add_edge(node::a, node::o, 0, Use::kFootway);
+  add_edge(node::a, node::b, 1, Use::kBus);
+  add_edge(node::a, node::c, 2, Use::kBus);
+  add_node(node::a, 3, NodeType::kMultiUseTransitPlatform);
+
+  add_edge(node::b, node::c, 0, Use::kBus);
+  add_node(node::b, 1, NodeType::kMultiUseTransitPlatform);
+
+  add_edge(node::c, node::d, 0, Use::kFootway);
+  add_node(node::c, 1, NodeType::kMultiUseTransitPlatform);
+
+  add_edge(node::d, node::c, 0, Use::kFootway);
+  add_node(node::d, 1, NodeType::kStreetIntersection);
+
+  tile.StoreTileData();
+}
+
+// Uses a made up timetable instead of building it from the transit departures,
+// which the test tile does not have. The timetable is of the tile of the given
+// dataset.
+class TestConnectionScan : public ConnectionScan {
+public:
+  explicit TestConnectionScan(const std::vector<TransitConnection>& connections,
+                              const uint64_t dataset_id = kDatasetId) {
+    auto timetable = std::make_shared<TransitTimetable>();
+    for (const auto& stop : {node::a, node::b, node::c}) {
+      timetable->AddStop(stop.first);
+    }
+    for (const auto& line : {edge::ab, edge::bc, edge::ac}) {
+      timetable->AddLine(line);
+    }
+    for (const auto& connection : connections) {
+      timetable->Add(connection);
+    }
+    timetable->Sort();
+
+    // Same key as LoadTimetable: the date, the time zone and the transit tiles
+    // with their datasets
+    timetable_ = timetable;
+    timetable_key_ = date_time.substr(0, 10) + ":1:" + std::to_string(tile_id.tileid()) + "@" +
+                     std::to_string(dataset_id);
+  }
+};
+
+valhalla::Location location(const std::pair<GraphId, PointLL>& v,
+                            const GraphId& edgeid,
+                            const float percent_along) {
+  valhalla::Location location;
+  location.mutable_ll()->set_lng(v.second.first);
+  location.mutable_ll()->set_lat(v.second.second);
+  auto* path_edge = location.mutable_path_edges()->Add();
+  path_edge->set_graph_id(edgeid);
+  path_edge->set_percent_along(percent_along);
+  path_edge->mutable_ll()->set_lng(v.second.first);
+  path_edge->mutable_ll()->set_lat(v.second.second);
+  path_edge->set_distance(0.0f);
+  path_edge->set_begin_node(percent_along == 0.0f);
+  path_edge->set_end_node(percent_along == 1.0f);
+  return location;
+}
+
+Options get_options(const uint32_t alternates) {
+  Api request;
+  ParseApi(R"({"locations":[{"lat":0.1,"lon":0.1},{"lat":0.1,"lon":0.121}],"costing":"multimodal",
+      "transit_algorithm":"connection_scan","alternates":)" +
+               std::to_string(alternates) + "}",
+           Options::route, request);
+  return request.options();
+}
+
+std::vector<std::vector<PathInfo>> route(const std::vector<TransitConnection>& connections,
+                                         const uint32_t alternates,
+                                         const uint64_t dataset_id = kDatasetId) {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", test_dir);
+  GraphReader reader(conf);
+
+  const auto options = get_options(alternates);
+  sif::cost_ptr_t mode_costing[static_cast<uint32_t>(sif::TravelMode::kMaxTravelMode)];
+  mode_costing[static_cast<uint32_t>(sif::TravelMode::kPedestrian)] =
+      sif::CreatePedestrianCost(Costing::pedestrian, options);
+  mode_costing[static_cast<uint32_t>(sif::TravelMode::kPublicTransit)] =
+      sif::CreateTransitCost(Costing::transit, options);
+
+  auto origin = location(node::o, edge::oa, 0.0f);
+  origin.set_date_time(date_time);
+  auto destination = location(node::d, edge::cd, 1.0f);
+  TestConnectionScan connection_scan(connections, dataset_id);
+  return connection_scan.GetBestPath(origin, destination, reader, mode_costing,
+                                     sif::TravelMode::kPedestrian, options);
+}
+
+// Connections: departure, arrival, from stop, to stop, line, trip, run, wheelchair, bicycle
+TransitConnection trip1() {
+  return {kStartTime + 600, kStartTime + 1200, 0, 1, 0, 1, 0, true, true};
+}
+TransitConnection trip2(const uint32_t arrival) {
+  return {kStartTime + 1500, arrival, 1, 2, 1, 2, 0, true, true};
+}
+TransitConnection trip3() {
+  return {kStartTime + 720, kStartTime + 3000, 0, 2, 2, 3, 0, true, true};
+}
+
+// Returns the path with the given trips, checking its edges
+const std::vector<PathInfo>& find_path(const std::vector<std::vector<PathInfo>>& paths,
+                                       const std::vector<GraphId>& edges,
+                                       const std::vector<uint32_t>& trips) {
+  for (const auto& path : paths) {
+    std::vector<uint32_t> path_trips;
+    for (const auto& info : path) {
+      path_trips.push_back(info.trip_id);
+    }
+    if (path_trips != trips) {
+      continue;
+    }
+    for (size_t i = 0; i < path.size(); ++i) {
+      const auto mode = trips[i] == 0 ? sif::TravelMode::kPedestrian : sif::TravelMode::kPublicTransit;
+      if (path[i].edgeid != edges[i] || path[i].mode != mode) {
+        throw std::logic_error("Wrong edge " + std::to_string(i) + " of the path");
+      }
+    }
+    return path;
+  }
+  throw std::logic_error("No path takes the expected trips");
+}
+
+void TestParse() {
+  if (get_options(0).transit_algorithm() != Options::connection_scan) {
+    throw std::logic_error("transit_algorithm should be parsed");
+  }
+  Api request;
+  ParseApi(R"({"locations":[{"lat":0.1,"lon":0.1},{"lat":0.1,"lon":0.121}],"costing":"multimodal",
+      "transit_algorithm":"raptor"})",
+           Options::route, request);
+  if (request.options().transit_algorithm() != Options::time_dependent) {
+    throw std::logic_error("Unknown transit algorithms should keep the time dependent default");
+  }
+}
+
+void TestOneTransfer() {
+  // Only the route changing trips at b
+  const auto paths = route({trip1(), trip2(kStartTime + 2100)}, 0);
+  if (paths.size() != 1 || paths[0].size() != 4) {
+    throw std::logic_error("Expected one path of 4 edges");
+  }
+  const auto& path = find_path(paths, {edge::oa, edge::ab, edge::bc, edge::cd}, {0, 1, 2, 0});
+
+  // Times are from the start, each trip edge ends at the arrival of its connection
+  if (path[1].elapsed_time != 1200 || path[2].elapsed_time != 2100 ||
+      path[3].elapsed_time <= 2100 || path[0].elapsed_time >= 600) {
+    throw std::logic_error("Wrong elapsed times along the path");
+  }
+}
+
+void TestParetoRounds() {
+  // The direct trip (round 1) arrives later than the route with a transfer
+  // (round 2), both are Pareto optimal options
+  const auto paths = route({trip1(), trip2(kStartTime + 2100), trip3()}, 2);
+  if (paths.size() != 2) {
+    throw std::logic_error("Expected both rounds but got " + std::to_string(paths.size()));
+  }
+  const auto& direct = find_path(paths, {edge::oa, edge::ac, edge::cd}, {0, 3, 0});
+  const auto& transfer =
+      find_path(paths, {edge::oa, edge::ab, edge::bc, edge::cd}, {0, 1, 2, 0});
+  if (transfer.back().elapsed_time >= direct.back().elapsed_time) {
+    throw std::logic_error("The later round should arrive earlier");
+  }
+
+  // The best path is the option with the lowest cost
+  if (paths[0].back().elapsed_cost > paths[1].back().elapsed_cost) {
+    throw std::logic_error("The lowest cost option should be the best path");
+  }
+  const auto best = route({trip1(), trip2(kStartTime + 2100), trip3()}, 0);
+  if (best.size() != 1 || best[0].back().elapsed_cost != paths[0].back().elapsed_cost) {
+    throw std::logic_error("Without alternates only the best path should be returned");
+  }
+}
+
+void TestLaterRoundArrivesEarlier() {
+  // A transfer arriving at c at the same time as the direct trip does not improve on it
+  auto paths = route({trip1(), trip2(kStartTime + 3000), trip3()}, 2);
+  if (paths.size() != 1) {
+    throw std::logic_error("A later round arriving at the same time should not be returned");
+  }
+  find_path(paths, {edge::oa, edge::ac, edge::cd}, {0, 3, 0});
+
+  // One second earlier it does
+  paths = route({trip1(), trip2(kStartTime + 2999), trip3()}, 2);
+  if (paths.size() != 2) {
+    throw std::logic_error("A later round arriving earlier should be returned");
+  }
+  find_path(paths, {edge::oa, edge::ab, edge::bc, edge::cd}, {0, 1, 2, 0});
+}
+
+void TestTimetableDataset() {
+  // A timetable of another build of the tile is not used, the one built from the
+  // tile has no departures
+  if (route({trip1(), trip2(kStartTime + 2100)}, 0).size() != 1) {
+    throw std::logic_error("The timetable of the tile should be used");
+  }
+  if (!route({trip1(), trip2(kStartTime + 2100)}, 0, kDatasetId + 1).empty()) {
+    throw std::logic_error("The timetable of another dataset should be rebuilt");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("connectionscan");
+
+  suite.test(TEST_CASE(make_tile));
+
+  suite.test(TEST_CASE(TestParse));
+
+  suite.test(TEST_CASE(TestOneTransfer));
+
+  suite.test(TEST_CASE(TestParetoRounds));
+
+  suite.test(TEST_CASE(TestLaterRoundArrivesEarlier));
+
+  suite.test(TEST_CASE(TestTimetableDataset));
+
+  return suite.tear_down();
+}
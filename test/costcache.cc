@@ -0,0 +1,161 @@
+#include "test.h"
+
+#include "sif/autocost.h"
+#include "sif/costcache.h"
+#include "sif/pedestriancost.h"
+#include "sif/truckcost.h"
+#include "worker.h"
+
+#include <string>
+#include <typeinfo>
+
+using namespace valhalla;
+using namespace valhalla::sif;
+
+namespace {
+
+Options get_options(const std::string& costing, const std::string& costing_options) {
+  Api request;
+  ParseApi(R"({"locations":[{"lat":52.09,"lon":5.11},{"lat":52.10,"lon":5.12}],"costing":")" +
+               costing + R"(","costing_options":{")" + costing + R"(":)" + costing_options + "}}",
+           Options::route, request);
+  return request.options();
+}
+
+void TestKey() {
+  // Same values in a different order give the same key
+  const auto a = get_options("auto", R"({"use_highways":0.2,"use_tolls":0.8})");
+  const auto b = get_options("auto", R"({"use_tolls":0.8,"use_highways":0.2})");
+  const auto key = CostCache::Key(Costing::auto_, a, CreateAutoCost);
+  if (key != CostCache::Key(Costing::auto_, b, CreateAutoCost)) {
+    throw std::logic_error("Same costing options should have the same key");
+  }
+
+  const auto c = get_options("auto", R"({"use_highways":0.3,"use_tolls":0.8})");
+  if (key == CostCache::Key(Costing::auto_, c, CreateAutoCost)) {
+    throw std::logic_error("Different costing options should have different keys");
+  }
+  if (key == CostCache::Key(Costing::truck, a, CreateAutoCost)) {
+    throw std::logic_error("Different costings should have different keys");
+  }
+  if (key == CostCache::Key(Costing::auto_, a, CreateAutoShorterCost)) {
+    throw std::logic_error("Different create functions should have different keys");
+  }
+
+  // Avoid edges are added to the copies, they are not part of the profile
+  auto d = a;
+  auto* avoid = d.add_avoid_edges();
+  avoid->set_id(1234);
+  avoid->set_percent_along(0.5f);
+  if (key != CostCache::Key(Costing::auto_, d, CreateAutoCost)) {
+    throw std::logic_error("Avoid edges should not change the key");
+  }
+}
+
+void TestCopies() {
+  const auto options = get_options("truck", R"({"height":3.5})");
+
+  CostCache cache;
+  auto first = cache.Create(Costing::truck, options, CreateTruckCost);
+  auto second = cache.Create(Costing::truck, options, CreateTruckCost);
+  if (cache.size() != 1) {
+    throw std::logic_error("Expected one cached profile but got " + std::to_string(cache.size()));
+  }
+  if (first == second || typeid(*first) != typeid(TruckCost) ||
+      typeid(*second) != typeid(TruckCost)) {
+    throw std::logic_error("Each request should get its own copy of the profile");
+  }
+
+  // Requests avoiding edges share the profile and only their copy avoids them
+  auto avoiding = options;
+  auto* avoid = avoiding.add_avoid_edges();
+  avoid->set_id(baldr::GraphId(1234, 0, 5).value);
+  avoid->set_percent_along(0.5f);
+  auto avoids = cache.Create(Costing::truck, avoiding, CreateTruckCost);
+  if (cache.size() != 1 || !avoids->IsUserAvoidEdge(baldr::GraphId(1234, 0, 5)) ||
+      cache.Create(Costing::truck, options, CreateTruckCost)
+          ->IsUserAvoidEdge(baldr::GraphId(1234, 0, 5))) {
+    throw std::logic_error("Avoid edges should only be added to the copy of the request");
+  }
+
+  // Changing the copy of a request must not change the profile
+  first->set_pass(1);
+  first->RelaxHierarchyLimits(16.0f, 4.0f);
+  first->set_allow_destination_only(false);
+  auto third = cache.Create(Costing::truck, options, CreateTruckCost);
+  if (third->pass() != 0 ||
+      third->GetHierarchyLimits()[1].max_up_transitions !=
+          second->GetHierarchyLimits()[1].max_up_transitions) {
+    throw std::logic_error("Changes to a copy should not change the cached profile");
+  }
+
+  // A different costing gets its own profile
+  cache.Create(Costing::pedestrian, get_options("pedestrian", R"({"walking_speed":4.0})"),
+               CreatePedestrianCost);
+  if (cache.size() != 2) {
+    throw std::logic_error("Expected two cached profiles but got " + std::to_string(cache.size()));
+  }
+  cache.Clear();
+  if (cache.size() != 0) {
+    throw std::logic_error("Expected an empty cache after clearing");
+  }
+}
+
+void TestDisabled() {
+  const auto options = get_options("auto", R"({})");
+  CostCache cache(0);
+  auto cost = cache.Create(Costing::auto_, options, CreateAutoCost);
+  if (!cost || cache.size() != 0) {
+    throw std::logic_error("A cache without room should only create the costing");
+  }
+}
+
+void TestProfileIds() {
+  const auto options = get_options("auto", R"({})");
+  CostCache cache;
+  if (cache.Create(Costing::auto_, options, CreateAutoCost)->profile_id() != 0) {
+    throw std::logic_error("Profiles should not have ids without edge cost memo");
+  }
+
+  // Enabling the memo drops the profiles, new ones get an id shared by their copies
+  cache.set_edge_cost_memo(true);
+  const auto first = cache.Create(Costing::auto_, options, CreateAutoCost);
+  const auto second = cache.Create(Costing::auto_, options, CreateAutoCost);
+  if (first->profile_id() == 0 || first->profile_id() != second->profile_id()) {
+    throw std::logic_error("Copies of a memoized profile should share its id");
+  }
+
+  // Configuring the same setting again (another worker starting) keeps the profiles
+  cache.set_edge_cost_memo(true);
+  if (cache.size() != 1 ||
+      cache.Create(Costing::auto_, options, CreateAutoCost)->profile_id() != first->profile_id()) {
+    throw std::logic_error("Setting the same edge cost memo should keep the profiles");
+  }
+  const auto truck = cache.Create(Costing::truck, get_options("truck", R"({})"), CreateTruckCost);
+  if (truck->profile_id() == 0 || truck->profile_id() == first->profile_id()) {
+    throw std::logic_error("Each memoized profile should get its own id");
+  }
+
+  // Costings not declaring their edge costs memoizable never get an id
+  const auto pedestrian =
+      cache.Create(Costing::pedestrian, get_options("pedestrian", R"({})"), CreatePedestrianCost);
+  if (pedestrian->profile_id() != 0) {
+    throw std::logic_error("Pedestrian edge costs should not be memoized");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("costcache");
+
+  suite.test(TEST_CASE(TestKey));
+
+  suite.test(TEST_CASE(TestCopies));
+
+  suite.test(TEST_CASE(TestDisabled));
+
+  suite.test(TEST_CASE(TestProfileIds));
+
+  return suite.tear_down();
+}
@@ -80,6 +80,22 @@ void TestClear() {
   TryClear(costs);
 }
 
+void TestCounters() {
+  std::vector<float> edgelabels = {67, 325, 25, 466};
+  const auto edgecost = [&edgelabels](const uint32_t label) { return edgelabels[label]; };
+  DoubleBucketQueue adjlist(0, 10000, 5, edgecost);
+  for (uint32_t i = 0; i < edgelabels.size(); i++) {
+    adjlist.add(i);
+  }
+  adjlist.decrease(3, 10);
+  edgelabels[3] = 10;
+  while (adjlist.pop() != kInvalidLabel) {
+  }
+  if (adjlist.adds() != 4 || adjlist.decreases() != 1 || adjlist.pops() != 4) {
+    throw runtime_error("TestCounters: unexpected counts of adds, decreases or pops");
+  }
+}
+
 /**
    void TestDecreseCost() {
    std::vector<uint32_t> costs = { 67, 325, 25, 466, 1000, 100005, 758, 167,
@@ -199,6 +215,8 @@ int main() {
 
   suite.test(TEST_CASE(TestClear));
 
+  suite.test(TEST_CASE(TestCounters));
+
   //  suite.test(TEST_CASE(TestDecreaseCost));
 
   suite.test(TEST_CASE(TestSimulation));
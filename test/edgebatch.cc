@@ -0,0 +1,75 @@
+#include "test.h"
+
+#include "baldr/directededge.h"
+#include "baldr/graphconstants.h"
+#include "baldr/nodeinfo.h"
+#include "thor/edgebatch.h"
+
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+void TestCandidates() {
+  // Alternate auto and pedestrian only edges, every 5th edge is a shortcut without
+  // any access. Use the maximum edge count so both words of the mask are used.
+  std::vector<DirectedEdge> edges(kMaxEdgesPerNode);
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    edges[i].set_forwardaccess(i % 2 == 0 ? kAutoAccess : kPedestrianAccess);
+    edges[i].set_reverseaccess(i % 2 == 0 ? kPedestrianAccess : kAutoAccess);
+    if (i % 5 == 0) {
+      edges[i].set_forwardaccess(0);
+      edges[i].set_reverseaccess(0);
+      edges[i].set_shortcut(1);
+    }
+  }
+
+  for (const bool forward : {true, false}) {
+    EdgeBatch batch;
+    batch.Evaluate(edges.data(), edges.size(), kAutoAccess, forward, nullptr);
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+      const uint32_t modes = forward ? edges[i].forwardaccess() : edges[i].reverseaccess();
+      const bool expected = (modes & kAutoAccess) || edges[i].is_shortcut();
+      if (batch.candidate(i) != expected) {
+        throw runtime_error("EdgeBatch candidate " + std::to_string(i) + " is wrong (" +
+                            (forward ? "forward" : "reverse") + ")");
+      }
+    }
+  }
+}
+
+void TestReuse() {
+  // A batch evaluated for a node with many edges must not keep candidates when
+  // evaluated for a node with fewer edges
+  std::vector<DirectedEdge> edges(kMaxEdgesPerNode);
+  for (auto& edge : edges) {
+    edge.set_forwardaccess(kAllAccess);
+  }
+  EdgeBatch batch;
+  batch.Evaluate(edges.data(), edges.size(), kAutoAccess, true, nullptr);
+
+  for (auto& edge : edges) {
+    edge.set_forwardaccess(kPedestrianAccess);
+  }
+  batch.Evaluate(edges.data(), 3, kAutoAccess, true, nullptr);
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    if (batch.candidate(i)) {
+      throw runtime_error("EdgeBatch kept candidate " + std::to_string(i));
+    }
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("edgebatch");
+
+  suite.test(TEST_CASE(TestCandidates));
+
+  suite.test(TEST_CASE(TestReuse));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,160 @@
+#include "test.h"
+
+#include "baldr/edgecostmemo.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphtile.h"
+#include "midgard/constants.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+void TestTable() {
+  EdgeCostTable table(100);
+  float cost, secs;
+  for (uint32_t i = 0; i < 100; ++i) {
+    if (table.get(i, cost, secs)) {
+      throw runtime_error("New table should be empty");
+    }
+  }
+
+  // Zero costs must be stored as well
+  table.set(0, 0.0f, 0.0f);
+  table.set(42, 123.5f, 61.25f);
+  if (!table.get(0, cost, secs) || cost != 0.0f || secs != 0.0f) {
+    throw runtime_error("Zero cost was not stored");
+  }
+  if (!table.get(42, cost, secs) || cost != 123.5f || secs != 61.25f) {
+    throw runtime_error("Cost was not stored");
+  }
+  if (table.get(41, cost, secs) || table.get(43, cost, secs)) {
+    throw runtime_error("Neighbouring costs should not be stored");
+  }
+}
+
+void TestMemo() {
+  EdgeCostMemo memo;
+  auto first = memo.table(1, 0, 10);
+  if (memo.table(1, 0, 10) != first) {
+    throw runtime_error("Same profile and time key should give the same table");
+  }
+  if (memo.table(2, 0, 10) == first || memo.table(1, 1, 10) == first) {
+    throw runtime_error("Other profiles and time keys should get their own table");
+  }
+
+  // Adding more tables than the memo holds drops the oldest but tables in use stay valid
+  first->set(3, 1.0f, 2.0f);
+  for (uint32_t key = 2; key < 2 + kMaxEdgeCostTables; ++key) {
+    memo.table(1, key, 10);
+  }
+  if (memo.table(1, 0, 10) == first) {
+    throw runtime_error("Oldest table should have been dropped");
+  }
+  float cost, secs;
+  if (!first->get(3, cost, secs) || cost != 1.0f || secs != 2.0f) {
+    throw runtime_error("Dropped table in use should keep its costs");
+  }
+
+  // Clearing changes the generation so remembered tables are fetched again
+  const auto generation = memo.generation();
+  memo.table(1, 0, 10);
+  if (memo.generation() != generation) {
+    throw runtime_error("Adding tables should keep the generation");
+  }
+  memo.Clear();
+  if (memo.generation() == generation) {
+    throw runtime_error("Clearing should change the generation");
+  }
+  if (memo.table(1, 0, 10)->get(3, cost, secs)) {
+    throw runtime_error("Cleared memo should give new tables");
+  }
+}
+
+void TestMemory() {
+  // The bytes of the tables count towards the counter of the cache holding the tile
+  const size_t bytes = 100 * sizeof(uint64_t);
+  auto counter = make_shared<atomic<size_t>>(0);
+  {
+    EdgeCostMemo memo;
+    memo.table(1, 0, 100);
+    memo.attach(counter);
+    if (*counter != bytes) {
+      throw runtime_error("The bytes of tables made before attaching should be counted");
+    }
+    for (uint32_t time_key = 1; time_key < 2 * kMaxEdgeCostTables; ++time_key) {
+      memo.table(1, time_key, 100);
+    }
+    if (*counter != kMaxEdgeCostTables * bytes || memo.memory() != *counter) {
+      throw runtime_error("Dropped tables should not be counted");
+    }
+    memo.Clear();
+    if (*counter != 0) {
+      throw runtime_error("Cleared tables should not be counted");
+    }
+    memo.table(2, 0, 100);
+  }
+  if (*counter != 0) {
+    throw runtime_error("The bytes should be released with the memo");
+  }
+}
+
+void TestSpeedTimeKey() {
+  // Without time all speeds are the same
+  if (GraphTile::SpeedTimeKey(kDefaultFlowMask, kInvalidSecondsOfWeek) != 0) {
+    throw runtime_error("No time should have key 0");
+  }
+
+  // Times within a predicted speed bucket share a key except at the start of the day
+  // time (7am is still night for the constrained flow speed)
+  const uint32_t seven_am = 7 * 3600;
+  auto key = GraphTile::SpeedTimeKey(kDefaultFlowMask, seven_am + 1);
+  for (uint32_t s = seven_am + 1; s < seven_am + kSpeedBucketSizeSeconds; ++s) {
+    if (GraphTile::SpeedTimeKey(kDefaultFlowMask, s) != key) {
+      throw runtime_error("Times in the same bucket should share a key: " + to_string(s));
+    }
+  }
+  if (GraphTile::SpeedTimeKey(kDefaultFlowMask, seven_am) == key) {
+    throw runtime_error("7am should not share the key of daytime");
+  }
+  if (GraphTile::SpeedTimeKey(kDefaultFlowMask, seven_am + kSpeedBucketSizeSeconds) == key) {
+    throw runtime_error("Next bucket should have another key");
+  }
+
+  // Every bucket of the week has its own key
+  std::set<uint32_t> keys;
+  for (uint32_t s = 0; s < valhalla::midgard::kSecondsPerWeek; s += kSpeedBucketSizeSeconds) {
+    keys.insert(GraphTile::SpeedTimeKey(kDefaultFlowMask, s + 1));
+  }
+  if (keys.size() != kBucketsPerWeek) {
+    throw runtime_error("Expected a key per bucket but got " + to_string(keys.size()));
+  }
+
+  // Without predicted speeds only day and night differ
+  const uint8_t mask = kFreeFlowMask | kConstrainedFlowMask;
+  if (GraphTile::SpeedTimeKey(mask, 8 * 3600) != GraphTile::SpeedTimeKey(mask, 15 * 3600) ||
+      GraphTile::SpeedTimeKey(mask, 8 * 3600) == GraphTile::SpeedTimeKey(mask, 22 * 3600)) {
+    throw runtime_error("Without predicted speeds the key should be day or night");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("edgecostmemo");
+
+  suite.test(TEST_CASE(TestTable));
+
+  suite.test(TEST_CASE(TestMemo));
+
+  suite.test(TEST_CASE(TestMemory));
+
+  suite.test(TEST_CASE(TestSpeedTimeKey));
+
+  return suite.tear_down();
+}
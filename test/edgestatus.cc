@@ -4,6 +4,8 @@
 #include "config.h"
 #include "thor/edgestatus.h"
 
+#include <thread>
+
 using namespace std;
 using namespace valhalla::baldr;
 using namespace valhalla::thor;
@@ -66,6 +68,50 @@ void TestStatus() {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreached);
 }
 
+void TestSharedStatus() {
+  SharedEdgeStatus settled;
+
+  // Dummy tile header
+  GraphTileHeader header;
+  header.set_directededgecount(100000);
+  test_tile tt;
+  tt.header_ = &header;
+  const GraphTile* tile = &tt;
+
+  // Set edges in many tiles on another thread while looking them up on this one.
+  // Any edge that is found must have the index it was set with.
+  std::thread writer([&settled, tile]() {
+    for (uint32_t t = 0; t < 200; ++t) {
+      for (uint32_t id = 0; id < 100; ++id) {
+        settled.Set(GraphId(t, 1, id * 1000), t * 100 + id, tile);
+      }
+    }
+  });
+  uint32_t index;
+  for (uint32_t i = 0; i < 10; ++i) {
+    for (uint32_t t = 0; t < 200; ++t) {
+      if (settled.Get(GraphId(t, 1, 5000), index) && index != t * 100 + 5)
+        throw runtime_error("SharedEdgeStatus concurrent get returned the wrong index");
+    }
+  }
+  writer.join();
+
+  // All edges are visible once the writer is done
+  for (uint32_t t = 0; t < 200; ++t) {
+    if (!settled.Get(GraphId(t, 1, 99000), index) || index != t * 100 + 99)
+      throw runtime_error("SharedEdgeStatus get test failed");
+    if (settled.Get(GraphId(t, 1, 99001), index) || settled.Get(GraphId(t, 2, 99000), index))
+      throw runtime_error("SharedEdgeStatus found an edge that was not set");
+  }
+  if (settled.full())
+    throw runtime_error("SharedEdgeStatus should not be full");
+
+  // Clear and make sure nothing is settled
+  settled.clear();
+  if (settled.Get(GraphId(555, 1, 0), index))
+    throw runtime_error("SharedEdgeStatus clear test failed");
+}
+
 } // namespace
 
 int main() {
@@ -74,5 +120,8 @@ int main() {
   // Test setting status, getting status, and clearing
   suite.test(TEST_CASE(TestStatus));
 
+  // Test settling edges on one thread while looking them up on another
+  suite.test(TEST_CASE(TestSharedStatus));
+
   return suite.tear_down();
 }
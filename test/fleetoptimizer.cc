@@ -0,0 +1,136 @@
+#include "thor/fleetoptimizer.h"
+#include "test.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+// Cost matrix of locations on a line, 10 seconds per unit of distance
+std::vector<float> LineCosts(const std::vector<float>& positions) {
+  std::vector<float> costs;
+  for (auto from : positions) {
+    for (auto to : positions) {
+      costs.push_back(std::fabs(from - to) * 10.0f);
+    }
+  }
+  return costs;
+}
+
+Vehicle* AddVehicle(google::protobuf::RepeatedPtrField<Vehicle>& vehicles,
+                    const uint32_t start,
+                    const uint32_t end,
+                    const uint32_t capacity) {
+  auto* vehicle = vehicles.Add();
+  vehicle->set_start(start);
+  vehicle->set_end(end);
+  vehicle->set_capacity(capacity);
+  return vehicle;
+}
+
+Job* AddJob(google::protobuf::RepeatedPtrField<Job>& jobs,
+            const uint32_t location,
+            const uint32_t demand) {
+  auto* job = jobs.Add();
+  job->set_location(location);
+  job->set_demand(demand);
+  return job;
+}
+
+void TestCapacity() {
+  // Depot in the middle, 2 jobs on each side and 2 vehicles that can take 2
+  // jobs each. Each vehicle should take one side.
+  auto costs = LineCosts({0, -2, -1, 1, 2});
+  google::protobuf::RepeatedPtrField<Vehicle> vehicles;
+  AddVehicle(vehicles, 0, 0, 2);
+  AddVehicle(vehicles, 0, 0, 2);
+  google::protobuf::RepeatedPtrField<Job> jobs;
+  for (uint32_t location = 1; location < 5; location++) {
+    AddJob(jobs, location, 1);
+  }
+
+  FleetOptimizer optimizer;
+  auto solution = optimizer.Solve(5, costs, vehicles, jobs);
+  if (!solution.unassigned.empty() || solution.routes.size() != 2) {
+    throw std::runtime_error("All jobs should be assigned to the 2 vehicles");
+  }
+  float total = 0.0f;
+  for (const auto& route : solution.routes) {
+    if (route.jobs.size() != 2) {
+      throw std::runtime_error("Each vehicle should take 2 jobs");
+    }
+    bool left = jobs.Get(route.jobs[0]).location() < 3;
+    bool other_left = jobs.Get(route.jobs[1]).location() < 3;
+    if (left != other_left) {
+      throw std::runtime_error("Each vehicle should take the jobs on one side");
+    }
+    total += route.cost;
+  }
+  if (std::fabs(total - 80.0f) > 0.01f) {
+    throw std::runtime_error("Expected a total cost of 80, got " + std::to_string(total));
+  }
+}
+
+void TestTimeWindows() {
+  // The closer job has a late time window so the further one is done first
+  auto costs = LineCosts({0, 1, 2});
+  google::protobuf::RepeatedPtrField<Vehicle> vehicles;
+  AddVehicle(vehicles, 0, 0, 10);
+  google::protobuf::RepeatedPtrField<Job> jobs;
+  auto* late = AddJob(jobs, 1, 1);
+  late->set_time_window_start(100);
+  late->set_time_window_end(200);
+  auto* early = AddJob(jobs, 2, 1);
+  early->set_time_window_start(0);
+  early->set_time_window_end(25);
+
+  FleetOptimizer optimizer;
+  auto solution = optimizer.Solve(3, costs, vehicles, jobs);
+  if (solution.routes.size() != 1 || solution.routes[0].jobs != std::vector<uint32_t>{1, 0}) {
+    throw std::runtime_error("Expected the job with the early time window first");
+  }
+  if (solution.routes[0].arrivals != std::vector<uint32_t>{20, 30}) {
+    throw std::runtime_error("Unexpected arrival times");
+  }
+}
+
+void TestUnassigned() {
+  // The vehicle can only take one of the jobs and a third job can not be
+  // reached at all
+  auto costs = LineCosts({0, 1, 2, 3});
+  for (uint32_t i = 0; i < 4; i++) {
+    costs[i * 4 + 3] = std::numeric_limits<float>::infinity();
+  }
+  google::protobuf::RepeatedPtrField<Vehicle> vehicles;
+  AddVehicle(vehicles, 0, 0, 3);
+  google::protobuf::RepeatedPtrField<Job> jobs;
+  AddJob(jobs, 1, 2);
+  AddJob(jobs, 2, 2);
+  AddJob(jobs, 3, 0);
+
+  FleetOptimizer optimizer;
+  auto solution = optimizer.Solve(4, costs, vehicles, jobs);
+  if (solution.routes.size() != 1 || solution.routes[0].jobs != std::vector<uint32_t>{0}) {
+    throw std::runtime_error("Expected the vehicle to take the closer job");
+  }
+  if (solution.unassigned != std::vector<uint32_t>{1, 2}) {
+    throw std::runtime_error("Expected the other jobs to be unassigned");
+  }
+}
+
+} // namespace
+
+int main() {
+  test::suite suite("fleetoptimizer");
+
+  suite.test(TEST_CASE(TestCapacity));
+  suite.test(TEST_CASE(TestTimeWindows));
+  suite.test(TEST_CASE(TestUnassigned));
+
+  return suite.tear_down();
+}
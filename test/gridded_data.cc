@@ -1,6 +1,8 @@
 #include "midgard/gridded_data.h"
 #include "midgard/pointll.h"
 #include "test.h"
+#include <algorithm>
+#include <cmath>
 #include <limits>
 //#include <iostream>
 
@@ -68,12 +70,350 @@ void test_gridded() {
   std::cout << "]}";*/
 }
 
+void test_threads() {
+  // a grid spanning several bands of rows with a few separate areas
+  GriddedData<PointLL> g({-5, -5, 5, 5}, .05f, std::numeric_limits<float>::max());
+  Tiles<PointLL> t({-5, -5, 5, 5}, .05f);
+  std::vector<PointLL> centers{{-3, -3}, {2, -1}, {-1, 3}};
+  for (int i = 0; i < 200; ++i) {
+    for (int j = 0; j < 200; ++j) {
+      auto b = t.Base(t.TileId(i, j));
+      float d = std::numeric_limits<float>::max();
+      for (const auto& c : centers) {
+        d = std::min(d, c.Distance(b));
+      }
+      g.Set(b, d);
+    }
+  }
+
+  // the contours should not depend on the number of threads
+  std::vector<float> iso_markers{50000, 100000, 200000, 300000};
+  for (bool rings_only : {false, true}) {
+    auto contours = g.GenerateContours(iso_markers, rings_only, 0.f, 0.f, 1);
+    for (uint32_t threads : {2, 3, 8}) {
+      if (g.GenerateContours(iso_markers, rings_only, 0.f, 0.f, threads) != contours)
+        throw std::logic_error("Contours should not depend on the number of threads");
+    }
+
+    // and there should be some of each
+    for (const auto& collection : contours) {
+      if (collection.second.empty() || collection.second.front().empty())
+        throw std::logic_error("There should be contours at " + std::to_string(collection.first));
+    }
+  }
+}
+
+void test_sparse() {
+  // only a small area of a large grid is set
+  GriddedData<PointLL> g({-5, -5, 5, 5}, .01f, 100.f);
+  Tiles<PointLL> t({-5, -5, 5, 5}, .01f);
+  for (int i = 480; i < 520; ++i) {
+    for (int j = 480; j < 520; ++j) {
+      auto b = t.Base(t.TileId(i, j));
+      g.SetIfLessThan(t.TileId(i, j), b.Distance(PointLL(0, 0)) / 100.f);
+    }
+  }
+
+  // only the blocks around that area should be allocated
+  if (g.allocated() > 4 * 4 * kGridBlockSize * kGridBlockSize)
+    throw std::logic_error("Only the blocks that are set should be allocated");
+  if (g.Get(t.TileId(0, 0)) != 100.f || g.Get(500, 500) > 1.f)
+    throw std::logic_error("Unexpected values in the grid");
+
+  // and there should be a ring around the center
+  auto contours = g.GenerateContours({10}, true, 1.f, 0.f);
+  const auto& feature = contours.begin()->second;
+  if (feature.size() != 1 || feature.front().size() != 1 ||
+      !PointLL(0, 0).WithinPolygon(feature.front().front()))
+    throw std::logic_error("There should be a single ring around the center");
+}
+
+// A grid of the distances to 2 centers, 40 rows so the contours cross the boundary of
+// the bands of rows they are generated on. The lines at 150km leave the grid.
+GriddedData<PointLL> conrec_grid() {
+  GriddedData<PointLL> g({-1.5, -5, 1.5, 5}, .25f, std::numeric_limits<float>::max());
+  Tiles<PointLL> t({-1.5, -5, 1.5, 5}, .25f);
+  std::vector<PointLL> centers{{0, -3}, {0, 2.5}};
+  for (int i = 0; i < t.ncolumns(); ++i) {
+    for (int j = 0; j < t.nrows(); ++j) {
+      auto b = t.Base(t.TileId(i, j));
+      float d = std::numeric_limits<float>::max();
+      for (const auto& c : centers) {
+        d = std::min(d, c.Distance(b));
+      }
+      g.Set(b, d);
+    }
+  }
+  return g;
+}
+
+// The contours of the conrec grid at 100km and 150km generated before contours
+// were generated on bands of rows (with no denoising nor generalization)
+using expected_t = std::vector<std::pair<float, std::vector<std::vector<std::vector<PointLL>>>>>;
+
+// Lines at each contour of the conrec grid, without rings_only
+const expected_t kConrecLines = {
+    {150000,
+     {
+         {
+             {{1.375000, -3.381835}, {1.292626, -3.542626}, {1.244245, -3.625000},
+              {1.193474, -3.693474}, {1.125000, -3.775447}, {1.076980, -3.826980},
+              {1.025113, -3.875000}, {0.943093, -3.943093}, {0.875000, -3.993276},
+              {0.791824, -4.041824}, {0.628494, -4.125000}, {0.626147, -4.126147},
+              {0.625000, -4.126652}, {0.622706, -4.127294}, {0.433404, -4.183404},
+              {0.375000, -4.199012}, {0.293488, -4.206512}, {0.214378, -4.214378},
+              {0.125000, -4.222468}, {0.035622, -4.214378}, {-0.043488, -4.206512},
+              {-0.125000, -4.199012}, {-0.183404, -4.183404}, {-0.372706, -4.127294},
+              {-0.375000, -4.126652}, {-0.376147, -4.126147}, {-0.378494, -4.125000},
+              {-0.541824, -4.041824}, {-0.625000, -3.993276}, {-0.693093, -3.943093},
+              {-0.775113, -3.875000}, {-0.826980, -3.826980}, {-0.875000, -3.775447},
+              {-0.943474, -3.693474}, {-0.994245, -3.625000}, {-1.042626, -3.542626},
+              {-1.125000, -3.381835}},
+         },
+         {
+             {{-1.125000, -2.369364}, {-1.042158, -2.207842}, {-0.993478, -2.125000},
+              {-0.943036, -2.056964}, {-0.875000, -1.975476}, {-0.826550, -1.923450},
+              {-0.774272, -1.875000}, {-0.692756, -1.807244}, {-0.625000, -1.757235},
+              {-0.541553, -1.708447}, {-0.378011, -1.625000}, {-0.375990, -1.624010},
+              {-0.375000, -1.623574}, {-0.373018, -1.623018}, {-0.183330, -1.566670},
+              {-0.125000, -1.551044}, {-0.043530, -1.543530}, {0.035640, -1.535640},
+              {0.125000, -1.527532}, {0.214360, -1.535640}, {0.293530, -1.543530},
+              {0.375000, -1.551044}, {0.433330, -1.566670}, {0.623018, -1.623018},
+              {0.625000, -1.623574}, {0.625990, -1.624010}, {0.628011, -1.625000},
+              {0.791553, -1.708447}, {0.875000, -1.757235}, {0.942756, -1.807244},
+              {1.024272, -1.875000}, {1.076550, -1.923450}, {1.125000, -1.975476},
+              {1.193036, -2.056964}, {1.243478, -2.125000}, {1.292158, -2.207842},
+              {1.375000, -2.369364}},
+         },
+         {
+             {{1.375000, 3.130647}, {1.292265, 3.292265}, {1.243712, 3.375000},
+              {1.193192, 3.443192}, {1.125000, 3.524896}, {1.076737, 3.576737},
+              {1.024657, 3.625000}, {0.942920, 3.692920}, {0.875000, 3.743022},
+              {0.791695, 3.791695}, {0.628276, 3.875000}, {0.626077, 3.876076},
+              {0.625000, 3.876550}, {0.622846, 3.877154}, {0.433372, 3.933372},
+              {0.375000, 3.948988}, {0.293506, 3.956494}, {0.214370, 3.964370},
+              {0.125000, 3.972468}, {0.035630, 3.964370}, {-0.043506, 3.956494},
+              {-0.125000, 3.948988}, {-0.183372, 3.933372}, {-0.372846, 3.877154},
+              {-0.375000, 3.876550}, {-0.376077, 3.876076}, {-0.378276, 3.875000},
+              {-0.541695, 3.791695}, {-0.625000, 3.743022}, {-0.692920, 3.692920},
+              {-0.774657, 3.625000}, {-0.826737, 3.576737}, {-0.875000, 3.524896},
+              {-0.943192, 3.443192}, {-0.993712, 3.375000}, {-1.042265, 3.292265},
+              {-1.125000, 3.130647}},
+         },
+         {
+             {{-1.125000, 2.120351}, {-1.041875, 1.958125}, {-0.993073, 1.875000},
+              {-0.942826, 1.807174}, {-0.875000, 1.725873}, {-0.826379, 1.673621},
+              {-0.773957, 1.625000}, {-0.692639, 1.557361}, {-0.625000, 1.507403},
+              {-0.541469, 1.458531}, {-0.377874, 1.375000}, {-0.375945, 1.374055},
+              {-0.375000, 1.373638}, {-0.373106, 1.373106}, {-0.183310, 1.316690},
+              {-0.125000, 1.301060}, {-0.043541, 1.293541}, {0.035645, 1.285645},
+              {0.125000, 1.277532}, {0.214355, 1.285645}, {0.293541, 1.293541},
+              {0.375000, 1.301060}, {0.433310, 1.316690}, {0.623106, 1.373106},
+              {0.625000, 1.373638}, {0.625945, 1.374055}, {0.627874, 1.375000},
+              {0.791469, 1.458531}, {0.875000, 1.507403}, {0.942639, 1.557361},
+              {1.023957, 1.625000}, {1.076379, 1.673621}, {1.125000, 1.725873},
+              {1.192826, 1.807174}, {1.243073, 1.875000}, {1.291875, 1.958125},
+              {1.375000, 2.120351}},
+         },
+     }},
+    {100000,
+     {
+         {
+             {{0.454497, -2.045503}, {0.618710, -2.125000}, {0.622850, -2.127150},
+              {0.625000, -2.128579}, {0.663846, -2.163846}, {0.754593, -2.245407},
+              {0.840474, -2.340474}, {0.871964, -2.375000}, {0.873180, -2.376820},
+              {0.875000, -2.380305}, {0.955093, -2.544907}, {0.988221, -2.625000},
+              {1.005989, -2.744011}, {1.007721, -2.757721}, {1.024545, -2.875000},
+              {1.007827, -2.992173}, {1.006082, -3.006082}, {0.988419, -3.125000},
+              {0.955263, -3.205263}, {0.875000, -3.370332}, {0.873399, -3.373399},
+              {0.872330, -3.375000}, {0.844525, -3.405475}, {0.754782, -3.504782},
+              {0.660956, -3.589044}, {0.625000, -3.621665}, {0.622996, -3.622996},
+              {0.619132, -3.625000}, {0.454571, -3.704571}, {0.375000, -3.737267},
+              {0.255021, -3.755021}, {0.243544, -3.756457}, {0.125000, -3.773312},
+              {0.006456, -3.756457}, {-0.005021, -3.755021}, {-0.125000, -3.737267},
+              {-0.204571, -3.704571}, {-0.369132, -3.625000}, {-0.372996, -3.622996},
+              {-0.375000, -3.621665}, {-0.410956, -3.589044}, {-0.504782, -3.504782},
+              {-0.594525, -3.405475}, {-0.622330, -3.375000}, {-0.623399, -3.373399},
+              {-0.625000, -3.370332}, {-0.705263, -3.205263}, {-0.738419, -3.125000},
+              {-0.756082, -3.006082}, {-0.757827, -2.992173}, {-0.774545, -2.875000},
+              {-0.757721, -2.757721}, {-0.755989, -2.744011}, {-0.738221, -2.625000},
+              {-0.705093, -2.544907}, {-0.625000, -2.380305}, {-0.623180, -2.376820},
+              {-0.621964, -2.375000}, {-0.590474, -2.340474}, {-0.504593, -2.245407},
+              {-0.413846, -2.163846}, {-0.375000, -2.128579}, {-0.372850, -2.127150},
+              {-0.368710, -2.125000}, {-0.204497, -2.045503}, {-0.125000, -2.012789},
+              {-0.004995, -1.995005}, {0.006426, -1.993574}, {0.125000, -1.976688},
+              {0.243574, -1.993574}, {0.254995, -1.995005}, {0.375000, -2.012789},
+              {0.454497, -2.045503}},
+         },
+         {
+             {{0.454525, 3.454525}, {0.618839, 3.375000}, {0.622894, 3.372894},
+              {0.625000, 3.371495}, {0.663103, 3.336896}, {0.754627, 3.254627},
+              {0.840644, 3.159356}, {0.871964, 3.125000}, {0.873180, 3.123180},
+              {0.875000, 3.119688}, {0.955012, 2.955012}, {0.988041, 2.875000},
+              {1.005746, 2.755746}, {1.007394, 2.742606}, {1.024168, 2.625000},
+              {1.007306, 2.507306}, {1.005669, 2.494331}, {0.987876, 2.375000},
+              {0.954870, 2.295130}, {0.875000, 2.130842}, {0.872997, 2.127003},
+              {0.871660, 2.125000}, {0.837309, 2.087308}, {0.754469, 1.995531},
+              {0.665543, 1.915543}, {0.625000, 1.878708}, {0.622773, 1.877227},
+              {0.618488, 1.875000}, {0.454463, 1.795537}, {0.375000, 1.762816},
+              {0.254983, 1.745017}, {0.243587, 1.743587}, {0.125000, 1.726688},
+              {0.006413, 1.743587}, {-0.004983, 1.745017}, {-0.125000, 1.762816},
+              {-0.204463, 1.795537}, {-0.368488, 1.875000}, {-0.372773, 1.877227},
+              {-0.375000, 1.878708}, {-0.415543, 1.915543}, {-0.504469, 1.995531},
+              {-0.587309, 2.087308}, {-0.621660, 2.125000}, {-0.622997, 2.127003},
+              {-0.625000, 2.130842}, {-0.704870, 2.295130}, {-0.737876, 2.375000},
+              {-0.755669, 2.494331}, {-0.757306, 2.507306}, {-0.774168, 2.625000},
+              {-0.757394, 2.742606}, {-0.755746, 2.755746}, {-0.738041, 2.875000},
+              {-0.705012, 2.955012}, {-0.625000, 3.119688}, {-0.623180, 3.123180},
+              {-0.621964, 3.125000}, {-0.590644, 3.159356}, {-0.504627, 3.254627},
+              {-0.413103, 3.336896}, {-0.375000, 3.371495}, {-0.372894, 3.372894},
+              {-0.368839, 3.375000}, {-0.204525, 3.454525}, {-0.125000, 3.487232},
+              {-0.005005, 3.505005}, {0.006438, 3.506438}, {0.125000, 3.523312},
+              {0.243562, 3.506438}, {0.255005, 3.505005}, {0.375000, 3.487232},
+              {0.454525, 3.454525}},
+         },
+     }},
+};
+
+// Rings at each contour of the conrec grid
+const expected_t kConrecRings = {
+    {150000,
+     {
+         {
+         },
+     }},
+    {100000,
+     {
+         {
+             {{0.454497, -2.045503}, {0.618710, -2.125000}, {0.622850, -2.127150},
+              {0.625000, -2.128579}, {0.663846, -2.163846}, {0.754593, -2.245407},
+              {0.840474, -2.340474}, {0.871964, -2.375000}, {0.873180, -2.376820},
+              {0.875000, -2.380305}, {0.955093, -2.544907}, {0.988221, -2.625000},
+              {1.005989, -2.744011}, {1.007721, -2.757721}, {1.024545, -2.875000},
+              {1.007827, -2.992173}, {1.006082, -3.006082}, {0.988419, -3.125000},
+              {0.955263, -3.205263}, {0.875000, -3.370332}, {0.873399, -3.373399},
+              {0.872330, -3.375000}, {0.844525, -3.405475}, {0.754782, -3.504782},
+              {0.660956, -3.589044}, {0.625000, -3.621665}, {0.622996, -3.622996},
+              {0.619132, -3.625000}, {0.454571, -3.704571}, {0.375000, -3.737267},
+              {0.255021, -3.755021}, {0.243544, -3.756457}, {0.125000, -3.773312},
+              {0.006456, -3.756457}, {-0.005021, -3.755021}, {-0.125000, -3.737267},
+              {-0.204571, -3.704571}, {-0.369132, -3.625000}, {-0.372996, -3.622996},
+              {-0.375000, -3.621665}, {-0.410956, -3.589044}, {-0.504782, -3.504782},
+              {-0.594525, -3.405475}, {-0.622330, -3.375000}, {-0.623399, -3.373399},
+              {-0.625000, -3.370332}, {-0.705263, -3.205263}, {-0.738419, -3.125000},
+              {-0.756082, -3.006082}, {-0.757827, -2.992173}, {-0.774545, -2.875000},
+              {-0.757721, -2.757721}, {-0.755989, -2.744011}, {-0.738221, -2.625000},
+              {-0.705093, -2.544907}, {-0.625000, -2.380305}, {-0.623180, -2.376820},
+              {-0.621964, -2.375000}, {-0.590474, -2.340474}, {-0.504593, -2.245407},
+              {-0.413846, -2.163846}, {-0.375000, -2.128579}, {-0.372850, -2.127150},
+              {-0.368710, -2.125000}, {-0.204497, -2.045503}, {-0.125000, -2.012789},
+              {-0.004995, -1.995005}, {0.006426, -1.993574}, {0.125000, -1.976688},
+              {0.243574, -1.993574}, {0.254995, -1.995005}, {0.375000, -2.012789},
+              {0.454497, -2.045503}},
+             {{0.454525, 3.454525}, {0.618839, 3.375000}, {0.622894, 3.372894},
+              {0.625000, 3.371495}, {0.663103, 3.336896}, {0.754627, 3.254627},
+              {0.840644, 3.159356}, {0.871964, 3.125000}, {0.873180, 3.123180},
+              {0.875000, 3.119688}, {0.955012, 2.955012}, {0.988041, 2.875000},
+              {1.005746, 2.755746}, {1.007394, 2.742606}, {1.024168, 2.625000},
+              {1.007306, 2.507306}, {1.005669, 2.494331}, {0.987876, 2.375000},
+              {0.954870, 2.295130}, {0.875000, 2.130842}, {0.872997, 2.127003},
+              {0.871660, 2.125000}, {0.837309, 2.087308}, {0.754469, 1.995531},
+              {0.665543, 1.915543}, {0.625000, 1.878708}, {0.622773, 1.877227},
+              {0.618488, 1.875000}, {0.454463, 1.795537}, {0.375000, 1.762816},
+              {0.254983, 1.745017}, {0.243587, 1.743587}, {0.125000, 1.726688},
+              {0.006413, 1.743587}, {-0.004983, 1.745017}, {-0.125000, 1.762816},
+              {-0.204463, 1.795537}, {-0.368488, 1.875000}, {-0.372773, 1.877227},
+              {-0.375000, 1.878708}, {-0.415543, 1.915543}, {-0.504469, 1.995531},
+              {-0.587309, 2.087308}, {-0.621660, 2.125000}, {-0.622997, 2.127003},
+              {-0.625000, 2.130842}, {-0.704870, 2.295130}, {-0.737876, 2.375000},
+              {-0.755669, 2.494331}, {-0.757306, 2.507306}, {-0.774168, 2.625000},
+              {-0.757394, 2.742606}, {-0.755746, 2.755746}, {-0.738041, 2.875000},
+              {-0.705012, 2.955012}, {-0.625000, 3.119688}, {-0.623180, 3.123180},
+              {-0.621964, 3.125000}, {-0.590644, 3.159356}, {-0.504627, 3.254627},
+              {-0.413103, 3.336896}, {-0.375000, 3.371495}, {-0.372894, 3.372894},
+              {-0.368839, 3.375000}, {-0.204525, 3.454525}, {-0.125000, 3.487232},
+              {-0.005005, 3.505005}, {0.006438, 3.506438}, {0.125000, 3.523312},
+              {0.243562, 3.506438}, {0.255005, 3.505005}, {0.375000, 3.487232},
+              {0.454525, 3.454525}},
+         },
+     }},
+};
+
+// Order points by longitude then latitude, equal within the precision of the expected contours
+bool less(const PointLL& a, const PointLL& b) {
+  if (std::abs(a.first - b.first) > 1e-5f)
+    return a.first < b.first;
+  return std::abs(a.second - b.second) > 1e-5f && a.second < b.second;
+}
+
+// Rings may start at any of their points and, like lines, go either way depending on
+// the order their segments are joined in. Start rings at their least point towards its
+// least neighbor and lines at their least end.
+std::vector<PointLL> canonical(std::vector<PointLL> line) {
+  if (line.size() > 2 && line.front() == line.back()) {
+    line.pop_back();
+    std::rotate(line.begin(), std::min_element(line.begin(), line.end(), less), line.end());
+    if (less(line.back(), line[1])) {
+      std::reverse(std::next(line.begin()), line.end());
+    }
+    line.push_back(line.front());
+  } else if (!line.empty() && less(line.back(), line.front())) {
+    std::reverse(line.begin(), line.end());
+  }
+  return line;
+}
+
+void check_contours(const GriddedData<PointLL>::contours_t& contours, const expected_t& expected) {
+  if (contours.size() != expected.size())
+    throw std::logic_error("Expected " + std::to_string(expected.size()) + " contours");
+  auto contour = contours.begin();
+  for (const auto& expected_contour : expected) {
+    const auto iso = std::to_string(expected_contour.first);
+    const auto& features = expected_contour.second;
+    if (contour->first != expected_contour.first || contour->second.size() != features.size())
+      throw std::logic_error("Expected " + std::to_string(features.size()) + " features at " + iso);
+    auto feature = contour->second.begin();
+    for (const auto& expected_feature : features) {
+      if (feature->size() != expected_feature.size())
+        throw std::logic_error("Wrong number of lines in a feature at " + iso);
+      auto line = feature->begin();
+      for (const auto& expected_line : expected_feature) {
+        const auto got = canonical({line->begin(), line->end()});
+        const auto want = canonical(expected_line);
+        if (got.size() != want.size())
+          throw std::logic_error("Expected a line of " + std::to_string(want.size()) +
+                                 " points at " + iso + ", got " + std::to_string(got.size()));
+        for (size_t i = 0; i < got.size(); ++i) {
+          if (less(got[i], want[i]) || less(want[i], got[i]))
+            throw std::logic_error("Point " + std::to_string(i) + " of a line at " + iso +
+                                   " differs from the expected contour");
+        }
+        ++line;
+      }
+      ++feature;
+    }
+    ++contour;
+  }
+}
+
+void test_conrec() {
+  // The same contours as before, on any number of threads
+  auto g = conrec_grid();
+  for (uint32_t threads : {1, 3}) {
+    check_contours(g.GenerateContours({100000, 150000}, false, 0.f, 0.f, threads), kConrecLines);
+    check_contours(g.GenerateContours({100000, 150000}, true, 0.f, 0.f, threads), kConrecRings);
+  }
+}
+
 } // namespace
 
 int main() {
   test::suite suite("gridded");
 
   suite.test(TEST_CASE(test_gridded));
+  suite.test(TEST_CASE(test_threads));
+  suite.test(TEST_CASE(test_sparse));
+  suite.test(TEST_CASE(test_conrec));
 
   return suite.tear_down();
 }
@@ -1,5 +1,6 @@
 #include "test.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -107,6 +108,35 @@ void test_isochrones() {
 #endif
 }
 
+void test_batch_isochrones() {
+  // Compute the origins on 2 threads
+  auto batch_config = config;
+  batch_config.put("thor.isochrone_concurrency", 2);
+  loki_worker_t loki_worker(batch_config);
+  thor_worker_t thor_worker(batch_config);
+
+  const auto test_request =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321},{"lat":52.093,"lon":5.110}],"costing":"auto","contours":[{"time":10}],"polygons":true})";
+  Api request;
+  ParseApi(test_request, Options::batch_isochrone, request);
+  loki_worker.batch_isochrones(request);
+  std::vector<std::string> lines;
+  thor_worker.batch_isochrones(request, [&lines](const std::string& line) { lines.push_back(line); });
+
+  // One line per origin, in any order
+  if (lines.size() != 2) {
+    throw std::runtime_error("Expected one line per origin");
+  }
+  for (const auto* origin : {"\"origin\":0", "\"origin\":1"}) {
+    if (std::count_if(lines.begin(), lines.end(), [origin](const std::string& line) {
+          return line.find(origin) != std::string::npos &&
+                 line.find("\"type\":\"Polygon\"") != std::string::npos && line.back() == '\n';
+        }) != 1) {
+      throw std::runtime_error(std::string("Expected the contours of ") + origin);
+    }
+  }
+}
+
 int main(int argc, char* argv[]) {
   test::suite suite("isochrones");
 
@@ -115,5 +145,7 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_isochrones));
 
+  suite.test(TEST_CASE(test_batch_isochrones));
+
   return suite.tear_down();
 }
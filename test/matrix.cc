@@ -1,6 +1,7 @@
 #include "test.h"
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,7 @@
 #include "loki/worker.h"
 #include "midgard/logging.h"
 #include "sif/dynamiccost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/worker.h"
@@ -39,6 +41,10 @@ public:
   ~SimpleCost() {
   }
 
+  std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<SimpleCost>(*this);
+  }
+
   uint32_t access_mode() const {
     return kAutoAccess;
   }
@@ -315,6 +321,177 @@ void test_matrix() {
   }
 }
 
+void test_bucket_matrix() {
+  loki_worker_t loki_worker(config);
+
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  GraphReader reader(config.get_child("mjolnir"));
+
+  cost_ptr_t costing = CreateSimpleCost(request.options());
+
+  BucketMatrix bucket_matrix;
+  std::vector<TimeDistance> results;
+  results = bucket_matrix.SourceToTarget(request.options().sources(), request.options().targets(),
+                                         reader, &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != matrix_answers.size()) {
+    throw std::logic_error("BucketMatrix returned the wrong number of results");
+  }
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    if (!within_tolerance(results[i].dist, matrix_answers[i].dist)) {
+      throw std::runtime_error("result " + std::to_string(i) +
+                               "'s distance is not close enough"
+                               " to expected value for BucketMatrix. Expected: " +
+                               std::to_string(matrix_answers[i].dist) +
+                               " Actual: " + std::to_string(results[i].dist));
+    }
+    if (!within_tolerance(results[i].time, matrix_answers[i].time)) {
+      throw std::runtime_error("result " + std::to_string(i) +
+                               "'s time is not close enough"
+                               " to expected value for BucketMatrix. Expected: " +
+                               std::to_string(matrix_answers[i].time) +
+                               " Actual: " + std::to_string(results[i].time));
+    }
+  }
+}
+
+void test_timedistance_matrix_threads() {
+  loki_worker_t loki_worker(config);
+
+  // Repeat the first source so there are more sources than targets (many to
+  // one searches) and two sources share the same edges
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  auto& options = *request.mutable_options();
+  options.mutable_sources()->Add()->CopyFrom(options.sources(0));
+  loki_worker.matrix(request);
+  adjust_scores(options);
+
+  GraphReader reader(config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(options);
+
+  auto reader_config = config.get_child("mjolnir");
+  reader_config.put("global_synchronized_cache", true);
+  std::vector<std::shared_ptr<GraphReader>> readers;
+  for (int i = 0; i < 2; ++i) {
+    readers.push_back(std::make_shared<GraphReader>(reader_config));
+  }
+  TimeDistanceMatrix timedist_matrix;
+  timedist_matrix.set_thread_readers(readers);
+  timedist_matrix.set_share_searches(true);
+  auto results = timedist_matrix.SourceToTarget(options.sources(), options.targets(), reader,
+                                                &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != matrix_answers.size() + options.targets_size()) {
+    throw std::logic_error("TimeDistanceMatrix returned the wrong number of results");
+  }
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    const auto& expected = matrix_answers[i % matrix_answers.size()];
+    if (!within_tolerance(results[i].dist, expected.dist) ||
+        !within_tolerance(results[i].time, expected.time)) {
+      throw std::runtime_error("result " + std::to_string(i) +
+                               " is not close enough to the expected value for threaded "
+                               "TimeDistanceMatrix. Expected: " +
+                               std::to_string(expected.time) + "s " +
+                               std::to_string(expected.dist) +
+                               "m Actual: " + std::to_string(results[i].time) + "s " +
+                               std::to_string(results[i].dist) + "m");
+    }
+  }
+}
+
+void test_matrix_threads() {
+  loki_worker_t loki_worker(config);
+
+  // Use every location as source and target, twice, so there are enough locations
+  // to expand the searches on up to 4 threads
+  Api request;
+  ParseApi(test_request, Options::sources_to_targets, request);
+  auto& options = *request.mutable_options();
+  const uint32_t original_count = options.sources_size();
+  for (const auto& target : options.targets()) {
+    options.mutable_sources()->Add()->CopyFrom(target);
+  }
+  for (uint32_t i = 0; i < 2 * original_count; ++i) {
+    options.mutable_sources()->Add()->CopyFrom(options.sources(i));
+  }
+  options.mutable_targets()->CopyFrom(options.sources());
+  loki_worker.matrix(request);
+  adjust_scores(options);
+
+  GraphReader reader(config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(options);
+
+  auto reader_config = config.get_child("mjolnir");
+  reader_config.put("global_synchronized_cache", true);
+  std::vector<std::shared_ptr<GraphReader>> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.push_back(std::make_shared<GraphReader>(reader_config));
+  }
+
+  // Searches expand batches of edges with any thread readers, 2 and 4 threads
+  // must give the same results
+  CostMatrix two_threads;
+  two_threads.set_thread_readers({readers.front()});
+  auto expected = two_threads.SourceToTarget(options.sources(), options.targets(), reader,
+                                             &costing, TravelMode::kDrive, 400000.0);
+  CostMatrix threaded_matrix;
+  threaded_matrix.set_thread_readers(readers);
+  auto results = threaded_matrix.SourceToTarget(options.sources(), options.targets(), reader,
+                                                &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != expected.size()) {
+    throw std::logic_error("Threaded CostMatrix returned a different number of results");
+  }
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    if (results[i].dist != expected[i].dist || results[i].time != expected[i].time) {
+      throw std::runtime_error("result " + std::to_string(i) +
+                               " of threaded CostMatrix differs. Expected: " +
+                               std::to_string(expected[i].time) + "s " +
+                               std::to_string(expected[i].dist) +
+                               "m Actual: " + std::to_string(results[i].time) + "s " +
+                               std::to_string(results[i].dist) + "m");
+    }
+  }
+
+  // The original sources to the original targets (the second locations) have the
+  // known answers, so both matrices cannot be wrong in the same way
+  auto check_answers = [&](const std::vector<TimeDistance>& results, const uint32_t targets,
+                           const uint32_t first_target) {
+    for (uint32_t source = 0; source < original_count; ++source) {
+      for (uint32_t target = 0; target < original_count; ++target) {
+        const auto& result = results[source * targets + first_target + target];
+        const auto& answer = matrix_answers[source * original_count + target];
+        if (!within_tolerance(result.dist, answer.dist) ||
+            !within_tolerance(result.time, answer.time)) {
+          throw std::runtime_error("result " + std::to_string(source) + "," +
+                                   std::to_string(target) +
+                                   " is not close enough to the expected value for threaded "
+                                   "CostMatrix. Expected: " +
+                                   std::to_string(answer.time) + "s " +
+                                   std::to_string(answer.dist) + "m Actual: " +
+                                   std::to_string(result.time) + "s " +
+                                   std::to_string(result.dist) + "m");
+        }
+      }
+    }
+  };
+  check_answers(results, options.targets_size(), original_count);
+
+  // Only the original sources and targets are too few locations for a second
+  // thread, the batches are expanded on this one
+  auto& few = *request.mutable_options();
+  few.mutable_sources()->DeleteSubrange(original_count, 3 * original_count);
+  few.mutable_targets()->DeleteSubrange(2 * original_count, 2 * original_count);
+  few.mutable_targets()->DeleteSubrange(0, original_count);
+  CostMatrix one_thread;
+  one_thread.set_thread_readers(readers);
+  check_answers(one_thread.SourceToTarget(few.sources(), few.targets(), reader, &costing,
+                                          TravelMode::kDrive, 400000.0),
+                few.targets_size(), 0);
+}
+
 void test_matrix_osrm() {
   loki_worker_t loki_worker(config);
 
@@ -376,6 +553,9 @@ int main(int argc, char* argv[]) {
   logging::Configure({{"type", ""}}); // silence logs
 
   suite.test(TEST_CASE(test_matrix));
+  suite.test(TEST_CASE(test_matrix_threads));
+  suite.test(TEST_CASE(test_bucket_matrix));
+  suite.test(TEST_CASE(test_timedistance_matrix_threads));
   // suite.test(TEST_CASE(test_matrix_osrm));
 
   return suite.tear_down();
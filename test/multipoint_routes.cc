@@ -64,8 +64,8 @@ boost::property_tree::ptree get_conf() {
 }
 
 struct route_tester {
-  route_tester()
-      : conf(get_conf()), reader(new GraphReader(conf.get_child("mjolnir"))),
+  route_tester(const boost::property_tree::ptree& config = get_conf())
+      : conf(config), reader(new GraphReader(conf.get_child("mjolnir"))),
         loki_worker(conf, reader), thor_worker(conf, reader), odin_worker(conf) {
   }
   Api test(const std::string& request_json) {
@@ -334,6 +334,27 @@ void test_mid_break_through_arrive_by() {
   test_mid_break_through(R"(,"date_time":{"type":2,"value":"2016-07-03T08:06"}})");
 }
 
+void test_concurrent_legs() {
+  // Legs are computed on separate threads except for the one continuing through a location
+  auto conf = get_conf();
+  conf.put("thor.leg_concurrency", 3);
+  route_tester sequential;
+  route_tester concurrent(conf);
+  std::string request =
+      R"({"locations":[{"lat":52.09015,"lon":5.06362},{"lat":52.09041,"lon":5.06337,"type":"via"},{"lat":52.10205,"lon":5.09720},{"lat":52.08917,"lon":5.11401,"type":"through"},{"lat":52.09015,"lon":5.06362}],"costing":"auto"})";
+  auto expected = sequential.test(request);
+  auto response = concurrent.test(request);
+
+  const auto& expected_legs = expected.trip().routes(0).legs();
+  const auto& legs = response.trip().routes(0).legs();
+  if (legs.size() != 2 || expected_legs.size() != legs.size())
+    throw std::logic_error("Should have two legs");
+  for (int i = 0; i < legs.size(); ++i) {
+    if (legs.Get(i).shape() != expected_legs.Get(i).shape())
+      throw std::logic_error("Concurrently computed legs should match the sequential ones");
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -369,5 +390,8 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_mid_break_through_arrive_by));
 
+  // legs computed concurrently
+  suite.test(TEST_CASE(test_concurrent_legs));
+
   return suite.tear_down();
 }
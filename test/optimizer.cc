@@ -13,9 +13,11 @@ namespace {
 
 void TryOptimizer(const uint32_t nlocs,
                   const std::vector<float>& costs,
-                  const std::vector<uint32_t>& expected_order) {
+                  const std::vector<uint32_t>& expected_order,
+                  const uint32_t threads = 1) {
   Optimizer optimizer;
   optimizer.Seed(111111);
+  optimizer.set_threads(threads);
   auto order = optimizer.Solve(nlocs, costs);
   if (order != expected_order) {
     throw runtime_error("TryOptimizer: expected order failed");
@@ -36,6 +38,9 @@ void TestOptimizer() {
                               2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854,  2000, 0};
   std::vector<uint32_t> expected_order = {0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10};
   TryOptimizer(11, costs, expected_order);
+
+  // Restarts running on several threads find the same tour
+  TryOptimizer(11, costs, expected_order, 3);
 }
 
 } // namespace
@@ -0,0 +1,107 @@
+#include "test.h"
+
+#include "baldr/rapidjson_utils.h"
+#include "tyr/actor.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace valhalla;
+
+namespace {
+
+// The test tiles are much smaller than the default minimum distance of the
+// concurrent searches, with no minimum every bidirectional route runs them
+boost::property_tree::ptree get_conf(const bool parallel) {
+  std::stringstream ss;
+  ss << R"({
+      "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
+      "loki":{
+        "actions":["route"],
+        "logging":{"long_request": 100},
+        "service_defaults":{"minimum_reachability": 50,"radius": 0,"search_cutoff": 35000, "node_snap_tolerance": 5, "street_side_tolerance": 5, "heading_tolerance": 60}
+      },
+      "thor":{"logging":{"long_request": 110}, "parallel_bidirectional": )"
+     << (parallel ? "true" : "false") << R"(, "parallel_bidirectional_min_distance": 0},
+      "odin":{"logging":{"long_request": 110}},
+      "skadi":{"actons":["height"],"logging":{"long_request": 5}},
+      "meili":{"customizable": ["turn_penalty_factor","max_route_distance_factor","max_route_time_factor","search_radius"],
+              "mode":"auto","grid":{"cache_size":100240,"size":500},
+              "default":{"beta":3,"breakage_distance":2000,"geometry":false,"gps_accuracy":5.0,"interpolation_distance":10,
+              "max_route_distance_factor":5,"max_route_time_factor":5,"max_search_radius":200,"route":true,
+              "search_radius":15.0,"sigma_z":4.07,"turn_penalty_factor":200}},
+      "service_limits": {
+        "auto": {"max_distance": 5000000.0, "max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "auto_shorter": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "bicycle": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+        "bus": {"max_distance": 5000000.0,"max_locations": 50,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "hov": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+        "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 1,"max_time": 120},
+        "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,"max_alternates":2,
+        "multimodal": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 0.0,"max_matrix_locations": 0},
+        "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
+        "skadi": {"max_shape": 750000,"min_resample": 10.0},
+        "trace": {"max_distance": 200000.0,"max_gps_accuracy": 100.0,"max_search_radius": 100,"max_shape": 16000,"max_best_paths":4,"max_best_paths_shape":100},
+        "transit": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+        "truck": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50}
+      }
+    })";
+  boost::property_tree::ptree conf;
+  rapidjson::read_json(ss, conf);
+  return conf;
+}
+
+std::string route(tyr::actor_t& actor, const std::string& request) {
+  try {
+    return actor.route(request);
+  } catch (const std::exception& e) { return e.what(); }
+}
+
+void TestParallelEqualsSerial() {
+  tyr::actor_t parallel(get_conf(true), true);
+  tyr::actor_t serial(get_conf(false), true);
+
+  // Routes across the city in both directions, for a costing specialized by the
+  // search loops and one that is not
+  const std::vector<std::string> locations = {
+      R"({"lat":52.09620,"lon":5.11520})", R"({"lat":52.07850,"lon":5.11540})",
+      R"({"lat":52.11460,"lon":5.05290})", R"({"lat":52.06325,"lon":5.12770})",
+      R"({"lat":52.12480,"lon":5.14130})", R"({"lat":52.08450,"lon":5.17900})",
+  };
+  size_t routes = 0;
+  for (const std::string costing : {"auto", "pedestrian"}) {
+    for (const auto& from : locations) {
+      for (const auto& to : locations) {
+        if (from == to) {
+          continue;
+        }
+        const std::string request =
+            R"({"locations":[)" + from + "," + to + R"(],"costing":")" + costing + R"("})";
+        const auto expected = route(serial, request);
+        const auto got = route(parallel, request);
+        if (got != expected) {
+          throw std::logic_error("Parallel route differs for " + request + ":\n" + got +
+                                 "\nexpected:\n" + expected);
+        }
+        routes += expected.find("\"trip\"") != std::string::npos;
+        parallel.cleanup();
+        serial.cleanup();
+      }
+    }
+  }
+  if (routes == 0) {
+    throw std::logic_error("No route was found");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("parallel_bidirectional");
+
+  suite.test(TEST_CASE(TestParallelEqualsSerial));
+
+  return suite.tear_down();
+}
@@ -154,6 +154,53 @@ void test_recover_shortcut_edges() {
     throw std::logic_error("More than 0.1% is too much");
 }
 
+void test_stored_shortcut_edges() {
+  auto conf = get_conf();
+  GraphReader graphreader(conf.get_child("mjolnir"));
+
+  size_t shortcuts = 0;
+  size_t stored = 0;
+  for (const auto& level : TileHierarchy::levels()) {
+    if (level.first > 1)
+      continue;
+
+    auto tileset = graphreader.GetTileSet(level.first);
+    for (const auto tileid : tileset) {
+      if (graphreader.OverCommitted())
+        graphreader.Trim();
+
+      // every stored expansion must chain from the shortcut's begin node to its end node
+      const auto* tile = graphreader.GetGraphTile(tileid);
+      for (uint32_t j = 0; j < tile->header()->directededgecount(); ++j) {
+        const auto* edge = tile->directededge(j);
+        if (!edge->is_shortcut())
+          continue;
+        ++shortcuts;
+
+        auto edges = tile->GetShortcutEdges(j);
+        if (edges.size() == 0)
+          continue;
+        ++stored;
+
+        GraphId shortcutid = tileid;
+        shortcutid.set_id(j);
+        GraphId node = graphreader.edge_startnode(shortcutid);
+        for (const auto& edgeid : edges) {
+          if (graphreader.edge_startnode(edgeid) != node)
+            throw std::logic_error("Stored shortcut edges are not connected");
+          const auto* de = graphreader.directededge(edgeid);
+          node = de->endnode();
+        }
+        if (node != edge->endnode())
+          throw std::logic_error("Stored shortcut edges do not end at the shortcut end node");
+      }
+    }
+  }
+  printf("stored: %zu, shortcuts: %zu\n", stored, shortcuts);
+  if (shortcuts > 0 && stored == 0)
+    throw std::logic_error("No shortcut edges were stored in the tiles");
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -163,5 +210,7 @@ int main(int argc, char* argv[]) {
 
   suite.test(TEST_CASE(test_recover_shortcut_edges));
 
+  suite.test(TEST_CASE(test_stored_shortcut_edges));
+
   return suite.tear_down();
 }
@@ -0,0 +1,117 @@
+#include "test.h"
+
+#include "thor/routecache.h"
+#include "worker.h"
+
+#include <string>
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+Api get_request(const std::string& extra) {
+  Api request;
+  ParseApi(R"({"locations":[{"lat":52.09,"lon":5.11},{"lat":52.10,"lon":5.12}],"costing":"auto")" +
+               extra + "}",
+           Options::route, request);
+  return request;
+}
+
+// A request with a trip of one route with one leg of the given shape
+Api get_routed(const std::string& extra, const std::string& shape) {
+  Api request = get_request(extra);
+  request.mutable_trip()->add_routes()->add_legs()->set_shape(shape);
+  return request;
+}
+
+void TestKey() {
+  // What only changes the response does not change the key
+  const auto a = get_request("");
+  const auto b = get_request(R"(,"id":"abc","units":"miles","language":"de-DE")");
+  if (RouteCache::Key(a.options()) != RouteCache::Key(b.options())) {
+    throw std::logic_error("Response only options should not change the key");
+  }
+
+  const auto c = get_request(R"(,"costing_options":{"auto":{"use_highways":0.2}})");
+  if (RouteCache::Key(a.options()) == RouteCache::Key(c.options())) {
+    throw std::logic_error("Costing options should change the key");
+  }
+  const auto d = get_request(R"(,"date_time":{"type":1,"value":"2019-11-21T11:05"})");
+  if (RouteCache::Key(a.options()) == RouteCache::Key(d.options())) {
+    throw std::logic_error("Date time should change the key");
+  }
+
+  // Requests for the current time share the key within the time bucket
+  const auto e = get_request(R"(,"date_time":{"type":0})");
+  const std::time_t now = 1000 * kRouteCacheCurrentTimeBucket;
+  if (RouteCache::Key(e.options(), now) !=
+      RouteCache::Key(e.options(), now + kRouteCacheCurrentTimeBucket - 1)) {
+    throw std::logic_error("Current time should share the key within the bucket");
+  }
+  if (RouteCache::Key(e.options(), now) ==
+      RouteCache::Key(e.options(), now + kRouteCacheCurrentTimeBucket)) {
+    throw std::logic_error("Current time should change the key in the next bucket");
+  }
+}
+
+void TestGetPut() {
+  RouteCache cache(2);
+  auto routed = get_routed("", "abc");
+  const auto key = RouteCache::Key(routed.options());
+
+  Api request = get_request("");
+  if (cache.Get(key, 1, request) || cache.misses() != 1) {
+    throw std::logic_error("Nothing should be cached yet");
+  }
+  cache.Put(key, 1, routed);
+  if (!cache.Get(key, 1, request) || cache.hits() != 1) {
+    throw std::logic_error("Route should be cached");
+  }
+  if (request.trip().routes_size() != 1 || request.trip().routes(0).legs(0).shape() != "abc") {
+    throw std::logic_error("Cached trip should be restored");
+  }
+
+  // A different graph empties the cache
+  if (cache.Get(key, 2, request) || cache.size() != 0) {
+    throw std::logic_error("A new dataset should empty the cache");
+  }
+}
+
+void TestEviction() {
+  RouteCache cache(2);
+  const auto a = get_routed("", "a");
+  const auto b = get_routed(R"(,"alternates":1)", "b");
+  const auto c = get_routed(R"(,"alternates":2)", "c");
+  const auto key_a = RouteCache::Key(a.options());
+  const auto key_b = RouteCache::Key(b.options());
+  const auto key_c = RouteCache::Key(c.options());
+
+  // Using a makes b the least recently used, evicted by c
+  Api request;
+  cache.Put(key_a, 1, a);
+  cache.Put(key_b, 1, b);
+  cache.Get(key_a, 1, request);
+  cache.Put(key_c, 1, c);
+  if (cache.size() != 2) {
+    throw std::logic_error("Expected 2 cached routes but got " + std::to_string(cache.size()));
+  }
+  if (!cache.Get(key_a, 1, request) || cache.Get(key_b, 1, request) ||
+      !cache.Get(key_c, 1, request)) {
+    throw std::logic_error("The least recently used route should be evicted");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("routecache");
+
+  suite.test(TEST_CASE(TestKey));
+
+  suite.test(TEST_CASE(TestGetPut));
+
+  suite.test(TEST_CASE(TestEviction));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,114 @@
+#include "test.h"
+
+#include "baldr/double_bucket_queue.h"
+#include "thor/searchmemory.h"
+#include "worker.h"
+
+#include <string>
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+constexpr size_t kKB = 1 << 10;
+constexpr size_t kMB = 1 << 20;
+
+void TestRequestLimit() {
+  SearchMemory memory(kMB);
+  size_t a = 0, b = 0;
+  memory.Update(a, 512 * kKB);
+  memory.Update(b, 256 * kKB);
+  if (memory.peak() != 768 * kKB) {
+    throw std::logic_error("Wrong peak " + std::to_string(memory.peak()));
+  }
+
+  // Small changes are not reported
+  memory.Update(a, 512 * kKB + 1000);
+  if (a != 512 * kKB) {
+    throw std::logic_error("Small changes should not be reported");
+  }
+
+  // The bytes of the search exceeding the limit are held until it is released
+  try {
+    memory.Update(b, 768 * kKB);
+    throw std::logic_error("The request limit should be exceeded");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 447 || e.http_code != 400 || b != 768 * kKB) {
+      throw std::logic_error("Wrong error " + std::string(e.what()));
+    }
+  }
+  memory.Release(b);
+  memory.Update(b, 256 * kKB);
+  if (memory.peak() != 1280 * kKB) {
+    throw std::logic_error("Peak should be kept until it is reset");
+  }
+  memory.ResetPeak();
+  if (memory.peak() != 768 * kKB) {
+    throw std::logic_error("Peak should restart from the held bytes");
+  }
+  memory.Release(a);
+  memory.Release(b);
+  if (a != 0 || b != 0 || SearchMemory::process_used() != 0) {
+    throw std::logic_error("All bytes should be released");
+  }
+}
+
+void TestProcessLimit() {
+  // The budgets of two workers share the process limit
+  SearchMemory first(0, kMB), second(0, kMB);
+  std::vector<size_t> held(2, 0);
+  first.Update(held[0], 768 * kKB);
+  try {
+    second.Update(held[1], 512 * kKB);
+    throw std::logic_error("The process limit should be exceeded");
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 448 || e.http_code != 503) {
+      throw std::logic_error("Wrong error " + std::string(e.what()));
+    }
+  }
+  if (second.peak() != 512 * kKB || SearchMemory::process_used() != 1280 * kKB) {
+    throw std::logic_error("Both searches should be accounted for");
+  }
+  first.Release(held[0]);
+  second.Release(held);
+  if (SearchMemory::process_used() != 0) {
+    throw std::logic_error("All bytes should be released");
+  }
+}
+
+void TestQueueMemory() {
+  std::vector<float> costs{10.0f, 20.0f, 500.0f};
+  baldr::DoubleBucketQueue queue(0.0f, 100.0f, 1, [&costs](const uint32_t label) {
+    return costs[label];
+  });
+  const size_t empty = queue.memory();
+  if (empty < 101 * sizeof(baldr::bucket_t)) {
+    throw std::logic_error("The buckets should be accounted for");
+  }
+  for (uint32_t label = 0; label < costs.size(); ++label) {
+    queue.add(label);
+  }
+  queue.pop();
+  if (queue.memory() != empty + 2 * sizeof(uint32_t)) {
+    throw std::logic_error("The labels held should be accounted for");
+  }
+  queue.clear();
+  if (queue.memory() != empty) {
+    throw std::logic_error("Cleared labels should not be accounted for");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("searchmemory");
+
+  suite.test(TEST_CASE(TestRequestLimit));
+
+  suite.test(TEST_CASE(TestProcessLimit));
+
+  suite.test(TEST_CASE(TestQueueMemory));
+
+  return suite.tear_down();
+}
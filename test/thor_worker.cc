@@ -4,6 +4,7 @@
 #include "thor/attributes_controller.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
+#include <algorithm>
 #include <boost/property_tree/ptree.hpp>
 #include <thread>
 #include <unistd.h>
@@ -135,6 +136,82 @@ void test_parse_filter_attributes_includes() {
       throw std::logic_error("Expected " + included_keys[i] + " to be present");
   }
 }
+
+void test_matrix_jsonl() {
+  tyr::actor_t actor(conf, true);
+  std::string request = R"({"costing":"auto","format":"jsonl",
+      "sources":[{"lat":52.106337,"lon":5.101728},{"lat":52.111276,"lon":5.089717},
+                 {"lat":52.103105,"lon":5.081005}],
+      "targets":[{"lat":52.106126,"lon":5.101497},{"lat":52.100469,"lon":5.087099}]})";
+
+  // Lines are written one by one, header first and then a row per source
+  std::vector<std::string> lines;
+  actor.matrix(request, []() {}, [&lines](const std::string& line) { lines.push_back(line); });
+  if (lines.size() != 4)
+    throw std::logic_error("Expected a header and 3 rows, got " + std::to_string(lines.size()) +
+                           " lines");
+  if (!json_to_pt(lines.front()).get_child_optional("sources"))
+    throw std::logic_error("Expected the header to have the sources");
+  std::vector<bool> found(3, false);
+  for (size_t i = 1; i < lines.size(); ++i) {
+    if (lines[i].back() != '\n')
+      throw std::logic_error("Expected each line to end with a newline");
+    auto row = json_to_pt(lines[i]).get_child("sources_to_targets");
+    if (row.size() != 2)
+      throw std::logic_error("Expected a row to have 2 targets");
+    found[row.front().second.get<size_t>("from_index")] = true;
+  }
+  if (std::find(found.begin(), found.end(), false) != found.end())
+    throw std::logic_error("Expected a row for each source");
+
+  // The same lines are returned as the response
+  std::string jsonl = actor.matrix(request);
+  if (std::count(jsonl.begin(), jsonl.end(), '\n') != 4)
+    throw std::logic_error("Expected 4 lines in the json lines response");
+}
+
+// Expect a request to fail because its searches exceed the memory of a request
+template <class Action>
+void expect_request_memory_exceeded(const std::string& what, const Action& action) {
+  try {
+    action();
+  } catch (const valhalla_exception_t& e) {
+    if (e.code != 447)
+      throw std::logic_error("Expected " + what + " to fail with 447, got " +
+                             std::to_string(e.code));
+    return;
+  }
+  throw std::logic_error("Expected " + what + " to exceed the memory of a request");
+}
+
+void test_search_memory_limit() {
+  // 1 MB, much less than the searches across the test tiles need
+  auto limited = conf;
+  limited.put("service_limits.max_search_memory", 1);
+
+  const std::string locations = R"([{"lat":52.106337,"lon":5.101728},{"lat":52.111276,"lon":5.089717},
+      {"lat":52.103105,"lon":5.081005},{"lat":52.103948,"lon":5.06813},
+      {"lat":52.106126,"lon":5.101497},{"lat":52.100469,"lon":5.087099},
+      {"lat":52.094273,"lon":5.075254},{"lat":52.08450,"lon":5.17900}])";
+  const std::string matrix =
+      R"({"costing":"auto","sources":)" + locations + R"(,"targets":)" + locations + "}";
+  for (const auto& algorithm : {"costmatrix", "bucketmatrix"}) {
+    limited.put("thor.source_to_target_algorithm", algorithm);
+    tyr::actor_t actor(limited, true);
+    expect_request_memory_exceeded(std::string(algorithm) + " matrix",
+                                   [&]() { actor.matrix(matrix); });
+  }
+
+  tyr::actor_t actor(limited, true);
+  expect_request_memory_exceeded("route", [&]() {
+    actor.route(R"({"costing":"auto","locations":[{"lat":52.106337,"lon":5.101728},
+        {"lat":52.08450,"lon":5.17900}]})");
+  });
+  expect_request_memory_exceeded("isochrone", [&]() {
+    actor.isochrone(R"({"costing":"auto","locations":[{"lat":52.078937,"lon":5.115321}],
+        "contours":[{"time":60}]})");
+  });
+}
 } // namespace
 
 int main(void) {
@@ -146,5 +223,9 @@ int main(void) {
 
   suite.test(TEST_CASE(test_parse_filter_attributes_includes));
 
+  suite.test(TEST_CASE(test_matrix_jsonl));
+
+  suite.test(TEST_CASE(test_search_memory_limit));
+
   return suite.tear_down();
 }
@@ -0,0 +1,141 @@
+#include "test.h"
+
+#include "baldr/transitserviceday.h"
+
+#include <vector>
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+// Departures sorted by line Id and then time. Schedule 1 does not run today,
+// line 7 has a frequency based departure every 10 minutes from 08:00 to 09:00.
+const vector<TransitDeparture> departures{
+    {3, 1, 0, 0, 0, 28800, 60, 0, true, true},
+    {3, 2, 0, 0, 0, 30600, 60, 1, true, true},
+    {3, 3, 0, 0, 0, 32400, 60, 0, false, true},
+    {3, 4, 0, 0, 0, 36000, 60, 0, true, false},
+    {7, 5, 0, 0, 0, 28800, 32400, 600, 90, 0, true, true},
+    {7, 6, 0, 0, 0, 29100, 120, 0, true, true},
+};
+
+TransitServiceDay get_service_day() {
+  return TransitServiceDay(departures.data(), departures.size(),
+                           [](const TransitDeparture& d) { return d.schedule_index() == 0; });
+}
+
+void TestFixed() {
+  const auto day = get_service_day();
+  const auto* departure = day.GetNextDeparture(3, 28000, false, false);
+  if (departure == nullptr || departure->tripid() != 1) {
+    throw runtime_error("First departure of line 3 not found");
+  }
+  // Trip 2 does not run today
+  departure = day.GetNextDeparture(3, 28801, false, false);
+  if (departure == nullptr || departure->tripid() != 3 || departure != &departures[2]) {
+    throw runtime_error("Departures not running today should be skipped");
+  }
+  // Accessibility is checked from the index
+  departure = day.GetNextDeparture(3, 28801, true, false);
+  if (departure == nullptr || departure->tripid() != 4) {
+    throw runtime_error("Wheelchair accessible departure not found");
+  }
+  if (day.GetNextDeparture(3, 28801, true, true) != nullptr ||
+      day.GetNextDeparture(3, 36001, false, false) != nullptr ||
+      day.GetNextDeparture(5, 0, false, false) != nullptr) {
+    throw runtime_error("No departure should be found");
+  }
+}
+
+void TestFrequency() {
+  const auto day = get_service_day();
+  if (day.size() != 3 + 6 + 1) {
+    throw runtime_error("Expected one departure per run but got " + to_string(day.size()));
+  }
+
+  // Runs interleave with the fixed departures of the line
+  const auto* departure = day.GetNextDeparture(7, 28900, false, false);
+  if (departure == nullptr || departure->tripid() != 6 || departure->departure_time() != 29100) {
+    throw runtime_error("Fixed departure between runs not found");
+  }
+  departure = day.GetNextDeparture(7, 29101, false, false);
+  if (departure == nullptr || departure->tripid() != 5 || departure->departure_time() != 29400 ||
+      departure->type() != kFrequencySchedule) {
+    throw runtime_error("Run of the frequency based departure not found");
+  }
+  // The last run departs before the end time
+  departure = day.GetNextDeparture(7, 31801, false, false);
+  if (departure != nullptr) {
+    throw runtime_error("No run should depart at the end time");
+  }
+}
+
+void TestServiceDays() {
+  TransitServiceDays days;
+  uint32_t builds = 0;
+  const auto build = [&]() {
+    ++builds;
+    return make_shared<const TransitServiceDay>(get_service_day());
+  };
+  auto first = days.service_day(10, 2, false, build);
+  if (days.service_day(10, 2, false, build) != first || builds != 1) {
+    throw runtime_error("The same day should be built once");
+  }
+  if (days.service_day(11, 4, false, build) == first ||
+      days.service_day(10, 2, true, build) == first) {
+    throw runtime_error("Other days should get their own index");
+  }
+
+  // Asking for more days than kept drops the oldest, which stays valid for its holders
+  for (uint32_t day = 20; day < 20 + kMaxTransitServiceDays; ++day) {
+    days.service_day(day, 1, false, build);
+  }
+  if (days.service_day(10, 2, false, build) == first ||
+      first->GetNextDeparture(3, 28000, false, false) == nullptr) {
+    throw runtime_error("The oldest day should be dropped");
+  }
+}
+
+void TestMemory() {
+  // The bytes of the indexes count towards the counter of the cache holding the tile
+  auto counter = make_shared<atomic<size_t>>(0);
+  {
+    TransitServiceDays days;
+    const auto build = []() { return make_shared<const TransitServiceDay>(get_service_day()); };
+    const size_t bytes = days.service_day(10, 2, false, build)->memory();
+    days.attach(counter);
+    if (*counter != bytes) {
+      throw runtime_error("The bytes built before attaching should be counted");
+    }
+    days.service_day(11, 2, false, build);
+    if (*counter != 2 * bytes) {
+      throw runtime_error("The bytes of a new index should be counted");
+    }
+    for (uint32_t day = 20; day < 20 + 2 * kMaxTransitServiceDays; ++day) {
+      days.service_day(day, 1, false, build);
+    }
+    if (*counter != kMaxTransitServiceDays * bytes) {
+      throw runtime_error("Dropped indexes should not be counted");
+    }
+  }
+  if (*counter != 0) {
+    throw runtime_error("The bytes should be released with the indexes");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("transitserviceday");
+
+  suite.test(TEST_CASE(TestFixed));
+
+  suite.test(TEST_CASE(TestFrequency));
+
+  suite.test(TEST_CASE(TestServiceDays));
+
+  suite.test(TEST_CASE(TestMemory));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,129 @@
+#include "test.h"
+
+#include "thor/transittimetable.h"
+
+#include <string>
+#include <vector>
+
+using namespace valhalla;
+using namespace valhalla::thor;
+using namespace valhalla::baldr;
+
+namespace {
+
+// Stops 0 to 3 and lines 0 to 2. Trip 1 goes 0 -> 1 -> 2 along lines 0 and 1,
+// trip 2 goes 0 -> 3 along line 2 and is not wheelchair accessible.
+TransitTimetable get_timetable() {
+  TransitTimetable timetable;
+  for (uint32_t i = 0; i < 4; ++i) {
+    timetable.AddStop(GraphId(0, 3, i));
+  }
+  for (uint32_t i = 0; i < 3; ++i) {
+    timetable.AddLine(GraphId(0, 3, 10 + i));
+  }
+  timetable.Add({300, 400, 1, 2, 1, 1, 0, true, true});
+  timetable.Add({200, 300, 0, 1, 0, 1, 0, true, true});
+  timetable.Add({150, 500, 0, 3, 2, 2, 0, false, true});
+  timetable.Sort();
+  return timetable;
+}
+
+std::vector<StopArrival> at_stop(const uint32_t stop, const uint32_t time) {
+  std::vector<StopArrival> from(4);
+  from[stop].time = time;
+  return from;
+}
+
+void TestSort() {
+  const auto timetable = get_timetable();
+  uint32_t departure_time = 0;
+  for (const auto& connection : timetable.connections()) {
+    if (connection.departure_time < departure_time) {
+      throw std::logic_error("Connections should be sorted by departure time");
+    }
+    departure_time = connection.departure_time;
+  }
+  if (timetable.stop_index(GraphId(0, 3, 2)) != 2 ||
+      timetable.stop_index(GraphId(0, 3, 7)) != kUnreachedTime) {
+    throw std::logic_error("Wrong stop index");
+  }
+}
+
+void TestScanRound() {
+  const auto timetable = get_timetable();
+  const std::vector<bool> allowed(3, true);
+
+  // Both trips are boarded at stop 0, trip 1 is stayed on to stop 2
+  std::vector<TripArrival> to(4);
+  if (!timetable.ScanRound(at_stop(0, 100), 100, 10.0f, allowed, false, false, to)) {
+    throw std::logic_error("Stops should be reached");
+  }
+  if (to[1].time != 300 || to[2].time != 400 || to[3].time != 500 || to[0].time != kUnreachedTime) {
+    throw std::logic_error("Wrong arrival times");
+  }
+  // The cost is the transfer plus the time from reaching the stop (wait included)
+  if (to[2].cost != 310.0f) {
+    throw std::logic_error("Wrong arrival cost " + std::to_string(to[2].cost));
+  }
+  const auto trip = timetable.TripConnections(to[2]);
+  if (trip.size() != 2 || timetable.connections()[trip.front()].departure_stop != 0 ||
+      timetable.connections()[trip.back()].arrival_stop != 2) {
+    throw std::logic_error("Wrong trip connections");
+  }
+
+  // Both trips depart before the stop is reached
+  to.assign(4, {});
+  if (timetable.ScanRound(at_stop(0, 250), 250, 0.0f, allowed, false, false, to)) {
+    throw std::logic_error("No trip should be boarded");
+  }
+
+  // Trip 2 is not wheelchair accessible
+  to.assign(4, {});
+  timetable.ScanRound(at_stop(0, 100), 100, 0.0f, allowed, true, false, to);
+  if (to[2].time != 400 || to[3].time != kUnreachedTime) {
+    throw std::logic_error("Only trip 1 should be boarded");
+  }
+
+  // Lines not allowed are not taken
+  to.assign(4, {});
+  std::vector<bool> no_line_0{false, true, true};
+  timetable.ScanRound(at_stop(0, 100), 100, 0.0f, no_line_0, false, false, to);
+  if (to[1].time != kUnreachedTime || to[2].time != kUnreachedTime || to[3].time != 500) {
+    throw std::logic_error("Line 0 should not be taken");
+  }
+}
+
+void TestFrequencyRuns() {
+  // Two runs of the same frequency based trip are different vehicles
+  TransitTimetable timetable;
+  timetable.AddStop(GraphId(0, 3, 0));
+  timetable.AddStop(GraphId(0, 3, 1));
+  timetable.AddStop(GraphId(0, 3, 2));
+  timetable.AddLine(GraphId(0, 3, 10));
+  timetable.AddLine(GraphId(0, 3, 11));
+  timetable.Add({100, 200, 0, 1, 0, 5, 0, true, true});
+  timetable.Add({700, 800, 0, 1, 0, 5, 1, true, true});
+  timetable.Add({250, 300, 1, 2, 1, 5, 0, true, true});
+  timetable.Add({850, 900, 1, 2, 1, 5, 1, true, true});
+  timetable.Sort();
+
+  std::vector<TripArrival> to(3);
+  timetable.ScanRound(at_stop(0, 600), 600, 0.0f, {true, true}, false, false, to);
+  if (to[1].time != 800 || to[2].time != 900 || timetable.TripConnections(to[2]).size() != 2) {
+    throw std::logic_error("Only the second run should be boarded");
+  }
+}
+
+} // namespace
+
+int main(void) {
+  test::suite suite("transittimetable");
+
+  suite.test(TEST_CASE(TestSort));
+
+  suite.test(TEST_CASE(TestScanRound));
+
+  suite.test(TEST_CASE(TestFrequencyRuns));
+
+  return suite.tear_down();
+}
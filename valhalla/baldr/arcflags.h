@@ -0,0 +1,44 @@
+#ifndef VALHALLA_BALDR_ARCFLAGS_H_
+#define VALHALLA_BALDR_ARCFLAGS_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+// Arc flags partition the arterial and highway levels into regions. Each directed
+// edge stores a 64 bit mask: the low 32 bits mark the regions for which the edge
+// lies on some shortest path towards the region (forward flags), the high 32 bits
+// mark the regions for which the edge lies on some shortest path leaving the
+// region (reverse flags). Shortest paths include the turn costs of the costing.
+// Every node in a tile (at any level) is assigned the region it lies within so
+// path algorithms can look up the region of their origin and destination.
+constexpr uint32_t kMaxArcFlagRegions = 32;
+constexpr uint8_t kArcFlagLevels = 2; // Flags are computed on the levels below this
+constexpr uint8_t kNoArcFlagRegion = 255;
+constexpr uint64_t kAllArcFlags = ~static_cast<uint64_t>(0);
+
+/**
+ * Get the forward arc flag bit for a region. Forward flags are tested while
+ * expanding towards a destination within the region.
+ * @param  region  Region index (< kMaxArcFlagRegions).
+ * @return Returns the bit mask for the region.
+ */
+inline uint64_t ForwardArcFlag(const uint8_t region) {
+  return static_cast<uint64_t>(1) << region;
+}
+
+/**
+ * Get the reverse arc flag bit for a region. Reverse flags are tested while
+ * expanding backwards towards an origin within the region.
+ * @param  region  Region index (< kMaxArcFlagRegions).
+ * @return Returns the bit mask for the region.
+ */
+inline uint64_t ReverseArcFlag(const uint8_t region) {
+  return static_cast<uint64_t>(1) << (region + kMaxArcFlagRegions);
+}
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_ARCFLAGS_H_
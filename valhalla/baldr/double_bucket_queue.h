@@ -75,6 +75,10 @@ public:
 
     // Set the cost function.
     labelcost_ = labelcost;
+    adds_ = 0;
+    decreases_ = 0;
+    pops_ = 0;
+    size_ = 0;
   }
 
   /**
@@ -98,6 +102,7 @@ public:
     // Reset current bucket and cost
     currentcost_ = mincost_;
     currentbucket_ = buckets_.begin();
+    size_ = 0;
   }
 
   /**
@@ -109,6 +114,8 @@ public:
    */
   void add(const uint32_t label) {
     get_bucket(labelcost_(label)).push_back(label);
+    adds_++;
+    size_++;
   }
 
   /**
@@ -119,6 +126,7 @@ public:
    * @param  newcost      New sort cost.
    */
   void decrease(const uint32_t label, const float newcost) {
+    decreases_++;
     // Get the buckets of the previous and new costs. Nothing needs to be done
     // if old cost and the new cost are in the same buckets.
     bucket_t& prevbucket = get_bucket(labelcost_(label));
@@ -157,9 +165,44 @@ public:
     // Return label from lowest non-empty bucket
     uint32_t label = currentbucket_->back();
     currentbucket_->pop_back();
+    pops_++;
+    size_--;
     return label;
   }
 
+  /**
+   * Get the number of labels added to the queue since it was constructed.
+   * @return  Returns the number of calls to add.
+   */
+  uint64_t adds() const {
+    return adds_;
+  }
+
+  /**
+   * Get the number of cost decreases since the queue was constructed.
+   * @return  Returns the number of calls to decrease.
+   */
+  uint64_t decreases() const {
+    return decreases_;
+  }
+
+  /**
+   * Get the number of labels removed from the queue since it was constructed.
+   * @return  Returns the number of valid labels returned by pop.
+   */
+  uint64_t pops() const {
+    return pops_;
+  }
+
+  /**
+   * Get the approximate number of bytes used by the queue: the low-level
+   * buckets and the label indexes currently held.
+   * @return  Returns the bytes used.
+   */
+  size_t memory() const {
+    return buckets_.capacity() * sizeof(bucket_t) + size_ * sizeof(uint32_t);
+  }
+
 private:
   float bucketrange_; // Total range of costs in lower level buckets
   float bucketsize_;  // Bucket size (range of costs in same bucket)
@@ -168,6 +211,14 @@ private:
   float maxcost_;     // Above this goes into overflow bucket
   float currentcost_; // Current cost
 
+  // Counts of the queue operations
+  uint64_t adds_;
+  uint64_t decreases_;
+  uint64_t pops_;
+
+  // Number of label indexes held
+  size_t size_;
+
   // Low level buckets
   buckets_t buckets_;
 
@@ -0,0 +1,117 @@
+#ifndef VALHALLA_BALDR_EDGECOSTMEMO_H_
+#define VALHALLA_BALDR_EDGECOSTMEMO_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <valhalla/baldr/tiledatamemory.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Maximum number of cost tables kept per tile. Each table takes 8 bytes per
+// directed edge of the tile.
+constexpr uint32_t kMaxEdgeCostTables = 8;
+
+/**
+ * Costs of the directed edges of one tile for one costing profile and one
+ * speed time key (see GraphTile::SpeedTimeKey). Filled lazily as the edges are
+ * costed. Entries are read and written atomically so threads sharing the tile
+ * can fill the table at the same time (they compute the same values).
+ */
+class EdgeCostTable {
+public:
+  /**
+   * Constructor.
+   * @param  count  Number of directed edges in the tile.
+   */
+  explicit EdgeCostTable(const uint32_t count);
+
+  /**
+   * Get the cost of an edge if it was stored.
+   * @param  idx   Directed edge index within the tile.
+   * @param  cost  Set to the cost of the edge.
+   * @param  secs  Set to the time of the edge.
+   * @return Returns false if the cost of the edge was not stored yet.
+   */
+  bool get(const uint32_t idx, float& cost, float& secs) const;
+
+  /**
+   * Store the cost of an edge.
+   * @param  idx   Directed edge index within the tile.
+   * @param  cost  Cost of the edge.
+   * @param  secs  Time of the edge.
+   */
+  void set(const uint32_t idx, const float cost, const float secs);
+
+protected:
+  // Cost and seconds packed in 64 bits, kEmptyEntry if not stored
+  std::unique_ptr<std::atomic<uint64_t>[]> entries_;
+};
+
+/**
+ * Cost tables of a tile. A tile keeps at most kMaxEdgeCostTables tables, when
+ * a new one is needed the oldest is dropped (users holding it keep it alive).
+ * The memo lives as long as the tile data: when a tile is evicted from the
+ * cache and loaded again it starts with an empty memo. The bytes of its tables
+ * count towards the size of the tile cache holding the tile.
+ */
+class EdgeCostMemo {
+public:
+  /**
+   * Get the table for a costing profile and speed time key, creating it if
+   * needed.
+   * @param  profile   Costing profile id (not 0).
+   * @param  time_key  Speed time key.
+   * @param  count     Number of directed edges in the tile.
+   * @return Returns the table.
+   */
+  std::shared_ptr<EdgeCostTable>
+  table(const uint64_t profile, const uint32_t time_key, const uint32_t count);
+
+  /**
+   * Drop all the tables, for example when the speeds of the tile change. Bumps
+   * the generation so users remembering a table fetch it again.
+   */
+  void Clear();
+
+  /**
+   * Returns the generation of the memo, changed by every Clear. A table fetched
+   * in an older generation must not be used anymore.
+   */
+  uint64_t generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Count the bytes of the tables towards the size of a tile cache.
+   * @param  counter  Counter of the cache.
+   */
+  void attach(const std::shared_ptr<std::atomic<size_t>>& counter);
+
+  /**
+   * Returns the bytes held by the tables.
+   */
+  size_t memory();
+
+protected:
+  struct Entry {
+    uint64_t profile;
+    uint32_t time_key;
+    std::shared_ptr<EdgeCostTable> table;
+  };
+
+  std::mutex mutex_;
+  std::vector<Entry> tables_;
+  uint32_t oldest_ = 0;
+  std::atomic<uint64_t> generation_{0};
+  TileDataMemory memory_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_EDGECOSTMEMO_H_
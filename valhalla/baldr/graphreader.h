@@ -1,7 +1,9 @@
 #ifndef VALHALLA_BALDR_GRAPHREADER_H_
 #define VALHALLA_BALDR_GRAPHREADER_H_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -137,6 +139,9 @@ protected:
   // The current cache size in bytes
   size_t cache_size_;
 
+  // Bytes of the data the cached tiles built after they were loaded
+  std::shared_ptr<std::atomic<size_t>> tile_data_size_;
+
   // The max cache size in bytes
   size_t max_cache_size_;
 };
@@ -243,6 +248,9 @@ protected:
   // The current cache size in bytes
   size_t cache_size_;
 
+  // Bytes of the data the cached tiles built after they were loaded
+  std::shared_ptr<std::atomic<size_t>> tile_data_size_;
+
   // The max cache size in bytes
   size_t max_cache_size_;
 };
@@ -416,6 +424,23 @@ public:
     return cache_->OverCommitted();
   }
 
+  /**
+   * Get the number of tiles requested from this reader (successive requests of
+   * the same tile through GetGraphTile(graphid, tile) are not counted).
+   * @return the number of tile requests since the reader was constructed
+   */
+  uint64_t tile_lookups() const {
+    return tile_lookups_;
+  }
+
+  /**
+   * Get the number of requested tiles that were not in the cache.
+   * @return the number of cache misses since the reader was constructed
+   */
+  uint64_t tile_cache_misses() const {
+    return tile_cache_misses_;
+  }
+
   /**
    * Convenience method to get an opposing directed edge.
    * @param  edgeid  Graph Id of the directed edge.
@@ -534,7 +559,8 @@ public:
   GraphId GetShortcut(const GraphId& edgeid);
 
   /**
-   * Recovers the edges comprising a shortcut edge.
+   * Recovers the edges comprising a shortcut edge. Uses the edges stored in the
+   * tile if it has them, otherwise walks the graph from the shortcut's begin node.
    * @param  shortcutid  Graph Id of the shortcut edge.
    * @return Returns the edgeids of the directed edges this shortcut represents.
    */
@@ -755,6 +781,10 @@ protected:
   std::unordered_set<GraphId> _404s;
 
   std::unique_ptr<TileCache> cache_;
+
+  // Counts of tile requests and cache misses
+  uint64_t tile_lookups_;
+  uint64_t tile_cache_misses_;
 };
 
 } // namespace baldr
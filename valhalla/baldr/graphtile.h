@@ -8,6 +8,7 @@
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/datetime.h>
 #include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/edgecostmemo.h>
 #include <valhalla/baldr/edgeinfo.h>
 #include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
@@ -15,12 +16,15 @@
 #include <valhalla/baldr/laneconnectivity.h>
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/nodetransition.h>
+#include <valhalla/baldr/arcflags.h>
 #include <valhalla/baldr/predictedspeeds.h>
+#include <valhalla/baldr/shortcutexpansion.h>
 #include <valhalla/baldr/sign.h>
 #include <valhalla/baldr/signinfo.h>
 #include <valhalla/baldr/transitdeparture.h>
 #include <valhalla/baldr/transitroute.h>
 #include <valhalla/baldr/transitschedule.h>
+#include <valhalla/baldr/transitserviceday.h>
 #include <valhalla/baldr/transitstop.h>
 #include <valhalla/baldr/transittransfer.h>
 #include <valhalla/baldr/turnlanes.h>
@@ -28,9 +32,12 @@
 #include <valhalla/midgard/logging.h>
 #include <valhalla/midgard/util.h>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 
+#include <boost/optional.hpp>
+
 namespace valhalla {
 namespace baldr {
 
@@ -355,9 +362,25 @@ public:
    */
   std::vector<SignInfo> GetSigns(const uint32_t idx, bool signs_on_node = false) const;
 
+  /**
+   * Get the departures of the lines of this tile that run on a service day.
+   * The index is built the first time a day is asked for and kept with the
+   * tile data (for the last kMaxTransitServiceDays days asked for).
+   * @param   day               Days since the tile creation date.
+   * @param   dow               Day of week (see graphconstants.h)
+   * @param   date_before_tile  Is the date that was inputed before
+   *                            the tile creation date?
+   * @return  Returns the service day index.
+   */
+  std::shared_ptr<const TransitServiceDay>
+  GetServiceDay(const uint32_t day, const uint32_t dow, bool date_before_tile) const;
+
   /**
    * Get the next departure given the directed edge Id and the current
-   * time (seconds from midnight). TODO - what if crosses midnight?
+   * time (seconds from midnight), a binary search in the service day index.
+   * Departures of frequency based trips are the run at or after the current
+   * time. The departure is returned by value since the index it is found in
+   * may be dropped as soon as the call returns. TODO - what if crosses midnight?
    * @param   lineid            Transit Line Id
    * @param   current_time      Current time (seconds from midnight).
    * @param   day               Days since the tile creation date.
@@ -366,10 +389,10 @@ public:
    *                            the tile creation date?
    * @param   wheelchair        Only find departures with wheelchair access if true
    * @param   bicycle           Only find departures with bicycle access if true
-   * @return  Returns a pointer to the transit departure information.
-   *          Returns nullptr if no departures are found.
+   * @return  Returns the transit departure information, none if no
+   *          departures are found.
    */
-  const TransitDeparture* GetNextDeparture(const uint32_t lineid,
+  boost::optional<TransitDeparture> GetNextDeparture(const uint32_t lineid,
                                            const uint32_t current_time,
                                            const uint32_t day,
                                            const uint32_t dow,
@@ -395,6 +418,15 @@ public:
    */
   std::unordered_map<uint32_t, TransitDeparture*> GetTransitDepartures() const;
 
+  /**
+   * Get an iterable set of all the departures in this tile, sorted by line Id
+   * and then by departure time.
+   * @return  Returns an iterable collection of transit departures.
+   */
+  midgard::iterable_t<const TransitDeparture> GetDepartures() const {
+    return midgard::iterable_t<const TransitDeparture>{departures_, header_->departurecount()};
+  }
+
   /**
    * Get the stop onestop Ids in this tile.
    * @return  Returns a map of transit stops with onestop Ids as the key and
@@ -472,6 +504,22 @@ public:
    */
   std::vector<LaneConnectivity> GetLaneConnectivity(const uint32_t idx) const;
 
+  /**
+   * Get the edges superseded by a shortcut edge, in the order they are
+   * traversed. Shortcut edges are stored by the shortcut builder.
+   * @param  idx  Index of the shortcut directed edge within the tile.
+   * @return  Returns the superseded edges, empty if the tile does not store them.
+   */
+  midgard::iterable_t<const GraphId> GetShortcutEdges(const uint32_t idx) const;
+
+  /**
+   * Get the number of shortcuts whose superseded edges are stored in the tile.
+   * @return  Returns the number of shortcuts.
+   */
+  uint32_t shortcut_expansion_count() const {
+    return shortcut_expansion_count_;
+  }
+
   /**
    * Convenience method to get the speed for an edge given the directed
    * edge and a time (seconds since start of the week).
@@ -548,6 +596,47 @@ public:
     return de->speed();
   }
 
+  /**
+   * Returns a key for the time given to GetSpeed: for the same flow mask two
+   * times with the same key give the same speed on every edge. The key has
+   * the predicted speed bucket and whether it is daytime (constrained versus
+   * free flow), so it must be kept in line with GetSpeed.
+   * @param  flow_mask  Which speed sources are used.
+   * @param  seconds    Seconds of the week or kInvalidSecondsOfWeek.
+   * @return Returns the key, 0 if no time is given.
+   */
+  static uint32_t SpeedTimeKey(const uint8_t flow_mask, const uint32_t seconds) {
+    if (seconds == kInvalidSecondsOfWeek) {
+      return 0;
+    }
+    const uint32_t day_seconds = seconds % midgard::kSecondsPerDay;
+    const uint32_t is_daytime = (25200 < day_seconds && day_seconds < 68400) ? 1 : 0;
+    if (!(flow_mask & kPredictedFlowMask)) {
+      return 1 + is_daytime;
+    }
+    return 3 + 2 * ((seconds % midgard::kSecondsPerWeek) / kSpeedBucketSizeSeconds) + is_daytime;
+  }
+
+  /**
+   * Returns the memo of edge costs of this tile. It is shared by the copies of
+   * the tile and starts empty whenever the tile is loaded.
+   * @return Returns the cost memo.
+   */
+  const std::shared_ptr<EdgeCostMemo>& cost_memo() const {
+    return cost_memo_;
+  }
+
+  /**
+   * Count the bytes of the data built after the tile is loaded (the transit
+   * service day indexes and the edge cost memo) towards the size of a tile
+   * cache. Called by the cache when the tile is put into it.
+   * @param  counter  Counter of the cache.
+   */
+  void AttachCacheMemory(const std::shared_ptr<std::atomic<size_t>>& counter) const {
+    service_days_->attach(counter);
+    cost_memo_->attach(counter);
+  }
+
   /**
    * Convenience method to get the turn lanes for an edge given the directed edge index.
    * @param  idx  Directed edge index. Used to lookup turn lanes.
@@ -566,6 +655,33 @@ public:
    */
   uint32_t turnlanes_offset(const uint32_t idx) const;
 
+  /**
+   * Does this tile have arc flags (added by valhalla_build_arcflags).
+   * @return  Returns true if arc flags and node regions are present.
+   */
+  bool has_arcflags() const {
+    return arcflags_ != nullptr;
+  }
+
+  /**
+   * Get the arc flags for a directed edge. Returns all flags set if the tile
+   * has no arc flags so that no edge is ever pruned.
+   * @param  idx  Directed edge index within the tile.
+   * @return Returns the forward (low 32 bits) and reverse (high 32 bits) flags.
+   */
+  uint64_t arcflags(const uint32_t idx) const {
+    return (arcflags_ == nullptr) ? kAllArcFlags : arcflags_[idx];
+  }
+
+  /**
+   * Get the arc flag region a node lies within.
+   * @param  idx  Node index within the tile.
+   * @return Returns the region index or kNoArcFlagRegion if not assigned.
+   */
+  uint8_t arcflag_region(const uint32_t idx) const {
+    return (arcflag_regions_ == nullptr) ? kNoArcFlagRegion : arcflag_regions_[idx];
+  }
+
 protected:
   // Graph tile memory, this must be shared so that we can put it into cache
   std::shared_ptr<std::vector<char>> graphtile_;
@@ -655,6 +771,22 @@ protected:
   // Predicted speeds
   PredictedSpeeds predictedspeeds_;
 
+  // Arc flags (one per directed edge) followed by the region of each node
+  const uint64_t* arcflags_ = nullptr;
+  const uint8_t* arcflag_regions_ = nullptr;
+
+  // Shortcut expansions sorted by shortcut index (plus an end marker) and the
+  // edges superseded by the shortcuts
+  uint32_t shortcut_expansion_count_ = 0;
+  const ShortcutExpansion* shortcut_expansions_ = nullptr;
+  const GraphId* shortcut_edges_ = nullptr;
+
+  // Edge costs memoized per costing profile and speed time key
+  std::shared_ptr<EdgeCostMemo> cost_memo_ = std::make_shared<EdgeCostMemo>();
+
+  // Departures running on the service days asked for
+  std::shared_ptr<TransitServiceDays> service_days_ = std::make_shared<TransitServiceDays>();
+
   // Map of stop one stops in this tile.
   std::unordered_map<std::string, GraphId> stop_one_stops;
 
@@ -16,7 +16,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 11;
+constexpr size_t kEmptySlots = 9;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -566,6 +566,40 @@ public:
     predictedspeeds_offset_ = offset;
   }
 
+  /**
+   * Gets the offset to the arc flag data. Arc flags are optional and are added
+   * to existing tiles by a separate preprocessing step.
+   * @return  Returns the offset (bytes) to arc flags, 0 if the tile has none.
+   */
+  uint32_t arcflags_offset() const {
+    return arcflags_offset_;
+  }
+
+  /**
+   * Sets the offset to arc flag data within the tile.
+   * @param offset Offset to arc flag data within the tile.
+   */
+  void set_arcflags_offset(const uint32_t offset) {
+    arcflags_offset_ = offset;
+  }
+
+  /**
+   * Gets the offset to the shortcut edge data: the edges superseded by each
+   * shortcut. It is added by the shortcut builder.
+   * @return  Returns the offset (bytes) to shortcut edges, 0 if the tile has none.
+   */
+  uint32_t shortcut_edges_offset() const {
+    return shortcut_edges_offset_;
+  }
+
+  /**
+   * Sets the offset to shortcut edge data within the tile.
+   * @param offset Offset to shortcut edge data within the tile.
+   */
+  void set_shortcut_edges_offset(const uint32_t offset) {
+    shortcut_edges_offset_ = offset;
+  }
+
   /**
    * Get the offset to the end of the tile
    * @return the number of bytes in the tile, unless the last slot is used
@@ -679,6 +713,12 @@ protected:
   // GraphTile data size in bytes
   uint32_t tile_size_;
 
+  // Offset to the beginning of the arc flag data
+  uint32_t arcflags_offset_;
+
+  // Offset to the beginning of the shortcut edge data
+  uint32_t shortcut_edges_offset_;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
@@ -0,0 +1,62 @@
+#ifndef VALHALLA_BALDR_SHORTCUTEXPANSION_H_
+#define VALHALLA_BALDR_SHORTCUTEXPANSION_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Locates the edges superseded by a shortcut edge within the shortcut edge
+ * list of a tile. The shortcut edge section of a tile starts with the number of
+ * shortcuts stored (64 bits), followed by one ShortcutExpansion per shortcut
+ * sorted by shortcut index plus one end marker, followed by the GraphIds of the
+ * superseded edges of each shortcut in the order they are traversed.
+ */
+class ShortcutExpansion {
+public:
+  ShortcutExpansion() : shortcut_(0), offset_(0) {
+  }
+
+  /**
+   * Constructor.
+   * @param  shortcut  Index of the shortcut directed edge within the tile.
+   * @param  offset    Index of its first superseded edge in the edge list.
+   */
+  ShortcutExpansion(const uint32_t shortcut, const uint32_t offset)
+      : shortcut_(shortcut), offset_(offset) {
+  }
+
+  /**
+   * Get the index of the shortcut directed edge within the tile.
+   * @return  Returns the directed edge index.
+   */
+  uint32_t shortcut() const {
+    return shortcut_;
+  }
+
+  /**
+   * Get the index of the first superseded edge of the shortcut within the
+   * edge list. The edges end at the offset of the next record.
+   * @return  Returns the index within the edge list.
+   */
+  uint32_t offset() const {
+    return offset_;
+  }
+
+  /**
+   * Less than operator for sorting and searching by shortcut index.
+   */
+  bool operator<(const ShortcutExpansion& other) const {
+    return shortcut_ < other.shortcut_;
+  }
+
+protected:
+  uint32_t shortcut_; // Directed edge index of the shortcut
+  uint32_t offset_;   // Index of its first edge in the edge list
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_SHORTCUTEXPANSION_H_
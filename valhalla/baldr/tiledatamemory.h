@@ -0,0 +1,61 @@
+#ifndef VALHALLA_BALDR_TILEDATAMEMORY_H_
+#define VALHALLA_BALDR_TILEDATAMEMORY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Bytes held by data a tile builds after it is loaded (the transit service day
+ * indexes, the edge cost memo). The bytes are added to the counter of the tile
+ * cache holding the tile so they count towards its size. Not thread safe, the
+ * owner of the data serializes the calls.
+ */
+class TileDataMemory {
+public:
+  ~TileDataMemory() {
+    set(0);
+  }
+
+  /**
+   * Attach the counter of a tile cache, moving the bytes held so far to it.
+   * @param  counter  Counter of the cache.
+   */
+  void attach(const std::shared_ptr<std::atomic<size_t>>& counter) {
+    if (counter == counter_) {
+      return;
+    }
+    const size_t bytes = bytes_;
+    set(0);
+    counter_ = counter;
+    set(bytes);
+  }
+
+  /**
+   * Set the bytes held.
+   * @param  bytes  Bytes held by the data.
+   */
+  void set(const size_t bytes) {
+    if (counter_) {
+      *counter_ += bytes;
+      *counter_ -= bytes_;
+    }
+    bytes_ = bytes;
+  }
+
+  size_t bytes() const {
+    return bytes_;
+  }
+
+protected:
+  size_t bytes_ = 0;
+  std::shared_ptr<std::atomic<size_t>> counter_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TILEDATAMEMORY_H_
@@ -0,0 +1,132 @@
+#ifndef VALHALLA_BALDR_TRANSITSERVICEDAY_H_
+#define VALHALLA_BALDR_TRANSITSERVICEDAY_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <valhalla/baldr/tiledatamemory.h>
+#include <valhalla/baldr/transitdeparture.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Maximum number of service days indexed per tile
+constexpr uint32_t kMaxTransitServiceDays = 4;
+
+/**
+ * Departures of the lines of one tile that run on one service day. For each
+ * line the departure times are sorted so finding the next departure is a
+ * binary search, without evaluating the transit schedules (day of week masks,
+ * calendar dates and exceptions). Frequency based departures are expanded into
+ * one departure per run, kept by the index so the returned departures live as
+ * long as the index does.
+ */
+class TransitServiceDay {
+public:
+  /**
+   * Constructor.
+   * @param  departures  Departures of the tile, sorted by line Id.
+   * @param  count       Number of departures.
+   * @param  runs_today  Returns true if a departure runs on the service day
+   *                     (its schedule is valid for the day).
+   */
+  TransitServiceDay(const TransitDeparture* departures,
+                    const uint32_t count,
+                    const std::function<bool(const TransitDeparture&)>& runs_today);
+
+  /**
+   * Get the next departure along a line at or after the current time.
+   * @param  lineid        Line Id within the tile.
+   * @param  current_time  Seconds from midnight.
+   * @param  wheelchair    Only return wheelchair accessible departures.
+   * @param  bicycle       Only return bicycle accessible departures.
+   * @return Returns the departure or nullptr if none runs later that day.
+   */
+  const TransitDeparture* GetNextDeparture(const uint32_t lineid,
+                                           const uint32_t current_time,
+                                           const bool wheelchair,
+                                           const bool bicycle) const;
+
+  /**
+   * Get the number of departures running on the service day (one per run of
+   * the frequency based departures).
+   */
+  size_t size() const {
+    return departures_.size();
+  }
+
+  /**
+   * Get the approximate bytes held by the index.
+   */
+  size_t memory() const;
+
+protected:
+  // A departure running that day with its accessibility packed in. The index
+  // is into the departures of the tile or into the runs of this index.
+  struct Departure {
+    uint32_t departure_time;
+    uint32_t index : 29;
+    uint32_t run : 1;
+    uint32_t wheelchair_accessible : 1;
+    uint32_t bicycle_accessible : 1;
+  };
+
+  const TransitDeparture* departures_of_tile_;
+
+  // Line Ids in increasing order and the start of their departures, the last
+  // offset is the end of the departures of the last line
+  std::vector<uint32_t> lineids_;
+  std::vector<uint32_t> offsets_;
+  std::vector<Departure> departures_;
+
+  // Runs of the frequency based departures
+  std::vector<TransitDeparture> runs_;
+};
+
+/**
+ * Service day indexes of a tile, built as they are first needed. A tile keeps
+ * at most kMaxTransitServiceDays indexes, when a new one is needed the oldest
+ * is dropped (users holding it keep it alive). The indexes live as long as the
+ * tile data.
+ */
+class TransitServiceDays {
+public:
+  /**
+   * Get the index of a service day, building it if needed.
+   * @param  day               Days since the tile was created.
+   * @param  dow               Day of week mask.
+   * @param  date_before_tile  True if the date is before the tile was created.
+   * @param  build             Builds the index if it is not kept.
+   * @return Returns the index.
+   */
+  std::shared_ptr<const TransitServiceDay>
+  service_day(const uint32_t day,
+              const uint32_t dow,
+              const bool date_before_tile,
+              const std::function<std::shared_ptr<const TransitServiceDay>()>& build);
+
+  /**
+   * Count the bytes held by the indexes towards the size of a tile cache.
+   * @param  counter  Counter of the cache holding the tile.
+   */
+  void attach(const std::shared_ptr<std::atomic<size_t>>& counter);
+
+protected:
+  struct Entry {
+    uint64_t key;
+    std::shared_ptr<const TransitServiceDay> index;
+  };
+
+  std::mutex mutex_;
+  std::vector<Entry> days_;
+  uint32_t oldest_ = 0;
+  TileDataMemory memory_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_TRANSITSERVICEDAY_H_
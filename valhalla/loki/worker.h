@@ -40,6 +40,7 @@ public:
   void route(Api& request);
   void matrix(Api& request);
   void isochrones(Api& request);
+  void batch_isochrones(Api& request);
   void trace(Api& request);
   std::string height(Api& request);
   std::string transit_available(Api& request);
@@ -50,6 +51,7 @@ protected:
       boost::optional<valhalla_exception_t> required_exception = valhalla_exception_t{110});
   void parse_trace(Api& request);
   void parse_costing(Api& request);
+  void parse_timeout(Api& request);
   void locations_from_shape(Api& request);
 
   void init_locate(Api& request);
@@ -85,6 +87,7 @@ protected:
   size_t max_transit_walking_dis;
   size_t max_contours;
   size_t max_time;
+  size_t max_batch_locations;
   size_t max_trace_shape;
   float max_gps_accuracy;
   float max_search_radius;
@@ -94,6 +97,8 @@ protected:
   size_t max_elevation_shape;
   float min_resample;
   unsigned int max_alternates;
+  // Milliseconds a request may take, 0 for no limit
+  uint32_t max_timeout;
 };
 } // namespace loki
 } // namespace valhalla
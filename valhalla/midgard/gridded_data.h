@@ -1,6 +1,8 @@
 #ifndef VALHALLA_MIDGARD_GRIDDEDDATA_H_
 #define VALHALLA_MIDGARD_GRIDDEDDATA_H_
 
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <list>
 #include <map>
@@ -14,9 +16,15 @@ namespace midgard {
 // compute an optimal generalization factor when creating contours.
 constexpr float kOptimalGeneralization = std::numeric_limits<float>::max();
 
+// Number of tiles along each side of a block of grid data
+constexpr int32_t kGridBlockSize = 16;
+
 /**
  * Class to store data in a gridded/tiled data structure. Contains methods
- * to mark each tile with data using a compare operator.
+ * to mark each tile with data using a compare operator. Data is stored in
+ * square blocks of tiles which are only allocated once a tile within them is
+ * set, other tiles have the initial value. Memory then grows with the area
+ * that is set rather than with the bounding box.
  */
 template <class coord_t> class GriddedData : public Tiles<coord_t> {
 public:
@@ -37,8 +45,8 @@ public:
    */
   bool Set(const coord_t& pt, const float value) {
     auto cell_id = this->TileId(pt);
-    if (cell_id >= 0 && cell_id < data_.size()) {
-      data_[cell_id] = value;
+    if (cell_id >= 0 && cell_id < this->nrows_ * this->ncolumns_) {
+      Cell(cell_id) = value;
       return true;
     }
     return false;
@@ -51,8 +59,8 @@ public:
    * @param  value  Value to set at the tile/grid location.
    */
   void SetIfLessThan(const int tile_id, const float value) {
-    if (tile_id >= 0 && tile_id < data_.size() && value < data_[tile_id]) {
-      data_[tile_id] = value;
+    if (tile_id >= 0 && tile_id < this->nrows_ * this->ncolumns_ && value < Get(tile_id)) {
+      Cell(tile_id) = value;
     }
   }
 
@@ -64,18 +72,41 @@ public:
    * @param  value  Value to set at the tile/grid location.
    */
   void SetIfLessThan(const coord_t& pt, const float value) {
-    int32_t cell_id = this->TileId(pt);
-    if (cell_id >= 0 && cell_id < data_.size() && value < data_[cell_id]) {
-      data_[cell_id] = value;
-    }
+    SetIfLessThan(this->TileId(pt), value);
+  }
+
+  /**
+   * Get the value at a tile.
+   * @param  tile_id  Tile Id, must be valid.
+   * @return Returns the value at the tile/grid location.
+   */
+  float Get(const int tile_id) const {
+    return Get(tile_id % this->ncolumns_, tile_id / this->ncolumns_);
   }
 
   /**
-   * Get the array of data.
-   * @return  Returns the data associated with the tiles.
+   * Get the value at a tile.
+   * @param  col  Column of the tile, must be valid.
+   * @param  row  Row of the tile, must be valid.
+   * @return Returns the value at the tile/grid location.
    */
-  const std::vector<float>& data() const {
-    return data_;
+  float Get(const int32_t col, const int32_t row) const {
+    const auto& block = blocks_[(row / kGridBlockSize) * block_columns_ + col / kGridBlockSize];
+    return block.empty()
+               ? max_value_
+               : block[(row % kGridBlockSize) * kGridBlockSize + col % kGridBlockSize];
+  }
+
+  /**
+   * Get the number of tiles whose data is allocated.
+   * @return Returns the number of tiles in the allocated blocks.
+   */
+  size_t allocated() const {
+    size_t count = 0;
+    for (const auto& block : blocks_) {
+      count += block.size();
+    }
+    return count;
   }
 
   using contour_t = std::list<coord_t>;
@@ -97,17 +128,61 @@ public:
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param threads              Number of threads generating the contours of bands
+   *                             of grid rows. The contours do not depend on it.
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
   contours_t GenerateContours(const std::vector<float>& contour_intervals,
                               const bool rings_only = false,
                               const float denoise = 1.f,
-                              const float generalize = 200.f) const;
+                              const float generalize = 200.f,
+                              const uint32_t threads = 1) const;
 
 protected:
-  float max_value_;         // Maximum value stored in the tile
-  std::vector<float> data_; // Data value within each tile
+  float max_value_;       // Maximum value stored in the tile
+  int32_t block_columns_; // Number of blocks in a row of blocks
+
+  // Data value within each tile of each block, empty until a tile is set
+  std::vector<std::vector<float>> blocks_;
+
+  /**
+   * Get the data value of a tile to set, allocating its block if needed.
+   * @param  tile_id  Tile Id, must be valid.
+   */
+  float& Cell(const int tile_id) {
+    int32_t col = tile_id % this->ncolumns_;
+    int32_t row = tile_id / this->ncolumns_;
+    auto& block = blocks_[(row / kGridBlockSize) * block_columns_ + col / kGridBlockSize];
+    if (block.empty()) {
+      block.resize(kGridBlockSize * kGridBlockSize, max_value_);
+    }
+    return block[(row % kGridBlockSize) * kGridBlockSize + col % kGridBlockSize];
+  }
+
+  // A contour line within a band of rows and the keys of its end points. Keys
+  // identify the points of the grid contours can go through.
+  struct band_line_t {
+    contour_t line;
+    size_t front;
+    size_t back;
+    bool ring;
+  };
+
+  /**
+   * Generate the contour lines crossing a band of rows of the grid.
+   * @param contour_intervals  the values at which the contour lines should occur
+   * @param crossed            whether the tiles of each block can be crossed by
+   *                           a contour line
+   * @param first_row          first row of the band
+   * @param last_row           row after the last row of the band
+   * @param lines              gets the lines of each contour interval
+   */
+  void GenerateBandContours(const std::vector<float>& contour_intervals,
+                            const std::vector<bool>& crossed,
+                            const int first_row,
+                            const int last_row,
+                            std::vector<std::vector<band_line_t>>& lines) const;
 };
 
 } // namespace midgard
@@ -0,0 +1,33 @@
+#ifndef VALHALLA_MJOLNIR_ARCFLAGSBUILDER_H
+#define VALHALLA_MJOLNIR_ARCFLAGSBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to add arc flags to a tile set. The nodes of the highway and arterial
+ * levels are partitioned into regions (recursive bisection of their locations
+ * balanced by edge count) and every node is assigned the region its location
+ * falls within. For each directed edge on these levels a bit is set for every
+ * region for which the edge lies on some shortest path towards (forward flags) or
+ * away from (reverse flags) the region. Shortest paths are computed edge to edge
+ * under default auto costing, so they include the turn costs and the simple turn
+ * restrictions of the search. Local level edges have all flags set.
+ */
+class ArcFlagsBuilder {
+public:
+  /**
+   * Compute arc flags and add them to the tiles.
+   * @param  pt  Configuration. Uses mjolnir.tile_dir, mjolnir.arc_flag_regions
+   *             and mjolnir.concurrency.
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_ARCFLAGSBUILDER_H
@@ -145,6 +145,14 @@ public:
    */
   void AddLaneConnectivity(const std::vector<baldr::LaneConnectivity>& lc);
 
+  /**
+   * Add the edges superseded by a shortcut edge. Shortcuts must be added in
+   * order of their directed edge index.
+   * @param  idx    Directed edge index of the shortcut.
+   * @param  edges  Superseded edges in the order they are traversed.
+   */
+  void AddShortcutEdges(const uint32_t idx, const std::vector<baldr::GraphId>& edges);
+
   /**
    * Add forward complex restriction.
    * @param  res  Complex restriction.
@@ -444,6 +452,14 @@ public:
    */
   void UpdatePredictedSpeeds(const std::vector<DirectedEdge>& directededges);
 
+  /**
+   * Updates a tile with arc flags. Arc flags are appended to the end of the tile
+   * or, if the tile already has arc flags, overwritten in place.
+   * @param  arcflags  Arc flags for each directed edge in the tile.
+   * @param  regions   Arc flag region of each node in the tile.
+   */
+  void UpdateArcFlags(const std::vector<uint64_t>& arcflags, const std::vector<uint8_t>& regions);
+
 protected:
   struct EdgeTupleHasher {
     std::size_t operator()(const edge_tuple& k) const {
@@ -548,6 +564,10 @@ protected:
   // List of turn lanes.
   std::vector<TurnLanes> turnlanes_builder_;
 
+  // Shortcut expansions and the edges superseded by the shortcuts.
+  std::vector<ShortcutExpansion> shortcut_expansion_builder_;
+  std::vector<GraphId> shortcut_edges_builder_;
+
   // Offsets into predicted speed profiles for each directed edge.
   std::vector<uint32_t> speed_profile_offset_builder_;
 
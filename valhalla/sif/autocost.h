@@ -2,6 +2,8 @@
 #define VALHALLA_SIF_AUTOCOST_H_
 
 #include <cstdint>
+#include <stdexcept>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 #include <valhalla/baldr/rapidjson_utils.h>
@@ -129,6 +131,426 @@ void ParseTaxiCostOptions(const rapidjson::Document& doc,
  */
 cost_ptr_t CreateTaxiCost(const Costing costing, const Options& options);
 
+/**
+ * Derived class providing dynamic edge costing for "direct" auto routes. This
+ * is a route that is generally shortest time but uses route hierarchies that
+ * can result in slightly longer routes that avoid shortcuts on residential
+ * roads.
+ */
+class AutoCost : public DynamicCost {
+public:
+  /**
+   * Construct auto costing. Pass in cost type and options using protocol buffer(pbf).
+   * @param  costing specified costing type.
+   * @param  options pbf with request options.
+   */
+  AutoCost(const Costing costing, const Options& options);
+
+  virtual ~AutoCost() {
+  }
+
+  /**
+   * Copy this costing.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const {
+    return std::make_shared<AutoCost>(*this);
+  }
+
+  /**
+   * Edge costs only depend on the edge, its speed and the costing options.
+   * @return  Returns true.
+   */
+  virtual bool EdgeCostMemoizable() const {
+    return true;
+  }
+
+  /**
+   * Does the costing method allow multiple passes (with relaxed hierarchy
+   * limits).
+   * @return  Returns true if the costing model allows multiple passes.
+   */
+  virtual bool AllowMultiPass() const {
+    return true;
+  }
+
+  /**
+   * Get the access mode used by this costing method.
+   * @return  Returns access mode.
+   */
+  uint32_t access_mode() const {
+    return baldr::kAutoAccess;
+  }
+
+  /**
+   * Checks if access is allowed for the provided directed edge.
+   * This is generally based on mode of travel and the access modes
+   * allowed on the edge. However, it can be extended to exclude access
+   * based on other parameters such as conditional restrictions and
+   * conditional access that can depend on time and travel mode.
+   * @param  edge           Pointer to a directed edge.
+   * @param  pred           Predecessor edge information.
+   * @param  tile           Current tile.
+   * @param  edgeid         GraphId of the directed edge.
+   * @param  current_time   Current time (seconds since epoch). A value of 0
+   *                        indicates the route is not time dependent.
+   * @param  tz_index       timezone index for the node
+   * @return Returns true if access is allowed, false if not.
+   */
+  virtual bool Allowed(const baldr::DirectedEdge* edge,
+                       const EdgeLabel& pred,
+                       const baldr::GraphTile*& tile,
+                       const baldr::GraphId& edgeid,
+                       const uint64_t current_time,
+                       const uint32_t tz_index,
+                       bool& has_time_restrictions) const;
+
+  /**
+   * Checks if access is allowed for an edge on the reverse path
+   * (from destination towards origin). Both opposing edges (current and
+   * predecessor) are provided. The access check is generally based on mode
+   * of travel and the access modes allowed on the edge. However, it can be
+   * extended to exclude access based on other parameters such as conditional
+   * restrictions and conditional access that can depend on time and travel
+   * mode.
+   * @param  edge           Pointer to a directed edge.
+   * @param  pred           Predecessor edge information.
+   * @param  opp_edge       Pointer to the opposing directed edge.
+   * @param  tile           Current tile.
+   * @param  edgeid         GraphId of the opposing edge.
+   * @param  current_time   Current time (seconds since epoch). A value of 0
+   *                        indicates the route is not time dependent.
+   * @param  tz_index       timezone index for the node
+   * @return  Returns true if access is allowed, false if not.
+   */
+  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
+                              const EdgeLabel& pred,
+                              const baldr::DirectedEdge* opp_edge,
+                              const baldr::GraphTile*& tile,
+                              const baldr::GraphId& opp_edgeid,
+                              const uint64_t current_time,
+                              const uint32_t tz_index,
+                              bool& has_time_restrictions) const;
+
+  /**
+   * Checks if access is allowed for the provided node. Node access can
+   * be restricted if bollards or gates are present.
+   * @param  node  Pointer to node information.
+   * @return  Returns true if access is allowed, false if not.
+   */
+  virtual bool Allowed(const baldr::NodeInfo* node) const {
+    return (node->access() & baldr::kAutoAccess);
+  }
+
+  /**
+   * Only transit costings are valid for this method call, hence we throw
+   * @param edge
+   * @param departure
+   * @param curr_time
+   * @return
+   */
+  virtual Cost EdgeCost(const baldr::DirectedEdge* edge,
+                        const baldr::TransitDeparture* departure,
+                        const uint32_t curr_time) const {
+    throw std::runtime_error("AutoCost::EdgeCost does not support transit edges");
+  }
+
+  /**
+   * Get the cost to traverse the specified directed edge. Cost includes
+   * the time (seconds) to traverse the edge.
+   * @param   edge    Pointer to a directed edge.
+   * @param   tile    Graph tile.
+   * @param   seconds Time of week in seconds.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost EdgeCost(const baldr::DirectedEdge* edge,
+                        const baldr::GraphTile* tile,
+                        const uint32_t seconds) const;
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge.
+   * Defaults to 0. Costing models that wish to include edge transition
+   * costs (i.e., intersection/turn costs) must override this method.
+   * @param  edge  Directed edge (the to edge)
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  Predecessor edge information.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
+                              const baldr::NodeInfo* node,
+                              const EdgeLabel& pred) const;
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge
+   * when using a reverse search (from destination towards the origin).
+   * @param  idx   Directed edge local index
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  the opposing current edge in the reverse tree.
+   * @param  edge  the opposing predecessor in the reverse tree
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost TransitionCostReverse(const uint32_t idx,
+                                     const baldr::NodeInfo* node,
+                                     const baldr::DirectedEdge* pred,
+                                     const baldr::DirectedEdge* edge) const;
+
+  /**
+   * Get the cost factor for A* heuristics. This factor is multiplied
+   * with the distance to the destination to produce an estimate of the
+   * minimum cost to the destination. The A* heuristic must underestimate the
+   * cost to the destination. So a time based estimate based on speed should
+   * assume the maximum speed is used to the destination such that the time
+   * estimate is less than the least possible time along roads.
+   */
+  virtual float AStarCostFactor() const {
+    return speedfactor_[baldr::kMaxSpeedKph];
+  }
+
+  /**
+   * Get the current travel type.
+   * @return  Returns the current travel type.
+   */
+  virtual uint8_t travel_type() const {
+    return static_cast<uint8_t>(type_);
+  }
+
+  /**
+   * Returns a function/functor to be used in location searching which will
+   * exclude and allow ranking results from the search by looking at each
+   * edges attribution and suitability for use as a location by the travel
+   * mode used by the costing method. Function/functor is also used to filter
+   * edges not usable / inaccessible by automobile.
+   */
+  virtual const EdgeFilter GetEdgeFilter() const {
+    // Throw back a lambda that checks the access for this type of costing
+    return [](const baldr::DirectedEdge* edge) {
+      if (edge->is_shortcut() || !(edge->forwardaccess() & baldr::kAutoAccess)) {
+        return 0.0f;
+      } else {
+        // TODO - use classification/use to alter the factor
+        return 1.0f;
+      }
+    };
+  }
+
+  /**
+   * Returns a function/functor to be used in location searching which will
+   * exclude results from the search by looking at each node's attribution
+   * @return Function/functor to be used in filtering out nodes
+   */
+  virtual const NodeFilter GetNodeFilter() const {
+    // throw back a lambda that checks the access for this type of costing
+    return [](const baldr::NodeInfo* node) { return !(node->access() & baldr::kAutoAccess); };
+  }
+
+protected:
+  // Turn cost tables and road factors used by the inline costing methods.
+  // Members so the methods below can be defined in this header.
+  static constexpr float kTCStraight = 0.5f;
+  static constexpr float kTCSlight = 0.75f;
+  static constexpr float kTCFavorable = 1.0f;
+  static constexpr float kTCFavorableSharp = 1.5f;
+  static constexpr float kTCCrossing = 2.0f;
+  static constexpr float kTCUnfavorable = 2.5f;
+  static constexpr float kTCUnfavorableSharp = 3.5f;
+  static constexpr float kTCReverse = 5.0f;
+
+  // Turn costs based on side of street driving
+  static constexpr float kRightSideTurnCosts[] = {kTCStraight,    kTCSlight,
+                                                  kTCFavorable,   kTCFavorableSharp,
+                                                  kTCReverse,     kTCUnfavorableSharp,
+                                                  kTCUnfavorable, kTCSlight};
+  static constexpr float kLeftSideTurnCosts[] = {kTCStraight,    kTCSlight,
+                                                 kTCUnfavorable, kTCUnfavorableSharp,
+                                                 kTCReverse,     kTCFavorableSharp,
+                                                 kTCFavorable,   kTCSlight};
+
+  // Highway and surface factors, indexed by road class and surface type
+  static constexpr float kHighwayFactor[] = {
+      10.0f, // Motorway
+      0.5f,  // Trunk
+      0.0f,  // Primary
+      0.0f,  // Secondary
+      0.0f,  // Tertiary
+      0.0f,  // Unclassified
+      0.0f,  // Residential
+      0.0f   // Service, other
+  };
+  static constexpr float kSurfaceFactor[] = {
+      0.0f, // kPavedSmooth
+      0.0f, // kPaved
+      0.0f, // kPaveRough
+      0.1f, // kCompacted
+      0.2f, // kDirt
+      0.5f, // kGravel
+      1.0f  // kPath
+  };
+
+  // Public so the unit tests within the source file can access them
+public:
+  VehicleType type_; // Vehicle type: car (default), motorcycle, etc
+  float speedfactor_[baldr::kMaxSpeedKph + 1];
+  float density_factor_[16]; // Density factor
+  float highway_factor_;     // Factor applied when road is a motorway or trunk
+  float toll_factor_;        // Factor applied when road has a toll
+  float surface_factor_;     // How much the surface factors are applied.
+
+  // Density factor used in edge transition costing
+  std::vector<float> trans_density_factor_;
+};
+
+// Check if access is allowed on the specified edge.
+inline bool AutoCost::Allowed(const baldr::DirectedEdge* edge,
+                              const EdgeLabel& pred,
+                              const baldr::GraphTile*& tile,
+                              const baldr::GraphId& edgeid,
+                              const uint64_t current_time,
+                              const uint32_t tz_index,
+                              bool& has_time_restrictions) const {
+  // Check access, U-turn, and simple turn restriction.
+  // Allow U-turns at dead-end nodes in case the origin is inside
+  // a not thru region and a heading selected an edge entering the
+  // region.
+  if (!(edge->forwardaccess() & baldr::kAutoAccess) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+      (pred.restrictions() & (1 << edge->localedgeidx())) ||
+      edge->surface() == baldr::Surface::kImpassable || IsUserAvoidEdge(edgeid) ||
+      (!allow_destination_only_ && !pred.destonly() && edge->destonly())) {
+    return false;
+  }
+
+  return DynamicCost::EvaluateRestrictions(baldr::kAutoAccess, edge, tile, edgeid, current_time,
+                                           tz_index, has_time_restrictions);
+}
+
+// Checks if access is allowed for an edge on the reverse path (from
+// destination towards origin). Both opposing edges are provided.
+inline bool AutoCost::AllowedReverse(const baldr::DirectedEdge* edge,
+                                     const EdgeLabel& pred,
+                                     const baldr::DirectedEdge* opp_edge,
+                                     const baldr::GraphTile*& tile,
+                                     const baldr::GraphId& opp_edgeid,
+                                     const uint64_t current_time,
+                                     const uint32_t tz_index,
+                                     bool& has_time_restrictions) const {
+  // Check access, U-turn, and simple turn restriction.
+  // Allow U-turns at dead-end nodes.
+  if (!(opp_edge->forwardaccess() & baldr::kAutoAccess) ||
+      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
+      (opp_edge->restrictions() & (1 << pred.opp_local_idx())) ||
+      opp_edge->surface() == baldr::Surface::kImpassable || IsUserAvoidEdge(opp_edgeid) ||
+      (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly())) {
+    return false;
+  }
+
+  return DynamicCost::EvaluateRestrictions(baldr::kAutoAccess, edge, tile, opp_edgeid, current_time,
+                                           tz_index, has_time_restrictions);
+}
+
+// Get the cost to traverse the edge in seconds
+inline Cost AutoCost::EdgeCost(const baldr::DirectedEdge* edge,
+                               const baldr::GraphTile* tile,
+                               const uint32_t seconds) const {
+  auto speed = tile->GetSpeed(edge, flow_mask_, seconds);
+  float factor =
+      (edge->use() == baldr::Use::kFerry) ? ferry_factor_ : density_factor_[edge->density()];
+
+  factor += highway_factor_ * kHighwayFactor[static_cast<uint32_t>(edge->classification())] +
+            surface_factor_ * kSurfaceFactor[static_cast<uint32_t>(edge->surface())];
+  if (edge->toll()) {
+    factor += toll_factor_;
+  }
+
+  float sec = (edge->length() * speedfactor_[speed]);
+  return Cost(sec * factor, sec);
+}
+
+// Returns the time (in seconds) to make the transition from the predecessor
+inline Cost AutoCost::TransitionCost(const baldr::DirectedEdge* edge,
+                                     const baldr::NodeInfo* node,
+                                     const EdgeLabel& pred) const {
+  // Get the transition cost for country crossing, ferry, gate, toll booth,
+  // destination only, alley, maneuver penalty
+  uint32_t idx = pred.opp_local_idx();
+  Cost c = base_transition_cost(node, edge, pred, idx);
+
+  // Intersection transition time = factor * stopimpact * turncost. Factor depends
+  // on density and whether traffic is available
+  if (edge->stopimpact(idx) > 0) {
+    float turn_cost;
+    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+      turn_cost = kTCCrossing;
+    } else {
+      turn_cost = (node->drive_on_right())
+                      ? kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))]
+                      : kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
+    }
+
+    if ((edge->use() != baldr::Use::kRamp && pred.use() == baldr::Use::kRamp) ||
+        (edge->use() == baldr::Use::kRamp && pred.use() != baldr::Use::kRamp)) {
+      turn_cost += 1.5f;
+      if (edge->roundabout())
+        turn_cost += 0.5f;
+    }
+
+    // Separate time and penalty when traffic is present. With traffic, edge speeds account for
+    // much of the intersection transition time (TODO - evaluate different elapsed time settings).
+    // Still want to add a penalty so routes avoid high cost intersections.
+    float seconds = turn_cost * edge->stopimpact(idx);
+    // Apply density factor penality if there isnt traffic on this edge or youre not using traffic
+    if (!edge->has_flow_speed() || flow_mask_ == 0)
+      seconds *= trans_density_factor_[node->density()];
+
+    c.cost += seconds;
+    c.secs += seconds;
+  }
+  return c;
+}
+
+// Returns the cost to make the transition from the predecessor edge
+// when using a reverse search (from destination towards the origin).
+// pred is the opposing current edge in the reverse tree
+// edge is the opposing predecessor in the reverse tree
+inline Cost AutoCost::TransitionCostReverse(const uint32_t idx,
+                                            const baldr::NodeInfo* node,
+                                            const baldr::DirectedEdge* pred,
+                                            const baldr::DirectedEdge* edge) const {
+  // Get the transition cost for country crossing, ferry, gate, toll booth,
+  // destination only, alley, maneuver penalty
+  Cost c = base_transition_cost(node, edge, pred, idx);
+
+  // Transition time = densityfactor * stopimpact * turncost
+  if (edge->stopimpact(idx) > 0) {
+    float turn_cost;
+    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
+      turn_cost = kTCCrossing;
+    } else {
+      turn_cost = (node->drive_on_right())
+                      ? kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))]
+                      : kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
+    }
+
+    if ((edge->use() != baldr::Use::kRamp && pred->use() == baldr::Use::kRamp) ||
+        (edge->use() == baldr::Use::kRamp && pred->use() != baldr::Use::kRamp)) {
+      turn_cost += 1.5f;
+      if (edge->roundabout())
+        turn_cost += 0.5f;
+    }
+
+    // Separate time and penalty when traffic is present. With traffic, edge speeds account for
+    // much of the intersection transition time (TODO - evaluate different elapsed time settings).
+    // Still want to add a penalty so routes avoid high cost intersections.
+    float seconds = turn_cost * edge->stopimpact(idx);
+    // Apply density factor penality if there isnt traffic on this edge or youre not using traffic
+    if (!edge->has_flow_speed() || flow_mask_ == 0)
+      seconds *= trans_density_factor_[node->density()];
+
+    c.secs += seconds;
+    c.cost += seconds;
+  }
+  return c;
+}
+
 } // namespace sif
 } // namespace valhalla
 
@@ -0,0 +1,165 @@
+#ifndef VALHALLA_SIF_COSTCACHE_H_
+#define VALHALLA_SIF_COSTCACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/edgecostmemo.h>
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/proto/options.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace sif {
+
+// Maximum number of costing profiles kept by the cache
+constexpr size_t kDefaultMaxCostProfiles = 256;
+
+/**
+ * Process wide cache of costing profiles. A profile is a costing constructed
+ * from one set of costing options, which parses the options and builds the
+ * speed factor and penalty tables. Profiles are never handed out and never
+ * change: each request gets a copy (see DynamicCost::Clone) holding its own
+ * mutable state (pass, hierarchy limits, ...). Copying a profile is much
+ * cheaper than constructing it. The cache is thread safe so the loki and thor
+ * workers of a process share it.
+ *
+ * Profiles are constructed without the avoid edges of the request, which are
+ * added to each copy, so requests avoiding different locations share a profile.
+ *
+ * When edge cost memoization is enabled each cached profile whose costing is
+ * EdgeCostMemoizable gets a unique id. The copies keep the id and memoize
+ * their edge costs in the tiles under it (see MemoizedEdgeCost).
+ */
+class CostCache {
+public:
+  using create_function_t = cost_ptr_t (*)(const Costing costing, const Options& options);
+
+  /**
+   * Returns the cache shared by the whole process.
+   */
+  static CostCache& GetInstance();
+
+  /**
+   * Constructor.
+   * @param  max_profiles  Maximum number of profiles to keep. Once reached new
+   *                       profiles are created for every request. 0 disables
+   *                       the cache.
+   */
+  explicit CostCache(const size_t max_profiles = kDefaultMaxCostProfiles);
+
+  /**
+   * Get a costing for the options of a request. Returns a copy of the cached
+   * profile with the avoid edges of the request, creating and caching the
+   * profile the first time these options are seen.
+   * @param  costing  Costing type.
+   * @param  options  Request options.
+   * @param  create   Function creating the costing from the options.
+   * @return Returns a costing the caller can change.
+   */
+  cost_ptr_t Create(const Costing costing, const Options& options, create_function_t create);
+
+  /**
+   * Returns the canonical key of a profile: the function creating it, the
+   * costing type and its costing options. The options are serialized, so two
+   * requests giving the same values (in any order in the json) have the same
+   * key.
+   * @param  costing  Costing type.
+   * @param  options  Request options.
+   * @param  create   Function creating the costing from the options.
+   * @return Returns the key.
+   */
+  static std::string Key(const Costing costing, const Options& options, create_function_t create);
+
+  /**
+   * Enable or disable memoizing the edge costs of the cached profiles. Clears
+   * the cache when the setting changes so it applies to all profiles, setting
+   * it again to the same value keeps them.
+   * @param  enabled  True to memoize edge costs.
+   */
+  void set_edge_cost_memo(const bool enabled);
+
+  /**
+   * Returns the number of cached profiles.
+   */
+  size_t size() const;
+
+  /**
+   * Removes all profiles.
+   */
+  void Clear();
+
+protected:
+  size_t max_profiles_;
+  bool edge_cost_memo_;
+  mutable std::mutex mutex_;
+
+  // Last profile id handed out. Ids are never reused so tables memoized for a
+  // dropped profile are never used by another one.
+  static std::atomic<uint64_t> last_profile_id_;
+
+  // Profiles by key. Keys are compared completely so hash collisions never
+  // return the profile of different options.
+  std::unordered_map<std::string, std::shared_ptr<const DynamicCost>> profiles_;
+};
+
+/**
+ * Get the table of memoized costs of a tile for a costing profile and time.
+ * Each thread remembers the last table it used so consecutive edges of the
+ * same tile don't lock the memo.
+ * @param  profile_id  Id of the costing profile (not 0).
+ * @param  flow_mask   Speed sources used by the costing.
+ * @param  tile        Tile of the edges.
+ * @param  seconds     Seconds of the week or kInvalidSecondsOfWeek.
+ * @return Returns the table.
+ */
+baldr::EdgeCostTable* GetEdgeCostTable(const uint64_t profile_id,
+                                       const uint8_t flow_mask,
+                                       const baldr::GraphTile* tile,
+                                       const uint32_t seconds);
+
+/**
+ * Get the cost of an edge from the memo of its tile, computing and storing it
+ * the first time. Costings without a profile id always compute the cost.
+ * @param  costing  Costing of the request.
+ * @param  edge     Directed edge, must be in the tile.
+ * @param  tile     Tile of the edge.
+ * @param  seconds  Seconds of the week or kInvalidSecondsOfWeek.
+ * @param  compute  Function computing the cost of the edge with the costing.
+ * @return Returns the cost of the edge.
+ */
+template <typename ComputeT>
+Cost MemoizedEdgeCost(const DynamicCost& costing,
+                      const baldr::DirectedEdge* edge,
+                      const baldr::GraphTile* tile,
+                      const uint32_t seconds,
+                      ComputeT compute) {
+  if (costing.profile_id() == 0) {
+    return compute();
+  }
+  const uint32_t count = tile->header()->directededgecount();
+  const baldr::DirectedEdge* first = tile->directededge(0);
+  if (edge < first || edge >= first + count) {
+    return compute();
+  }
+
+  const uint32_t idx = static_cast<uint32_t>(edge - first);
+  baldr::EdgeCostTable* table =
+      GetEdgeCostTable(costing.profile_id(), costing.flow_mask(), tile, seconds);
+  Cost cost;
+  if (!table->get(idx, cost.cost, cost.secs)) {
+    cost = compute();
+    table->set(idx, cost.cost, cost.secs);
+  }
+  return cost;
+}
+
+} // namespace sif
+} // namespace valhalla
+
+#endif // VALHALLA_SIF_COSTCACHE_H_
@@ -0,0 +1,140 @@
+#ifndef VALHALLA_SIF_COSTDISPATCH_H_
+#define VALHALLA_SIF_COSTDISPATCH_H_
+
+#include <typeinfo>
+#include <utility>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/nodeinfo.h>
+#include <valhalla/sif/autocost.h>
+#include <valhalla/sif/costcache.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/truckcost.h>
+
+namespace valhalla {
+namespace sif {
+
+/**
+ * Forwards the costing calls made in the inner loop of the path algorithms
+ * (access checks, edge and transition costs) to a costing object. For a
+ * concrete costing class the calls are qualified with the class so they are
+ * resolved at compile time and can be inlined into the expansion loops. The
+ * DynamicCost specialization below makes the usual virtual calls. Edge costs
+ * come from the tile memos when the costing has a profile id.
+ */
+template <class CostT> class CostCalls {
+public:
+  /**
+   * Constructor. The costing must be exactly of type CostT, see SelectByCostType.
+   * @param  costing  Costing to forward the calls to.
+   */
+  explicit CostCalls(const DynamicCost& costing) : costing_(static_cast<const CostT&>(costing)) {
+  }
+
+  template <typename... Args> bool Allowed(Args&&... args) const {
+    return costing_.CostT::Allowed(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args> bool AllowedReverse(Args&&... args) const {
+    return costing_.CostT::AllowedReverse(std::forward<Args>(args)...);
+  }
+
+  Cost EdgeCost(const baldr::DirectedEdge* edge,
+                const baldr::GraphTile* tile,
+                const uint32_t seconds) const {
+    return MemoizedEdgeCost(costing_, edge, tile, seconds, [&]() {
+      return costing_.CostT::EdgeCost(edge, tile, seconds);
+    });
+  }
+
+  // Same as DynamicCost::EdgeCost(edge, tile), which the costing classes hide. Memoized
+  // like the time aware costs, under the time key without time.
+  Cost EdgeCost(const baldr::DirectedEdge* edge, const baldr::GraphTile* tile) const {
+    return EdgeCost(edge, tile, baldr::kInvalidSecondsOfWeek);
+  }
+
+  Cost TransitionCost(const baldr::DirectedEdge* edge,
+                      const baldr::NodeInfo* node,
+                      const EdgeLabel& pred) const {
+    return costing_.CostT::TransitionCost(edge, node, pred);
+  }
+
+  Cost TransitionCostReverse(const uint32_t idx,
+                             const baldr::NodeInfo* node,
+                             const baldr::DirectedEdge* pred,
+                             const baldr::DirectedEdge* edge) const {
+    return costing_.CostT::TransitionCostReverse(idx, node, pred, edge);
+  }
+
+protected:
+  const CostT& costing_;
+};
+
+/**
+ * Generic version for any costing, calls through the virtual methods.
+ */
+template <> class CostCalls<DynamicCost> {
+public:
+  explicit CostCalls(const DynamicCost& costing) : costing_(costing) {
+  }
+
+  template <typename... Args> bool Allowed(Args&&... args) const {
+    return costing_.Allowed(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args> bool AllowedReverse(Args&&... args) const {
+    return costing_.AllowedReverse(std::forward<Args>(args)...);
+  }
+
+  Cost EdgeCost(const baldr::DirectedEdge* edge,
+                const baldr::GraphTile* tile,
+                const uint32_t seconds) const {
+    return MemoizedEdgeCost(costing_, edge, tile, seconds,
+                            [&]() { return costing_.EdgeCost(edge, tile, seconds); });
+  }
+
+  Cost EdgeCost(const baldr::DirectedEdge* edge, const baldr::GraphTile* tile) const {
+    return EdgeCost(edge, tile, baldr::kInvalidSecondsOfWeek);
+  }
+
+  template <typename... Args> Cost TransitionCost(Args&&... args) const {
+    return costing_.TransitionCost(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args> Cost TransitionCostReverse(Args&&... args) const {
+    return costing_.TransitionCostReverse(std::forward<Args>(args)...);
+  }
+
+protected:
+  const DynamicCost& costing_;
+};
+
+/**
+ * Selects one of the instantiations of an algorithm (typically a member
+ * function pointer) based on the type of the costing. Only the exact types
+ * match: the costings derived from AutoCost (bus, hov, taxi, ...) override
+ * its methods and get the generic instantiation.
+ * @param  costing   Costing used by the request.
+ * @param  for_auto  Instantiation using CostCalls<AutoCost>.
+ * @param  for_truck Instantiation using CostCalls<TruckCost>.
+ * @param  generic   Instantiation using CostCalls<DynamicCost>.
+ * @return Returns the instantiation to use for this costing.
+ */
+template <typename FnT>
+FnT SelectByCostType(const DynamicCost& costing, FnT for_auto, FnT for_truck, FnT generic) {
+  const std::type_info& type = typeid(costing);
+  if (type == typeid(AutoCost)) {
+    return for_auto;
+  }
+  if (type == typeid(TruckCost)) {
+    return for_truck;
+  }
+  return generic;
+}
+
+} // namespace sif
+} // namespace valhalla
+
+#endif // VALHALLA_SIF_COSTDISPATCH_H_
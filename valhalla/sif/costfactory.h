@@ -8,6 +8,7 @@
 #include <valhalla/proto/options.pb.h>
 #include <valhalla/sif/autocost.h>
 #include <valhalla/sif/bicyclecost.h>
+#include <valhalla/sif/costcache.h>
 #include <valhalla/sif/motorcyclecost.h>
 #include <valhalla/sif/motorscootercost.h>
 #include <valhalla/sif/pedestriancost.h>
@@ -43,7 +44,9 @@ public:
   }
 
   /**
-   * Make a cost from its specified type
+   * Make a cost from its specified type. The cost is a copy of the profile for
+   * these options in the process wide CostCache, the profile is constructed
+   * the first time the options are seen.
    * @param costing  the type of cost to create
    * @param options  pbf with request options
    */
@@ -53,8 +56,8 @@ public:
       auto costing_str = Costing_Enum_Name(costing);
       throw std::runtime_error("No costing method found for '" + costing_str + "'");
     }
-    // create the cost using the function pointer
-    return itr->second(costing, options);
+    // copy the cached profile or create the cost using the function pointer
+    return CostCache::GetInstance().Create(costing, options, itr->second);
   }
 
   /**
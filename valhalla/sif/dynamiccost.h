@@ -78,6 +78,14 @@ public:
 
   virtual ~DynamicCost();
 
+  /**
+   * Copy this costing. The copy has the same type and does not share any
+   * state with this costing, so a request can change it (pass, hierarchy
+   * limits, excluded tiles, ...) without affecting other copies.
+   * @return  Returns a copy of this costing.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const = 0;
+
   /**
    * Does the costing method allow multiple passes (with relaxed
    * hierarchy limits).
@@ -543,6 +551,12 @@ public:
    */
   void AddUserAvoidEdges(const std::vector<AvoidEdge>& avoid_edges);
 
+  /**
+   * Adds the avoid edges of the request options to the user specified avoid list.
+   * @param  options  Request options.
+   */
+  void AddUserAvoidEdges(const Options& options);
+
   /**
    * Check if the edge is in the user-specified avoid list.
    * @param  edgeid  Directed edge Id.
@@ -590,6 +604,33 @@ public:
     return flow_mask_;
   }
 
+  /**
+   * Can the edge costs of this costing be memoized in the tiles? This is the
+   * case if EdgeCost only depends on the edge, its speed in the tile and the
+   * costing options (not on any state changed while computing a path).
+   * @return  Returns true if the edge costs can be memoized.
+   */
+  virtual bool EdgeCostMemoizable() const {
+    return false;
+  }
+
+  /**
+   * Get the id of the cached profile this costing is a copy of, which keys its
+   * edge costs in the tile memos. 0 if the edge costs are not memoized.
+   * @return  Returns the profile id.
+   */
+  uint64_t profile_id() const {
+    return profile_id_;
+  }
+
+  /**
+   * Set the id of the cached profile, see CostCache.
+   * @param  profile_id  Profile id, 0 to not memoize edge costs.
+   */
+  void set_profile_id(const uint64_t profile_id) {
+    profile_id_ = profile_id;
+  }
+
 protected:
   // Algorithm pass
   uint32_t pass_;
@@ -628,6 +669,9 @@ protected:
   // A mask which determines which flow data the costing should use from the tile
   uint8_t flow_mask_;
 
+  // Id of the cached profile keying the memoized edge costs (0 if not memoized)
+  uint64_t profile_id_;
+
   /**
    * Get the base transition costs (and ferry factor) from the costing options.
    * @param costing_options Protocol buffer of costing options.
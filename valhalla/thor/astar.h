@@ -67,6 +67,12 @@ public:
    */
   virtual void Clear();
 
+  /**
+   * Get the counters of the search since it was last initialized.
+   * @return Returns the search counters.
+   */
+  virtual SearchStats stats() const override;
+
   /**
    * Set a maximum label count. The path algorithm terminates if this
    * is exceeded.
@@ -102,6 +108,15 @@ protected:
   // Destinations, id and percent used along the edge
   std::map<uint64_t, float> destinations_percent_along_;
 
+  // Arc flags of the destination region(s), all set if not pruning
+  uint64_t arcflags_mask_;
+
+  /**
+   * Report the bytes held by the edge labels, adjacency list and edge status
+   * to the memory budget, if any.
+   */
+  virtual void UpdateMemory();
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
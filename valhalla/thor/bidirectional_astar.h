@@ -1,6 +1,7 @@
 #ifndef VALHALLA_THOR_BIDIRECTIONAL_ASTAR_H_
 #define VALHALLA_THOR_BIDIRECTIONAL_ASTAR_H_
 
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -19,6 +20,31 @@
 namespace valhalla {
 namespace thor {
 
+// Default minimum distance (meters) between origin and destination to run the
+// forward and reverse searches concurrently. Shorter routes complete in about
+// the time it takes to start a thread.
+constexpr float kParallelMinDistance = 50000.0f;
+
+// Alternate paths through the connections of the forward and reverse searches,
+// as fractions of the cost of the best path: the maximum extra cost of an
+// alternate (bounded stretch), the maximum cost it shares with the paths already
+// chosen (limited sharing) and the minimum cost of its plateau, the part around
+// the connection that is on both search trees (local optimality).
+constexpr float kAlternateMaxStretch = 0.25f;
+constexpr float kAlternateMaxSharing = 0.8f;
+constexpr float kAlternateMinPlateau = 0.2f;
+
+/**
+ * Check whether a path goes along an edge or through a node more than once, e.g.
+ * an alternate joining the search trees at a detour into a dead end and back. The
+ * begin node of the first edge and the end node of the last edge are not counted
+ * as the origin and destination may be partway along them.
+ * @param  graphreader  Graph reader to get the end nodes of the edges.
+ * @param  path         Edges of the path.
+ * @return Returns true if the path loops.
+ */
+bool PathLoops(baldr::GraphReader& graphreader, const std::vector<PathInfo>& path);
+
 /**
  * Candidate connections - a directed edge and its opposing directed edge
  * are both temporarily labeled. Store the edge Ids and its cost.
@@ -74,6 +100,27 @@ public:
    */
   void Clear();
 
+  /**
+   * Get the counters of the forward and reverse searches since they were last
+   * initialized.
+   * @return Returns the search counters.
+   */
+  SearchStats stats() const override;
+
+  /**
+   * Run the forward and reverse searches concurrently on two threads. The
+   * reverse search runs on a separate thread using the supplied graph reader
+   * (GraphReader is not thread safe). Pass an empty pointer to disable.
+   * @param  reader        Graph reader used by the reverse search.
+   * @param  min_distance  Minimum distance (meters) between origin and destination
+   *                       to run the searches concurrently.
+   */
+  void set_reverse_reader(const std::shared_ptr<baldr::GraphReader>& reader,
+                          const float min_distance = kParallelMinDistance) {
+    reverse_reader_ = reader;
+    parallel_min_distance_ = min_distance;
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -112,6 +159,47 @@ protected:
   float threshold_;
   CandidateConnection best_connection_;
 
+  // Number of alternate paths requested. When non zero all connections found
+  // are kept as candidate via edges for the alternates.
+  uint32_t desired_alternates_;
+  std::vector<CandidateConnection> candidates_;
+
+  // Arc flags of the destination region(s) for the forward search and of the
+  // origin region(s) for the reverse search. All set if not pruning.
+  uint64_t arcflags_forward_mask_;
+  uint64_t arcflags_reverse_mask_;
+
+  // Edges of the destination (forward) and origin (reverse) locations, never pruned
+  // by the arc flags since the regions of their nodes may differ from the flags
+  std::vector<baldr::GraphId> arcflags_exempt_forward_;
+  std::vector<baldr::GraphId> arcflags_exempt_reverse_;
+
+  // Support for running the forward and reverse searches concurrently. Each
+  // search publishes the edges it settles so the other can check connections
+  // without locking, the best connection cost and the threshold are shared.
+  std::shared_ptr<baldr::GraphReader> reverse_reader_;
+  SharedEdgeStatus settled_forward_;
+  SharedEdgeStatus settled_reverse_;
+  std::atomic<float> shared_best_cost_;
+  std::atomic<float> shared_threshold_;
+  std::atomic<bool> stop_parallel_;
+  float parallel_min_distance_;
+  CandidateConnection best_reverse_connection_;
+
+  // How a search thread stopped
+  enum class SearchState : uint8_t { kThreshold, kExhausted, kOverflow, kStopped };
+
+  // Bytes last reported by the reverse search, the forward search reports with
+  // memory_held_. Each search reports on the thread expanding it.
+  size_t memory_held_reverse_;
+
+  /**
+   * Report the bytes held by the edge labels, adjacency list and edge status
+   * of one of the searches to the memory budget, if any.
+   * @param  forward  True for the forward search, false for the reverse search.
+   */
+  void UpdateMemory(const bool forward);
+
   /**
    * Initialize the A* heuristic and adjacency lists for both the forward
    * and reverse search.
@@ -120,15 +208,34 @@ protected:
    */
   void Init(const midgard::PointLL& origll, const midgard::PointLL& destll);
 
+  // Instantiations of the expansion methods for the costing of the request,
+  // selected once per request (see sif::SelectByCostType).
+  using ExpandForwardFn = bool (BidirectionalAStar::*)(baldr::GraphReader&,
+                                                       const baldr::GraphId&,
+                                                       sif::BDEdgeLabel&,
+                                                       const uint32_t,
+                                                       const bool);
+  using ExpandReverseFn = bool (BidirectionalAStar::*)(baldr::GraphReader&,
+                                                       const baldr::GraphId&,
+                                                       sif::BDEdgeLabel&,
+                                                       const uint32_t,
+                                                       const baldr::DirectedEdge*,
+                                                       const bool);
+  ExpandForwardFn expand_forward_;
+  ExpandReverseFn expand_reverse_;
+
   /**
-   * Expand from the node along the forward search path.
+   * Expand from the node along the forward search path. CostT is the type
+   * of the costing, or sif::DynamicCost to call the costing virtually.
    */
+  template <class CostT>
   bool ExpandForward(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      sif::BDEdgeLabel& pred,
                      const uint32_t pred_idx,
                      const bool from_transition);
   // Private helper function for `ExpandForward`
+  template <class CostT>
   bool ExpandForwardInner(baldr::GraphReader& graphreader,
                           const sif::BDEdgeLabel& pred,
                           const baldr::NodeInfo* nodeinfo,
@@ -138,8 +245,10 @@ protected:
                           const baldr::GraphTile* tile);
 
   /**
-   * Expand from the node along the reverse search path.
+   * Expand from the node along the reverse search path. CostT is the type
+   * of the costing, or sif::DynamicCost to call the costing virtually.
    */
+  template <class CostT>
   bool ExpandReverse(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      sif::BDEdgeLabel& pred,
@@ -148,6 +257,7 @@ protected:
                      const bool from_transition);
 
   // Private helper function for `ExpandReverse`
+  template <class CostT>
   bool ExpandReverseInner(baldr::GraphReader& graphreader,
                           const sif::BDEdgeLabel& pred,
                           const baldr::DirectedEdge* opp_pred_edge,
@@ -156,6 +266,53 @@ protected:
                           const EdgeMetadata& meta,
                           uint32_t& shortcuts,
                           const baldr::GraphTile* tile);
+  /**
+   * Run the forward search on this thread and the reverse search on another
+   * thread until both have exceeded the shared threshold, one of them is
+   * exhausted or one runs out of room to publish settled edges (in which case
+   * the searches can be continued on a single thread).
+   * @param  graphreader  Graph reader used by the forward search.
+   * @return Returns true if the searches are complete.
+   */
+  bool ExpandParallel(baldr::GraphReader& graphreader);
+
+  /**
+   * Expand the forward search, run by ExpandParallel.
+   */
+  SearchState ParallelForward(baldr::GraphReader& graphreader);
+
+  /**
+   * Expand the reverse search, run by ExpandParallel.
+   */
+  SearchState ParallelReverse(baldr::GraphReader& graphreader);
+
+  /**
+   * Lower the shared best connection cost and set the shared threshold if
+   * not yet set.
+   * @param  cost       Cost of the connection.
+   * @param  threshold  Threshold to extend the search.
+   * @return Returns true if this is the best connection found so far.
+   */
+  bool UpdateSharedConnection(const float cost, const float threshold);
+
+  /**
+   * Get the cost of the path through a forward edge label connecting to a
+   * settled edge on the reverse search tree.
+   * @param  pred     Forward edge label.
+   * @param  opp_idx  Index of the edge label of the opposing edge.
+   * @return Returns the cost of the path.
+   */
+  float ForwardConnectionCost(const sif::BDEdgeLabel& pred, const uint32_t opp_idx) const;
+
+  /**
+   * Get the cost of the path through a reverse edge label connecting to a
+   * settled edge on the forward search tree.
+   * @param  pred     Reverse edge label.
+   * @param  opp_idx  Index of the edge label of the opposing edge.
+   * @return Returns the cost of the path.
+   */
+  float ReverseConnectionCost(const sif::BDEdgeLabel& pred, const uint32_t opp_idx) const;
+
   /**
    * Add edges at the origin to the forward adjacency list.
    * @param  graphreader  Graph tile reader.
@@ -197,10 +354,38 @@ protected:
    * @param   options      Controls whether or not we get alternatives
    * @return  Returns the path infos, a list of GraphIds representing the
    *          directed edges along the path - ordered from origin to
-   *          destination - along with travel modes and elapsed time.
+   *          destination - along with travel modes and elapsed time. The
+   *          best path is first, followed by any alternates.
    */
   std::vector<std::vector<PathInfo>> FormPath(baldr::GraphReader& graphreader,
                                               const Options& options);
+
+  /**
+   * Form the path through a connection: the forward search tree from the
+   * origin to the connecting edge followed by the reverse search tree from
+   * the opposing edge to the destination.
+   * @param  connection  Connection between the forward and reverse trees.
+   * @param  path        Path edges (cleared first).
+   * @param  opp_edges   Opposing edges of the path edges (cleared first).
+   * @return Returns the index of the connecting edge within the path.
+   */
+  size_t FormConnectionPath(const CandidateConnection& connection,
+                            std::vector<PathInfo>& path,
+                            std::vector<baldr::GraphId>& opp_edges);
+
+  /**
+   * Get the cost of the plateau of a path through a connection: the part of
+   * the path around the connecting edge that is on both the forward and the
+   * reverse search trees. A path with a long plateau is locally optimal, it
+   * has no shortcut around its connecting edge.
+   * @param  path       Path through the connection.
+   * @param  opp_edges  Opposing edges of the path edges.
+   * @param  via_idx    Index of the connecting edge within the path.
+   * @return Returns the cost along the plateau.
+   */
+  float PlateauCost(const std::vector<PathInfo>& path,
+                    const std::vector<baldr::GraphId>& opp_edges,
+                    const size_t via_idx) const;
 };
 
 } // namespace thor
@@ -0,0 +1,103 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/tripcommon.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default maximum number of edge labels of each backward search. Bounds the
+// memory used by the buckets (all edge labels of all targets are kept until
+// the forward searches are done).
+constexpr uint32_t kDefaultMaxBucketLabels = 10000;
+
+/**
+ * Class to compute cost (cost + time + distance) matrices for many sources and
+ * many targets using buckets. Unlike CostMatrix, which interleaves the searches
+ * from all locations until every pair has met, the backward searches from the
+ * targets run first and independently: every edge they reach keeps a bucket of
+ * the targets that reached it (with their edge labels). Then each source runs a
+ * single forward search that scans the buckets of the edges it settles, so the
+ * work grows with the number of locations rather than with the number of pairs.
+ * Both phases use highway hierarchies and run on multiple threads when graph
+ * readers are set for them.
+ *
+ * Backward searches stop at the cost threshold of the farthest source of their
+ * target or after a maximum number of edge labels. Any path to the target
+ * crosses the edges settled by its backward search, so a forward search still
+ * finds it past them. Pairs that are not connected when the backward search of
+ * their target was cut short are computed with CostMatrix, one target (column)
+ * at a time.
+ */
+class BucketMatrix : public CostMatrix {
+public:
+  BucketMatrix() : max_bucket_labels_(kDefaultMaxBucketLabels) {
+  }
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance>
+  SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+                 baldr::GraphReader& graphreader,
+                 const std::shared_ptr<sif::DynamicCost>* mode_costing,
+                 const sif::TravelMode mode,
+                 const float max_matrix_distance);
+
+  /**
+   * Set the maximum number of edge labels of each backward search.
+   * @param  max_labels  Maximum number of edge labels, 0 for no maximum.
+   */
+  void set_max_bucket_labels(const uint32_t max_labels) {
+    max_bucket_labels_ = max_labels;
+  }
+
+protected:
+  uint32_t max_bucket_labels_;
+
+  // Search loops specialized for the costing of the matrix
+  void (CostMatrix::*forward_search_)(const uint32_t, const uint32_t, baldr::GraphReader&);
+  void (CostMatrix::*backward_search_)(const uint32_t, baldr::GraphReader&);
+
+  // Targets whose backward search stopped before it was exhausted or reached
+  // the cost threshold of the matrix
+  std::vector<uint8_t> truncated_;
+
+  /**
+   * Expand the backward search from a target until it is exhausted, exceeds
+   * its cost threshold or reaches the maximum number of edge labels.
+   * @param  index        Index of the target location.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  void FillBuckets(const uint32_t index, baldr::GraphReader& graphreader);
+
+  /**
+   * Expand the forward search from a source, checking the buckets of each
+   * settled edge, until all targets are connected (plus a threshold) or the
+   * search is exhausted.
+   * @param  index        Index of the source location.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  void ScanBuckets(const uint32_t index, baldr::GraphReader& graphreader);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BUCKETMATRIX_H_
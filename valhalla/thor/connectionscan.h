@@ -0,0 +1,219 @@
+#ifndef VALHALLA_THOR_CONNECTIONSCAN_H_
+#define VALHALLA_THOR_CONNECTIONSCAN_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/transittimetable.h>
+
+namespace valhalla {
+namespace thor {
+
+// Maximum number of trips taken by a route
+constexpr uint32_t kMaxTransitRounds = 5;
+
+// Meters the region of the timetable extends around the origin and destination
+constexpr float kTimetableMargin = 10000.0f;
+
+/**
+ * Round based multimodal (walking and transit) pathfinding algorithm. Round k
+ * finds the earliest arrival at every stop and at the destination with k trips:
+ * a connection scan over the timetable of the region takes one more trip from
+ * the stops reached by the previous round, then a walk (using the pedestrian
+ * costing) from the stops it reaches gives the transfers and the egress to the
+ * destination. Round 0 is the walk from the origin.
+ *
+ * Each round arriving earlier than the rounds before it gives a Pareto optimal
+ * option (fewer trips or earlier arrival). The option with the lowest cost is
+ * the best path, the others are returned as alternates.
+ */
+class ConnectionScan : public PathAlgorithm {
+public:
+  /**
+   * Constructor.
+   */
+  ConnectionScan();
+
+  /**
+   * Destructor
+   */
+  virtual ~ConnectionScan();
+
+  /**
+   * Form multi-modal paths between an origin and destination location. The
+   * origin must have a date_time.
+   * @param  origin        Origin location
+   * @param  dest          Destination location
+   * @param  graphreader   Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode          Travel mode from the origin.
+   * @param  options       Request options, alternates are the other Pareto
+   *                       optimal options.
+   * @return Returns the path edges (and elapsed time/modes at end of each
+   *         edge) of the best path followed by the alternates.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const std::shared_ptr<sif::DynamicCost>* mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Clear the temporary information generated during path construction. The
+   * timetable is kept for the next request in the same region and day.
+   */
+  void Clear() override;
+
+  /**
+   * Get the counters of the search since it was last initialized.
+   * @return Returns the search counters.
+   */
+  SearchStats stats() const override;
+
+protected:
+  // The walk of a round: from the origin (round 0) or from the stops reached
+  // by the trips of the round. The first labels of a round k > 0 are its seeds,
+  // one per stop reached, along the line edge of the trip arriving there.
+  struct Walk {
+    std::vector<sif::EdgeLabel> edgelabels;
+    std::vector<uint32_t> seeds;    // Stop of each seed label
+    std::vector<StopArrival> stops; // Arrivals at the stops (indexed by stop)
+    uint32_t destination = baldr::kInvalidLabel; // Label reaching the destination
+    uint32_t destination_time = kUnreachedTime;  // Arrival time at the destination
+    float destination_cost = 0.0f;               // Cost to the destination
+  };
+
+  uint32_t start_time_; // Seconds from midnight at the origin
+  int start_tz_index_;  // Timezone at the origin
+  uint32_t max_transfer_distance_;
+  uint32_t best_arrival_; // Earliest arrival at the destination of any round
+
+  // Timetable of the region and its key (date, timezone, tiles and their datasets)
+  std::shared_ptr<TransitTimetable> timetable_;
+  std::string timetable_key_;
+  std::vector<bool> allowed_lines_;
+
+  // Walks and trips of each round, trips_[k - 1] are the arrivals of round k
+  std::vector<Walk> walks_;
+  std::vector<std::vector<TripArrival>> trips_;
+  std::vector<uint32_t> best_stops_; // Earliest arrival at each stop of any round
+
+  // Adjacency list of the current walk and counters of the earlier walks
+  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
+  SearchStats walk_stats_;
+
+  // Edge status of the current walk
+  EdgeStatus edgestatus_;
+
+  // Destinations, id and cost
+  std::map<uint64_t, sif::Cost> destinations_;
+
+  /**
+   * Report the bytes held by the walks, the trip arrivals of the rounds, the
+   * adjacency list and the edge status to the memory budget, if any.
+   */
+  void UpdateMemory();
+
+  /**
+   * Get the timetable of the transit tiles around the origin and destination
+   * for the day of the origin, and the lines allowed by the transit costing.
+   * @param  graphreader  Graph reader.
+   * @param  origin       Origin location (with its date_time).
+   * @param  dest         Destination location.
+   * @param  tc           Transit costing.
+   */
+  void LoadTimetable(baldr::GraphReader& graphreader,
+                     const valhalla::Location& origin,
+                     const valhalla::Location& dest,
+                     const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * Add the edges at the origin to the walk of round 0.
+   * @param  graphreader  Graph tile reader.
+   * @param  origin       Location information of the origin.
+   * @param  dest         Location information of the destination.
+   * @param  costing      Pedestrian costing.
+   */
+  void SetOrigin(baldr::GraphReader& graphreader,
+                 valhalla::Location& origin,
+                 const valhalla::Location& dest,
+                 const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Set the destination edge(s).
+   * @param  graphreader  Graph tile reader.
+   * @param  dest         Location information of the destination.
+   * @param  costing      Pedestrian costing.
+   */
+  void SetDestination(baldr::GraphReader& graphreader,
+                      const valhalla::Location& dest,
+                      const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Add the seeds of the walk of a round: the stops its trips reach earlier
+   * than any earlier round.
+   * @param  graphreader  Graph tile reader.
+   * @param  round        Round (> 0).
+   * @return Returns true if any stop was seeded.
+   */
+  bool SetSeeds(baldr::GraphReader& graphreader, const uint32_t round);
+
+  /**
+   * Walk from the labels of the walk of a round, recording the earliest
+   * arrivals at the stops and at the destination.
+   * @param  graphreader  Graph tile reader.
+   * @param  round        Round of the walk.
+   * @param  pc           Pedestrian costing.
+   * @param  tc           Transit costing.
+   */
+  void WalkRound(baldr::GraphReader& graphreader,
+                 const uint32_t round,
+                 const std::shared_ptr<sif::DynamicCost>& pc,
+                 const std::shared_ptr<sif::DynamicCost>& tc);
+
+  /**
+   * Expand the walk from a node. Immediately expands from the end node of
+   * any transition edge if from_transition is false.
+   * @param  graphreader      Graph tile reader.
+   * @param  walk             Walk being expanded.
+   * @param  node             Graph Id of the node being expanded.
+   * @param  pred             Predecessor edge label.
+   * @param  pred_idx         Index of the predecessor in the walk labels.
+   * @param  pc               Pedestrian costing.
+   * @param  from_transition  True if this method is called from a transition edge.
+   */
+  void ExpandForward(baldr::GraphReader& graphreader,
+                     Walk& walk,
+                     const baldr::GraphId& node,
+                     const sif::EdgeLabel& pred,
+                     const uint32_t pred_idx,
+                     const std::shared_ptr<sif::DynamicCost>& pc,
+                     const bool from_transition);
+
+  /**
+   * Form the path reaching the destination in a round. Walks back through
+   * the walks and trips of the earlier rounds.
+   * @param  round  Round reaching the destination.
+   * @return Returns the path info, ordered from origin to destination.
+   */
+  std::vector<PathInfo> FormPath(const uint32_t round);
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONNECTIONSCAN_H_
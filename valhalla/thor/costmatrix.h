@@ -2,6 +2,7 @@
 #define VALHALLA_THOR_COSTMATRIX_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -16,6 +17,8 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/searchmemory.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -94,6 +97,11 @@ public:
    */
   CostMatrix();
 
+  /**
+   * Destructor. Releases the memory of the searches from the budget.
+   */
+  ~CostMatrix();
+
   /**
    * Forms a time distance matrix from the set of source locations
    * to the set of target locations.
@@ -119,6 +127,54 @@ public:
    */
   void Clear();
 
+  /**
+   * Get the counters of the source and target searches of the last matrix.
+   * @return Returns the search counters.
+   */
+  SearchStats stats() const;
+
+  /**
+   * Set graph readers used to expand the searches on additional threads. Each
+   * reader must only be used by one thread at a time, readers sharing a
+   * synchronized tile cache avoid loading tiles once per thread. With readers
+   * each search expands a batch of edges between the synchronizations of the
+   * threads, which changes the results slightly compared to no readers.
+   * @param  readers  Graph readers, one per additional thread.
+   */
+  void set_thread_readers(const std::vector<std::shared_ptr<baldr::GraphReader>>& readers) {
+    thread_readers_ = readers;
+  }
+
+  /**
+   * Set a callback that will throw when the matrix computation should be aborted.
+   * It is only called from the thread computing the matrix.
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Set a thread safe callback that will throw when the matrix computation
+   * should be aborted, e.g. past the deadline of the request. It is called from
+   * the additional threads which don't synchronize with the computing thread.
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_thread_interrupt(const std::function<void()>* interrupt_callback) {
+    thread_interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Set the memory budget the source and target searches report to. Throws
+   * from the search that exceeds it, on whichever thread expands it.
+   * @param memory  the budget, nullptr to not account for memory
+   */
+  void set_memory(SearchMemory* memory) {
+    memory_ = memory;
+  }
+
 protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
@@ -162,6 +218,39 @@ protected:
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // Edges reached by each target and targets whose backward search is exhausted
+  // within the current round. Applied to targets_ and the status after the
+  // backward searches
+  std::vector<std::vector<baldr::GraphId>> target_reached_;
+  std::vector<uint8_t> target_exhausted_;
+
+  // Cost threshold of the backward search of each target, the cost threshold
+  // of the matrix unless a lower bound is known for the target (BucketMatrix)
+  std::vector<float> target_cost_threshold_;
+
+  // Target status updates (target index, source edge label count) found by each
+  // source within the current round. Applied after the forward searches
+  std::vector<std::vector<std::pair<uint32_t, size_t>>> target_updates_;
+
+  // Graph readers for additional threads
+  std::vector<std::shared_ptr<baldr::GraphReader>> thread_readers_;
+
+  // Interrupt callback, called between rounds of the searches
+  const std::function<void()>* interrupt_;
+
+  // Thread safe interrupt callback, called from the additional threads
+  const std::function<void()>* thread_interrupt_;
+
+  // Memory budget and the bytes last reported by each source and target search
+  // and by the target edge markings (the buckets of BucketMatrix)
+  SearchMemory* memory_;
+  std::vector<size_t> source_memory_;
+  std::vector<size_t> target_memory_;
+  size_t targets_memory_;
+
+  // Number of target indexes in the target edge markings
+  size_t target_entries_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -179,11 +268,13 @@ protected:
                   const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list);
 
   /**
-   * Iterate the forward search from the source/origin location.
+   * Iterate the forward search from the source/origin location. CostT is the
+   * type of the costing, or sif::DynamicCost to call the costing virtually.
    * @param  index        Index of the source location.
    * @param  n            Iteration counter.
    * @param  graphreader  Graph reader for accessing routing graph.
    */
+  template <class CostT>
   void ForwardSearch(const uint32_t index, const uint32_t n, baldr::GraphReader& graphreader);
 
   /**
@@ -196,19 +287,64 @@ protected:
   void CheckForwardConnections(const uint32_t source, const sif::BDEdgeLabel& pred, const uint32_t n);
 
   /**
-   * Update status when a connection is found.
+   * Update status when a connection is found on the forward search. The
+   * target status is updated after the forward searches of the current round.
    * @param  source  Source index
    * @param  target  Target index
    */
   void UpdateStatus(const uint32_t source, const uint32_t target);
 
   /**
-   * Iterate the backward search from the target/destination location.
+   * Remove the target from the remaining locations of the source.
+   * @param  source  Source index
+   * @param  target  Target index
+   */
+  void UpdateSourceStatus(const uint32_t source, const uint32_t target);
+
+  /**
+   * Remove the source from the remaining locations of the target.
+   * @param  target              Target index
+   * @param  source              Source index
+   * @param  source_label_count  Number of edge labels of the source search
+   *                             when the connection was found.
+   */
+  void UpdateTargetStatus(const uint32_t target,
+                          const uint32_t source,
+                          const size_t source_label_count);
+
+  /**
+   * Iterate the backward search from the target/destination location. CostT is
+   * the type of the costing, or sif::DynamicCost to call the costing virtually.
    * @param  index        Index of the target location.
    * @param  graphreader  Graph reader for accessing routing graph.
    */
+  template <class CostT>
   void BackwardSearch(const uint32_t index, baldr::GraphReader& graphreader);
 
+  /**
+   * Report the bytes held by the edge labels, adjacency list and edge status
+   * of a source or target search to the memory budget, if any.
+   * @param  forward  True for the search of a source, false for a target.
+   * @param  index    Index of the source or target location.
+   */
+  void UpdateMemory(const bool forward, const uint32_t index);
+
+  /**
+   * Mark an edge as reached by the search of a target.
+   * @param  edgeid  Edge reached, in the forward direction.
+   * @param  index   Index of the target location.
+   */
+  void AddTarget(const baldr::GraphId& edgeid, const uint32_t index) {
+    targets_[edgeid].push_back(index);
+    target_entries_++;
+  }
+
+  /**
+   * Report the bytes held by the target edge markings to the memory budget, if
+   * any. Not thread safe, called once the markings of the round are added.
+   */
+  void UpdateTargetsMemory();
+
   /**
    * Sets the source/origin locations. Search expands forward from these
    * locations.
@@ -0,0 +1,69 @@
+#ifndef VALHALLA_THOR_EDGEBATCH_H_
+#define VALHALLA_THOR_EDGEBATCH_H_
+
+#include <cstdint>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/nodeinfo.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Evaluates all outgoing edges of a node in one pass before they are relaxed
+ * one at a time. The pass runs over the contiguous directed edges without
+ * calling the costing and marks the candidates for expansion: edges with
+ * access for the travel mode and shortcuts (which are needed to mark the
+ * edges they supersede). While the edges are loaded it prefetches the end
+ * nodes of the candidates within the tile, which the relaxation reads next.
+ */
+class EdgeBatch {
+public:
+  /**
+   * Evaluate the outgoing edges of a node.
+   * @param  edges    First outgoing directed edge of the node.
+   * @param  count    Number of outgoing edges.
+   * @param  access   Access mode of the costing.
+   * @param  forward  Test forward access if true, reverse access if false.
+   * @param  tile     Tile of the node, end nodes within it are prefetched.
+   *                  Can be null to skip prefetching.
+   */
+  void Evaluate(const baldr::DirectedEdge* edges,
+                const uint32_t count,
+                const uint32_t access,
+                const bool forward,
+                const baldr::GraphTile* tile) {
+    candidates_[0] = 0;
+    candidates_[1] = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      const baldr::DirectedEdge& edge = edges[i];
+      const uint32_t modes = forward ? edge.forwardaccess() : edge.reverseaccess();
+      const uint64_t candidate = static_cast<uint64_t>((modes & access) != 0 || edge.is_shortcut());
+      candidates_[i >> 6] |= candidate << (i & 63);
+#if defined(__GNUC__) || defined(__clang__)
+      if (candidate && tile != nullptr && !edge.leaves_tile()) {
+        __builtin_prefetch(tile->node(edge.endnode()));
+      }
+#endif
+    }
+  }
+
+  /**
+   * Is the edge a candidate for expansion.
+   * @param  i  Index of the edge within the outgoing edges of the node.
+   * @return Returns false if the edge can be skipped.
+   */
+  bool candidate(const uint32_t i) const {
+    return (candidates_[i >> 6] >> (i & 63)) & 1;
+  }
+
+protected:
+  // One bit per outgoing edge (a node has at most kMaxEdgesPerNode edges)
+  uint64_t candidates_[(baldr::kMaxEdgesPerNode + 63) / 64];
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_EDGEBATCH_H_
@@ -1,7 +1,10 @@
 #ifndef VALHALLA_THOR_EDGESTATUS_H_
 #define VALHALLA_THOR_EDGESTATUS_H_
 
+#include <atomic>
 #include <unordered_map>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 
@@ -64,6 +67,16 @@ public:
       delete[] iter.second;
     }
     edgestatus_.clear();
+    memory_ = 0;
+  }
+
+  /**
+   * Get the approximate number of bytes used by the edge status: the arrays
+   * of the tiles and their entries in the map.
+   * @return  Returns the bytes used.
+   */
+  size_t memory() const {
+    return memory_;
   }
 
   /**
@@ -85,6 +98,7 @@ public:
       // the number of directed edges in the specified tile.
       auto inserted = edgestatus_.emplace(edgeid.tile_value(),
                                           new EdgeStatusInfo[tile->header()->directededgecount()]);
+      memory_ += tile->header()->directededgecount() * sizeof(EdgeStatusInfo) + kTileEntryBytes;
       inserted.first->second[edgeid.id()] = {set, index};
     }
   }
@@ -131,15 +145,133 @@ public:
       // the number of directed edges in the specified tile.
       auto inserted = edgestatus_.emplace(edgeid.tile_value(),
                                           new EdgeStatusInfo[tile->header()->directededgecount()]);
+      memory_ += tile->header()->directededgecount() * sizeof(EdgeStatusInfo) + kTileEntryBytes;
       return &(inserted.first->second)[edgeid.id()];
     }
   }
 
 private:
+  // Approximate bytes of a map entry (node, key, array pointer and bucket)
+  static constexpr size_t kTileEntryBytes = 4 * sizeof(void*);
+
   // Edge status - keys are the tile Ids (level and tile Id) and the
   // values are dynamically allocated arrays of EdgeStatusInfo (sized
   // based on the directed edge count within the tile).
   std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+
+  // Bytes allocated for the tiles in the map
+  size_t memory_ = 0;
+};
+
+/**
+ * Settled edges of one direction of a bidirectional search, shared with the
+ * opposing search while both directions expand on separate threads. Only the
+ * owning thread sets edges, any thread may look them up without locking. As in
+ * EdgeStatus, edges are stored within arrays for each tile. The tile arrays are
+ * found through a fixed size open addressing table so a lookup never races
+ * with a rehash. Each edge stores its edge label index + 1 (0 if not settled).
+ */
+class SharedEdgeStatus {
+public:
+  SharedEdgeStatus() : tiles_(kMaxTiles) {
+  }
+
+  /**
+   * Destructor. Delete any allocated arrays.
+   */
+  ~SharedEdgeStatus() {
+    clear();
+  }
+
+  /**
+   * Clear the tile table. Not thread safe - only call this when no other
+   * thread is accessing the edge status.
+   */
+  void clear() {
+    for (auto slot : used_) {
+      delete[] tiles_[slot].edges.load();
+      tiles_[slot].edges = nullptr;
+      tiles_[slot].key = 0;
+    }
+    used_.clear();
+  }
+
+  /**
+   * Returns true if no more tiles can be added. Check this before setting an
+   * edge that may be within a new tile.
+   */
+  bool full() const {
+    return used_.size() >= kMaxTiles / 2;
+  }
+
+  /**
+   * Mark a directed edge as settled. Must only be called from the thread that
+   * owns this edge status.
+   * @param  edgeid   GraphId of the directed edge.
+   * @param  index    Index of the edge label.
+   * @param  tile     Graph tile of the directed edge.
+   */
+  void Set(const baldr::GraphId& edgeid, const uint32_t index, const baldr::GraphTile* tile) {
+    const uint32_t key = edgeid.tile_value() + 1;
+    uint32_t slot = hash(key);
+    while (true) {
+      uint32_t k = tiles_[slot].key.load(std::memory_order_relaxed);
+      if (k == key) {
+        break;
+      }
+      if (k == 0) {
+        // Publish the edge array before the key so readers that find the key
+        // also find the array
+        tiles_[slot].edges = new std::atomic<uint32_t>[tile->header()->directededgecount()]();
+        tiles_[slot].key = key;
+        used_.push_back(slot);
+        break;
+      }
+      slot = (slot + 1) & (kMaxTiles - 1);
+    }
+    tiles_[slot].edges.load(std::memory_order_relaxed)[edgeid.id()] = index + 1;
+  }
+
+  /**
+   * Check if a directed edge has been settled. Can be called from any thread.
+   * @param   edgeid  GraphId of the directed edge.
+   * @param   index   Returns the index of the edge label if settled.
+   * @return  Returns true if the edge has been settled.
+   */
+  bool Get(const baldr::GraphId& edgeid, uint32_t& index) const {
+    const uint32_t key = edgeid.tile_value() + 1;
+    uint32_t slot = hash(key);
+    while (true) {
+      uint32_t k = tiles_[slot].key;
+      if (k == 0) {
+        return false;
+      }
+      if (k == key) {
+        uint32_t v = tiles_[slot].edges.load()[edgeid.id()];
+        index = v - 1;
+        return v != 0;
+      }
+      slot = (slot + 1) & (kMaxTiles - 1);
+    }
+  }
+
+private:
+  static constexpr uint32_t kTileBits = 14;
+  static constexpr uint32_t kMaxTiles = 1 << kTileBits;
+
+  static uint32_t hash(const uint32_t key) {
+    return (key * 2654435761u) >> (32 - kTileBits);
+  }
+
+  struct TileSlot {
+    std::atomic<uint32_t> key;
+    std::atomic<std::atomic<uint32_t>*> edges;
+  };
+
+  // Fixed size tile table (keys are tile values + 1, 0 is empty) and the
+  // slots in use (only accessed by the owning thread).
+  std::vector<TileSlot> tiles_;
+  std::vector<uint32_t> used_;
 };
 
 } // namespace thor
@@ -0,0 +1,119 @@
+#ifndef VALHALLA_THOR_FLEETOPTIMIZER_H_
+#define VALHALLA_THOR_FLEETOPTIMIZER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+// The route of a vehicle
+struct FleetRoute {
+  uint32_t vehicle;               // Index of the vehicle
+  std::vector<uint32_t> jobs;     // Indexes of the jobs in the order they are done
+  std::vector<uint32_t> arrivals; // Arrival time at each job in seconds
+  float cost;                     // Travel time of the route in seconds
+};
+
+// Routes of the vehicles that have jobs and the jobs no vehicle could take
+struct FleetSolution {
+  std::vector<FleetRoute> routes;
+  std::vector<uint32_t> unassigned;
+};
+
+/**
+ * Assigns jobs to vehicles and orders the jobs of each vehicle (a vehicle
+ * routing problem with capacities and time windows). Vehicles start at their
+ * start location at the start of their shift and must reach their end location
+ * (or finish their last job if they have none) by the end of it. The total
+ * demand of the jobs of a vehicle must not exceed its capacity and the service
+ * of a job must start within its time window, vehicles wait when early.
+ *
+ * Jobs are assigned by regret insertion: the job whose best insertion is the
+ * most ahead of its best insertion in any other vehicle is inserted first. The
+ * routes are then improved by local search until no move reduces the total
+ * travel time: relocating a job, swapping 2 jobs, exchanging the ends of 2
+ * routes (2-opt*) and reversing part of a route (2-opt). Jobs that could not be
+ * assigned are tried again after each local search. Results are deterministic.
+ */
+class FleetOptimizer {
+public:
+  /**
+   * Assign jobs to vehicles and order them.
+   * @param  count     Number of locations.
+   * @param  costs     2-D matrix of travel times between locations. Pairs that
+   *                   can not be reached have infinite cost.
+   * @param  vehicles  Vehicles, referencing locations by index.
+   * @param  jobs      Jobs, referencing locations by index.
+   * @return Returns the routes of the vehicles and the unassigned jobs.
+   */
+  FleetSolution Solve(const uint32_t count,
+                      const std::vector<float>& costs,
+                      const google::protobuf::RepeatedPtrField<Vehicle>& vehicles,
+                      const google::protobuf::RepeatedPtrField<Job>& jobs);
+
+protected:
+  uint32_t count_;
+  const std::vector<float>* costs_;
+  const google::protobuf::RepeatedPtrField<Vehicle>* vehicles_;
+  const google::protobuf::RepeatedPtrField<Job>* jobs_;
+
+  std::vector<std::vector<uint32_t>> tours_; // Jobs of each vehicle in order
+  std::vector<float> tour_costs_;            // Travel time of each vehicle
+  std::vector<uint32_t> unassigned_;         // Jobs not assigned to a vehicle
+
+  /**
+   * Get the travel time of a vehicle doing a sequence of jobs.
+   * @param  vehicle   Index of the vehicle.
+   * @param  tour      Jobs in the order they are done.
+   * @param  arrivals  If not null, gets the arrival time at each job.
+   * @return Returns the travel time or infinity if the tour is not feasible.
+   */
+  float TourCost(const uint32_t vehicle,
+                 const std::vector<uint32_t>& tour,
+                 std::vector<uint32_t>* arrivals = nullptr) const;
+
+  /**
+   * Insert unassigned jobs by regret insertion until none can be inserted.
+   * @return Returns true if any job was inserted.
+   */
+  bool Insert();
+
+  /**
+   * Improve the routes with relocate, swap, 2-opt* and 2-opt moves until none
+   * of them reduces the total travel time.
+   */
+  void LocalSearch();
+
+  /**
+   * Apply the first improving move of each kind.
+   * @return Returns true if a move was applied.
+   */
+  bool Relocate();
+  bool Swap();
+  bool TwoOptStar();
+  bool TwoOpt();
+
+  /**
+   * Replace the tours of 2 vehicles if it reduces the total travel time.
+   * @return Returns true if the tours were replaced.
+   */
+  bool Improve(const uint32_t a,
+               std::vector<uint32_t>& tour_a,
+               const uint32_t b,
+               std::vector<uint32_t>& tour_b);
+
+  /**
+   * Get the cost between two locations.
+   */
+  float Cost(const uint32_t loc1, const uint32_t loc2) const {
+    return (*costs_)[(loc1 * count_) + loc2];
+  }
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_FLEETOPTIMIZER_H_
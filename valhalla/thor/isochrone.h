@@ -2,6 +2,7 @@
 #define VALHALLA_THOR_ISOCHRONE_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -17,6 +18,8 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/searchmemory.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -43,6 +46,29 @@ public:
    */
   void Clear();
 
+  /**
+   * Get the counters of the search of the last computed grid.
+   * @return Returns the search counters.
+   */
+  SearchStats stats() const;
+
+  /**
+   * Set a callback that will throw when the isochrone computation should be aborted
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Set the memory budget the search reports to.
+   * @param memory  the budget, nullptr to not account for memory
+   */
+  void set_memory(SearchMemory* memory) {
+    memory_ = memory;
+  }
+
   /**
    * Compute an isochrone grid. This creates and populates a lat,lon grid with
    * time taken to reach each grid point. This gridded data is then contoured
@@ -127,6 +153,19 @@ protected:
   // Isochrone gridded time data
   std::shared_ptr<midgard::GriddedData<midgard::PointLL>> isotile_;
 
+  // Interrupt callback, called every so many labels expanded
+  const std::function<void()>* interrupt_;
+
+  // Memory budget and the bytes last reported by the search
+  SearchMemory* memory_;
+  size_t memory_held_;
+
+  /**
+   * Report the bytes held by the edge labels, adjacency list and edge status
+   * to the memory budget, if any.
+   */
+  void UpdateMemory();
+
   /**
    * Initialize prior to computing the isochrones. Creates adjacency list,
    * edgestatus support, and reserves edgelabels.
@@ -160,7 +199,8 @@ protected:
                         google::protobuf::RepeatedPtrField<valhalla::Location>& origin_locations);
 
   /**
-   * Expand from the node along the forward search path.
+   * Expand from the node along the forward search path. CostT is the type of
+   * the costing, or sif::DynamicCost to call the costing virtually.
    * @param graphreader  Graph reader.
    * @param node Graph Id of the node to expand.
    * @param pred Edge label of the predecessor edge leading to the node.
@@ -169,6 +209,7 @@ protected:
    * @param localtime Current local time.  Seconds since epoch.
    * @param seconds_of_week For time dependent isochrones this allows lookup of predicted traffic.
    */
+  template <class CostT>
   void ExpandForward(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      const sif::EdgeLabel& pred,
@@ -178,7 +219,8 @@ protected:
                      int32_t seconds_of_week);
 
   /**
-   * Expand from the node along the reverse search path.
+   * Expand from the node along the reverse search path. CostT is the type of
+   * the costing, or sif::DynamicCost to call the costing virtually.
    * @param graphreader  Graph reader.
    * @param node Graph Id of the node to expand.
    * @param pred Edge label of the predecessor edge leading to the node.
@@ -187,6 +229,7 @@ protected:
    * @param localtime Current local time.  Seconds since epoch.
    * @param seconds_of_week For time dependent isochrones this allows lookup of predicted traffic.
    */
+  template <class CostT>
   void ExpandReverse(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node,
                      const sif::BDEdgeLabel& pred,
@@ -63,6 +63,12 @@ public:
    */
   void Clear();
 
+  /**
+   * Get the counters of the search since it was last initialized.
+   * @return Returns the search counters.
+   */
+  SearchStats stats() const override;
+
 protected:
   // Current walking distance.
   uint32_t walking_distance_;
@@ -104,6 +110,12 @@ protected:
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
+  /**
+   * Report the bytes held by the edge labels, adjacency list and edge status
+   * to the memory budget, if any.
+   */
+  void UpdateMemory();
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -15,6 +15,16 @@ namespace thor {
 // setting too high takes longer to converge on a solution.
 constexpr float kCoolingRate = 0.93f;
 
+// Number of nearest locations (by cost, in each direction) considered when
+// looking for improvements of a tour.
+constexpr uint32_t kNeighborCount = 10;
+
+// Number of restarts (perturbed local searches) and the number of perturbations
+// tried in each restart per location.
+constexpr uint32_t kRestarts = 4;
+constexpr uint32_t kPerturbationsPerLocation = 10;
+constexpr uint32_t kMaxPerturbations = 2000;
+
 // Alteration type.
 // kRotate  - Alters a portion of the tour by rotating the locations about
 //            a middle point. The middle location becomes the new start
@@ -32,12 +42,25 @@ struct TourAlteration {
 };
 
 /**
- * Optimization method using simulated annealing. Optimizes the order of
- * locations - keeping the first location (origin) and last location
- * (destination) fixed.
+ * Optimizes the order of locations - keeping the first location (origin) and
+ * last location (destination) fixed. The cost matrix does not need to be
+ * symmetric.
+ *
+ * Solve builds a tour by cheapest insertion and improves it with local search:
+ * 2-opt (segment reversal) and Or-opt (moving a segment of up to 3 locations,
+ * a restricted 3-opt) limited to the nearest neighbors of each location, with
+ * don't look bits so only locations near a change are looked at again. It then
+ * restarts a few times from the improved tour, each restart perturbing the best
+ * tour it has found (a random segment exchange) and searching again. Restarts
+ * use their own seeded random numbers and can run on multiple threads; results
+ * do not depend on the number of threads unless a time budget stops them.
+ *
+ * SolveAnnealing is the former simulated annealing solver.
  */
 class Optimizer {
 public:
+  Optimizer();
+
   /**
    * Optimize the tour through a set of locations given the cost matrix
    * among all locations. The first location (origin) and last location
@@ -49,19 +72,62 @@ public:
    */
   std::vector<uint32_t> Solve(const uint32_t count, const std::vector<float>& costs);
 
+  /**
+   * Optimize the tour with simulated annealing. Slower and results depend on
+   * the random numbers. Kept for comparison.
+   * @param  count  Number of locations.
+   * @param  costs  2-D cost matrix.
+   * @return Returns the tour as an updated order of locations visited to
+   *         complete the tour.
+   */
+  std::vector<uint32_t> SolveAnnealing(const uint32_t count, const std::vector<float>& costs);
+
   /**
    * Seed the random number generator. This is used by tests to create a
    * repeatable sequence.
    * @param  seed  Seed to use for the random number generator.
    */
   void Seed(const uint32_t seed) {
+    seed_ = seed;
     random_generator_.seed(seed);
   }
 
+  /**
+   * Set the number of threads running restarts.
+   * @param  threads  Number of threads (1 runs them on the calling thread).
+   */
+  void set_threads(const uint32_t threads) {
+    threads_ = std::max(threads, 1u);
+  }
+
+  /**
+   * Set a time budget for the restarts. Restarts stop when it is exceeded,
+   * which makes results depend on the speed of the machine.
+   * @param  milliseconds  Time budget in milliseconds, 0 for none.
+   */
+  void set_time_budget(const uint32_t milliseconds) {
+    time_budget_ = milliseconds;
+  }
+
+  /**
+   * Get the cost for the specified tour (order of locations).
+   * @param  count  Number of locations.
+   * @param  costs  2-D cost array between locations.
+   * @param  tour   Order that locations are traversed.
+   * @return Returns the total cost for the tour.
+   */
+  static float TourCost(const uint32_t count,
+                        const std::vector<float>& costs,
+                        const std::vector<uint32_t>& tour);
+
 protected:
   // Random number generation: 0 <= r < 1
   std::mt19937_64 random_generator_;
   std::uniform_real_distribution<float> uniform_distribution_{0.0, 1.0};
+  uint32_t seed_;
+
+  uint32_t threads_;     // # of threads running restarts
+  uint32_t time_budget_; // Time budget for restarts in ms (0 is none)
 
   uint32_t ntry_;                   // # of attempts (for debugging)
   uint32_t count_;                  // # of locations
@@ -71,6 +137,21 @@ protected:
   std::vector<uint32_t> tour_;      // Current tour (order of locations)
   std::vector<uint32_t> best_tour_; // Best tour so far
 
+  /**
+   * Solve the trivial cases (up to 4 locations).
+   * @param  costs  2-D cost matrix.
+   * @return Returns the tour or an empty tour if the case is not trivial.
+   */
+  std::vector<uint32_t> SolveTrivial(const std::vector<float>& costs) const;
+
+  /**
+   * Build a tour by cheapest insertion: starting from the origin and the
+   * destination repeatedly insert the location which adds the least cost.
+   * @param  costs  2-D cost matrix.
+   * @return Returns the tour.
+   */
+  std::vector<uint32_t> CheapestInsertion(const std::vector<float>& costs) const;
+
   /*
    * Perform the annealing process.
    * @param  costs        2-D cost matrix.
@@ -106,7 +187,9 @@ protected:
    * @param  tour   Order that locations are traversed.
    * @return Returns the total cost for the tour.
    */
-  float TourCost(const std::vector<float>& costs, const std::vector<uint32_t>& tour) const;
+  float TourCost(const std::vector<float>& costs, const std::vector<uint32_t>& tour) const {
+    return TourCost(count_, costs, tour);
+  }
 
   // ------------------------ Convenience methods (inline) ---------------- //
 
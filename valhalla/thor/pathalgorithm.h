@@ -7,12 +7,18 @@
 #include <utility>
 #include <vector>
 
+#include <valhalla/baldr/arcflags.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/midgard/distanceapproximator.h>
+#include <valhalla/midgard/util.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/searchmemory.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -29,7 +35,9 @@ public:
   /**
    * Constructor
    */
-  PathAlgorithm() : interrupt(nullptr), has_ferry_(false), expansion_callback_() {
+  PathAlgorithm()
+      : interrupt(nullptr), has_ferry_(false), use_arcflags_(false), memory_(nullptr),
+        memory_held_(0), expansion_callback_() {
   }
 
   /**
@@ -62,6 +70,13 @@ public:
    */
   virtual void Clear() = 0;
 
+  /**
+   * Get the counters of the search since it was last initialized (so of the
+   * last call to GetBestPath until the next one or Clear).
+   * @return Returns the search counters.
+   */
+  virtual SearchStats stats() const = 0;
+
   /**
    * Set a callback that will throw when the path computation should be aborted
    * @param interrupt_callback  the function to periodically call to see if
@@ -71,6 +86,14 @@ public:
     interrupt = interrupt_callback;
   }
 
+  /**
+   * Set the memory budget the search reports to.
+   * @param memory  the budget, nullptr to not account for memory
+   */
+  void set_memory(SearchMemory* memory) {
+    memory_ = memory;
+  }
+
   /**
    * Does the path include a ferry?
    * @return  Returns true if the path includes a ferry.
@@ -79,6 +102,16 @@ public:
     return has_ferry_;
   }
 
+  /**
+   * Enable pruning of the expansion using arc flags (if the tiles have them).
+   * Arc flags are computed for a baseline costing so this should only be enabled
+   * for requests using that costing.
+   * @param  use_arcflags  True to skip edges not on a shortest path to the target region.
+   */
+  void set_use_arcflags(const bool use_arcflags) {
+    use_arcflags_ = use_arcflags;
+  }
+
   /**
    * Sets the functor which will track the algorithms expansion.
    *
@@ -96,6 +129,12 @@ protected:
 
   bool has_ferry_; // Indicates whether the path has a ferry
 
+  bool use_arcflags_; // Prune expansion using arc flags
+
+  // Memory budget and the bytes last reported by the search
+  SearchMemory* memory_;
+  size_t memory_held_;
+
   // for tracking the expansion of the algorithm visually
   expansion_callback_t expansion_callback_;
 
@@ -124,6 +163,94 @@ protected:
     return false;
   }
 
+  /**
+   * Get the arc flag mask used to prune expansion towards (or from) a location. For the
+   * forward search the region of the node at the start of each destination edge is used,
+   * for the reverse search the region of the node at the end of each origin edge. The flags
+   * only cover the highway and arterial levels, so the regions of their nodes within the
+   * distance the local level is expanded from the location are added: a route can join or
+   * leave the arterial levels on local roads there. Returns all flags set (no pruning) if
+   * arc flags are disabled or any region is unknown.
+   * @param  graphreader  Graph reader.
+   * @param  location     Destination (forward) or origin (reverse) location.
+   * @param  forward      True for the forward search, false for the reverse search.
+   * @param  radius       Distance (meters) the local level is expanded from the location.
+   * @return Returns the mask to test edge arc flags against.
+   */
+  uint64_t GetArcFlagsMask(baldr::GraphReader& graphreader,
+                           const valhalla::Location& location,
+                           const bool forward,
+                           const float radius) {
+    if (!use_arcflags_ || location.path_edges_size() == 0) {
+      return baldr::kAllArcFlags;
+    }
+    uint64_t mask = 0;
+    auto add_region = [&mask, forward](const uint8_t region) {
+      if (region == baldr::kNoArcFlagRegion) {
+        return false;
+      }
+      mask |= forward ? baldr::ForwardArcFlag(region) : baldr::ReverseArcFlag(region);
+      return true;
+    };
+    for (const auto& edge : location.path_edges()) {
+      // Get the node the search reaches the location through
+      const baldr::GraphTile* tile = graphreader.GetGraphTile(baldr::GraphId(edge.graph_id()));
+      if (tile == nullptr) {
+        return baldr::kAllArcFlags;
+      }
+      const baldr::DirectedEdge* directededge = tile->directededge(baldr::GraphId(edge.graph_id()));
+      baldr::GraphId node = directededge->endnode();
+      if (forward) {
+        const baldr::DirectedEdge* opp_edge =
+            graphreader.GetOpposingEdge(baldr::GraphId(edge.graph_id()), tile);
+        if (opp_edge == nullptr) {
+          return baldr::kAllArcFlags;
+        }
+        node = opp_edge->endnode();
+      }
+      tile = graphreader.GetGraphTile(node);
+      if (tile == nullptr || !add_region(tile->arcflag_region(node.id()))) {
+        return baldr::kAllArcFlags;
+      }
+
+      // Regions of the arterial nodes the local level reaches
+      const midgard::PointLL ll(edge.ll().lng(), edge.ll().lat());
+      const midgard::DistanceApproximator approximator(ll);
+      const auto box = midgard::ExpandMeters(ll, radius);
+      for (uint8_t level = 0; level < baldr::kArcFlagLevels; ++level) {
+        const auto& tiles = baldr::TileHierarchy::levels().find(level)->second.tiles;
+        for (auto tileid : tiles.TileList(box)) {
+          tile = graphreader.GetGraphTile(baldr::GraphId(tileid, level, 0));
+          for (uint32_t i = 0; tile != nullptr && i < tile->header()->nodecount(); ++i) {
+            const midgard::PointLL node_ll = tile->get_node_ll(baldr::GraphId(tileid, level, i));
+            if (approximator.DistanceSquared(node_ll) < radius * radius &&
+                !add_region(tile->arcflag_region(i))) {
+              return baldr::kAllArcFlags;
+            }
+          }
+        }
+      }
+    }
+    return mask;
+  }
+
+  /**
+   * The arc flags prune the expansion on the highway and arterial levels exactly, so
+   * stop limiting the expansion on them when the search is pruned by the flags.
+   * @param  limits  Hierarchy limits of the search.
+   * @param  mask    Arc flag mask of the search.
+   */
+  void RelaxArcFlagHierarchyLimits(std::vector<sif::HierarchyLimits>& limits,
+                                   const uint64_t mask) const {
+    if (mask == baldr::kAllArcFlags) {
+      return;
+    }
+    for (uint8_t level = 0; level < baldr::kArcFlagLevels && level < limits.size(); ++level) {
+      limits[level].max_up_transitions = kUnlimitedTransitions;
+      limits[level].expansion_within_dist = kMaxDistance;
+    }
+  }
+
   /**
    * Convenience method to get the timezone index at a node.
    * @param graphreader Graph reader.
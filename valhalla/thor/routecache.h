@@ -0,0 +1,115 @@
+#ifndef VALHALLA_THOR_ROUTECACHE_H_
+#define VALHALLA_THOR_ROUTECACHE_H_
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <valhalla/proto/api.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+// Seconds of wall clock time requests departing or arriving at the current
+// time share their cached routes
+constexpr std::time_t kRouteCacheCurrentTimeBucket = 60;
+
+/**
+ * Least recently used cache of route results. A result is the trip (the trip
+ * legs of every route) and the locations as changed by the route computation
+ * (date times propagated along the legs, ...), which are restored into the
+ * request on a hit so the path computation is skipped entirely.
+ *
+ * Results are keyed by the correlated locations (their edge candidates) and
+ * the options that change the trip legs: costing, costing options, avoids,
+ * date time, alternates and attribute filters. Date times are given to the
+ * minute, requests for the current time are bucketed by wall clock minute.
+ * The cache is emptied whenever the routing graph changes (its dataset id).
+ */
+class RouteCache {
+public:
+  /**
+   * Constructor.
+   * @param  max_entries  Maximum number of route results to keep.
+   */
+  explicit RouteCache(const size_t max_entries);
+
+  /**
+   * Returns the canonical key of the route results of a request: the options
+   * without the fields that only change the serialization of the response
+   * (id, format, units, language, ...). The locations must be correlated.
+   * @param  options  Request options.
+   * @param  now      Current wall clock time, used if the request is for the
+   *                  current time.
+   * @return Returns the key.
+   */
+  static std::string Key(const Options& options, const std::time_t now = std::time(nullptr));
+
+  /**
+   * Restore the cached route results of a request.
+   * @param  key         Key of the request, see Key.
+   * @param  dataset_id  Id of the routing graph. The cache is emptied if the
+   *                     graph changed.
+   * @param  request     Request to restore the trip and locations into.
+   * @return Returns true if the results were cached.
+   */
+  bool Get(const std::string& key, const uint64_t dataset_id, Api& request);
+
+  /**
+   * Cache the route results of a request, evicting the least recently used
+   * results if full.
+   * @param  key         Key of the request, see Key.
+   * @param  dataset_id  Id of the routing graph the results were computed on.
+   * @param  request     Request with the computed trip.
+   */
+  void Put(const std::string& key, const uint64_t dataset_id, const Api& request);
+
+  /**
+   * Returns the number of cached route results.
+   */
+  size_t size() const;
+
+  /**
+   * Returns the number of requests found in the cache.
+   */
+  uint64_t hits() const;
+
+  /**
+   * Returns the number of requests not found in the cache.
+   */
+  uint64_t misses() const;
+
+  /**
+   * Removes all route results.
+   */
+  void Clear();
+
+protected:
+  struct Entry {
+    Trip trip;
+    google::protobuf::RepeatedPtrField<Location> locations;
+  };
+  using entry_list_t = std::list<std::pair<std::string, Entry>>;
+
+  // Empty the cache if the routing graph changed. Must hold the lock.
+  void CheckDataset(const uint64_t dataset_id);
+
+  size_t max_entries_;
+  uint64_t dataset_id_;
+  uint64_t hits_;
+  uint64_t misses_;
+  mutable std::mutex mutex_;
+
+  // Entries from the most to the least recently used and their index by key
+  entry_list_t entries_;
+  std::unordered_map<std::string, entry_list_t::iterator> index_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_ROUTECACHE_H_
@@ -0,0 +1,100 @@
+#ifndef VALHALLA_THOR_SEARCHMEMORY_H_
+#define VALHALLA_THOR_SEARCHMEMORY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace thor {
+
+// Searches only report their memory once it changed by at least this many
+// bytes, so reports are rare compared to the labels expanded
+constexpr size_t kSearchMemoryReportBytes = 64 * 1024;
+
+/**
+ * Memory budget of the searches of a thor worker. Each search reports the
+ * approximate bytes held by its edge labels, adjacency list and edge status
+ * as it expands and releases them when it is cleared. The budget keeps the
+ * bytes held by the searches of the worker and by the searches of all workers
+ * of the process, and throws as soon as either exceeds its limit so a request
+ * fails before it can exhaust the memory of the machine. Searches may report
+ * from any thread.
+ */
+class SearchMemory {
+public:
+  /**
+   * Constructor.
+   * @param  request_limit  Maximum bytes the searches of the worker may hold,
+   *                        0 for no limit. The worker computes one request
+   *                        at a time so this is the limit of a request.
+   * @param  process_limit  Maximum bytes the searches of all workers of the
+   *                        process may hold together, 0 for no limit.
+   */
+  SearchMemory(const size_t request_limit = 0, const size_t process_limit = 0);
+
+  /**
+   * Report the bytes held by a search. Throws a valhalla_exception_t (447 or
+   * 448) if a limit is exceeded, the bytes are accounted for anyway so they
+   * are released when the search is cleared.
+   * @param  held   Bytes the search last reported, updated.
+   * @param  bytes  Bytes the search holds now.
+   */
+  void Update(size_t& held, const size_t bytes) {
+    if (bytes < held || bytes - held >= kSearchMemoryReportBytes) {
+      Set(held, bytes);
+    }
+  }
+
+  /**
+   * Release the bytes held by a search (when it is cleared).
+   * @param  held  Bytes the search last reported, set to 0.
+   */
+  void Release(size_t& held);
+
+  /**
+   * Release the bytes held by a list of searches.
+   * @param  held  Bytes each search last reported, all set to 0.
+   */
+  void Release(std::vector<size_t>& held);
+
+  /**
+   * Restart the peak from the bytes currently held, done between requests.
+   */
+  void ResetPeak();
+
+  /**
+   * Get the most bytes held by the searches of the worker since the peak was
+   * last reset.
+   */
+  size_t peak() const {
+    return peak_;
+  }
+
+  /**
+   * Get the bytes currently held by the searches of all workers of the process.
+   */
+  static size_t process_used() {
+    return process_used_;
+  }
+
+protected:
+  /**
+   * Account for the change of the bytes held by a search and check the limits.
+   */
+  void Set(size_t& held, const size_t bytes);
+
+  size_t request_limit_;
+  size_t process_limit_;
+  std::atomic<size_t> used_;
+  std::atomic<size_t> peak_;
+
+  // Bytes held by the searches of all workers of the process
+  static std::atomic<size_t> process_used_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_SEARCHMEMORY_H_
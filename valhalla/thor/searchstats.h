@@ -0,0 +1,47 @@
+#ifndef VALHALLA_THOR_SEARCHSTATS_H_
+#define VALHALLA_THOR_SEARCHSTATS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/sif/hierarchylimits.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Counters of the work done by searches. They are read from the adjacency
+ * lists and hierarchy limits the searches keep anyway so the expansion itself
+ * does not count anything.
+ */
+struct SearchStats {
+  uint64_t edges_settled = 0;   // Labels popped from the adjacency lists
+  uint64_t labels_created = 0;  // Labels added to the adjacency lists
+  uint64_t queue_decreases = 0; // Costs lowered in the adjacency lists
+  uint64_t transitions = 0;     // Upward hierarchy transitions
+
+  void Add(const SearchStats& stats) {
+    edges_settled += stats.edges_settled;
+    labels_created += stats.labels_created;
+    queue_decreases += stats.queue_decreases;
+    transitions += stats.transitions;
+  }
+
+  void Add(const baldr::DoubleBucketQueue& adjacencylist) {
+    edges_settled += adjacencylist.pops();
+    labels_created += adjacencylist.adds();
+    queue_decreases += adjacencylist.decreases();
+  }
+
+  void Add(const std::vector<sif::HierarchyLimits>& hierarchy_limits) {
+    for (const auto& limits : hierarchy_limits) {
+      transitions += limits.up_transition_count;
+    }
+  }
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_SEARCHSTATS_H_
@@ -140,6 +140,11 @@ protected:
   // bidirectional edge label structure.
   std::vector<sif::BDEdgeLabel> edgelabels_rev_;
 
+  /**
+   * Report the bytes held by the search, including the reverse edge labels.
+   */
+  virtual void UpdateMemory();
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -2,6 +2,7 @@
 #define VALHALLA_THOR_TIMEDISTANCEMATRIX_H_
 
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -18,6 +19,8 @@
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/searchmemory.h>
+#include <valhalla/thor/searchstats.h>
 
 namespace valhalla {
 namespace thor {
@@ -58,6 +61,11 @@ public:
    */
   TimeDistanceMatrix();
 
+  /**
+   * Destructor. Releases the memory of the search from the budget.
+   */
+  ~TimeDistanceMatrix();
+
   /**
    * One to many time and distance cost matrix. Computes time and distance
    * matrix from one origin location to many other locations.
@@ -138,11 +146,85 @@ public:
    */
   void Clear();
 
+  /**
+   * Get the counters of the searches of the last SourceToTarget.
+   * @return Returns the search counters.
+   */
+  SearchStats stats() const {
+    return stats_;
+  }
+
+  /**
+   * Set graph readers used to run the searches of SourceToTarget on additional
+   * threads, each with its own TimeDistanceMatrix. Each reader must only be
+   * used by one thread at a time, readers sharing a synchronized tile cache
+   * avoid loading tiles once per thread.
+   * @param  readers  Graph readers, one per additional thread.
+   */
+  void set_thread_readers(const std::vector<std::shared_ptr<baldr::GraphReader>>& readers) {
+    thread_readers_ = readers;
+  }
+
+  /**
+   * Let locations correlated to the same edges share a single search in
+   * SourceToTarget (their results are the same).
+   * @param  share  True to share searches.
+   */
+  void set_share_searches(const bool share) {
+    share_searches_ = share;
+  }
+
+  /**
+   * Set a function called by SourceToTarget with the matrix and the index of
+   * a source each time the row of that source is done. Rows of one to many
+   * searches are done as soon as their search (in any order), otherwise all at
+   * the end. Calls are never concurrent.
+   * @param  callback  Function called for each row.
+   */
+  void set_row_callback(
+      const std::function<void(const std::vector<TimeDistance>&, uint32_t)>& callback) {
+    row_callback_ = callback;
+  }
+
+  /**
+   * Set a callback that will throw when the matrix computation should be aborted.
+   * It is only called from the thread computing the matrix, searches on the
+   * additional threads stop once it threw.
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Set a thread safe callback that will throw when the matrix computation
+   * should be aborted, e.g. past the deadline of the request. The searches on
+   * the additional threads call it.
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_thread_interrupt(const std::function<void()>* interrupt_callback) {
+    thread_interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Set the memory budget the searches report to, including those on the
+   * additional threads.
+   * @param memory  the budget, nullptr to not account for memory
+   */
+  void set_memory(SearchMemory* memory) {
+    memory_ = memory;
+  }
+
 protected:
   // Number of destinations that have been found and settled (least cost path
   // computed).
   uint32_t settled_count_;
 
+  // Counters of the searches of SourceToTarget
+  SearchStats stats_;
+
   // The cost threshold being used for the currently executing query
   float current_cost_threshold_;
 
@@ -169,6 +251,31 @@ protected:
 
   sif::TravelMode mode_;
 
+  // Graph readers for additional threads
+  std::vector<std::shared_ptr<baldr::GraphReader>> thread_readers_;
+
+  // Share searches of locations correlated to the same edges
+  bool share_searches_;
+
+  // Called when a row of the matrix is done
+  std::function<void(const std::vector<TimeDistance>&, uint32_t)> row_callback_;
+
+  // Interrupt callback, called by the searches on this instance
+  const std::function<void()>* interrupt_;
+
+  // Thread safe interrupt callback, called by the searches on the additional threads
+  const std::function<void()>* thread_interrupt_;
+
+  // Memory budget and the bytes last reported by the search on this instance
+  SearchMemory* memory_;
+  size_t memory_held_;
+
+  /**
+   * Report the bytes held by the edge labels, adjacency list and edge status
+   * to the memory budget, if any.
+   */
+  void UpdateMemory();
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
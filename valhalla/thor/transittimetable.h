@@ -0,0 +1,173 @@
+#ifndef VALHALLA_THOR_TRANSITTIMETABLE_H_
+#define VALHALLA_THOR_TRANSITTIMETABLE_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+
+namespace valhalla {
+namespace thor {
+
+// Time (seconds) for an unreached stop
+constexpr uint32_t kUnreachedTime = std::numeric_limits<uint32_t>::max();
+
+/**
+ * A departure of one trip along one transit line edge: from the stop at the
+ * start of the edge to the stop at its end.
+ */
+struct TransitConnection {
+  uint32_t departure_time; // Seconds from midnight of the origin time zone
+  uint32_t arrival_time;   // Seconds from midnight of the origin time zone
+  uint32_t departure_stop; // Index of the stop the connection departs from
+  uint32_t arrival_stop;   // Index of the stop the connection arrives at
+  uint32_t line;           // Index of the line edge
+  uint32_t tripid;         // Trip Id (spans tiles)
+  uint32_t run;            // Run of frequency based trips, 0 for fixed trips
+  bool wheelchair_accessible;
+  bool bicycle_accessible;
+
+  // Key of the vehicle run the connection belongs to
+  uint64_t trip_key() const {
+    return (static_cast<uint64_t>(run) << 32) | tripid;
+  }
+};
+
+/**
+ * Earliest arrival at a stop after walking (or staying at the stop).
+ */
+struct StopArrival {
+  uint32_t time = kUnreachedTime; // Seconds from midnight of the origin time zone
+  float cost = 0.0f;              // Cost of the path to the stop
+  uint32_t label = 0;             // Label of the walk reaching the stop
+};
+
+/**
+ * Earliest arrival at a stop on a trip.
+ */
+struct TripArrival {
+  uint32_t time = kUnreachedTime; // Seconds from midnight of the origin time zone
+  float cost = 0.0f;              // Cost of the path to the stop
+  uint32_t connection = 0;        // Connection arriving at the stop
+  uint32_t boarding = 0;          // Connection where the trip was boarded
+};
+
+/**
+ * Timetable of the transit connections of a region on one service day, built
+ * from the departures of the transit tiles. Connections are sorted by their
+ * departure time so a round of the connection scan is one pass over them.
+ * Stops are the transit platform nodes, lines the transit line edges.
+ */
+class TransitTimetable {
+public:
+  /**
+   * Build the timetable of the transit tiles covering a bounding box.
+   * @param  graphreader  Graph reader.
+   * @param  tiles        Ids of the transit tiles of the region.
+   * @param  date_time    Local date and time at the origin.
+   * @param  origin_tz    Time zone index of the origin. Departures at stops in
+   *                      other time zones are converted to it.
+   */
+  TransitTimetable(baldr::GraphReader& graphreader,
+                   const std::vector<baldr::GraphId>& tiles,
+                   const std::string& date_time,
+                   const int origin_tz);
+
+  /**
+   * Constructor of an empty timetable, connections are added with Add.
+   */
+  TransitTimetable() = default;
+
+  /**
+   * Add a stop.
+   * @param  node  Transit platform node.
+   * @return Returns the index of the stop.
+   */
+  uint32_t AddStop(const baldr::GraphId& node);
+
+  /**
+   * Add a line.
+   * @param  edgeid  Transit line edge.
+   * @return Returns the index of the line.
+   */
+  uint32_t AddLine(const baldr::GraphId& edgeid);
+
+  /**
+   * Add a connection. Sort must be called once all are added.
+   * @param  connection  Connection between two stops.
+   */
+  void Add(const TransitConnection& connection);
+
+  /**
+   * Sort the connections by departure time.
+   */
+  void Sort();
+
+  /**
+   * Run one round of the connection scan: take one more trip from the stops
+   * reached by the previous round. A trip can be boarded at a stop reached by
+   * the time it departs, it then arrives at all its later stops.
+   * @param  from          Arrivals at the stops reached after walking from the
+   *                       previous round (indexed by stop).
+   * @param  start_time    Time the route starts, earlier connections are skipped.
+   * @param  transfer      Cost added when boarding a trip.
+   * @param  allowed       Lines allowed by the costing (indexed by line).
+   * @param  wheelchair    Only take wheelchair accessible connections.
+   * @param  bicycle       Only take bicycle accessible connections.
+   * @param  to            Arrivals at the stops on the trips taken (indexed by
+   *                       stop, must be unreached on input).
+   * @return Returns true if any stop was reached.
+   */
+  bool ScanRound(const std::vector<StopArrival>& from,
+                 const uint32_t start_time,
+                 const float transfer,
+                 const std::vector<bool>& allowed,
+                 const bool wheelchair,
+                 const bool bicycle,
+                 std::vector<TripArrival>& to) const;
+
+  /**
+   * Get the connections of the trip taken to a stop, from boarding to arrival.
+   * @param  arrival  Arrival at the stop on a trip.
+   * @return Returns the indexes of the connections in order.
+   */
+  std::vector<uint32_t> TripConnections(const TripArrival& arrival) const;
+
+  /**
+   * Get the index of a stop.
+   * @param  node  Transit platform node.
+   * @return Returns the index, or kUnreachedTime if not a stop of the timetable.
+   */
+  uint32_t stop_index(const baldr::GraphId& node) const {
+    auto found = stop_index_.find(node);
+    return found == stop_index_.end() ? kUnreachedTime : found->second;
+  }
+
+  const std::vector<TransitConnection>& connections() const {
+    return connections_;
+  }
+
+  const std::vector<baldr::GraphId>& stops() const {
+    return stops_;
+  }
+
+  const std::vector<baldr::GraphId>& lines() const {
+    return lines_;
+  }
+
+protected:
+  std::vector<TransitConnection> connections_;
+  std::vector<baldr::GraphId> stops_;
+  std::vector<baldr::GraphId> lines_;
+  std::unordered_map<baldr::GraphId, uint32_t> stop_index_;
+  std::unordered_map<baldr::GraphId, uint32_t> line_index_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_TRANSITTIMETABLE_H_
@@ -1,7 +1,12 @@
 #ifndef __VALHALLA_THOR_SERVICE_H__
 #define __VALHALLA_THOR_SERVICE_H__
 
+#include <chrono>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <tuple>
 #include <vector>
 
@@ -20,9 +25,14 @@
 #include <valhalla/thor/astar.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/bidirectional_astar.h>
+#include <valhalla/thor/connectionscan.h>
+#include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/isochrone.h>
 #include <valhalla/thor/match_result.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/routecache.h>
+#include <valhalla/thor/searchmemory.h>
+#include <valhalla/thor/searchstats.h>
 #include <valhalla/thor/timedep.h>
 #include <valhalla/thor/triplegbuilder.h>
 #include <valhalla/tyr/actor.h>
@@ -37,7 +47,12 @@ void run_service(const boost::property_tree::ptree& config);
 
 class thor_worker_t : public service_worker_t {
 public:
-  enum SOURCE_TO_TARGET_ALGORITHM { SELECT_OPTIMAL = 0, COST_MATRIX = 1, TIME_DISTANCE_MATRIX = 2 };
+  enum SOURCE_TO_TARGET_ALGORITHM {
+    SELECT_OPTIMAL = 0,
+    COST_MATRIX = 1,
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3
+  };
   thor_worker_t(const boost::property_tree::ptree& config,
                 const std::shared_ptr<baldr::GraphReader>& graph_reader = {});
   virtual ~thor_worker_t();
@@ -50,23 +65,78 @@ public:
 
   void route(Api& request);
   std::string matrix(Api& request);
+  /**
+   * Compute a matrix writing it as json lines, the header first and then each
+   * row (rows may be written in any order). Only the time distance matrix writes
+   * a row as soon as its search is done, the cost and bucket matrices write all
+   * rows once the whole matrix is computed. The times and distances of all pairs
+   * are held either way, only the serialization is done row by row.
+   * @param request  the matrix request
+   * @param writer   called with each line
+   */
+  void matrix(Api& request, const std::function<void(const std::string&)>& writer);
   void optimized_route(Api& request);
+  void optimized_routes(Api& request);
   std::string isochrones(Api& request);
+  std::string batch_isochrones(Api& request);
+  /**
+   * Compute the isochrones of each location separately writing them as json
+   * lines, one feature collection per origin as soon as it is done (origins may
+   * be written in any order).
+   * @param request  the batch isochrone request
+   * @param writer   called with each line
+   */
+  void batch_isochrones(Api& request, const std::function<void(const std::string&)>& writer);
   void trace_route(Api& request);
   std::string trace_attributes(Api& request);
   std::string expansion(Api& request);
 
 protected:
+  std::vector<TimeDistance>
+  compute_matrix(Api& request,
+                 const std::function<void(const std::vector<TimeDistance>&, uint32_t)>& row_done);
   std::vector<std::vector<thor::PathInfo>> get_path(PathAlgorithm* path_algorithm,
                                                     Location& origin,
                                                     Location& destination,
                                                     const std::string& costing,
                                                     const Options& options);
+  std::vector<std::vector<thor::PathInfo>> get_path(PathAlgorithm* path_algorithm,
+                                                    Location& origin,
+                                                    Location& destination,
+                                                    const std::string& costing,
+                                                    const Options& options,
+                                                    baldr::GraphReader& graphreader,
+                                                    const sif::cost_ptr_t* costings);
+  // A route leg computed ahead of the sequential pass over the locations. Keeps the
+  // locations as they were so the leg is only used if an earlier leg did not change
+  // their candidate edges or time.
+  struct leg_paths_t {
+    bool computed = false;
+    Location origin_start;
+    Location destination_start;
+    Location origin;
+    Location destination;
+    std::vector<std::vector<thor::PathInfo>> paths;
+    std::exception_ptr error;
+    bool take(Location& origin,
+              Location& destination,
+              std::vector<std::vector<thor::PathInfo>>& leg_paths);
+  };
+  std::vector<leg_paths_t> compute_legs(Api& api, const std::string& costing, bool arrive_by);
   void log_admin(const TripLeg&);
   sif::cost_ptr_t get_costing(const Costing costing, const Options& options);
+  struct leg_router_t;
+  /**
+   * Get the path algorithm for a pair of locations.
+   * @param router  the leg router of the thread computing the leg, nullptr for the
+   *                searches of the worker. Legs only use A* or bidirectional A*,
+   *                compute_legs leaves multimodal and time dependent legs to the worker.
+   */
   thor::PathAlgorithm* get_path_algorithm(const std::string& routetype,
                                           const Location& origin,
-                                          const Location& destination);
+                                          const Location& destination,
+                                          const Options& options,
+                                          leg_router_t* router = nullptr);
   void route_match(Api& request);
   std::vector<std::tuple<float, float, std::vector<thor::MatchResult>>> map_match(Api& request);
   void path_map_match(const std::vector<meili::MatchResult>& match_results,
@@ -77,6 +147,31 @@ protected:
   void path_arrive_by(Api& api, const std::string& costing);
   void path_depart_at(Api& api, const std::string& costing);
 
+  /**
+   * Add the counters of a search to the stats of the request.
+   * @param stats  the counters of the search
+   * @param start  when the search started, the time since is added to the search time
+   */
+  void add_search_stats(const SearchStats& stats,
+                        const std::chrono::steady_clock::time_point& start);
+  /**
+   * Add the time since the contour generation started to the stats of the request.
+   */
+  void add_contour_stats(const std::chrono::steady_clock::time_point& start);
+  /**
+   * Set the stats of the request (since the last cleanup) if it asked for them.
+   */
+  void set_search_stats(Api& request);
+  /**
+   * Get the tile lookups and cache misses of all the graph readers.
+   */
+  std::pair<uint64_t, uint64_t> tile_counts() const;
+  /**
+   * Get the dataset id of the routing graph at the first correlated location,
+   * 0 if it has no edges.
+   */
+  uint64_t dataset_id(const Options& options) const;
+
   void parse_locations(Api& request);
   void parse_measurements(const Api& request);
   std::string parse_costing(const Api& request);
@@ -90,10 +185,14 @@ protected:
   std::vector<meili::Measurement> trace;
   sif::CostFactory<sif::DynamicCost> factory;
   sif::cost_ptr_t mode_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+  // Memory budget of the route, matrix and isochrone searches, declared before
+  // them so it outlives the searches releasing their memory from it
+  SearchMemory search_memory;
   // Path algorithms (TODO - perhaps use a map?))
   AStarPathAlgorithm astar;
   BidirectionalAStar bidir_astar;
   MultiModalPathAlgorithm multi_modal_astar;
+  ConnectionScan connection_scan;
   TimeDepForward timedep_forward;
   TimeDepReverse timedep_reverse;
   Isochrone isochrone_gen;
@@ -102,8 +201,42 @@ protected:
   float max_timedep_distance;
   std::unordered_map<std::string, float> max_matrix_distance;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  bool use_arcflags;
   meili::MapMatcherFactory matcher_factory;
   std::shared_ptr<baldr::GraphReader> reader;
+  std::shared_ptr<baldr::GraphReader> reverse_reader;
+  // Graph reader and path algorithms for each thread computing route legs
+  struct leg_router_t {
+    std::shared_ptr<baldr::GraphReader> reader;
+    AStarPathAlgorithm astar;
+    BidirectionalAStar bidir_astar;
+  };
+  std::vector<std::unique_ptr<leg_router_t>> leg_routers;
+  // Graph readers for the additional threads expanding cost matrix searches
+  std::vector<std::shared_ptr<baldr::GraphReader>> matrix_readers;
+  bool matrix_share_searches;
+  uint32_t bucket_matrix_max_labels;
+  uint32_t optimizer_concurrency;
+  uint32_t optimizer_time_budget;
+  uint32_t contour_concurrency;
+  // Graph reader and isochrone search for each additional thread of batch isochrones
+  struct isochrone_generator_t {
+    std::shared_ptr<baldr::GraphReader> reader;
+    Isochrone isochrone;
+  };
+  std::vector<std::unique_ptr<isochrone_generator_t>> isochrone_generators;
+  // Results of earlier route requests, empty if not caching
+  std::shared_ptr<RouteCache> route_cache;
+  // Counters of the searches of the request, searches on other threads add to
+  // them under the lock. The tile counts are those of the readers at the start.
+  struct request_stats_t {
+    SearchStats search;
+    double search_ms = 0.0;
+    double contour_ms = 0.0;
+    std::pair<uint64_t, uint64_t> tiles_start;
+  };
+  request_stats_t request_stats;
+  std::mutex request_stats_lock;
   AttributesController controller;
 };
 
@@ -18,10 +18,29 @@ public:
                      const std::function<void()>& interrupt = []() -> void {});
   std::string matrix(const std::string& request_str,
                      const std::function<void()>& interrupt = []() -> void {});
+  /**
+   * Compute a matrix writing it as json lines: a header line (units, locations and
+   * id) and then one line per source row. See thor_worker_t::matrix for when the
+   * rows are written.
+   */
+  void matrix(const std::string& request_str,
+              const std::function<void()>& interrupt,
+              const std::function<void(const std::string&)>& writer);
   std::string optimized_route(const std::string& request_str,
                               const std::function<void()>& interrupt = []() -> void {});
+  std::string optimized_routes(const std::string& request_str,
+                               const std::function<void()>& interrupt = []() -> void {});
   std::string isochrone(const std::string& request_str,
                         const std::function<void()>& interrupt = []() -> void {});
+  std::string batch_isochrone(const std::string& request_str,
+                              const std::function<void()>& interrupt = []() -> void {});
+  /**
+   * Compute the isochrones of each location separately writing them as json
+   * lines: one feature collection per origin as soon as the origin is done.
+   */
+  void batch_isochrone(const std::string& request_str,
+                       const std::function<void()>& interrupt,
+                       const std::function<void(const std::string&)>& writer);
   std::string trace_route(const std::string& request_str,
                           const std::function<void()>& interrupt = []() -> void {});
   std::string trace_attributes(const std::string& request_str,
@@ -35,6 +35,25 @@ std::string serializeMatrix(const Api& request,
                             const std::vector<thor::TimeDistance>& time_distances,
                             double distance_scale);
 
+/**
+ * Turn a time distance matrix request into the first line of a json lines
+ * matrix response (units, locations and id). Each row follows as its own line.
+ */
+std::string serializeMatrixHeader(const Api& request);
+
+/**
+ * Turn one source row of a time distance matrix into a line of a json lines
+ * matrix response. Rows can be written in any order as soon as they are done.
+ * @param request         the matrix request
+ * @param time_distances  the matrix (only the row of the source is read)
+ * @param source_index    index of the source whose row to serialize
+ * @param distance_scale  scale of distances (units)
+ */
+std::string serializeMatrixRow(const Api& request,
+                               const std::vector<thor::TimeDistance>& time_distances,
+                               size_t source_index,
+                               double distance_scale);
+
 /**
  * Turn grid data contours into geojson
  *
@@ -49,6 +68,31 @@ serializeIsochrones(const Api& request,
                     const std::unordered_map<float, std::string>& colors = {},
                     bool show_locations = false);
 
+/**
+ * Turn the contours of one origin of a batch isochrone request into a line of
+ * a json lines response: a feature collection with the index of the origin.
+ *
+ * @param origin_index     index of the origin in the request locations
+ * @param grid_contours    the contours generated from the grid of the origin
+ * @param colors           the #ABC123 hex string color used in geojson fill color
+ */
+template <class coord_t>
+std::string
+serializeBatchIsochrone(const Api& request,
+                        size_t origin_index,
+                        const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
+                        bool polygons = true,
+                        const std::unordered_map<float, std::string>& colors = {},
+                        bool show_locations = false);
+
+/**
+ * Turn the error of one origin of a batch isochrone request into a line of a
+ * json lines response so the other origins are still returned.
+ */
+std::string serializeBatchIsochroneError(const Api& request,
+                                         size_t origin_index,
+                                         const valhalla_exception_t& error);
+
 /**
  * Turn heights and ranges into a height response
  *
@@ -28,6 +28,8 @@ const std::string& Options_Units_Enum_Name(const Options::Units unit);
 bool FilterAction_Enum_Parse(const std::string& action, FilterAction* a);
 const std::string& FilterAction_Enum_Name(const FilterAction action);
 bool DirectionsType_Enum_Parse(const std::string& dtype, DirectionsType* t);
+bool Options_TransitAlgorithm_Enum_Parse(const std::string& algorithm,
+                                         Options::TransitAlgorithm* a);
 bool PreferredSide_Enum_Parse(const std::string& pside, valhalla::Location::PreferredSide* p);
 
 const std::unordered_map<unsigned, std::string>
@@ -43,6 +45,7 @@ const std::unordered_map<unsigned, std::string>
                  "Insufficiently specified required parameter 'locations' or 'sources & targets'"},
                 {113, "Insufficiently specified required parameter 'contours'"},
                 {114, "Insufficiently specified required parameter 'shape' or 'encoded_polyline'"},
+                {115, "Insufficiently specified required parameter 'vehicles'"},
 
                 {120, "Insufficient number of locations provided"},
                 {121, "Insufficient number of sources provided"},
@@ -59,6 +62,8 @@ const std::unordered_map<unsigned, std::string>
                 {134, "Failed to parse shape"},
                 {135, "Failed to parse trace"},
                 {136, "durations size not compatible with trace size"},
+                {137, "Failed to parse vehicle"},
+                {138, "Failed to parse job"},
 
                 {140, "Action does not support multimodal costing"},
                 {141, "Arrive by for multimodal not implemented yet"},
@@ -81,6 +86,7 @@ const std::unordered_map<unsigned, std::string>
                 {162, "Date and time is invalid.  Format is YYYY-MM-DDTHH:MM"},
                 {163, "Invalid date_type"},
                 {164, "Invalid shape format"},
+                {165, "Format is not supported by this action"},
 
                 {170, "Locations are in unconnected regions. Go check/edit the map at osm.org"},
                 {171, "No suitable edges near location"},
@@ -136,6 +142,9 @@ const std::unordered_map<unsigned, std::string>
                 {444, "Map Match algorithm failed to find path"},
                 {445, "Shape match algorithm specification in api request is incorrect. Please see "
                       "documentation for valid shape_match input."},
+                {446, "Request exceeded its timeout"},
+                {447, "Request exceeded the max search memory"},
+                {448, "Searches of all requests exceeded the max total search memory"},
 
                 {499, "Unknown"},
 
@@ -181,6 +190,10 @@ prime_server::worker_t::result_t to_response_json(const std::string& json,
 prime_server::worker_t::result_t to_response_xml(const std::string& xml,
                                                  prime_server::http_request_info_t& request_info,
                                                  const Api& options);
+// The whole body is sent in one message, prime_server workers cannot send chunks
+prime_server::worker_t::result_t to_response_jsonl(const std::string& jsonl,
+                                                   prime_server::http_request_info_t& request_info,
+                                                   const Api& options);
 #endif
 
 class service_worker_t {
@@ -220,8 +233,24 @@ public:
    */
   virtual void set_interrupt(const std::function<void()>& interrupt) final;
 
+  /**
+   * Enforce the deadline of the request, if it has one, through the interrupt function. Once the
+   * deadline has passed calling the interrupt throws a timeout error, right away if the request
+   * already waited past its deadline before getting here. The additional threads of the request
+   * check the deadline through thread_interrupt. Setting the interrupt again clears it
+   * @param  request  the request about to be worked on
+   */
+  virtual void set_deadline(const Api& request) final;
+
 protected:
   const std::function<void()>* interrupt;
+  // the interrupt function that was set and the one also checking the deadline of the request
+  const std::function<void()>* caller_interrupt;
+  std::function<void()> deadline_interrupt;
+  // only checks the deadline of the request (nullptr without one). Unlike the interrupt function
+  // that was set it is thread safe, so the additional threads of a request can call it
+  const std::function<void()>* thread_interrupt;
+  std::function<void()> deadline_check;
 };
 } // namespace valhalla
 